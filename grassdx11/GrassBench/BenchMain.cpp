@@ -0,0 +1,34 @@
+#include "GrassBench.h"
+
+#include <cstring>
+
+static BenchCase* s_pFirstCase = NULL;
+
+BenchCase::BenchCase (const char* a_sName, BenchFunc a_pFunc)
+{
+   sName = a_sName;
+   pFunc = a_pFunc;
+   pNext = s_pFirstCase;
+   s_pFirstCase = this;
+}
+
+double ElapsedMs (BenchClock::time_point a_tStart)
+{
+   return std::chrono::duration<double, std::milli>(BenchClock::now() - a_tStart).count();
+}
+
+int main (int argc, char* argv[])
+{
+   const char* sFilter = (argc > 1) ? argv[1] : NULL;
+
+   for (BenchCase* pCase = s_pFirstCase; pCase; pCase = pCase->pNext)
+   {
+      if (sFilter && !strstr(pCase->sName, sFilter))
+         continue;
+
+      printf("%s\n", pCase->sName);
+      pCase->pFunc();
+      printf("\n");
+   }
+   return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "includes.h"
+
+#include <chrono>
+#include <cstdio>
+
+/**
+Timings of the GrassDX11 code, no window and no device.
+A benchmark is a function registered with GRASS_BENCH, the runner calls all of them
+(or the ones whose name contains the first argument), each prints a tab separated table.
+Data files are read relative to the GrassDX11 directory, the debugger starts the runner there.
+Only the Release and Profile numbers mean anything
+*/
+typedef void (*BenchFunc)(void);
+
+struct BenchCase
+{
+   const char *sName;
+   BenchFunc   pFunc;
+   BenchCase  *pNext;
+
+   BenchCase (const char* a_sName, BenchFunc a_pFunc);
+};
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+/**
+return milliseconds since a_tStart
+*/
+double ElapsedMs (BenchClock::time_point a_tStart);
+
+#define GRASS_BENCH(name) \
+static void name (void); \
+static BenchCase s_##name##Case(#name, name); \
+static void name (void)
@@ -0,0 +1,122 @@
+#include "GrassBench.h"
+#include "GrassManager.h"
+
+#include <thread>
+
+/* the physics lod of main.cpp: 280 m of grass in 37 patches a side, 20 blades a patch side */
+#define PHYS_BENCH_TERR_RADIUS  400.0f
+#define PHYS_BENCH_PATCH_SIZE   (280.0f / 37.0f)
+#define PHYS_BENCH_BLADES_SIDE  20
+/* patches of the pool, a square around the origin */
+#define PHYS_BENCH_SIDE         8
+#define PHYS_BENCH_WARMUP       10
+#define PHYS_BENCH_STEPS        200
+
+/**
+What the pool steps against, without a device: flat terrain, still air
+and a trample over every patch, so the blades are simulated and not animated
+*/
+struct PhysBenchWorld
+{
+   TerrainHeightData              Height;
+   AirData                        Air;
+   TrampleField                   Trample;
+   GrassPatchLod0                 BasePatch;
+   std::vector<GrassPropsUnified> SubTypes;
+   IndexMapData                   IndexMap;
+   float                          fGridOrigin;
+
+   PhysBenchWorld (void);
+};
+
+PhysBenchWorld::PhysBenchWorld (void)
+   : Air(NULL, NULL)
+   , Trample(NULL, NULL, PHYS_BENCH_TERR_RADIUS, 0.5f)
+   , BasePatch(NULL, NULL, PHYS_BENCH_PATCH_SIZE, PHYS_BENCH_BLADES_SIDE)
+{
+   Height.uWidth = Height.uHeight = 2;
+   Height.fWidth = Height.fHeight = 2.0f;
+   Height.pData = new float[4];
+   Height.pNormals = new XMFLOAT3[4];
+   for (UINT i = 0; i < 4; i++)
+   {
+      Height.pData[i] = 0.0f;
+      Height.pNormals[i] = XMFLOAT3(0.0f, 1.0f, 0.0f);
+   }
+
+   GrassPropertiesT1 t1(L"config/T1SubTypes.cfg");
+   for (UINT i = 0; i < t1.GetDataNum(); i++)
+      SubTypes.push_back(t1.GetProperty(i));
+   IndexMap.pData = NULL;
+   IndexMap.uWidth = IndexMap.uHeight = 1;
+
+   fGridOrigin = -0.5f * (PHYS_BENCH_SIDE - 1) * PHYS_BENCH_PATCH_SIZE;
+   for (UINT z = 0; z < PHYS_BENCH_SIDE; z++)
+   {
+      for (UINT x = 0; x < PHYS_BENCH_SIDE; x++)
+      {
+         float3 vCenter = create(fGridOrigin + x * PHYS_BENCH_PATCH_SIZE, 0.0f, fGridOrigin + z * PHYS_BENCH_PATCH_SIZE);
+         Trample.Stamp(vCenter, PHYS_BENCH_PATCH_SIZE, create(1.0f, 0.0f, 0.0f));
+      }
+   }
+
+   PhysPatch::pHeightData = &Height;
+   PhysPatch::pAirData = &Air;
+   PhysPatch::fTerrRadius = PHYS_BENCH_TERR_RADIUS;
+   PhysPatch::fHeightScale = 1.0f;
+   PhysPatch::InvalidateStaticData();
+}
+
+/* a private pool with all the patches taken, bent by the trample */
+static GrassPool* TakeBenchPool (PhysBenchWorld& a_World)
+{
+   GrassPool* pPool = new GrassPool(&a_World.BasePatch, PHYS_BENCH_SIDE * PHYS_BENCH_SIDE);
+   pPool->SetPatchGrid(a_World.fGridOrigin);
+   pPool->SetTrampleField(&a_World.Trample);
+   for (UINT z = 0; z < PHYS_BENCH_SIDE; z++)
+   {
+      for (UINT x = 0; x < PHYS_BENCH_SIDE; x++)
+      {
+         XMMATRIX mTransform = XMMatrixTranslation(a_World.fGridOrigin + x * PHYS_BENCH_PATCH_SIZE, 0.0f, a_World.fGridOrigin + z * PHYS_BENCH_PATCH_SIZE);
+         pPool->TakePatch(mTransform, 1.0e6f, 0);
+      }
+   }
+   for (int i = 0; i < pPool->GetPatchCount(); i++)
+      pPool->SetPatchVisibility(i, true);
+   return pPool;
+}
+
+/* StepPhysics of one pool with a private scheduler of 1..hardware threads, the blades never fall asleep */
+GRASS_BENCH(PhysicsScaling)
+{
+   PhysBenchWorld world;
+   float3 vCamPos = create(0.0f, 2.0f, 0.0f);
+   float fPhysLodDst = 70.0f;
+   UINT uMaxThreads = max(std::thread::hardware_concurrency(), 1u);
+   UINT uSleepFrames = PhysPatch::uSleepFrames;
+   PhysPatch::uSleepFrames = UINT_MAX;
+
+   printf("threads\tms/step\tspeedup\tefficiency\n");
+   double fSingleMs = 0.0;
+   for (UINT uThreads = 1; uThreads <= uMaxThreads; uThreads++)
+   {
+      JobScheduler scheduler(uThreads);
+      GrassPool* pPool = TakeBenchPool(world);
+      pPool->SetJobScheduler(&scheduler);
+
+      for (UINT uStep = 0; uStep < PHYS_BENCH_WARMUP; uStep++)
+         pPool->StepPhysics(vCamPos, fPhysLodDst, NULL, 0, world.SubTypes, world.IndexMap);
+
+      BenchClock::time_point tStart = BenchClock::now();
+      for (UINT uStep = 0; uStep < PHYS_BENCH_STEPS; uStep++)
+         pPool->StepPhysics(vCamPos, fPhysLodDst, NULL, 0, world.SubTypes, world.IndexMap);
+      double fMs = ElapsedMs(tStart) / PHYS_BENCH_STEPS;
+      delete pPool;
+
+      if (uThreads == 1)
+         fSingleMs = fMs;
+      double fSpeedup = fSingleMs / fMs;
+      printf("%u\t%.3f\t%.2f\t%.2f\n", uThreads, fMs, fSpeedup, fSpeedup / uThreads);
+   }
+   PhysPatch::uSleepFrames = uSleepFrames;
+}
@@ -0,0 +1,68 @@
+#include "GrassBench.h"
+#include "GrassPool.h"
+
+/* the physics patch of main.cpp: 280 m of grass in 37 patches a side, 20 blades a patch side */
+#define POOL_BENCH_PATCH_SIZE   (280.0f / 37.0f)
+#define POOL_BENCH_BLADES_SIDE  20
+#define POOL_BENCH_ROUNDS       10
+/* lifetimes are spread over this many frames of 1/60 s */
+#define POOL_BENCH_EXPIRE_FRAMES 60
+
+/* take, release and lifetime expiry of a headless pool of a_uPoolSize patches, a table row */
+static void BenchPoolSize (GrassPatch* a_pBasePatch, UINT a_uPoolSize)
+{
+   const float fFrameTime = 1.0f / 60.0f;
+   GrassPool* pPool = new GrassPool(a_pBasePatch, a_uPoolSize);
+   pPool->SetPatchGrid(0.0f);
+
+   UINT uSide = (UINT)ceilf(sqrtf((float)a_uPoolSize));
+   std::vector<XMMATRIX> transforms(a_uPoolSize);
+   for (UINT i = 0; i < a_uPoolSize; i++)
+      transforms[i] = XMMatrixTranslation((i % uSide) * POOL_BENCH_PATCH_SIZE, 0.0f, (i / uSide) * POOL_BENCH_PATCH_SIZE);
+
+   double fTakeMs = 0.0, fReleaseMs = 0.0, fExpireMs = 0.0, fIdleMs = 0.0;
+   UINT uRound, i;
+   for (uRound = 0; uRound < POOL_BENCH_ROUNDS; uRound++)
+   {
+      /* take: lifetimes spread over POOL_BENCH_EXPIRE_FRAMES frames */
+      BenchClock::time_point tStart = BenchClock::now();
+      for (i = 0; i < a_uPoolSize; i++)
+         pPool->TakePatch(transforms[i], (i % POOL_BENCH_EXPIRE_FRAMES + 0.5f) * fFrameTime, 0);
+      fTakeMs += ElapsedMs(tStart);
+
+      /* nothing is due: the cost of a frame without deaths */
+      tStart = BenchClock::now();
+      pPool->ClearDeadPatches(0.0f);
+      fIdleMs += ElapsedMs(tStart);
+
+      /* expire: the clock stands still, the horizon moves a frame at a time */
+      tStart = BenchClock::now();
+      for (i = 1; i <= POOL_BENCH_EXPIRE_FRAMES; i++)
+         pPool->ClearDeadPatches(i * fFrameTime);
+      fExpireMs += ElapsedMs(tStart);
+
+      /* release: take again and free every patch by its position */
+      for (i = 0; i < a_uPoolSize; i++)
+         pPool->TakePatch(transforms[i], POOL_BENCH_EXPIRE_FRAMES * fFrameTime * 2.0f, 0);
+      tStart = BenchClock::now();
+      for (i = 0; i < a_uPoolSize; i++)
+         pPool->FreePatch(transforms[i].r[3]);
+      fReleaseMs += ElapsedMs(tStart);
+   }
+   delete pPool;
+
+   double fOps = (double)a_uPoolSize * POOL_BENCH_ROUNDS;
+   printf("%u\t%.1f\t%.1f\t%.1f\t%.1f\n", a_uPoolSize, fTakeMs * 1.0e6 / fOps, fReleaseMs * 1.0e6 / fOps,
+      fExpireMs * 1.0e6 / fOps, fIdleMs * 1.0e6 / POOL_BENCH_ROUNDS);
+}
+
+/* ns per patch of take, release and expiry, ns per frame without deaths, at several pool sizes */
+GRASS_BENCH(PoolOperations)
+{
+   const UINT uSizes[] = { 64, 256, 1024 };
+   GrassPatchLod0 basePatch(NULL, NULL, POOL_BENCH_PATCH_SIZE, POOL_BENCH_BLADES_SIDE);
+
+   printf("patches\ttake ns\trelease ns\texpire ns\tidle clear ns\n");
+   for (UINT i = 0; i < sizeof(uSizes) / sizeof(uSizes[0]); i++)
+      BenchPoolSize(&basePatch, uSizes[i]);
+}
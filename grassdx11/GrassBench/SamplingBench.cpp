@@ -0,0 +1,70 @@
+#include "GrassBench.h"
+#include "BilinearGrid.h"
+#include "PhysRandom.h"
+
+#include <vector>
+
+#define SAMPLING_BENCH_ROUNDS 10
+
+/* the air grid of AirData, the wind grid at the size of the gradient map */
+static const UINT s_uGridSizes[] = { 512, 256 };
+static const UINT s_uCounts[] = { 1024, 65536, 1048576 };
+
+/* ns per sample of a_uCount random texcoords: the original sampler, SampleBilinear and SampleBilinearBatch */
+static void BenchSampling (const std::vector<XMFLOAT3>& a_Grid, UINT a_uSize, UINT a_uCount)
+{
+   /* texcoords of a field larger than the tile, the negative ones too */
+   std::vector<float> vX(a_uCount), vY(a_uCount);
+   RandomStream random(a_uCount);
+   for (UINT i = 0; i < a_uCount; i++)
+   {
+      vX[i] = random.NextFloat(-2.0f, 2.0f);
+      vY[i] = random.NextFloat(-2.0f, 2.0f);
+   }
+   std::vector<XMVECTOR> vOut(a_uCount);
+   const XMFLOAT3* pGrid = a_Grid.data();
+
+   double fMs[3];
+   for (UINT uTest = 0; uTest < 3; uTest++)
+   {
+      BenchClock::time_point tStart = BenchClock::now();
+      for (UINT uRound = 0; uRound < SAMPLING_BENCH_ROUNDS; uRound++)
+      {
+         switch (uTest)
+         {
+         case 0:
+            for (UINT i = 0; i < a_uCount; i++)
+               vOut[i] = SampleBilinearReference(pGrid, a_uSize, a_uSize, 1.0f, vX[i], vY[i]);
+            break;
+         case 1:
+            for (UINT i = 0; i < a_uCount; i++)
+               vOut[i] = SampleBilinear(pGrid, a_uSize, a_uSize, 1.0f, vX[i], vY[i]);
+            break;
+         case 2:
+            SampleBilinearBatch(pGrid, a_uSize, a_uSize, 1.0f, vX.data(), vY.data(), a_uCount, vOut.data());
+            break;
+         }
+      }
+      fMs[uTest] = ElapsedMs(tStart);
+   }
+
+   double fSamples = (double)a_uCount * SAMPLING_BENCH_ROUNDS;
+   printf("%u^2\t%u\t%.2f\t%.2f\t%.2f\t%.2f\n", a_uSize, a_uCount, fMs[0] * 1.0e6 / fSamples, fMs[1] * 1.0e6 / fSamples,
+      fMs[2] * 1.0e6 / fSamples, fMs[0] / fMs[2]);
+}
+
+/* bilinear sampling of the air and wind grid sizes, the original scalar sampler is the baseline of the speedup */
+GRASS_BENCH(BilinearSampling)
+{
+   printf("grid\tsamples\treference ns\tscalar ns\tbatch ns\tspeedup\n");
+   for (UINT uSize : s_uGridSizes)
+   {
+      std::vector<XMFLOAT3> grid(uSize * uSize);
+      RandomStream random(uSize);
+      for (size_t i = 0; i < grid.size(); i++)
+         grid[i] = XMFLOAT3(random.NextFloat(-5.0f, 5.0f), random.NextFloat(-5.0f, 5.0f), random.NextFloat(-5.0f, 5.0f));
+
+      for (UINT uCount : s_uCounts)
+         BenchSampling(grid, uSize, uCount);
+   }
+}
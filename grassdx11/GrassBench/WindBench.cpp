@@ -0,0 +1,88 @@
+#include "GrassBench.h"
+#include "Wind.h"
+
+#include <thread>
+
+/* the gradient map of resources/Wind.dds is 256 x 256 */
+#define WIND_BENCH_MAP_SIZE  256
+/* the wind speed of main.h */
+#define WIND_BENCH_SPEED     2.5f
+#define WIND_BENCH_FRAME     (1.0f / 60.0f)
+#define WIND_BENCH_WARMUP    10
+#define WIND_BENCH_UPDATES   200
+
+/* a smooth gradient map in place of the one Wind renders on the device */
+static void FillBenchWindMap (WindData& a_Data)
+{
+   a_Data.uMapWidth = a_Data.uMapHeight = WIND_BENCH_MAP_SIZE;
+   a_Data.fMapWidth = a_Data.fMapHeight = (float)WIND_BENCH_MAP_SIZE;
+   a_Data.pWindMapData = new XMFLOAT4[WIND_BENCH_MAP_SIZE * WIND_BENCH_MAP_SIZE];
+   for (UINT row = 0; row < WIND_BENCH_MAP_SIZE; row++)
+   {
+      for (UINT col = 0; col < WIND_BENCH_MAP_SIZE; col++)
+      {
+         float fW = 0.5f + 0.25f * sinf(0.11f * col + 0.05f * row) + 0.25f * cosf(0.07f * row);
+         a_Data.pWindMapData[row * WIND_BENCH_MAP_SIZE + col] = XMFLOAT4(0.0f, 0.0f, 0.0f, fW);
+      }
+   }
+}
+
+/**
+Wind::BeginUpdate and Wind::EndUpdate without the device: Advance, UpdateWindTex
+spawned on the scheduler with its row jobs, Publish when due and the staging of
+the wind texture; only the UpdateSubresource calls of WindCopy are left out
+*/
+static void UpdateBenchWind (WindData& a_Data, JobScheduler& a_Scheduler, JobGroup& a_Group)
+{
+   bool bPublish = a_Data.Advance(WIND_BENCH_FRAME);
+   a_Scheduler.Spawn(a_Group, [&a_Data]()
+   {
+      a_Data.UpdateWindTex(create(0.0f, 0.0f, 1.0f));
+   });
+   a_Scheduler.Wait(a_Group);
+   if (bPublish)
+      a_Data.Publish();
+   a_Data.StageTexels();
+}
+
+/* ms per wind update at several grid sizes and solve rates, with a private scheduler of 1..hardware threads */
+GRASS_BENCH(WindUpdate)
+{
+   static const UINT uSizes[] = { 64, 128, 256 };
+   /* solves per second, 0 - one every update */
+   static const float fSolveRates[] = { 0.0f, 15.0f };
+   UINT uMaxThreads = max(std::thread::hardware_concurrency(), 1u);
+
+   printf("grid\tsolve rate\tthreads\tms/update\tspeedup\tefficiency\n");
+   for (UINT uSize : uSizes)
+   {
+      for (float fRate : fSolveRates)
+      {
+         double fSingleMs = 0.0;
+         for (UINT uThreads = 1; uThreads <= uMaxThreads; uThreads++)
+         {
+            JobScheduler scheduler(uThreads);
+            JobGroup group;
+            WindData data;
+            FillBenchWindMap(data);
+            data.fWindSpeed = WIND_BENCH_SPEED;
+            data.pJobScheduler = &scheduler;
+            data.Resize(uSize, uSize);
+            data.SetSolvePeriod((fRate > 0.0f) ? 1.0f / fRate : 0.0f);
+
+            for (UINT uUpdate = 0; uUpdate < WIND_BENCH_WARMUP; uUpdate++)
+               UpdateBenchWind(data, scheduler, group);
+
+            BenchClock::time_point tStart = BenchClock::now();
+            for (UINT uUpdate = 0; uUpdate < WIND_BENCH_UPDATES; uUpdate++)
+               UpdateBenchWind(data, scheduler, group);
+            double fMs = ElapsedMs(tStart) / WIND_BENCH_UPDATES;
+
+            if (uThreads == 1)
+               fSingleMs = fMs;
+            double fSpeedup = fSingleMs / fMs;
+            printf("%u^2\t%g\t%u\t%.3f\t%.2f\t%.2f\n", uSize, fRate, uThreads, fMs, fSpeedup, fSpeedup / uThreads);
+         }
+      }
+   }
+}
@@ -1,14 +1,19 @@
 #pragma once
 
 #include "includes.h"
+#include "BilinearGrid.h"
 
 class AirData {
 public:
    AirData (ID3D11Device* pD3DDevice, ID3D11DeviceContext* pD3DDeviceCtx)
    {
-      data = new XMFLOAT3[dataSize];  // FlowW * FlowH * segments count
+      data = new XMFLOAT3[dataSize]();  // FlowW * FlowH * segments count
       dev = pD3DDevice;
       devcon = pD3DDeviceCtx;
+      texture = NULL;
+      /* without a device the air stays still, for the physics benchmarks */
+      if (!dev)
+         return;
 
       D3D11_TEXTURE2D_DESC textureDesc;
       ZeroMemory(&textureDesc, sizeof(textureDesc));
@@ -48,34 +53,18 @@ public:
 
    XMVECTOR GetAirValue (const XMVECTOR& a_vTexCoord) const
    {
-      float fX = getx(a_vTexCoord);
-      float fY = gety(a_vTexCoord);
-      /* bilinear interpolation... */
-      fX = (fX - floorf(fX)) * 512.f - 0.5f;
-      fY = (fY - floorf(fY)) * 512.f - 0.5f;
-      float fFracX = fX - floorf(fX);
-      float fFracY = fY - floorf(fY);
-      UINT uLX = UINT(fX);
-      UINT uHX = uLX + 1;
-      UINT uLY = UINT(fY);
-      UINT uHY = uLY + 1;
-      if (uHX > 512 - 1)
-         uHX = 511;
-      if (uHY > 512 - 1)
-         uHY = 511;
-
-      XMFLOAT3 fLL = data[512 * uLY + uLX];
-      XMFLOAT3 fHL = data[512 * uHY + uLX];
-      XMFLOAT3 fLR = data[512 * uLY + uHX];
-      XMFLOAT3 fHR = data[512 * uHY + uHX];
+      return SampleBilinear(data, 512, 512, 1.0f, getx(a_vTexCoord), gety(a_vTexCoord));
+   }
 
-      XM_TO_V(fLL, v_fLL, 3);
-      XM_TO_V(fHL, v_fHL, 3);
-      XM_TO_V(fLR, v_fLR, 3);
-      XM_TO_V(fHR, v_fHR, 3);
 
-      return ((1.0f - fFracX) * v_fLL + fFracX * v_fLR) * (1.0f - fFracY) +
-         fFracY * ((1.0f - fFracX) * v_fHL + fFracX * v_fHR);
+   /**
+   GetAirValue of a_uCount texcoords at once
+   param a_pX, a_pY texcoords
+   param a_pOut a_uCount values
+   */
+   void GetAirValues (const float* a_pX, const float* a_pY, UINT a_uCount, XMVECTOR* a_pOut) const
+   {
+      SampleBilinearBatch(data, 512, 512, 1.0f, a_pX, a_pY, a_uCount, a_pOut);
    }
 
 
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "includes.h"
+#include "PhysLanes.h"
+
+/*
+Bilinear sampling of a tiled grid of vectors, a_uWidth * a_uHeight texels in rows.
+A texcoord is repeated a_fTile times over [0, 1), texel centres are at (i + 0.5) / size,
+beyond the first and the last centre the edge texel is taken.
+*/
+
+/**
+return grid value at (a_fX, a_fY)
+*/
+inline XMVECTOR SampleBilinear(const XMFLOAT3* a_pGrid, UINT a_uWidth, UINT a_uHeight, float a_fTile, float a_fX, float a_fY)
+{
+   float fX = a_fX * a_fTile;
+   float fY = a_fY * a_fTile;
+   fX = (fX - floorf(fX)) * (float)a_uWidth - 0.5f;
+   fY = (fY - floorf(fY)) * (float)a_uHeight - 0.5f;
+   float fFloorX = floorf(fX);
+   float fFloorY = floorf(fY);
+   float fFracX = fX - fFloorX;
+   float fFracY = fY - fFloorY;
+
+   /* before the first texel centre the floor is -1: clamp it rather than wrap it through UINT */
+   int iX = (int)fFloorX;
+   int iY = (int)fFloorY;
+   UINT uLX = (UINT)max(iX, 0);
+   UINT uHX = (UINT)min(iX + 1, (int)a_uWidth - 1);
+   UINT uLY = (UINT)max(iY, 0);
+   UINT uHY = (UINT)min(iY + 1, (int)a_uHeight - 1);
+
+   XMVECTOR v_fLL = XMLoadFloat3(&a_pGrid[a_uWidth * uLY + uLX]);
+   XMVECTOR v_fHL = XMLoadFloat3(&a_pGrid[a_uWidth * uHY + uLX]);
+   XMVECTOR v_fLR = XMLoadFloat3(&a_pGrid[a_uWidth * uLY + uHX]);
+   XMVECTOR v_fHR = XMLoadFloat3(&a_pGrid[a_uWidth * uHY + uHX]);
+
+   return ((1.0f - fFracX) * v_fLL + fFracX * v_fLR) * (1.0f - fFracY) +
+      fFracY * ((1.0f - fFracX) * v_fHL + fFracX * v_fHR);
+}
+
+
+/**
+The sampler WindData and AirData had before SampleBilinear, kept as the reference of the
+tests and the timing baseline of the benchmarks. Before the first texel centre it truncates
+the negative position to texel 0 and blends it with texel 1, SampleBilinear takes texel 0 there
+return grid value at (a_fX, a_fY)
+*/
+inline XMVECTOR SampleBilinearReference(const XMFLOAT3* a_pGrid, UINT a_uWidth, UINT a_uHeight, float a_fTile, float a_fX, float a_fY)
+{
+   float fX = (a_fX * a_fTile);
+   float fY = (a_fY * a_fTile);
+   /* bilinear interpolation... */
+   fX = (fX - floorf(fX)) * (float)a_uWidth - 0.5f;
+   fY = (fY - floorf(fY)) * (float)a_uHeight - 0.5f;
+   float fFracX = fX - floorf(fX);
+   float fFracY = fY - floorf(fY);
+   /* through int: the truncation of the UINT cast the original compiled to, without its undefined negative case */
+   UINT uLX = (UINT)(int)fX;
+   UINT uHX = uLX + 1;
+   UINT uLY = (UINT)(int)fY;
+   UINT uHY = uLY + 1;
+   if (uHX > a_uWidth - 1)
+      uHX = a_uWidth - 1;
+   if (uHY > a_uHeight - 1)
+      uHY = a_uHeight - 1;
+
+   XMVECTOR v_fLL = XMLoadFloat3(&a_pGrid[a_uWidth * uLY + uLX]);
+   XMVECTOR v_fHL = XMLoadFloat3(&a_pGrid[a_uWidth * uHY + uLX]);
+   XMVECTOR v_fLR = XMLoadFloat3(&a_pGrid[a_uWidth * uLY + uHX]);
+   XMVECTOR v_fHR = XMLoadFloat3(&a_pGrid[a_uWidth * uHY + uHX]);
+
+   return ((1.0f - fFracX) * v_fLL + fFracX * v_fLR) * (1.0f - fFracY) +
+      fFracY * ((1.0f - fFracX) * v_fHL + fFracX * v_fHR);
+}
+
+
+/**
+SampleBilinear of a_uCount texcoords, the same values.
+Texel indices and weights are computed for PHYS_LANES texcoords at once, then the
+four corners of every sample are gathered with one XMLoadFloat3 each.
+param a_pX, a_pY texcoords, any alignment
+param a_pOut a_uCount values
+*/
+inline void SampleBilinearBatch(const XMFLOAT3* a_pGrid, UINT a_uWidth, UINT a_uHeight, float a_fTile,
+   const float* a_pX, const float* a_pY, UINT a_uCount, XMVECTOR* a_pOut)
+{
+   XMVECTOR tile = XMVectorReplicate(a_fTile);
+   XMVECTOR width = XMVectorReplicate((float)a_uWidth);
+   XMVECTOR height = XMVectorReplicate((float)a_uHeight);
+   XMVECTOR maxX = XMVectorReplicate((float)(a_uWidth - 1));
+   XMVECTOR maxY = XMVectorReplicate((float)(a_uHeight - 1));
+   XMVECTOR half = XMVectorReplicate(0.5f);
+   XMVECTOR one = XMVectorSplatOne();
+   XMVECTOR zero = XMVectorZero();
+
+   for (UINT i = 0; i < a_uCount; i += PHYS_LANES)
+   {
+      UINT uLanes = min(a_uCount - i, (UINT)PHYS_LANES);
+      XMVECTOR x, y;
+      if (uLanes == PHYS_LANES)
+      {
+         x = XMLoadFloat4((const XMFLOAT4*)(a_pX + i));
+         y = XMLoadFloat4((const XMFLOAT4*)(a_pY + i));
+      }
+      else
+      {
+         XMFLOAT4 vX(0.0f, 0.0f, 0.0f, 0.0f), vY(0.0f, 0.0f, 0.0f, 0.0f);
+         memcpy(&vX, a_pX + i, uLanes * sizeof(float));
+         memcpy(&vY, a_pY + i, uLanes * sizeof(float));
+         x = XMLoadFloat4(&vX);
+         y = XMLoadFloat4(&vY);
+      }
+
+      x = XMVectorMultiply(x, tile);
+      y = XMVectorMultiply(y, tile);
+      x = XMVectorSubtract(XMVectorMultiply(XMVectorSubtract(x, XMVectorFloor(x)), width), half);
+      y = XMVectorSubtract(XMVectorMultiply(XMVectorSubtract(y, XMVectorFloor(y)), height), half);
+      XMVECTOR floorX = XMVectorFloor(x);
+      XMVECTOR floorY = XMVectorFloor(y);
+      XMVECTOR fracX = XMVectorSubtract(x, floorX);
+      XMVECTOR fracY = XMVectorSubtract(y, floorY);
+
+      XMVECTOR lx = XMVectorClamp(floorX, zero, maxX);
+      XMVECTOR hx = XMVectorClamp(XMVectorAdd(floorX, one), zero, maxX);
+      XMVECTOR ly = XMVectorMultiply(XMVectorClamp(floorY, zero, maxY), width);
+      XMVECTOR hy = XMVectorMultiply(XMVectorClamp(XMVectorAdd(floorY, one), zero, maxY), width);
+
+      /* the indices are whole numbers below 2^24, exact in float */
+      XMUINT4 uLL, uHL, uLR, uHR;
+      XMStoreUInt4(&uLL, XMConvertVectorFloatToUInt(XMVectorAdd(ly, lx), 0));
+      XMStoreUInt4(&uHL, XMConvertVectorFloatToUInt(XMVectorAdd(hy, lx), 0));
+      XMStoreUInt4(&uLR, XMConvertVectorFloatToUInt(XMVectorAdd(ly, hx), 0));
+      XMStoreUInt4(&uHR, XMConvertVectorFloatToUInt(XMVectorAdd(hy, hx), 0));
+
+      XMVECTOR invFracX = XMVectorSubtract(one, fracX);
+      XMVECTOR invFracY = XMVectorSubtract(one, fracY);
+      XMFLOAT4A wLL, wHL, wLR, wHR;
+      XMStoreFloat4A(&wLL, XMVectorMultiply(invFracX, invFracY));
+      XMStoreFloat4A(&wHL, XMVectorMultiply(invFracX, fracY));
+      XMStoreFloat4A(&wLR, XMVectorMultiply(fracX, invFracY));
+      XMStoreFloat4A(&wHR, XMVectorMultiply(fracX, fracY));
+
+      const UINT* pLL = &uLL.x;
+      const UINT* pHL = &uHL.x;
+      const UINT* pLR = &uLR.x;
+      const UINT* pHR = &uHR.x;
+      const float* pWLL = &wLL.x;
+      const float* pWHL = &wHL.x;
+      const float* pWLR = &wLR.x;
+      const float* pWHR = &wHR.x;
+      for (UINT k = 0; k < uLanes; k++)
+      {
+         XMVECTOR v = XMVectorMultiply(XMLoadFloat3(&a_pGrid[pLL[k]]), XMVectorReplicate(pWLL[k]));
+         v = XMVectorMultiplyAdd(XMLoadFloat3(&a_pGrid[pHL[k]]), XMVectorReplicate(pWHL[k]), v);
+         v = XMVectorMultiplyAdd(XMLoadFloat3(&a_pGrid[pLR[k]]), XMVectorReplicate(pWLR[k]), v);
+         a_pOut[i + k] = XMVectorMultiplyAdd(XMLoadFloat3(&a_pGrid[pHR[k]]), XMVectorReplicate(pWHR[k]), v);
+      }
+   }
+}
@@ -5,6 +5,22 @@
 
 XMMATRIX GetNormalizedMt (AABB vBBox);
 
+#define CAR_MODEL_PATH "resources/Car/car_low/source/car_low.fbx"
+/* the baked field of the model, in the cache folder of the user */
+#define CAR_SDF_CACHE  "car_low.sdf"
+/* voxels along the car length, distances are exact within CAR_SDF_BAND voxels of the body */
+#define CAR_SDF_CELLS  64
+#define CAR_SDF_BAND   3.0f
+/* blades are kept this far from the body, meters */
+#define CAR_SDF_SKIN   0.05f
+
+/* height of the car frame over the ground */
+#define CAR_HEIGHT_OFFSET  1.5f
+/* wheel sizes and the wheelbase as parts of the car sizes */
+#define CAR_WHEEL_RADIUS   0.3f
+#define CAR_WHEEL_WIDTH    0.3f
+#define CAR_WHEEL_BASE     0.6f
+
 Car::Car (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx, ID3DX11Effect* a_pEffect, XMVECTOR a_vPosAndRadius,
    Terrain* const a_pTerrain, float a_fHeightScale, float a_fGrassRadius,
    float a_fCarWidth, float a_fCarHeight, float a_fCarLength, float a_fAmplAngle)
@@ -57,8 +73,24 @@ Car::Car (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx, ID3D
    carModel = new ModelLoader;
    //if (!carModel->Load(0, m_pD3DDevice, m_pD3DDeviceCtx, "resources/SuperCar/obj/carFordtest.obj"))
    //   assert(false);
-   if (!carModel->Load(0, m_pD3DDevice, m_pD3DDeviceCtx, "resources/Car/car_low/source/car_low.fbx"))
+   if (!carModel->Load(0, m_pD3DDevice, m_pD3DDeviceCtx, CAR_MODEL_PATH))
       assert(false);
+
+   // Baked once off the main thread, then taken from the cache while the model is the same.
+   // The planes collide until SetPosAndRadius finds the field done
+   std::vector<XMFLOAT3> Triangles;
+   carModel->GetTriangles(Triangles);
+   m_pCarSdf = new SignedDistanceField;
+   m_pSdfCollider = NULL;
+   m_bSdfBaked = false;
+   m_SdfBake = std::thread([this, Triangles]()
+   {
+      m_pCarSdf->LoadOrBake(Triangles, CAR_SDF_CELLS, CAR_SDF_BAND, SignedDistanceField::CachePath(CAR_SDF_CACHE));
+      m_bSdfBaked = true;
+   });
+
+   AddWheels();
+   AttachContacts(&m_Wheels);
 }
 
 Car::~Car(void)
@@ -67,6 +99,10 @@ Car::~Car(void)
    delete m_pPlanes[1];
    delete m_pPlanes[2];
    delete m_pPlanes[3];
+   if (m_SdfBake.joinable())
+      m_SdfBake.join();
+   delete m_pSdfCollider;
+   delete m_pCarSdf;
    carModel->Close();
 }
 
@@ -87,22 +123,35 @@ void Car::CreateInputLayout(void)
       &m_pInputLayout);
 }
 
-void Car::Render(void)
+void Car::AddWheels(void)
 {
-   //m_pNormalMatrixEMV->SetMatrix((float*)& m_mNormalMatrix);
-   //if (GetGlobalStateManager().UseWireframe())
-   //   GetGlobalStateManager().SetRasterizerState("EnableMSAACulling_Wire");
-   //else
-   //   GetGlobalStateManager().SetRasterizerState("EnableMSAACulling");
-
-   m_pD3DDeviceCtx->IASetInputLayout(m_pInputLayout);
-   m_pD3DDeviceCtx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+   // In the car frame: x to the right, y up, z forward
+   float fRadius = CAR_WHEEL_RADIUS * m_fCarHeight;
+   float fWidth = CAR_WHEEL_WIDTH * m_fCarWidth;
+   float fY = fRadius - CAR_HEIGHT_OFFSET;
+   float fZ = CAR_WHEEL_BASE * m_fCarLength;
+
+   m_Wheels.Clear();
+   for (int i = 0; i < 4; i++)
+   {
+      /* the axis points to the right on both sides */
+      float fRight = (i & 1) ? m_fCarWidth : -m_fCarWidth + fWidth;
+      ContactPrimitive wheel;
+      wheel.eType = ContactPrimitive::CYLINDER;
+      wheel.vA = XMFLOAT3(fRight - fWidth, fY, (i & 2) ? fZ : -fZ);
+      wheel.vB = XMFLOAT3(fRight, fY, (i & 2) ? fZ : -fZ);
+      wheel.fRadius = fRadius;
+      m_Wheels.Add(wheel);
+   }
+}
 
+XMMATRIX Car::ModelTransform(void)
+{
    XMVECTOR trnsl, quatr, scale;
    XMMATRIX tr = XMLoadFloat4x4(&m_mTransform);
    XMMatrixDecompose(&scale, &quatr, &trnsl, tr);
 
-   tr = XMMatrixScaling(4.43, 4.43, 4.43) *
+   return XMMatrixScaling(4.43, 4.43, 4.43) *
       XMMatrixRotationX(PI / 2) *
       XMMatrixRotationY(PI) *
       XMMatrixTranslation(0, -1.4050, 0) *
@@ -110,6 +159,20 @@ void Car::Render(void)
       XMMatrixRotationQuaternion(quatr) *
       XMMatrixTranslationFromVector(trnsl) *
       XMMatrixIdentity(); 
+}
+
+void Car::Render(void)
+{
+   //m_pNormalMatrixEMV->SetMatrix((float*)& m_mNormalMatrix);
+   //if (GetGlobalStateManager().UseWireframe())
+   //   GetGlobalStateManager().SetRasterizerState("EnableMSAACulling_Wire");
+   //else
+   //   GetGlobalStateManager().SetRasterizerState("EnableMSAACulling");
+
+   m_pD3DDeviceCtx->IASetInputLayout(m_pInputLayout);
+   m_pD3DDeviceCtx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+   XMMATRIX tr = ModelTransform();
 
    /*tr = XMMatrixScaling(1, 1, 1) *
       //XMMatrixRotationX(PI / 2) *
@@ -140,6 +203,10 @@ void Car::SetPosAndRadius (XMFLOAT4& a_vPosAndRadius)
    float3 vY = create(0, 1, 0), dir, plane_cur_pos, plane_prev_pos, cur_pos, offset;
    XMMATRIX translate, scale, rotate, plane_coords, model_coords;
 
+   // The field replaces the planes from the first move after its bake
+   if (m_pSdfCollider == NULL && m_bSdfBaked && !m_pCarSdf->IsEmpty())
+      m_pSdfCollider = new SdfCollider(m_pCarSdf, CAR_SDF_SKIN);
+
    // Calculate move direction
    XMVECTOR prevPos = create(m_vPosAndRadius.x, m_vPosAndRadius.y, m_vPosAndRadius.z);
    XMStoreFloat3(&m_vPrevPos, prevPos);
@@ -163,7 +230,7 @@ void Car::SetPosAndRadius (XMFLOAT4& a_vPosAndRadius)
    // Calculate car height
    TerrainHeightData* pHD = m_pTerrain->HeightDataPtr();
    float2 vTexCoord;
-   float fHeightOffset = 1.5f;
+   float fHeightOffset = CAR_HEIGHT_OFFSET;
    float g_fCarLength = 1.0;
 
    // Calculate up dir
@@ -213,8 +280,7 @@ void Car::SetPosAndRadius (XMFLOAT4& a_vPosAndRadius)
    dir = p3 - cur_pos;
    model_coords = XMMatrixLookAtLH(cur_pos, cur_pos + dir, up);
    XMStoreFloat4x4(&m_mMatr, XMMatrixInverse(NULL, model_coords));
-   
-   XMStoreFloat4x4(&m_mInvBottom, model_coords);
+   m_Wheels.SetTransform(m_mMatr);
    // Scale
    scale = XMMatrixScaling(1.0f / m_fCarWidth, 1.0f / m_fCarHeight, 1.0f / m_fCarLength);
    //   D3DXMatrixScaling(&scale, 1.0f , 1.0f , 1.0f);
@@ -228,6 +294,13 @@ void Car::SetPosAndRadius (XMFLOAT4& a_vPosAndRadius)
    m_mNormalMatrix = XMMatrixInverse(NULL, transform);
    XMStoreFloat4x4(&m_mTransform, transform);
 
+   if (m_pSdfCollider != NULL)
+   {
+      XMFLOAT4X4 modelTransform;
+      XMStoreFloat4x4(&modelTransform, ModelTransform());
+      m_pSdfCollider->SetTransform(modelTransform);
+   }
+
    // Place front plane
    offset = create(0.0f, 0.0f, -m_fPlaneLength);
 
@@ -322,6 +395,9 @@ bool Car::CheckCollision (XMVECTOR Beg, XMVECTOR End, float* Dist)
 {
    float treshold = -1.5f;
 
+   if (m_pSdfCollider != NULL)
+      return m_pSdfCollider->CheckCollision(Beg, End, Dist);
+
    for (UINT k = 1; k < m_uNumPlanes; k++)
    {
       float cur_dist;
@@ -351,22 +427,120 @@ bool Car::Collide(XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End,
 
    *Ret = create(0, 0, 0);
 
-
-   for (UINT k = 1; k < m_uNumPlanes; k++)
+   // The body: its baked field if there is one, the planes otherwise
+   if (m_pSdfCollider != NULL)
+      is_collided = m_pSdfCollider->Collide(Ret, Beg, End, a_pBladePhysData, a_iSegmentIndex);
+   else
    {
-      XMVECTOR psi;
-      bool collision = m_pPlanes[k]->Collide(&psi, Beg, End, a_pBladePhysData);
-      
-      if (collision)
+      for (UINT k = 1; k < m_uNumPlanes; k++)
       {
-         *Ret += psi;
-         is_collided = true;
+         XMVECTOR psi;
+         bool collision = m_pPlanes[k]->Collide(&psi, Beg, End, a_pBladePhysData);
+
+         if (collision)
+         {
+            *Ret += psi;
+            is_collided = true;
+         }
       }
    }
 
+   // The field and the planes hold the body, the wheels under it are added to either
+   XMVECTOR psi;
+   if (m_Wheels.Collide(&psi, Beg, End))
+   {
+      *Ret += psi;
+      is_collided = true;
+   }
+
    return is_collided;
 }
 
+UINT Car::CollideSegments(XMVECTOR* a_pRet, bool* a_pHit, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount,
+   PhysPatch::BladePhysData** a_ppBladePhysData, int a_iSegmentIndex)
+{
+   UINT uNumHits = 0;
+
+   if (m_pSdfCollider != NULL)
+      m_pSdfCollider->CollideSegments(a_pRet, a_pHit, a_pBeg, a_pEnd, a_uCount, a_ppBladePhysData, a_iSegmentIndex);
+
+   for (UINT uBase = 0; uBase < a_uCount; uBase += PHYS_LANES)
+   {
+      UINT uLanes = min(a_uCount - uBase, (UINT)PHYS_LANES);
+      UINT uMask = 0;
+      XMVECTOR vSum[PHYS_LANES];
+
+      /* the body: the field result of the lanes, or the planes */
+      if (m_pSdfCollider != NULL)
+      {
+         for (UINT i = 0; i < uLanes; i++)
+         {
+            vSum[i] = a_pRet[uBase + i];
+            if (a_pHit[uBase + i])
+               uMask |= 1 << i;
+         }
+      }
+      else
+      {
+         for (UINT i = 0; i < uLanes; i++)
+            vSum[i] = create(0, 0, 0);
+
+         for (UINT k = 1; k < m_uNumPlanes; k++)
+         {
+            XMVECTOR psi[PHYS_LANES];
+            UINT uPlaneMask = m_pPlanes[k]->CollideLanes(psi, a_pBeg + uBase, a_pEnd + uBase, uLanes);
+            if (uPlaneMask == 0)
+               continue;
+
+            for (UINT i = 0; i < uLanes; i++)
+               vSum[i] += psi[i];
+            uMask |= uPlaneMask;
+         }
+      }
+
+      /* the wheels under the body, on top of either */
+      XMVECTOR psi[PHYS_LANES];
+      UINT uWheelMask = m_Wheels.CollideLanes(psi, a_pBeg + uBase, a_pEnd + uBase, uLanes);
+      if (uWheelMask != 0)
+      {
+         for (UINT i = 0; i < uLanes; i++)
+            vSum[i] += psi[i];
+         uMask |= uWheelMask;
+      }
+
+      for (UINT i = 0; i < uLanes; i++)
+      {
+         a_pRet[uBase + i] = vSum[i];
+         a_pHit[uBase + i] = (uMask & (1 << i)) != 0;
+         if (a_pHit[uBase + i])
+            uNumHits++;
+      }
+   }
+
+   return uNumHits;
+}
+
+void Car::GetBounds(XMVECTOR& a_vMin, XMVECTOR& a_vMax)
+{
+   m_Wheels.GetBounds(a_vMin, a_vMax);
+   if (m_pSdfCollider != NULL)
+   {
+      XMVECTOR vMin, vMax;
+      m_pSdfCollider->GetBounds(vMin, vMax);
+      a_vMin = XMVectorMin(a_vMin, vMin);
+      a_vMax = XMVectorMax(a_vMax, vMax);
+      return;
+   }
+
+   for (UINT k = 1; k < m_uNumPlanes; k++)
+   {
+      XMVECTOR vMin, vMax;
+      m_pPlanes[k]->GetBounds(vMin, vMax);
+      a_vMin = XMVectorMin(a_vMin, vMin);
+      a_vMax = XMVectorMax(a_vMax, vMax);
+   }
+}
+
 float Car::GetDist(XMVECTOR& Pnt, bool* IsUnderWheel)
 {
    float min_dist = INVALID_DIST;
@@ -385,36 +559,6 @@ float Car::GetDist(XMVECTOR& Pnt, bool* IsUnderWheel)
 }
 
 
-int Car::IsBottom(XMVECTOR& Pnt, XMVECTOR& vNormal)
-{
-   XMVECTOR loc_coord;
-   float2 vTexCoord;
-   TerrainHeightData* pHD = m_pTerrain->HeightDataPtr();
-
-   XM_TO_M(m_mInvBottom, invB);
-   loc_coord = XMVector3Transform(Pnt, invB);
-   if (fabs(getx(loc_coord) <= m_fCarWidth && fabs(getz(loc_coord)) <= m_fCarLength))
-   {
-      vTexCoord = create(getx(Pnt) / m_fGrassRadius * 0.5f + 0.5f, getz(Pnt) / m_fGrassRadius * 0.5f + 0.5f);
-      setx(vNormal, max((m_fCarWidth - fabs(getx(loc_coord))) / 0.75f, 0.3f));
-      if (getx(vNormal) > 1.0f) 
-         setx(vNormal, 1.0f);
-      if (fabs(getx(loc_coord)) > m_fCarWidth - 0.75f)
-      {
-         if (getx(loc_coord) > 0.0f) 
-            return 2;
-         else 
-            return 3;
-      }
-      else 
-         return 1;
-
-   }
-   else
-      return 0;
-}
-
-
 XMMATRIX GetNormalizedMt(AABB vBBox)
 {
    XMMATRIX m;
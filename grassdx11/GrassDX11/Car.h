@@ -4,6 +4,10 @@
 #include "plane.h"
 #include "terrain.h"
 #include "ModelLoader.h"
+#include "SdfCollider.h"
+
+#include <atomic>
+#include <thread>
 
 class Car : public Mesh
 {
@@ -23,6 +27,9 @@ public:
 
    virtual XMFLOAT4 GetPosAndRadius (void);
 
+   /* box of the wheels and of the planes Collide tests, or of the distance field */
+   virtual void GetBounds (XMVECTOR& a_vMin, XMVECTOR& a_vMax);
+
    virtual void Render (void);
 
 
@@ -31,6 +38,11 @@ public:
    virtual bool Collide (XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End,
       PhysPatch::BladePhysData* a_pBladePhysData, int a_iSegmentIndex);
 
+   /* Collide of PHYS_LANES segments at a time: one field sample per segment or every plane
+      with Plane::CollideLanes for the body, plus the wheels with ContactPrimitives::CollideLanes */
+   virtual UINT CollideSegments (XMVECTOR* a_pRet, bool* a_pHit, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount,
+      PhysPatch::BladePhysData** a_ppBladePhysData, int a_iSegmentIndex);
+
    virtual float GetDist (XMVECTOR& Pnt, bool* IsUnderWheel);
 
    virtual void RotateToEdge (XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End)
@@ -38,8 +50,6 @@ public:
       ;
    }
 
-   virtual int IsBottom(XMVECTOR& Pnt, XMVECTOR& vNormal);
-
 private:
    // Car sizes
    float m_fCarLength;
@@ -53,9 +63,6 @@ private:
    float m_fPlaneWidth;
    float m_fPlaneHeight;
 
-   // Inverse Matrix of bottom plane  
-   XMFLOAT4X4 m_mInvBottom;
-
    // Use to convert normals to world space in shader
    XMMATRIX m_mNormalMatrix;
    //ID3DX11EffectMatrixVariable* m_pNormalMatrixEMV;
@@ -68,6 +75,15 @@ private:
    //CMeshLoader10 m_Mesh;
    ModelLoader* carModel;
 
+   // Distance field of the car model, the planes collide while it is baked or if it is empty
+   SignedDistanceField* m_pCarSdf;
+   SdfCollider*         m_pSdfCollider;
+   std::thread          m_SdfBake;
+   std::atomic<bool>    m_bSdfBaked;
+
+   // Wheels, attached as the contacts: the grass is laid down along their tracks only
+   ContactPrimitives    m_Wheels;
+
    // Terrain height data
    Terrain* m_pTerrain;
    float m_fHeightScale, m_fGrassRadius;
@@ -75,4 +91,10 @@ private:
    ID3DX11EffectShaderResourceVariable* m_pTexESRV;
 
    void CreateInputLayout(void);
+
+   /* four cylinders in the car frame, on the ground under the body */
+   void AddWheels(void);
+
+   /* car model to world, as it is rendered */
+   XMMATRIX ModelTransform(void);
 };
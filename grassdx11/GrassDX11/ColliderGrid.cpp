@@ -0,0 +1,164 @@
+#include "ColliderGrid.h"
+#include "mesh.h"
+
+#include <algorithm>
+
+
+ColliderGrid::ColliderGrid(float a_fCellSize)
+{
+   SetCellSize(a_fCellSize);
+}
+
+
+void ColliderGrid::SetCellSize(float a_fCellSize)
+{
+   m_fCellSize = max(a_fCellSize, 0.1f);
+   m_Cells.clear();
+}
+
+
+void ColliderGrid::Register(Mesh* a_pMesh)
+{
+   if (std::find(m_Registered.begin(), m_Registered.end(), a_pMesh) == m_Registered.end())
+      m_Registered.push_back(a_pMesh);
+}
+
+
+void ColliderGrid::Unregister(Mesh* a_pMesh)
+{
+   m_Registered.erase(std::remove(m_Registered.begin(), m_Registered.end(), a_pMesh), m_Registered.end());
+   /* no dangling pointer until the next Rebuild */
+   m_Colliders.erase(std::remove(m_Colliders.begin(), m_Colliders.end(), a_pMesh), m_Colliders.end());
+   m_Bounds.clear();
+   m_Cells.clear();
+}
+
+
+UINT64 ColliderGrid::CellKey(int a_iX, int a_iZ) const
+{
+   return ((UINT64)(UINT)a_iX << 32) | (UINT)a_iZ;
+}
+
+
+int ColliderGrid::CellCoord(float a_fCoord) const
+{
+   return (int)floorf(a_fCoord / m_fCellSize);
+}
+
+
+void ColliderGrid::Rebuild(Mesh* a_pMeshes[], UINT a_uNumMeshes)
+{
+   m_Colliders = m_Registered;
+   for (UINT i = 0; i < a_uNumMeshes; i++)
+   {
+      if (std::find(m_Registered.begin(), m_Registered.end(), a_pMeshes[i]) == m_Registered.end())
+         m_Colliders.push_back(a_pMeshes[i]);
+   }
+
+   m_Bounds.resize(m_Colliders.size());
+   m_Cells.clear();
+   for (UINT c = 0; c < (UINT)m_Colliders.size(); c++)
+   {
+      /* the sphere is what the patches are taken and their update tiers assigned by */
+      XMVECTOR vMin, vMax;
+      m_Colliders[c]->GetBounds(vMin, vMax);
+      XMFLOAT4 vPosAndRadius = m_Colliders[c]->GetPosAndRadius();
+      XMVECTOR vPos = XMLoadFloat4(&vPosAndRadius);
+      XMVECTOR vRadius = XMVectorReplicate(vPosAndRadius.w);
+      vMin = XMVectorMin(vMin, vPos - vRadius);
+      vMax = XMVectorMax(vMax, vPos + vRadius);
+      XMStoreFloat3(&m_Bounds[c].vMin, vMin);
+      XMStoreFloat3(&m_Bounds[c].vMax, vMax);
+
+      int iMinX = CellCoord(m_Bounds[c].vMin.x), iMaxX = CellCoord(m_Bounds[c].vMax.x);
+      int iMinZ = CellCoord(m_Bounds[c].vMin.z), iMaxZ = CellCoord(m_Bounds[c].vMax.z);
+      for (int iX = iMinX; iX <= iMaxX; iX++)
+      {
+         for (int iZ = iMinZ; iZ <= iMaxZ; iZ++)
+         {
+            CellEntry entry = { CellKey(iX, iZ), c };
+            m_Cells.push_back(entry);
+         }
+      }
+   }
+
+   std::sort(m_Cells.begin(), m_Cells.end(), [](const CellEntry& a, const CellEntry& b)
+   {
+      return a.uKey < b.uKey;
+   });
+}
+
+
+bool ColliderGrid::Overlaps(UINT a_uCollider, FXMVECTOR a_vMin, FXMVECTOR a_vMax) const
+{
+   const ColliderBounds& bounds = m_Bounds[a_uCollider];
+   return XMVector3LessOrEqual(XMLoadFloat3(&bounds.vMin), a_vMax) && XMVector3LessOrEqual(a_vMin, XMLoadFloat3(&bounds.vMax));
+}
+
+
+UINT ColliderGrid::Query(FXMVECTOR a_vMin, FXMVECTOR a_vMax, UINT* a_pIndices, UINT a_uMaxCount) const
+{
+   UINT uCount = 0;
+   if (m_Cells.empty())
+      return 0;
+
+   float fMinX = XMVectorGetX(a_vMin), fMaxX = XMVectorGetX(a_vMax);
+   float fMinZ = XMVectorGetZ(a_vMin), fMaxZ = XMVectorGetZ(a_vMax);
+   float fCellsX = (fMaxX - fMinX) / m_fCellSize + 1.0f;
+   float fCellsZ = (fMaxZ - fMinZ) / m_fCellSize + 1.0f;
+
+   /* a box over more cells than the grid has entries: the colliders are fewer than the cells */
+   if (fCellsX * fCellsZ > (float)m_Cells.size())
+   {
+      for (UINT c = 0; c < (UINT)m_Colliders.size() && uCount < a_uMaxCount; c++)
+      {
+         if (Overlaps(c, a_vMin, a_vMax))
+            a_pIndices[uCount++] = c;
+      }
+      return uCount;
+   }
+
+   int iMinX = CellCoord(fMinX), iMaxX = CellCoord(fMaxX);
+   int iMinZ = CellCoord(fMinZ), iMaxZ = CellCoord(fMaxZ);
+   for (int iX = iMinX; iX <= iMaxX; iX++)
+   {
+      for (int iZ = iMinZ; iZ <= iMaxZ; iZ++)
+      {
+         CellEntry key = { CellKey(iX, iZ), 0 };
+         auto it = std::lower_bound(m_Cells.begin(), m_Cells.end(), key, [](const CellEntry& a, const CellEntry& b)
+         {
+            return a.uKey < b.uKey;
+         });
+         for (; it != m_Cells.end() && it->uKey == key.uKey; ++it)
+         {
+            /* a collider over several cells is met in each of them */
+            if (std::find(a_pIndices, a_pIndices + uCount, it->uCollider) != a_pIndices + uCount)
+               continue;
+            if (!Overlaps(it->uCollider, a_vMin, a_vMax))
+               continue;
+            if (uCount == a_uMaxCount)
+               return uCount;
+            a_pIndices[uCount++] = it->uCollider;
+         }
+      }
+   }
+   return uCount;
+}
+
+
+Mesh** ColliderGrid::Colliders(void)
+{
+   return m_Colliders.empty() ? NULL : &m_Colliders[0];
+}
+
+
+Mesh* ColliderGrid::Collider(UINT a_uIndex) const
+{
+   return m_Colliders[a_uIndex];
+}
+
+
+UINT ColliderGrid::Count(void) const
+{
+   return (UINT)m_Colliders.size();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "includes.h"
+
+#include <vector>
+
+class Mesh;
+
+/**
+Colliders the grass bends under: cars, copter skids, characters.
+Every frame the colliders are bucketed by their bounds into a uniform grid over x and z,
+a query visits the cells of its box only, so its cost follows the colliders around
+the box and not how many there are on the whole terrain.
+*/
+class ColliderGrid
+{
+public:
+   /**
+   param a_fCellSize cell side in meters, about the size of a typical collider
+   */
+   ColliderGrid(float a_fCellSize);
+
+   /**
+   Adds a collider to every Rebuild until it is unregistered
+   */
+   void Register(Mesh* a_pMesh);
+   void Unregister(Mesh* a_pMesh);
+
+   /**
+   Buckets the registered colliders and the colliders of this frame
+   param a_pMeshes colliders of this frame, a registered one is taken once
+   */
+   void Rebuild(Mesh* a_pMeshes[], UINT a_uNumMeshes);
+
+   /**
+   Finds the colliders whose bounds overlap a box, each one once
+   param a_pIndices at least a_uMaxCount indices of Colliders(), the colliders past it are dropped
+   return number of indices written
+   */
+   UINT Query(FXMVECTOR a_vMin, FXMVECTOR a_vMax, UINT* a_pIndices, UINT a_uMaxCount) const;
+
+   /**
+   return colliders of the last Rebuild, the indices of Query are into this array
+   */
+   Mesh** Colliders(void);
+   Mesh*  Collider(UINT a_uIndex) const;
+   UINT   Count(void) const;
+
+   void   SetCellSize(float a_fCellSize);
+
+private:
+   /* collider in one cell, m_Cells is sorted by the cell key */
+   struct CellEntry
+   {
+      UINT64 uKey;
+      UINT   uCollider;
+   };
+
+   /* box the collider is bucketed by: its bounds and its bounding sphere */
+   struct ColliderBounds
+   {
+      XMFLOAT3 vMin;
+      XMFLOAT3 vMax;
+   };
+
+   UINT64 CellKey(int a_iX, int a_iZ) const;
+   int    CellCoord(float a_fCoord) const;
+   bool   Overlaps(UINT a_uCollider, FXMVECTOR a_vMin, FXMVECTOR a_vMax) const;
+
+   std::vector<Mesh*>          m_Registered;
+   std::vector<Mesh*>          m_Colliders;
+   std::vector<ColliderBounds> m_Bounds;
+   std::vector<CellEntry>      m_Cells;
+   float                       m_fCellSize;
+};
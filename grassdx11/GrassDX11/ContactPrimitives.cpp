@@ -0,0 +1,207 @@
+#include "ContactPrimitives.h"
+
+/* lever of a segment touching at its very begin, as a part of the segment */
+#define CONTACT_MIN_LEVER 0.05f
+/* the push goes a little further, as the planes do */
+#define CONTACT_OVERSHOOT 1.1f
+
+
+static XMVECTOR DotLanes(const LaneVec3& a_vA, const LaneVec3& a_vB)
+{
+   return XMVectorMultiplyAdd(a_vA.x, a_vB.x, XMVectorMultiplyAdd(a_vA.y, a_vB.y, XMVectorMultiply(a_vA.z, a_vB.z)));
+}
+
+/* a_vA . (a_fX, a_fY, a_fZ) */
+static XMVECTOR DotLanes(const LaneVec3& a_vA, float a_fX, float a_fY, float a_fZ)
+{
+   return XMVectorMultiplyAdd(a_vA.x, XMVectorReplicate(a_fX), XMVectorMultiplyAdd(a_vA.y, XMVectorReplicate(a_fY), XMVectorMultiply(a_vA.z, XMVectorReplicate(a_fZ))));
+}
+
+
+ContactPrimitives::ContactPrimitives(void)
+   : m_fScale(1.0f)
+{
+   XMStoreFloat4x4(&m_mTransform, XMMatrixIdentity());
+}
+
+
+UINT ContactPrimitives::Add(const ContactPrimitive& a_Primitive)
+{
+   m_Local.push_back(a_Primitive);
+   m_World.push_back(a_Primitive);
+   SetTransform(m_mTransform);
+   return (UINT)m_Local.size() - 1;
+}
+
+
+void ContactPrimitives::Clear(void)
+{
+   m_Local.clear();
+   m_World.clear();
+}
+
+
+void ContactPrimitives::SetTransform(const XMFLOAT4X4& a_mTransform)
+{
+   m_mTransform = a_mTransform;
+   XMMATRIX mTransform = XMLoadFloat4x4(&a_mTransform);
+   m_fScale = XMVectorGetX(XMVector3Length(mTransform.r[0]));
+   for (size_t i = 0; i < m_Local.size(); i++)
+   {
+      XMStoreFloat3(&m_World[i].vA, XMVector3TransformCoord(XMLoadFloat3(&m_Local[i].vA), mTransform));
+      XMStoreFloat3(&m_World[i].vB, XMVector3TransformCoord(XMLoadFloat3(&m_Local[i].vB), mTransform));
+      m_World[i].fRadius = m_Local[i].fRadius * m_fScale;
+   }
+}
+
+
+void ContactPrimitives::GetBounds(XMVECTOR& a_vMin, XMVECTOR& a_vMax) const
+{
+   a_vMin = XMVectorReplicate(FLT_MAX);
+   a_vMax = XMVectorReplicate(-FLT_MAX);
+   for (size_t i = 0; i < m_World.size(); i++)
+   {
+      XMVECTOR vA = XMLoadFloat3(&m_World[i].vA);
+      XMVECTOR vB = XMLoadFloat3(&m_World[i].vB);
+      XMVECTOR vRadius = XMVectorReplicate(m_World[i].fRadius);
+      a_vMin = XMVectorMin(a_vMin, XMVectorMin(vA, vB) - vRadius);
+      a_vMax = XMVectorMax(a_vMax, XMVectorMax(vA, vB) + vRadius);
+   }
+}
+
+
+bool ContactPrimitives::Collide(XMVECTOR* a_pRet, FXMVECTOR a_vBeg, FXMVECTOR a_vEnd) const
+{
+   XMVECTOR vBeg = a_vBeg, vEnd = a_vEnd;
+   return CollideLanes(a_pRet, &vBeg, &vEnd, 1) != 0;
+}
+
+
+static_assert(PHYS_LANES == 4, "ContactPrimitives::CollideLanes transposes the lanes as a 4x4 matrix");
+
+UINT ContactPrimitives::CollideLanes(XMVECTOR* a_pRet, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount) const
+{
+   UINT k;
+   XMVECTOR vBeg[PHYS_LANES], vEnd[PHYS_LANES];
+   for (k = 0; k < PHYS_LANES; k++)
+   {
+      /* missing lanes repeat the first segment and are masked out at the end */
+      vBeg[k] = a_pBeg[(k < a_uCount) ? k : 0];
+      vEnd[k] = a_pEnd[(k < a_uCount) ? k : 0];
+   }
+
+   /* AoS -> SoA */
+   XMMATRIX mBeg = XMMatrixTranspose(XMMATRIX(vBeg[0], vBeg[1], vBeg[2], vBeg[3]));
+   XMMATRIX mEnd = XMMatrixTranspose(XMMATRIX(vEnd[0], vEnd[1], vEnd[2], vEnd[3]));
+   LaneVec3 vP0 = { mBeg.r[0], mBeg.r[1], mBeg.r[2] };
+   LaneVec3 vD1 = { XMVectorSubtract(mEnd.r[0], mBeg.r[0]), XMVectorSubtract(mEnd.r[1], mBeg.r[1]), XMVectorSubtract(mEnd.r[2], mBeg.r[2]) };
+
+   XMVECTOR vZero = XMVectorZero();
+   XMVECTOR vOne = XMVectorReplicate(1.0f);
+   XMVECTOR vA = DotLanes(vD1, vD1);
+   XMVECTOR vHitAll = XMVectorFalseInt();
+   LaneVec3 vSum = { vZero, vZero, vZero };
+
+   for (size_t i = 0; i < m_World.size(); i++)
+   {
+      const ContactPrimitive& prim = m_World[i];
+      float fD2X = prim.vB.x - prim.vA.x, fD2Y = prim.vB.y - prim.vA.y, fD2Z = prim.vB.z - prim.vA.z;
+      XMVECTOR vE = XMVectorReplicate(max(fD2X * fD2X + fD2Y * fD2Y + fD2Z * fD2Z, 1e-8f));
+      LaneVec3 vR = { XMVectorSubtract(vP0.x, XMVectorReplicate(prim.vA.x)),
+                      XMVectorSubtract(vP0.y, XMVectorReplicate(prim.vA.y)),
+                      XMVectorSubtract(vP0.z, XMVectorReplicate(prim.vA.z)) };
+
+      /* closest points of the segment and the axis, Ericson's Real-Time Collision Detection 5.1.9 without branches */
+      XMVECTOR vB = DotLanes(vD1, fD2X, fD2Y, fD2Z);
+      XMVECTOR vC = DotLanes(vD1, vR);
+      XMVECTOR vF = DotLanes(vR, fD2X, fD2Y, fD2Z);
+      XMVECTOR vDenom = XMVectorNegativeMultiplySubtract(vB, vB, XMVectorMultiply(vA, vE));
+      XMVECTOR vS = XMVectorDivide(XMVectorSubtract(XMVectorMultiply(vB, vF), XMVectorMultiply(vC, vE)), vDenom);
+      vS = XMVectorSelect(XMVectorClamp(vS, vZero, vOne), vZero, XMVectorLessOrEqual(vDenom, XMVectorMultiply(XMVectorMultiply(vA, vE), XMVectorReplicate(1e-6f))));
+      XMVECTOR vT = XMVectorDivide(XMVectorMultiplyAdd(vB, vS, vF), vE);
+      XMVECTOR vTClamped = XMVectorClamp(vT, vZero, vOne);
+      XMVECTOR vSEnd = XMVectorClamp(XMVectorDivide(XMVectorSubtract(XMVectorMultiply(vTClamped, vB), vC), vA), vZero, vOne);
+      vS = XMVectorSelect(vS, vSEnd, XMVectorOrInt(XMVectorLess(vT, vZero), XMVectorGreater(vT, vOne)));
+
+      /* the axis point nearest to the segment point */
+      LaneVec3 vP = { XMVectorMultiplyAdd(vS, vD1.x, vR.x), XMVectorMultiplyAdd(vS, vD1.y, vR.y), XMVectorMultiplyAdd(vS, vD1.z, vR.z) };
+      XMVECTOR vTProj = XMVectorDivide(DotLanes(vP, fD2X, fD2Y, fD2Z), vE);
+      vT = XMVectorClamp(vTProj, vZero, vOne);
+      LaneVec3 vOff = { XMVectorNegativeMultiplySubtract(vT, XMVectorReplicate(fD2X), vP.x),
+                        XMVectorNegativeMultiplySubtract(vT, XMVectorReplicate(fD2Y), vP.y),
+                        XMVectorNegativeMultiplySubtract(vT, XMVectorReplicate(fD2Z), vP.z) };
+      XMVECTOR vDist2 = DotLanes(vOff, vOff);
+
+      XMVECTOR vHit = XMVectorLess(vDist2, XMVectorReplicate(prim.fRadius * prim.fRadius));
+      vHit = XMVectorAndInt(vHit, XMVectorGreater(vDist2, vZero));
+      vHit = XMVectorAndInt(vHit, XMVectorGreater(vA, vZero));
+      if (prim.eType == ContactPrimitive::CYLINDER)
+      {
+         /* past the end discs of a wheel there is nothing */
+         vHit = XMVectorAndInt(vHit, XMVectorGreaterOrEqual(vTProj, vZero));
+         vHit = XMVectorAndInt(vHit, XMVectorLessOrEqual(vTProj, vOne));
+      }
+      if (XMVector4EqualInt(vHit, XMVectorFalseInt()))
+         continue;
+
+      /* the segment point goes out to the surface: by vOff * (radius / dist - 1) */
+      XMVECTOR vPush = XMVectorSubtract(XMVectorMultiply(XMVectorReplicate(prim.fRadius), XMVectorReciprocalSqrt(vDist2)), vOne);
+      LaneVec3 vDelta = { XMVectorMultiply(vOff.x, vPush), XMVectorMultiply(vOff.y, vPush), XMVectorMultiply(vOff.z, vPush) };
+
+      /* rotation about the segment begin that moves the point by vDelta: lever x delta / |lever|^2 */
+      XMVECTOR vLever = XMVectorMax(vS, XMVectorReplicate(CONTACT_MIN_LEVER));
+      LaneVec3 vL = { XMVectorMultiply(vD1.x, vLever), XMVectorMultiply(vD1.y, vLever), XMVectorMultiply(vD1.z, vLever) };
+      XMVECTOR vInvL2 = XMVectorReciprocal(DotLanes(vL, vL));
+      LaneVec3 vPsi;
+      vPsi.x = XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(vL.y, vDelta.z), XMVectorMultiply(vL.z, vDelta.y)), vInvL2);
+      vPsi.y = XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(vL.z, vDelta.x), XMVectorMultiply(vL.x, vDelta.z)), vInvL2);
+      vPsi.z = XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(vL.x, vDelta.y), XMVectorMultiply(vL.y, vDelta.x)), vInvL2);
+
+      /* lanes that miss may hold nan */
+      vSum.x = XMVectorAdd(vSum.x, XMVectorSelect(vZero, vPsi.x, vHit));
+      vSum.y = XMVectorAdd(vSum.y, XMVectorSelect(vZero, vPsi.y, vHit));
+      vSum.z = XMVectorAdd(vSum.z, XMVectorSelect(vZero, vPsi.z, vHit));
+      vHitAll = XMVectorOrInt(vHitAll, vHit);
+   }
+
+   UINT uMask = 0;
+   for (k = 0; k < a_uCount; k++)
+      if (XMVectorGetIntByIndex(vHitAll, k))
+         uMask |= 1 << k;
+   if (uMask == 0)
+   {
+      for (k = 0; k < a_uCount; k++)
+         a_pRet[k] = vZero;
+      return 0;
+   }
+
+   /* overshoot, but never more than a right angle */
+   XMVECTOR vAngle = XMVectorSqrt(DotLanes(vSum, vSum));
+   XMVECTOR vScale = XMVectorDivide(XMVectorMin(XMVectorMultiply(vAngle, XMVectorReplicate(CONTACT_OVERSHOOT)), XMVectorReplicate((float)M_PI * 0.5f)), vAngle);
+   vScale = XMVectorSelect(vZero, vScale, XMVectorAndInt(vHitAll, XMVectorGreater(vAngle, vZero)));
+
+   /* SoA -> AoS */
+   XMMATRIX mRet = XMMatrixTranspose(XMMATRIX(
+      XMVectorMultiply(vSum.x, vScale),
+      XMVectorMultiply(vSum.y, vScale),
+      XMVectorMultiply(vSum.z, vScale),
+      vZero));
+   for (k = 0; k < a_uCount; k++)
+      a_pRet[k] = mRet.r[k];
+
+   return uMask;
+}
+
+
+float ContactPrimitives::GetFootprint(UINT a_uIndex, XMVECTOR& a_vCenter) const
+{
+   const ContactPrimitive& prim = m_World[a_uIndex];
+   a_vCenter = XMVectorSet((prim.vA.x + prim.vB.x) * 0.5f, min(prim.vA.y, prim.vB.y) - prim.fRadius, (prim.vA.z + prim.vB.z) * 0.5f, 0.0f);
+
+   /* a wheel lying on its side leaves a track as wide as the tyre */
+   float fDX = prim.vB.x - prim.vA.x, fDZ = prim.vB.z - prim.vA.z;
+   float fHalfLength = 0.5f * sqrtf(fDX * fDX + fDZ * fDZ);
+   if (prim.eType == ContactPrimitive::CYLINDER && fHalfLength > 1e-3f)
+      return min(prim.fRadius, fHalfLength);
+   return prim.fRadius;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "includes.h"
+#include "PhysBlades.h"
+
+#include <vector>
+
+/**
+Capsule or flat-ended cylinder around the axis vA..vB
+*/
+struct ContactPrimitive
+{
+   enum TYPE
+   {
+      CAPSULE = 0,
+      CYLINDER        /* a wheel: no contact past the end discs */
+   };
+
+   TYPE     eType;
+   XMFLOAT3 vA;
+   XMFLOAT3 vB;
+   float    fRadius;
+};
+
+/**
+Capsules and cylinders attached to a mesh, wheels or feet.
+A blade segment is tested against a primitive in closed form: the closest points
+of the segment and the axis, the segment is rotated about its begin until that
+point is out of the primitive. PHYS_LANES segments are tested at once.
+*/
+class ContactPrimitives
+{
+public:
+   ContactPrimitives(void);
+
+   /**
+   param a_Primitive in the space of the transform
+   return index of the primitive
+   */
+   UINT Add(const ContactPrimitive& a_Primitive);
+   void Clear(void);
+   UINT Count(void) const { return (UINT)m_Local.size(); }
+
+   /**
+   Places the primitives, the scale must be uniform
+   */
+   void SetTransform(const XMFLOAT4X4& a_mTransform);
+
+   /* world box of all the primitives */
+   void GetBounds(XMVECTOR& a_vMin, XMVECTOR& a_vMax) const;
+
+   /**
+   return world rotation vector of one segment, the sum over the primitives it touches
+   */
+   bool Collide(XMVECTOR* a_pRet, FXMVECTOR a_vBeg, FXMVECTOR a_vEnd) const;
+
+   /**
+   Collide for up to PHYS_LANES segments at once, one segment per SIMD lane
+   param a_pRet rotation vectors of the colliding segments, zero for the others
+   return bit k set if segment k collides
+   */
+   UINT CollideLanes(XMVECTOR* a_pRet, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount) const;
+
+   /**
+   Disc a primitive presses the ground with
+   param a_vCenter center of the shadow of the primitive, y is its lowest point
+   return radius of the disc, within the shadow
+   */
+   float GetFootprint(UINT a_uIndex, XMVECTOR& a_vCenter) const;
+
+private:
+   std::vector<ContactPrimitive> m_Local;
+   std::vector<ContactPrimitive> m_World;
+   XMFLOAT4X4                    m_mTransform;
+   float                         m_fScale;
+};
@@ -37,6 +37,21 @@ GrassFieldManager::GrassFieldManager (GrassFieldState& a_InitState)
    a_InitState.InitState[1].fTerrRadius = a_InitState.fTerrRadius;
    a_InitState.InitState[2].fTerrRadius = a_InitState.fTerrRadius;
 
+   /* Physics jobs of all grass types share one thread pool */
+   m_pJobScheduler = new JobScheduler();
+   for (i = 0; i < GrassTypeNum; i++)
+      a_InitState.InitState[i].pJobScheduler = m_pJobScheduler;
+
+   /* Trample of the grass out of the physics range, half a meter texels */
+   m_pTrampleField = new TrampleField(a_InitState.InitState[0].pD3DDevice, a_InitState.InitState[0].pD3DDeviceCtx, a_InitState.fTerrRadius, 0.5f);
+   for (i = 0; i < GrassTypeNum; i++)
+      a_InitState.InitState[i].pTrampleField = m_pTrampleField;
+
+   /* Colliders of all grass types, cells of about a car size */
+   m_pColliderGrid = new ColliderGrid(8.0f);
+   for (i = 0; i < GrassTypeNum; i++)
+      a_InitState.InitState[i].pColliderGrid = m_pColliderGrid;
+
    m_pFlowManager = new FlowManager(
       a_InitState.InitState[0].pD3DDevice,
       a_InitState.InitState[0].pD3DDeviceCtx, 
@@ -67,6 +82,9 @@ GrassFieldManager::GrassFieldManager (GrassFieldState& a_InitState)
    m_fTerrRadius = a_InitState.fTerrRadius;
 
    m_pWind = new Wind(a_InitState.InitState[0].pD3DDevice, a_InitState.InitState[0].pD3DDeviceCtx);
+   m_pWind->SetJobScheduler(m_pJobScheduler);
+   m_pWind->SetSolveRate(a_InitState.fWindSolveRate);
+   m_SpectralWind = a_InitState.SpectralWind;
 
    m_pGrassTypes[0]->SetHeightDataPtr(m_pTerrain->HeightDataPtr());
    m_pGrassTypes[0]->SetWindDataPtr(m_pWind->WindDataPtr());
@@ -122,6 +140,11 @@ GrassFieldManager::GrassFieldManager (GrassFieldState& a_InitState)
       pESRV = m_pGrassTypes[i]->GetEffect()->GetVariableByName("g_txHeightMap")->AsShaderResource();
       pESRV->SetResource(pHeightMapSRV);
 
+      pESRV = m_pGrassTypes[i]->GetEffect()->GetVariableByName("g_txTrampleMap")->AsShaderResource();
+      pESRV->SetResource(m_pTrampleField->GetSRV());
+      m_pGrassTypes[i]->GetEffect()->GetVariableByName("g_fTrampleUVScale")->AsScalar()->SetFloat(m_pTrampleField->UVScale());
+      m_pGrassTypes[i]->GetEffect()->GetVariableByName("g_fTrampleAngle")->AsScalar()->SetFloat(PhysPatch::trampleAngle);
+
       m_pGrassTime[i] = m_pGrassTypes[i]->GetEffect()->GetVariableByName("g_fTime")->AsScalar();
    }
 
@@ -245,6 +268,10 @@ GrassFieldManager::~GrassFieldManager(void)
    delete m_pT1SubTypes;
    delete m_pT2SubTypes;
    delete m_pT3SubTypes;
+
+   delete m_pColliderGrid;
+   delete m_pTrampleField;
+   delete m_pJobScheduler;
 }
 
 
@@ -290,6 +317,17 @@ void GrassFieldManager::ToggleRenderingGrass()
    isGrassRendering = !isGrassRendering;
 }
 
+void GrassFieldManager::ToggleSpectralWind()
+{
+   isSpectralWind = !isSpectralWind;
+   if (!isSpectralWind)
+   {
+      m_pWind->SetSpectrum(NULL);
+      return;
+   }
+   m_pWind->SetSpectrum(&m_SpectralWind);
+}
+
 
 void GrassFieldManager::SetQuality(float a_fQuality)
 {
@@ -345,6 +383,11 @@ void GrassFieldManager::SetWindSpeed(float a_fWindSpeed)
    m_pWind->SetWindSpeed(a_fWindSpeed);
 }
 
+void GrassFieldManager::SetWindSolveRate(float a_fRate)
+{
+   m_pWind->SetSolveRate(a_fRate);
+}
+
 void GrassFieldManager::SetViewMtx(float4x4& a_mView)
 {
    UINT i;
@@ -448,6 +491,7 @@ void GrassFieldManager::SetHeightScale(float a_fHeightScale)
    m_pHeightScale[GrassTypeNum]->SetFloat(a_fHeightScale);
 
    PhysPatch::fHeightScale = a_fHeightScale;
+   PhysPatch::InvalidateStaticData();
    m_fHeightScale = a_fHeightScale;
 }
 
@@ -612,15 +656,53 @@ void GrassFieldManager::Update (float3 a_vCamDir, float3 a_vCamPos, Mesh* a_pMes
    m_vCamDir = a_vCamDir;
    m_vCamPos = a_vCamPos;
 
-   m_pWind->Update(a_fElapsedTime, a_vCamDir);
+   /* the next wind frame is computed on a worker, the grass below reads the last one */
+   m_pWind->BeginUpdate(a_fElapsedTime, a_vCamDir);
    m_pTerrain->UpdateLightMap();
 
    m_pFlowManager->Update(a_fElapsedTime, a_fTime);
-   m_pMixer->MixTextures(m_pWind->GetMap(), m_pFlowManager->GetFlowSRV());
+   m_pMixer->MixTextures(m_pWind->GetPrevMap(), m_pWind->GetMap(), m_pWind->GetMapBlend(), m_pFlowManager->GetFlowSRV());
    m_pAirData->Update(m_pMixer->m_renderTargetsTexture);
 
+   /* the registered colliders join the ones of this frame, the grass managers get them all */
+   m_pColliderGrid->Rebuild(a_pMeshes, a_uNumMeshes);
+   a_pMeshes = m_pColliderGrid->Colliders();
+   a_uNumMeshes = m_pColliderGrid->Count();
+
+   /* colliders touching the ground press the grass, it rises back over the recovery time */
+   TerrainHeightData* pHD = m_pTerrain->HeightDataPtr();
+   for (UINT k = 0; k < a_uNumMeshes; k++)
+   {
+      /* a mesh on wheels or feet presses along their tracks only */
+      ContactPrimitives* pContacts = a_pMeshes[k]->GetContacts();
+      if (pContacts != NULL && pContacts->Count() > 0)
+      {
+         for (UINT c = 0; c < pContacts->Count(); c++)
+         {
+            XMVECTOR vCenter;
+            float fRadius = pContacts->GetFootprint(c, vCenter);
+            float fGround = pHD->GetHeight(getx(vCenter) / m_fTerrRadius * 0.5f + 0.5f, getz(vCenter) / m_fTerrRadius * 0.5f + 0.5f) * m_fHeightScale;
+            if (gety(vCenter) - fGround < fRadius)
+               m_pTrampleField->Stamp(vCenter, fRadius, a_pMeshes[k]->GetMoveDir());
+         }
+         continue;
+      }
+
+      XMFLOAT4 vPosAndRadius = a_pMeshes[k]->GetPosAndRadius();
+      float fHeight = pHD->GetHeight(vPosAndRadius.x / m_fTerrRadius * 0.5f + 0.5f, vPosAndRadius.z / m_fTerrRadius * 0.5f + 0.5f) * m_fHeightScale;
+      float fAbove = vPosAndRadius.y - fHeight;
+      if (fAbove >= vPosAndRadius.w)
+         continue;
+      float fGroundRadius = sqrtf(vPosAndRadius.w * vPosAndRadius.w - max(fAbove, 0.0f) * max(fAbove, 0.0f));
+      m_pTrampleField->Stamp(XMLoadFloat4(&vPosAndRadius), fGroundRadius, a_pMeshes[k]->GetMoveDir());
+   }
+   m_pTrampleField->Update(a_fElapsedTime);
+   m_pTrampleField->Upload();
+
    m_pGrassTypes[0]->Update(*m_pViewProj, a_vCamPos, a_pMeshes, a_uNumMeshes, a_fElapsedTime);
    m_pGrassTypes[2]->Update(*m_pViewProj, a_vCamPos, a_pMeshes, a_uNumMeshes, a_fElapsedTime);
+
+   m_pWind->EndUpdate();
 }
 
 ID3DX11Effect* GrassFieldManager::SceneEffect(void)
@@ -634,3 +716,59 @@ void GrassFieldManager::ClearGrassPools(void)
       if (m_pGrassTypes[i] != NULL && i != 1)
          m_pGrassTypes[i]->ClearGrassPools();
 }
+
+void GrassFieldManager::SetIntegrator(UINT a_uGrassType, int a_iSubType, BladeIntegrator a_Integrator)
+{
+   if (a_uGrassType >= GrassTypeNum || a_uGrassType == 1)
+      return;
+   m_pGrassTypes[a_uGrassType]->SetSubTypeIntegrator(a_iSubType, a_Integrator);
+}
+
+void GrassFieldManager::SetPhysBudget(float a_fBudgetMs)
+{
+   m_pGrassTypes[0]->SetPhysBudget(a_fBudgetMs);
+   m_pGrassTypes[2]->SetPhysBudget(a_fBudgetMs);
+}
+
+void GrassFieldManager::SetDormantBudget(UINT a_uBudgetKB)
+{
+   m_pGrassTypes[0]->SetDormantBudget(a_uBudgetKB);
+   m_pGrassTypes[2]->SetDormantBudget(a_uBudgetKB);
+}
+
+void GrassFieldManager::SetPhysTier(UINT a_uTier, const PhysTier& a_Tier)
+{
+   m_pGrassTypes[0]->SetPhysTier(a_uTier, a_Tier);
+   m_pGrassTypes[2]->SetPhysTier(a_uTier, a_Tier);
+}
+
+void GrassFieldManager::AddCollider(Mesh* a_pMesh)
+{
+   m_pColliderGrid->Register(a_pMesh);
+}
+
+void GrassFieldManager::RemoveCollider(Mesh* a_pMesh)
+{
+   m_pColliderGrid->Unregister(a_pMesh);
+}
+
+void GrassFieldManager::GetPhysScheduleStats(PhysScheduleStats& a_Stats)
+{
+   ZeroMemory(&a_Stats, sizeof(a_Stats));
+   UINT i, t;
+   for (i = 0; i < GrassTypeNum; i++)
+   {
+      if (i == 1)
+         continue;
+      const PhysScheduleStats& stats = m_pGrassTypes[i]->GetPhysScheduleStats();
+      for (t = 0; t < PHYS_TIERS; t++)
+         a_Stats.uPatchesPerTier[t] += stats.uPatchesPerTier[t];
+      a_Stats.uUpdated += stats.uUpdated;
+      a_Stats.uSkippedByRate += stats.uSkippedByRate;
+      a_Stats.uDeferred += stats.uDeferred;
+      a_Stats.uDroppedSteps += stats.uDroppedSteps;
+      a_Stats.fPhysMs += stats.fPhysMs;
+      a_Stats.uCollideTested += stats.uCollideTested;
+      a_Stats.uCollideCulled += stats.uCollideCulled;
+   }
+}
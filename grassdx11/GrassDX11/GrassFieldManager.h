@@ -20,6 +20,9 @@
 
 #include "TexturesMixer.h"
 #include "AirData.h"
+#include "JobScheduler.h"
+#include "TrampleField.h"
+#include "ColliderGrid.h"
 
 class Car;
 
@@ -37,12 +40,17 @@ struct GrassFieldState
    std::wstring   sGrassOnTerrainTexturePath;
    float          fHeightScale;
    float          fTerrRadius;
+   /* wind solves per second, 0 - one every frame */
+   float          fWindSolveRate;
+   /* wind of ToggleSpectralWind */
+   WindSpectrumDesc SpectralWind;
 };
 
 class GrassFieldManager
 {
 public:
    bool                   isGrassRendering = true;
+   bool                   isSpectralWind = false;
 
    Terrain                    *m_pTerrain;
    float                       m_fHeightScale;
@@ -114,6 +122,10 @@ private:
    float3                       m_vCamDir;
    float3                       m_vCamPos;
    GrassTracker                *m_pGrassTracker;
+   JobScheduler                *m_pJobScheduler;
+   TrampleField                *m_pTrampleField;
+   ColliderGrid                *m_pColliderGrid;
+   WindSpectrumDesc             m_SpectralWind;
 
    void SetHeightScale       (float a_fHeightScale);
 
@@ -126,6 +138,7 @@ public:
    void SetGrassAmbient      (float a_fGrassAmbient);
    void SetWindStrength      (float a_fWindStrength);
    void SetWindSpeed         (float a_fWindSpeed);
+   void SetWindSolveRate     (float a_fRate);
    void SetProjMtx           (float4x4 &a_mProj);
    void SetViewMtx           (float4x4 &a_mView);
    void SetViewProjMtx       (float4x4 &a_mViewProj);
@@ -141,9 +154,39 @@ public:
    void SetTerrRGB           (float3 &a_vValue);
    void SetFogColor          (float4 &a_vColor);
    void ToggleRenderingGrass (void);
+   /* spectral wind or the gradient map */
+   void ToggleSpectralWind   (void);
 
    void ClearGrassPools      (void);
 
+   /**
+   Selects the blade solver of a sub-type of a grass type, a_iSubType -1 - of all its sub-types
+   */
+   void SetIntegrator        (UINT a_uGrassType, int a_iSubType, BladeIntegrator a_Integrator);
+
+   /**
+   Physics time budget of one frame for every grass type, and its update rate tiers
+   */
+   void SetPhysBudget        (float a_fBudgetMs);
+   void SetPhysTier          (UINT a_uTier, const PhysTier &a_Tier);
+
+   /**
+   Memory of every grass type for the poses of trampled patches that left the view
+   */
+   void SetDormantBudget     (UINT a_uBudgetKB);
+
+   /**
+   Adds a collider the grass bends under in every Update until it is removed,
+   besides the meshes passed to Update
+   */
+   void AddCollider          (Mesh *a_pMesh);
+   void RemoveCollider       (Mesh *a_pMesh);
+
+   /**
+   Sums the physics scheduling counters of the last frame over the grass types
+   */
+   void GetPhysScheduleStats (PhysScheduleStats &a_Stats);
+
    Terrain *    const GetTerrain     (float *a_fHeightScale, float *a_fGrassRadius);
    Wind*        const GetWind        (void) { return m_pWind; }
 
@@ -75,6 +75,8 @@ void GrassManager::LoadIndexData(void)
    SAFE_RELEASE(pRes);
    SAFE_RELEASE(pSRTex);
    SAFE_RELEASE(pStagingTex);
+
+   PhysPatch::InvalidateStaticData();
 }
 
 GrassManager::GrassManager(GrassInitState& a_pInitState, GrassTracker* a_pGrassTracker, FlowManager* a_pFlowManager)
@@ -218,6 +220,15 @@ void GrassManager::Init()
    /* pools for physics */
 //    m_GrassPool[0] = new GrassPool(m_GrassState.pD3DDevice, m_pInputLayout, m_pEffect, pGrassPatchLod0, 25, m_bUseLowGrass);
    m_GrassPool[0] = new GrassPool(m_GrassState.pD3DDevice, m_GrassState.pD3DDeviceCtx, m_pInputLayout, m_pEffect, pGrassPatchLod0, 35, m_bUseLowGrass);
+   m_pPhysBasePatch = pGrassPatchLod0;
+   m_GrassPool[0]->SetPhysStep(m_GrassState.fPhysStep, m_GrassState.uMaxPhysSubsteps);
+   m_GrassPool[0]->SetJobScheduler(m_GrassState.pJobScheduler);
+   m_GrassPool[0]->SetPhysBudget(m_GrassState.fPhysBudgetMs);
+   m_GrassPool[0]->SetDormantBudget(m_GrassState.uDormantBudgetKB * 1024);
+   m_GrassPool[0]->SetTrampleField(m_GrassState.pTrampleField);
+   m_GrassPool[0]->SetColliderGrid(m_GrassState.pColliderGrid);
+   /* the same grid as the patches of Update */
+   m_GrassPool[0]->SetPatchGrid(-m_GrassState.fGrassRadius + m_fPatchSize * 0.5f);
    //m_GrassPool[1] = new GrassPool(m_GrassState.pD3DDevice, m_pEffect, pGrassPatchLod1, 100);
    //PhysPatch::fGrassRadius = m_GrassState.fGrassRadius;
    PhysPatch::fTerrRadius = m_GrassState.fTerrRadius;
@@ -228,9 +239,10 @@ void GrassManager::Init()
    if (m_pRotatePattern)
       delete[] m_pRotatePattern;
    m_pRotatePattern = new DWORD[dwPatchCount];
+   RandomStream random(dwPatchCount);
    for (DWORD i = 0; i < dwPatchCount; i++)
    {
-      m_pRotatePattern[i] = rand() % 4;
+      m_pRotatePattern[i] = random.NextUInt(4);
    }
 
    m_pMostDetailedDistESV->SetFloat(m_GrassState.fMostDetailedDist);
@@ -292,6 +304,7 @@ void GrassManager::SetHeightDataPtr(const TerrainHeightData* a_pHeightData)
 {
    m_pHeightData = a_pHeightData;
    PhysPatch::pHeightData = a_pHeightData;
+   PhysPatch::InvalidateStaticData();
 }
 
 void GrassManager::SetWindDataPtr(const WindData* a_pWindData)
@@ -491,7 +504,7 @@ void GrassManager::Update(float4x4& a_mViewProj, float3 a_vCamPos, Mesh* a_pMesh
          {
             int ind = m_GrassPool[0]->GetPatchIndex(vPatchPos);
             if (ind != NO_VALUE)
-               m_GrassPool[0]->FreePatch(ind);
+               m_GrassPool[0]->SuspendPatch(ind);
 
             setz(vPatchPos, getz(vPatchPos) + m_fPatchSize);
             continue;
@@ -528,8 +541,25 @@ void GrassManager::Update(float4x4& a_mViewProj, float3 a_vCamPos, Mesh* a_pMesh
 
          if (fDist < physLodDst)
          {
-            for (k = 0; k < a_uNumMeshes; k++)
+            /* trampled before it left the view */
+            if (iLodPatchInd == NO_VALUE && m_GrassPool[0]->RestorePatch(mCurTransform))
+            {
+               iLodPatchInd = m_GrassPool[0]->GetPatchIndex(vPatchPos);
+               if (iLodPatchInd != NO_VALUE)
+                  m_GrassPool[0]->SetPatchVisibility(iLodPatchInd, true);
+            }
+
+            /* with the grid only the colliders around the patch are tried, their indices are into a_pMeshes then */
+            UINT uNear[PHYS_MAX_PATCH_COLLIDERS];
+            UINT uNumNear = a_uNumMeshes;
+            if (m_GrassState.pColliderGrid)
+            {
+               XMVECTOR vRange = XMVectorSet(m_fPatchSize, FLT_MAX, m_fPatchSize, 0.0f);
+               uNumNear = m_GrassState.pColliderGrid->Query(vPatchPos - vRange, vPatchPos + vRange, uNear, PHYS_MAX_PATCH_COLLIDERS);
+            }
+            for (UINT n = 0; n < uNumNear; n++)
             {
+               k = m_GrassState.pColliderGrid ? uNear[n] : n;
                vSpherePos = create(a_pMeshes[k]->GetPosAndRadius().x, 0.0f, a_pMeshes[k]->GetPosAndRadius().z);
 
                fRadius = a_pMeshes[k]->GetPosAndRadius().w;
@@ -580,12 +610,24 @@ ID3DX11Effect* GrassManager::GetEffect(void)
 void GrassManager::AddSubType(const GrassPropsUnified& a_SubTypeData)
 {
    m_SubTypeProps.push_back(a_SubTypeData);
+   PhysPatch::InvalidateStaticData();
+}
+
+
+void GrassManager::SetSubTypeIntegrator(int a_iSubType, BladeIntegrator a_Integrator)
+{
+   for (UINT i = 0; i < m_SubTypeProps.size(); i++)
+   {
+      if (a_iSubType < 0 || (UINT)a_iSubType == i)
+         m_SubTypeProps[i].uIntegrator = a_Integrator;
+   }
 }
 
 
 void GrassManager::ClearSubTypes(void)
 {
    m_SubTypeProps.clear();
+   PhysPatch::InvalidateStaticData();
 }
 
 
@@ -613,4 +655,27 @@ void GrassManager::ClearGrassPools(void)
 {
    for (int i = 0; i < m_GrassPool[0]->GetPatchCount(); i++)
       m_GrassPool[0]->FreePatch(i);
+   m_GrassPool[0]->ClearDormant();
+}
+
+void GrassManager::SetPhysBudget(float a_fBudgetMs)
+{
+   m_GrassState.fPhysBudgetMs = a_fBudgetMs;
+   m_GrassPool[0]->SetPhysBudget(a_fBudgetMs);
+}
+
+void GrassManager::SetDormantBudget(UINT a_uBudgetKB)
+{
+   m_GrassState.uDormantBudgetKB = a_uBudgetKB;
+   m_GrassPool[0]->SetDormantBudget(a_uBudgetKB * 1024);
+}
+
+void GrassManager::SetPhysTier(UINT a_uTier, const PhysTier& a_Tier)
+{
+   m_GrassPool[0]->SetPhysTier(a_uTier, a_Tier);
+}
+
+const PhysScheduleStats& GrassManager::GetPhysScheduleStats(void)
+{
+   return m_GrassPool[0]->GetScheduleStats();
 }
@@ -30,6 +30,19 @@ struct GrassInitState
     UINT             uNumCollidedPatchesPerMesh;
     UINT             uMaxColliders;
     float             fCameraMeshDist;
+    /* fixed physics step (seconds) and max steps per frame */
+    float             fPhysStep;
+    UINT              uMaxPhysSubsteps;
+    /* physics time budget of one frame (ms), 0 - unlimited */
+    float             fPhysBudgetMs;
+    /* memory of the poses of trampled patches that left the view (KB), 0 - forget them */
+    UINT              uDormantBudgetKB;
+    /* runs physics jobs, owned by GrassFieldManager */
+    JobScheduler     *pJobScheduler;
+    /* trample of the whole terrain, owned by GrassFieldManager */
+    TrampleField     *pTrampleField;
+    /* colliders by grid cell, rebuilt by GrassFieldManager::Update, Update gets its colliders */
+    ColliderGrid     *pColliderGrid;
     
    std::vector<std::wstring> sTexPaths;
     
@@ -73,6 +86,7 @@ private:
    DWORD                              *m_pRotatePattern;
    GrassLod                           *m_GrassLod[GrassLodsCount];
    GrassPool                          *m_GrassPool[GrassLodsCount - 1];//last lod don't need physics
+   GrassPatch                         *m_pPhysBasePatch;
    const WindData                     *m_pWindData;
    std::vector< GrassPropsUnified >    m_SubTypeProps;
    IndexMapData                        m_pIndexMapData;
@@ -143,8 +157,15 @@ public:
    void SetLowGrassDiffuse (float4 &a_vValue);
 
    void ClearGrassPools    (void);
+   void SetPhysBudget      (float a_fBudgetMs);
+   void SetPhysTier        (UINT a_uTier, const PhysTier &a_Tier);
+   void SetDormantBudget   (UINT a_uBudgetKB);
+
+   const PhysScheduleStats& GetPhysScheduleStats (void);
 
    void AddSubType         (const GrassPropsUnified &a_SubTypeData);
+   /* a_iSubType -1 - all sub-types */
+   void SetSubTypeIntegrator (int a_iSubType, BladeIntegrator a_Integrator);
    void ClearSubTypes      (void);
 
    void ApplyRenderPass (void) { m_pRenderPass->Apply(0, m_GrassState.pD3DDeviceCtx); }
@@ -73,6 +73,9 @@ void GrassPatch::GeneratePatch()
 
 void GrassPatch::GenerateBuffers()
 {
+   /* a patch made without a device is only a blade layout for the physics */
+   if (!m_pD3DDevice)
+      return;
    D3D11_BUFFER_DESC bufferDesc =
    {
       m_dwVerticesCount * sizeof(GrassVertex),
@@ -125,41 +128,43 @@ void GrassPatchLod0::GeneratePatch()
    DWORD dwStartVertIndex = 0;
    XMFLOAT3 vPivotPt = XMFLOAT3(0.0f, 0.0f, 0.0f);
    float fBlockSize = m_fPatchSize / m_dwBladesPerSide;
+   /* same patch every run */
+   RandomStream random(HashCombine(m_dwBladesPerSide, (UINT)(m_fPatchSize * 1000.0f)));
 
    for (dw4x4BlockZ = 0; dw4x4BlockZ < m_dwBladesPerSide; dw4x4BlockZ += 4)
    {
       for (dw4x4BlockX = 0; dw4x4BlockX < m_dwBladesPerSide; dw4x4BlockX += 4)
       {
          for (i = 0; i < 4; ++i)
-            f4LowAlpha[i] = fRand(0.0825f) + i * 0.0825f;// 0.0825 = 1/4 * 0.33
+            f4LowAlpha[i] = random.NextFloat(0.0f, 0.0825f) + i * 0.0825f;// 0.0825 = 1/4 * 0.33
          for (i = 0; i < 4; ++i)
             for (j = 0; j < 4; ++j)
             {
-               f4x4BlockAlpha[i * 4 + j] = f4LowAlpha[rand() % 4];//fRand(0.33f);
+               f4x4BlockAlpha[i * 4 + j] = f4LowAlpha[random.NextUInt(4)];//fRand(0.33f);
             }
          /* Choosing the most non-transparent blade */
-         dwTheChoosenOneX = rand() % 4;
-         dwTheChoosenOneZ = rand() % 4;
-         f4x4BlockAlpha[dwTheChoosenOneZ * 4 + dwTheChoosenOneX] = fRand(0.66f, 1.0f);
+         dwTheChoosenOneX = random.NextUInt(4);
+         dwTheChoosenOneZ = random.NextUInt(4);
+         f4x4BlockAlpha[dwTheChoosenOneZ * 4 + dwTheChoosenOneX] = random.NextFloat(0.66f, 1.0f);
          /* Choosing the most non-transparent blade in each 2x2 block */
          if (dwTheChoosenOneZ > 2 || dwTheChoosenOneX > 2)
          {
-            f4x4BlockAlpha[(rand() % 2) * 4 + (rand() % 2)] = f4LowAlpha[rand() % 4] + 0.33f;//fRand(0.33f, 0.66f);
+            f4x4BlockAlpha[random.NextUInt(2) * 4 + random.NextUInt(2)] = f4LowAlpha[random.NextUInt(4)] + 0.33f;//fRand(0.33f, 0.66f);
          }
 
          if (dwTheChoosenOneZ < 2 || dwTheChoosenOneX > 2)
          {
-            f4x4BlockAlpha[(rand() % 2 + 2) * 4 + (rand() % 2)] = f4LowAlpha[rand() % 4] + 0.33f;//fRand(0.33f, 0.66f);
+            f4x4BlockAlpha[(random.NextUInt(2) + 2) * 4 + random.NextUInt(2)] = f4LowAlpha[random.NextUInt(4)] + 0.33f;//fRand(0.33f, 0.66f);
          }
 
          if (dwTheChoosenOneZ > 2 || dwTheChoosenOneX < 2)
          {
-            f4x4BlockAlpha[(rand() % 2) * 4 + (rand() % 2 + 2)] = f4LowAlpha[rand() % 4] + 0.33f;//fRand(0.33f, 0.66f);
+            f4x4BlockAlpha[random.NextUInt(2) * 4 + (random.NextUInt(2) + 2)] = f4LowAlpha[random.NextUInt(4)] + 0.33f;//fRand(0.33f, 0.66f);
          }
 
          if (dwTheChoosenOneZ < 2 || dwTheChoosenOneX < 2)
          {
-            f4x4BlockAlpha[(rand() % 2 + 2) * 4 + (rand() % 2 + 2)] = f4LowAlpha[rand() % 4] + 0.33f;//fRand(0.33f, 0.66f);
+            f4x4BlockAlpha[(random.NextUInt(2) + 2) * 4 + (random.NextUInt(2) + 2)] = f4LowAlpha[random.NextUInt(4)] + 0.33f;//fRand(0.33f, 0.66f);
          }
 
 
@@ -167,27 +172,27 @@ void GrassPatchLod0::GeneratePatch()
          for (i = 0; i < 4; ++i)
             for (j = 0; j < 4; ++j)
             {
-               vPivotPt.x = (float(i + dw4x4BlockX) + fRand(1.0f)) * fBlockSize - m_fPatchSize / 2.0f;
-               vPivotPt.z = (float(j + dw4x4BlockZ) + fRand(1.0f)) * fBlockSize - m_fPatchSize / 2.0f;
+               vPivotPt.x = (float(i + dw4x4BlockX) + random.NextFloat()) * fBlockSize - m_fPatchSize / 2.0f;
+               vPivotPt.z = (float(j + dw4x4BlockZ) + random.NextFloat()) * fBlockSize - m_fPatchSize / 2.0f;
                vPivotPt.y = 0.0f;
-               GenerateBlade(&dwStartVertIndex, &vPivotPt, f4x4BlockAlpha[i * 4 + j]);
+               GenerateBlade(&dwStartVertIndex, &vPivotPt, f4x4BlockAlpha[i * 4 + j], random);
             }
       }
    }
 }
 
-void GrassPatchLod0::GenerateBlade (DWORD* a_pCurVerticesIndex, XMFLOAT3* a_pPivotPt, float a_fTransparency)
+void GrassPatchLod0::GenerateBlade (DWORD* a_pCurVerticesIndex, XMFLOAT3* a_pPivotPt, float a_fTransparency, RandomStream& a_Random)
 {
    DWORD& dwVertInd = *a_pCurVerticesIndex;
    m_pVertices[dwVertInd].vPos = *a_pPivotPt;
    m_pVertices[dwVertInd].fTransparency = a_fTransparency;
    m_pVertices[dwVertInd].vRotAxe.y = 0.0f;
-   m_pVertices[dwVertInd].vRotAxe.x = SignedfRand(8.5f) + 1.0f;
-   m_pVertices[dwVertInd].vRotAxe.z = SignedfRand(9.5f);
+   m_pVertices[dwVertInd].vRotAxe.x = a_Random.NextFloat(-8.5f, 8.5f) + 1.0f;
+   m_pVertices[dwVertInd].vRotAxe.z = a_Random.NextFloat(-9.5f, 9.5f);
 
    XM_TO_V(m_pVertices[dwVertInd].vRotAxe, rotAxe, 3);
    float fLen = XMVectorGetX(XMVector3Length(rotAxe));
-   rotAxe *= (fRand(8.f) / fLen);
+   rotAxe *= (a_Random.NextFloat(0.0f, 8.f) / fLen);
    //    m_pVertices[dwVertInd].vRotAxe *= (fRand(10.f)/fLen);
    XMStoreFloat3(&m_pVertices[dwVertInd].vRotAxe, rotAxe);
 
@@ -197,7 +202,7 @@ void GrassPatchLod0::GenerateBlade (DWORD* a_pCurVerticesIndex, XMFLOAT3* a_pPiv
    
    XM_TO_V(m_pVertices[dwVertInd].vYRotAxe, YrotAxe, 3);
    fLen = XMVectorGetX(XMVector3Length(YrotAxe));
-   YrotAxe *= (fRand(90.f) / fLen);
+   YrotAxe *= (a_Random.NextFloat(0.0f, 90.f) / fLen);
    XMStoreFloat3(&m_pVertices[dwVertInd].vYRotAxe, YrotAxe);
 
    //m_pVertices[dwVertInd].vRotAxe.y = 0.0f;
@@ -214,7 +219,7 @@ void GrassPatchLod0::GenerateBlade (DWORD* a_pCurVerticesIndex, XMFLOAT3* a_pPiv
       std::pair<float3, float>(create(0.34f, 0.60f, 0.00f), 0.1f),
    };
 
-   float rand_param = fRand(1);
+   float rand_param = a_Random.NextFloat();
    for (UINT i = 0; i < sizeof(colors) / sizeof(colors[0]); ++i)
       if (rand_param <= colors[i].second)
       {
@@ -1,5 +1,6 @@
 #pragma once
 #include "includes.h"
+#include "PhysRandom.h"
 
 struct GrassVertex
 {
@@ -56,7 +57,7 @@ class GrassPatchLod0 : public GrassPatch
 {
 private:
    void GeneratePatch (void);
-   void GenerateBlade (DWORD* a_pCurVerticesIndex, XMFLOAT3* a_pPivotPt, float a_fTransparency);
+   void GenerateBlade (DWORD* a_pCurVerticesIndex, XMFLOAT3* a_pPivotPt, float a_fTransparency, RandomStream& a_Random);
 
 public:
    GrassPatchLod0  (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx, float a_fPatchSize, DWORD a_dwBladesPerSide);
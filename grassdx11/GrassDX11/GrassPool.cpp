@@ -1,13 +1,15 @@
 #include "GrassPool.h"
-//#include <omp.h>
 
-GrassPatchExt::GrassPatchExt (GrassPatch* a_pPatch)
-   : Patch(a_pPatch)
+#include <algorithm>
+
+GrassPatchExt::GrassPatchExt (GrassPatch* a_pPatch, PhysSlab* a_pSlab)
+   : Patch(a_pPatch, a_pSlab)
 {
-   fLifeTime = 0.0f;
-   pNext = NULL;
-   pPrev = NULL;
-   bIsDead = true;
+   iPoolIndex = NO_VALUE;
+   uPhysTier = 0;
+   uStepsPending = 0;
+   fLastStepDt = 0.0f;
+   fCamDist = 0.0f;
 }
 
 GrassPool::GrassPool (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx, ID3D11InputLayout* a_pAnimInputLayout,
@@ -21,6 +23,7 @@ GrassPool::GrassPool (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDev
    m_pRenderPhysPass = a_pEffect->GetTechniqueByName("RenderGrass")->GetPassByName("RenderPhysPass");
    m_pShadowPassPhys = a_pEffect->GetTechniqueByName("RenderGrass")->GetPassByName("ShadowPhysicsPass");
    m_pShadowPassAnim = a_pEffect->GetTechniqueByName("RenderGrass")->GetPassByName("ShadowAnimPass");
+   m_pPatchOriginEVV = a_pEffect->GetVariableByName("g_vPhysPatchOrigin")->AsVector();
 
    if (m_bUseLowGrass)
    {
@@ -32,21 +35,11 @@ GrassPool::GrassPool (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDev
 
    const D3D11_INPUT_ELEMENT_DESC InputLayoutDesc[] =
    {
-      { "R0MTX"         , 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R0MTX"         , 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R0MTX"         , 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R0MTX"         , 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R1MTX"         , 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R1MTX"         , 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R1MTX"         , 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R1MTX"         , 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R2MTX"         , 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R2MTX"         , 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R2MTX"         , 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "R2MTX"         , 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "POSITION"      , 0, DXGI_FORMAT_R32G32B32_FLOAT   , 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "TRANSPARENCY"  , 0, DXGI_FORMAT_R32_FLOAT         , 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-      { "BLADECOLOR"    , 0, DXGI_FORMAT_R32G32B32_FLOAT   , 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+      { "POSITION"      , 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+      { "SEGQUAT"       , 0, DXGI_FORMAT_R10G10B10A2_UNORM , 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+      { "SEGQUAT"       , 1, DXGI_FORMAT_R10G10B10A2_UNORM , 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+      { "SEGQUAT"       , 2, DXGI_FORMAT_R10G10B10A2_UNORM , 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+      { "BLADECOLOR"    , 0, DXGI_FORMAT_R8G8B8A8_UNORM    , 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
    };
    int iNumElements = sizeof(InputLayoutDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
 
@@ -56,34 +49,61 @@ GrassPool::GrassPool (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDev
       PassDesc.pIAInputSignature, PassDesc.IAInputSignatureSize,
       &m_pPhysInputLayout);
 
-   m_pPatches = new GrassPatchExt * [a_iPatchCount];
-   m_iPatchCount = a_iPatchCount;
-   /* list of free space */
-   int i;
-   for (i = 0; i < m_iPatchCount; i++)
-      m_pPatches[i] = new GrassPatchExt(a_pBasePatch);
+   Init(a_pBasePatch, a_iPatchCount);
+}
 
-   for (i = 0; i < m_iPatchCount; i++)
+GrassPool::GrassPool (GrassPatch* a_pBasePatch, int a_iPatchCount)
+{
+   m_pAnimInputLayout = NULL;
+   m_pPhysInputLayout = NULL;
+   m_pD3DDevice = NULL;
+   m_pD3DDeviceCtx = NULL;
+   m_bUseLowGrass = false;
+   m_pRenderAnimPass = NULL;
+   m_pRenderPhysPass = NULL;
+   m_pShadowPassPhys = NULL;
+   m_pShadowPassAnim = NULL;
+   m_pLowGrassAnimPass = NULL;
+   m_pLowGrassPhysPass = NULL;
+   m_pShadowLowGrassAnimPass = NULL;
+   m_pShadowLowGrassPhysPass = NULL;
+   m_pPatchOriginEVV = NULL;
+   Init(a_pBasePatch, a_iPatchCount);
+}
+
+void GrassPool::Init (GrassPatch* a_pBasePatch, int a_iPatchCount)
+{
+   m_fPhysStep = 1.0f / 60.0f;
+   m_uMaxPhysSubsteps = 4;
+   m_fPhysTime = 0.0f;
+   m_pJobScheduler = NULL;
+   m_fPhysBudgetMs = 0.0f;
+   m_uPhysStepIndex = 0;
+   m_fCellSize = a_pBasePatch->GetPatchSize();
+   m_Slots.SetGrid(0.0f, m_fCellSize);
+   ZeroMemory(&m_ScheduleStats, sizeof(m_ScheduleStats));
+   /* near the camera or a collider - every step, then every 2nd and every 4th step */
+   PhysTier Tiers[PHYS_TIERS] =
    {
-      if (i != 0)
-      {
-         m_pPatches[i]->pPrev = m_pPatches[i - 1];
-      }
-      else
-      {
-         m_pPatches[i]->pPrev = NULL;
-      }
-      if (i != m_iPatchCount - 1)
-      {
-         m_pPatches[i]->pNext = m_pPatches[i + 1];
-      }
-      else
-      {
-         m_pPatches[i]->pNext = NULL;
-      }
-   }
-   m_pFirst = m_pPatches[0];
-   m_pLast = m_pPatches[m_iPatchCount - 1];
+      { 1.0f,  6.0f, 1 },
+      { 2.0f, 15.0f, 2 },
+      { 0.0f,  0.0f, 4 },
+   };
+   for (int t = 0; t < PHYS_TIERS; t++)
+      m_PhysTiers[t] = Tiers[t];
+
+   m_pBasePatch = a_pBasePatch;
+   m_iPatchCount = 0;
+   m_iChunkSize = max(a_iPatchCount, 1);
+   m_iMaxPatchCount = m_iChunkSize * 8;
+   m_fShrinkDelay = 10.0f;
+   m_fLastHighTime = 0.0f;
+   m_fPoolTime = 0.0f;
+   m_uDormantBytes = 0;
+   m_uDormantBudget = 1024 * 1024;
+   m_pTrampleField = NULL;
+   m_pColliderGrid = NULL;
+   Grow(m_iChunkSize);
 }
 
 GrassPool::~GrassPool()
@@ -92,10 +112,64 @@ GrassPool::~GrassPool()
    {
       delete m_pPatches[i];
    }
-   delete[] m_pPatches;
+   for (size_t i = 0; i < m_Chunks.size(); i++)
+      delete m_Chunks[i].pSlab;
    SAFE_RELEASE(m_pPhysInputLayout);
 }
 
+bool GrassPool::Grow (int a_iCount)
+{
+   a_iCount = min(a_iCount, m_iMaxPatchCount - m_iPatchCount);
+   if (a_iCount <= 0)
+      return false;
+
+   PatchChunk chunk;
+   chunk.pSlab = new PhysSlab(a_iCount * PhysPatch::SlabBytes(m_pBasePatch));
+   /* out of memory: the pool stays as it is, an empty one takes no patches */
+   if (!chunk.pSlab->IsValid())
+   {
+      delete chunk.pSlab;
+      return false;
+   }
+   chunk.iFirst = m_iPatchCount;
+   chunk.iCount = a_iCount;
+   m_Chunks.push_back(chunk);
+
+   m_pPatches.resize(m_iPatchCount + a_iCount);
+   for (int i = m_iPatchCount; i < m_iPatchCount + a_iCount; i++)
+   {
+      m_pPatches[i] = new GrassPatchExt(m_pBasePatch, chunk.pSlab);
+      m_pPatches[i]->iPoolIndex = i;
+   }
+   m_Slots.Grow(a_iCount);
+   m_iPatchCount += a_iCount;
+   return true;
+}
+
+void GrassPool::TryShrink (void)
+{
+   if (m_Chunks.size() < 2 || m_fPoolTime - m_fLastHighTime < m_fShrinkDelay)
+      return;
+
+   const PatchChunk& chunk = m_Chunks.back();
+   if (!m_Slots.Shrink(chunk.iFirst))
+      return;
+
+   for (int i = chunk.iFirst; i < m_iPatchCount; i++)
+      delete m_pPatches[i];
+   delete chunk.pSlab;
+   m_iPatchCount = chunk.iFirst;
+   m_pPatches.resize(m_iPatchCount);
+   m_Chunks.pop_back();
+   m_fLastHighTime = m_fPoolTime;
+}
+
+void GrassPool::SetPoolLimits (int a_iMaxPatchCount, float a_fShrinkDelay)
+{
+   m_iMaxPatchCount = max(a_iMaxPatchCount, m_iChunkSize);
+   m_fShrinkDelay = a_fShrinkDelay;
+}
+
 int GrassPool::GetPatchCount (void)
 {
    return m_iPatchCount;
@@ -116,57 +190,165 @@ const PhysPatch& GrassPool::GetPatch (int a_iPatchIndex)
 
 float GrassPool::GetLifeTime (int a_iPatchIndex)
 {
-   return m_pPatches[a_iPatchIndex]->fLifeTime;
+   return m_Slots.ExpireTime(a_iPatchIndex) - m_fPoolTime;
 }
 
-bool GrassPool::FreePatch (XMVECTOR a_vPatchPos)
+UINT64 GrassPool::CellKey (XMVECTOR a_vPatchPos)
 {
-   /* looking for a match */
-   int i;
-   for (i = 0; i < m_iPatchCount; i++)
+   return m_Slots.CellKey(getx(a_vPatchPos), getz(a_vPatchPos));
+}
+
+void GrassPool::KillPatch (GrassPatchExt* a_pPatch)
+{
+   m_Slots.Kill(a_pPatch->iPoolIndex);
+}
+
+GrassPatchExt* GrassPool::TakeFreePatch (XMVECTOR a_vPatchPos)
+{
+   int i = m_Slots.Take(getx(a_vPatchPos), getz(a_vPatchPos));
+   if (i == NO_VALUE)
    {
-      /* skipping dead patches */
-      //if (m_pPatches[i]->fLifeTime == 0.0f)
-      //    continue;
-      if (m_pPatches[i]->bIsDead)
-         continue;
-      if (XMVector3Alike(GetPatchPos(i), a_vPatchPos))
-      {
-         /* match found, returning true and killing patch */
-         m_pPatches[i]->bIsDead = true;
-         m_pPatches[i]->inFirstLod = false;
-         return true;
-      }
+      if (!Grow(m_iChunkSize))
+         return NULL;
+      i = m_Slots.Take(getx(a_vPatchPos), getz(a_vPatchPos));
    }
-   return false;
+
+   /* the last chunk is still needed */
+   if (m_Slots.AliveCount() > m_Chunks.back().iFirst)
+      m_fLastHighTime = m_fPoolTime;
+   return m_pPatches[i];
+}
+
+void GrassPool::SetLifeTime (GrassPatchExt* a_pPatch, float a_fLifeTime)
+{
+   m_Slots.SetExpireTime(a_pPatch->iPoolIndex, m_fPoolTime + a_fLifeTime);
+}
+
+void GrassPool::ValidateIndex (void)
+{
+#ifdef _DEBUG
+   assert(IndexMismatches() == 0);
+#endif
+}
+
+UINT GrassPool::IndexMismatches (void)
+{
+   return m_Slots.Mismatches();
+}
+
+void GrassPool::SetPatchGrid (float a_fOrigin)
+{
+   m_Slots.SetGrid(a_fOrigin, m_fCellSize);
+}
+
+bool GrassPool::FreePatch (XMVECTOR a_vPatchPos)
+{
+   int i = GetPatchIndex(a_vPatchPos);
+   if (i == NO_VALUE)
+      return false;
+
+   /* match found, returning true and killing patch */
+   KillPatch(m_pPatches[i]);
+   m_pPatches[i]->inFirstLod = false;
+   return true;
 }
 
 bool GrassPool::FreePatch (int a_iPatchIndex)
 {
-   if ((a_iPatchIndex > m_iPatchCount) || (a_iPatchIndex < 0))
+   if ((a_iPatchIndex >= m_iPatchCount) || (a_iPatchIndex < 0))
       return false;
-   m_pPatches[a_iPatchIndex]->bIsDead = true;
+   KillPatch(m_pPatches[a_iPatchIndex]);
    m_pPatches[a_iPatchIndex]->inFirstLod = false;
    return true;
 }
 
-int GrassPool::GetPatchIndex (XMVECTOR a_vPatchPos)
+/* list node and map entry of a dormant patch */
+#define DORMANT_ENTRY_OVERHEAD 64
+
+bool GrassPool::SuspendPatch (int a_iPatchIndex)
 {
-   /* looking for a match */
-   int i;
-   for (i = 0; i < m_iPatchCount; i++)
-   {
-      /* skipping dead patches */
-      if (m_pPatches[i]->bIsDead)
-         continue;
+   if ((a_iPatchIndex >= m_iPatchCount) || (a_iPatchIndex < 0))
+      return false;
 
-      if (XMVector3Alike(GetPatchPos(i), a_vPatchPos))
-      {
-         /* match found */
-         return i;
-      }
+   GrassPatchExt* pPatch = m_pPatches[a_iPatchIndex];
+   float fLifeTime = GetLifeTime(a_iPatchIndex);
+   if (m_Slots.IsAlive(a_iPatchIndex) && m_uDormantBudget > 0 && fLifeTime > 0.0f && pPatch->Patch.SaveDormant(m_DormantScratch))
+   {
+      UINT64 uKey = CellKey(GetPatchPos(a_iPatchIndex));
+      auto it = m_DormantIndex.find(uKey);
+      if (it != m_DormantIndex.end())
+         EraseDormant(it->second);
+
+      DormantPatch dormant;
+      dormant.uKey = uKey;
+      dormant.fLifeTime = fLifeTime;
+      dormant.uMeshIndex = pPatch->uMeshIndex;
+      m_Dormant.push_front(dormant);
+      m_Dormant.front().Data.swap(m_DormantScratch);
+      m_DormantIndex[uKey] = m_Dormant.begin();
+      m_uDormantBytes += m_Dormant.front().Data.size() + DORMANT_ENTRY_OVERHEAD;
+
+      while (m_uDormantBytes > m_uDormantBudget && !m_Dormant.empty())
+         EraseDormant(--m_Dormant.end());
    }
-   return NO_VALUE;
+   return FreePatch(a_iPatchIndex);
+}
+
+bool GrassPool::RestorePatch (XMMATRIX a_mTransform)
+{
+   auto it = m_DormantIndex.find(CellKey(a_mTransform.r[3]));
+   if (it == m_DormantIndex.end())
+      return false;
+
+   DormantPatch& dormant = *it->second;
+   return TakePatch(a_mTransform, dormant.fLifeTime, dormant.uMeshIndex);
+}
+
+bool GrassPool::WakeDormant (GrassPatchExt* a_pPatch)
+{
+   auto it = m_DormantIndex.find(CellKey(GetPatchPos(a_pPatch->iPoolIndex)));
+   if (it == m_DormantIndex.end())
+      return false;
+
+   a_pPatch->Patch.LoadDormant(it->second->Data);
+   EraseDormant(it->second);
+   return true;
+}
+
+void GrassPool::EraseDormant (std::list<DormantPatch>::iterator a_It)
+{
+   m_uDormantBytes -= a_It->Data.size() + DORMANT_ENTRY_OVERHEAD;
+   m_DormantIndex.erase(a_It->uKey);
+   m_Dormant.erase(a_It);
+}
+
+void GrassPool::SetDormantBudget (size_t a_uBytes)
+{
+   m_uDormantBudget = a_uBytes;
+   while (m_uDormantBytes > m_uDormantBudget && !m_Dormant.empty())
+      EraseDormant(--m_Dormant.end());
+}
+
+void GrassPool::ClearDormant (void)
+{
+   m_Dormant.clear();
+   m_DormantIndex.clear();
+   m_uDormantBytes = 0;
+}
+
+void GrassPool::SetTrampleField (const TrampleField* a_pField)
+{
+   m_pTrampleField = a_pField;
+}
+
+void GrassPool::SetColliderGrid (const ColliderGrid* a_pGrid)
+{
+   m_pColliderGrid = a_pGrid;
+}
+
+int GrassPool::GetPatchIndex (XMVECTOR a_vPatchPos)
+{
+   return m_Slots.Find(getx(a_vPatchPos), getz(a_vPatchPos));
 }
 
 void GrassPool::SetPatchVisibility (int a_iPatchIndex, bool isVisible)
@@ -186,33 +368,28 @@ bool GrassPool::TakePatch (XMMATRIX a_mTransform, float a_fLifeTime, UINT a_uMes
       getz(a_mTransform.r[3]));
 
    /* looking for a match */
-   int i;
-   for (i = 0; i < m_iPatchCount; i++)
+   int i = GetPatchIndex(vNewPos);
+   if (i != NO_VALUE)
    {
-      /* skipping dead patches */
-      if (m_pPatches[i]->bIsDead)
-         continue;
-      if (XMVector3Alike(GetPatchPos(i), vNewPos))
-      {
-         /* match found, returning true */
-         m_pPatches[i]->fLifeTime = a_fLifeTime;
-         m_pPatches[i]->uMeshIndex = a_uMeshIndex;
-         return true;
-      }
+      /* match found, returning true */
+      SetLifeTime(m_pPatches[i], a_fLifeTime);
+      m_pPatches[i]->uMeshIndex = a_uMeshIndex;
+      return true;
    }
    /* looking for a dead patch otherwise*/
-   GrassPatchExt* pPatch = m_pFirst;
+   GrassPatchExt* pPatch = TakeFreePatch(vNewPos);
 
    if (pPatch)
    {
       XMStoreFloat4x4(&pPatch->Transform, a_mTransform);
       pPatch->Patch.SetTransform(&pPatch->Transform);
-      pPatch->fLifeTime = a_fLifeTime;
       pPatch->uMeshIndex = a_uMeshIndex;
       pPatch->inFirstLod = false;
-      pPatch->bIsDead = false;
+      SetLifeTime(pPatch, a_fLifeTime);
       pPatch->Patch.Reinit();
-      m_pFirst = m_pFirst->pNext;
+      if (!WakeDormant(pPatch) && m_pTrampleField)
+         pPatch->Patch.ApplyTrample(*m_pTrampleField);
+      ResetPatchSchedule(pPatch);
    }
    else
       return false;
@@ -228,23 +405,18 @@ bool GrassPool::TakePatch (XMMATRIX a_mTransform, bool a_bInFirstLod)
       getz(a_mTransform.r[3]));
 
    /* looking for a match */
-   int i;
-   for (i = 0; i < m_iPatchCount; i++)
+   int i = GetPatchIndex(vNewPos);
+   if (i != NO_VALUE)
    {
-      /* skipping dead patches */
-      if (m_pPatches[i]->bIsDead)
-         continue;
-      if (XMVector3Alike(GetPatchPos(i), vNewPos))
+      /* match found, returning true */
+      /* leaving the first lod: ClearDeadPatches skipped the patch while it was there */
+      m_pPatches[i]->inFirstLod = a_bInFirstLod;
+      if (!a_bInFirstLod && (GetLifeTime(i) <= 0.0f || m_pPatches[i]->uMeshIndex == -1))
       {
-         /* match found, returning true */
-         m_pPatches[i]->inFirstLod = a_bInFirstLod;
-         if (!a_bInFirstLod && m_pPatches[i]->fLifeTime <= 0.0f)
-         {
-            m_pPatches[i]->bIsDead = true;
-            return false;
-         }
-         return true;
+         KillPatch(m_pPatches[i]);
+         return false;
       }
+      return true;
    }
 
    //not found and not in phys lod
@@ -252,18 +424,20 @@ bool GrassPool::TakePatch (XMMATRIX a_mTransform, bool a_bInFirstLod)
       return false;
 
    //not found and in phys lod and without collision
-   GrassPatchExt* pPatch = m_pFirst;
+   GrassPatchExt* pPatch = TakeFreePatch(vNewPos);
 
    if (pPatch)
    {
       XMStoreFloat4x4(&pPatch->Transform, a_mTransform);
       pPatch->Patch.SetTransform(&pPatch->Transform);
-      pPatch->fLifeTime = 0.0f;
       pPatch->uMeshIndex = -1;
       pPatch->inFirstLod = a_bInFirstLod;
-      pPatch->bIsDead = false;
+      /* lives while it is in the first lod */
+      SetLifeTime(pPatch, 0.0f);
       pPatch->Patch.Reinit();
-      m_pFirst = m_pFirst->pNext;
+      if (!WakeDormant(pPatch) && m_pTrampleField)
+         pPatch->Patch.ApplyTrample(*m_pTrampleField);
+      ResetPatchSchedule(pPatch);
       return true;
    }
 
@@ -272,136 +446,260 @@ bool GrassPool::TakePatch (XMMATRIX a_mTransform, bool a_bInFirstLod)
 
 void GrassPool::ClearDeadPatches (float a_fElapsedTime)
 {
-   int i;
-   m_pFirst = NULL;
-   m_pLast = NULL;
+   float fDeathTime = m_fPoolTime + a_fElapsedTime;
 
-   for (i = 0; i < m_iPatchCount; i++)
+   for (int i = m_Slots.PopExpired(fDeathTime); i != NO_VALUE; i = m_Slots.PopExpired(fDeathTime))
    {
-      /* killing patches */
-      if (!m_pPatches[i]->bIsDead)
+      /* killing patches, first lod ones are killed by TakePatch when they leave it */
+      GrassPatchExt* pPatch = m_pPatches[i];
+      if (m_Slots.IsAlive(i) && !pPatch->inFirstLod)
       {
-         if (((m_pPatches[i]->fLifeTime - a_fElapsedTime) <= 0.0f || m_pPatches[i]->uMeshIndex == -1) &&
-            !m_pPatches[i]->inFirstLod)
-         {
-            m_pPatches[i]->bIsDead = true;
-            m_pPatches[i]->fLifeTime = 0.0f;
-            //m_pPatches[i]->Patch.Reinit();
-            m_pPatches[i]->Patch.SetTransform(NULL);
-         }
+         KillPatch(pPatch);
+         //pPatch->Patch.Reinit();
+         pPatch->Patch.SetTransform(NULL);
       }
+   }
+   TryShrink();
+   ValidateIndex();
+}
 
-      /* constructing list of dead patches */
-      if (m_pPatches[i]->bIsDead)
-      {
-         if (m_pFirst == NULL)
-         {
-            m_pLast = m_pFirst = m_pPatches[i];
-            m_pPatches[i]->pNext = NULL;
-         }
-         else
-         {
-            m_pLast->pNext = m_pPatches[i];
-            m_pPatches[i]->pNext = NULL;
-            m_pLast = m_pPatches[i];
-         }
-      }
+void GrassPool::SetPhysStep (float a_fStep, UINT a_uMaxSubsteps)
+{
+   /* the solver takes steps of [PHYS_MIN_STEP, PHYS_MAX_STEP] as they are */
+   m_fPhysStep = min(max(a_fStep, PHYS_MIN_STEP), PHYS_MAX_STEP);
+   m_uMaxPhysSubsteps = max(a_uMaxSubsteps, 1u);
+}
+
+void GrassPool::SetJobScheduler (JobScheduler* a_pScheduler)
+{
+   m_pJobScheduler = a_pScheduler;
+}
+
+void GrassPool::SetPhysTier (UINT a_uTier, const PhysTier& a_Tier)
+{
+   if (a_uTier >= PHYS_TIERS)
+      return;
+   m_PhysTiers[a_uTier] = a_Tier;
+   if (m_PhysTiers[a_uTier].uPeriod == 0)
+      m_PhysTiers[a_uTier].uPeriod = 1;
+}
+
+void GrassPool::SetPhysBudget (float a_fBudgetMs)
+{
+   m_fPhysBudgetMs = a_fBudgetMs;
+}
+
+const PhysScheduleStats& GrassPool::GetScheduleStats (void)
+{
+   return m_ScheduleStats;
+}
+
+void GrassPool::ResetPatchSchedule (GrassPatchExt* a_pPatch)
+{
+   a_pPatch->uPhysTier = 0;
+   a_pPatch->uStepsPending = 0;
+   a_pPatch->fLastStepDt = m_fPhysStep;
+}
+
+void GrassPool::AssignPhysTier (GrassPatchExt* a_pPatch, const float3& viewPos, float physLodDst, Mesh* a_pMeshes[], UINT a_uNumMeshes)
+{
+   float3 vPatchPos = create(a_pPatch->Transform._41, a_pPatch->Transform._42, a_pPatch->Transform._43);
+   a_pPatch->fCamDist = XMVectorGetX(XMVector3Length(vPatchPos - viewPos));
+
+   /* patches a mesh has collided are stepped every time */
+   if (a_pPatch->uMeshIndex != -1 && a_uNumMeshes > 0)
+   {
+      a_pPatch->uPhysTier = 0;
+      return;
    }
+
+   /* distance to the surface of the nearest collider sphere, the ones out of reach of the tiers are left out */
+   Mesh* pColliders[PHYS_MAX_PATCH_COLLIDERS];
+   if (m_pColliderGrid)
+   {
+      float fRange = 0.0f;
+      for (UINT t = 0; t < PHYS_TIERS - 1; t++)
+         fRange = max(fRange, m_PhysTiers[t].fColliderDist);
+      a_uNumMeshes = PatchColliders(a_pPatch, fRange, pColliders);
+      a_pMeshes = pColliders;
+   }
+
+   float fColliderDist = FLT_MAX;
+   for (UINT m = 0; m < a_uNumMeshes; m++)
+   {
+      XMFLOAT4 sphere = a_pMeshes[m]->GetPosAndRadius();
+      float fDist = XMVectorGetX(XMVector3Length(vPatchPos - create(sphere.x, sphere.y, sphere.z))) - sphere.w;
+      fColliderDist = min(fColliderDist, fDist);
+   }
+
+   UINT uTier = 0;
+   while (uTier < PHYS_TIERS - 1 &&
+          a_pPatch->fCamDist >= m_PhysTiers[uTier].fCamDist * physLodDst &&
+          fColliderDist >= m_PhysTiers[uTier].fColliderDist)
+      uTier++;
+   a_pPatch->uPhysTier = uTier;
+}
+
+float GrassPool::FrameMs (void)
+{
+   return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - m_tFrameStart).count();
 }
 
 UINT PhysPatch::uTickCount = 0;
-static int MaxPatchCount = 0;
-static int NPatchs1[32];
-static int NPatchs2[32];
-static int j1_ = 0, j2_ = 0, m_ = 0;
 
-void GrassPool::Update (const float3& viewPos, float physLodDst, float a_fElapsedTime, Mesh* a_pMeshes[], UINT a_uNumMeshes, const std::vector<GrassPropsUnified>& grassProps, const IndexMapData& indexMapData)
+UINT GrassPool::PatchColliders (GrassPatchExt* a_pPatch, float a_fRange, Mesh** a_ppOut)
+{
+   /* patch transforms are on the plane, so the box is not bounded in y */
+   XMVECTOR vPatchPos = XMVectorSet(a_pPatch->Transform._41, 0.0f, a_pPatch->Transform._43, 0.0f);
+   XMVECTOR vRange = XMVectorSet(a_fRange, FLT_MAX, a_fRange, 0.0f);
+   UINT uIndices[PHYS_MAX_PATCH_COLLIDERS];
+   UINT uCount = m_pColliderGrid->Query(vPatchPos - vRange, vPatchPos + vRange, uIndices, PHYS_MAX_PATCH_COLLIDERS);
+   for (UINT m = 0; m < uCount; m++)
+      a_ppOut[m] = m_pColliderGrid->Collider(uIndices[m]);
+   return uCount;
+}
+
+void GrassPool::StepPatches (const float3& viewPos, float physLodDst, Mesh* a_pMeshes[], UINT a_uNumMeshes, const std::vector<GrassPropsUnified>& grassProps, const IndexMapData& indexMapData, bool a_bScheduled)
 {
-   j1_ = 0;
-   j2_ = 0;
-   m_ = 0;
+   m_StepPatches.clear();
    for (int i = 0; i < m_iPatchCount; i++)
    {
-      if (!m_pPatches[i]->bIsDead)
+      GrassPatchExt* pPatch = m_pPatches[i];
+      if (!m_Slots.IsAlive(pPatch->iPoolIndex) || !pPatch->isVisible)
+         continue;
+
+      /* a patch catches up on m_uMaxPhysSubsteps steps at most, older ones are dropped */
+      if (pPatch->uStepsPending < m_uMaxPhysSubsteps)
+         pPatch->uStepsPending++;
+      else
+         m_ScheduleStats.uDroppedSteps++;
+      if (a_bScheduled)
       {
-         if (m_ == 0)
-         {
-            NPatchs1[j1_] = i;
-            j1_++;
-            m_ = 1;
-         }
-         else
+         AssignPhysTier(pPatch, viewPos, physLodDst, a_pMeshes, a_uNumMeshes);
+
+         /* patches of a tier are spread over its period, a deferred patch is due until it is stepped,
+            a period longer than m_uMaxPhysSubsteps is cut to it so that no steps are dropped */
+         UINT uPeriod = min(m_PhysTiers[pPatch->uPhysTier].uPeriod, m_uMaxPhysSubsteps);
+         if ((m_uPhysStepIndex + i) % uPeriod != 0 && pPatch->uStepsPending < uPeriod)
          {
-            NPatchs2[j2_] = i;
-            j2_++;
-            m_ = 0;
+            m_ScheduleStats.uSkippedByRate++;
+            continue;
          }
       }
+      m_StepPatches.push_back(pPatch);
    }
 
-#pragma omp parallel sections num_threads(2)
+   if (a_bScheduled)
    {
-#pragma omp section
+      m_uPhysStepIndex++;
+
+      /* priority: lower tier, then longer waiting, then nearer to the camera */
+      std::sort(m_StepPatches.begin(), m_StepPatches.end(), [](const GrassPatchExt* a, const GrassPatchExt* b)
       {
-         int i, PatchCount = 0;
-         //         for (int i = 0; i < m_iPatchCount; i += 2)
-         for (int k = 0; k < j1_; k++)
+         if (a->uPhysTier != b->uPhysTier)
+            return a->uPhysTier < b->uPhysTier;
+         if (a->uStepsPending != b->uStepsPending)
+            return a->uStepsPending > b->uStepsPending;
+         return a->fCamDist < b->fCamDist;
+      });
+   }
+
+   std::atomic<UINT> uNext(0);
+   std::atomic<UINT> uNumUpdated(0);
+   std::atomic<UINT> uNumDeferred(0);
+   std::atomic<UINT> uNumCollideTested(0);
+   std::atomic<UINT> uNumCollideCulled(0);
+
+   /* one job per patch, every patch splits its blades into further jobs */
+   auto UpdatePatches = [&](UINT a_uBegin, UINT a_uEnd)
+   {
+      for (UINT k = a_uBegin; k < a_uEnd; k++)
+      {
+         /* jobs take the patches in the priority order, whatever order the scheduler runs them in */
+         GrassPatchExt* pPatch = m_StepPatches[uNext++];
+         if (a_bScheduled && pPatch->uPhysTier > 0 && m_fPhysBudgetMs > 0.0f && FrameMs() > m_fPhysBudgetMs)
          {
-            i = NPatchs1[k];
-            if (m_pPatches[i]->bIsDead)
-               continue;
-            PatchCount++;
-            if (PatchCount > MaxPatchCount)
-               MaxPatchCount = PatchCount;
-            //out << "Num=" << i << "\n";
-            float3 sp;
-            float sr = 0.0f;
-            bool collision = (m_pPatches[i]->uMeshIndex != -1 && a_uNumMeshes > 0);
-            if (collision)
-            {
-               XMFLOAT4 sphere = a_pMeshes[m_pPatches[i]->uMeshIndex]->GetPosAndRadius();
-               sr = sphere.w;
-               sp = create(sphere.x, sphere.y, sphere.z, sphere.w);
-            }
-
-            //
-            if (m_pPatches[i]->isVisible)
-               m_pPatches[i]->Patch.UpdatePhysics(viewPos, physLodDst, collision, sp, sr, a_fElapsedTime, grassProps, indexMapData, a_pMeshes, a_uNumMeshes);
-            m_pPatches[i]->isVisible = true;
-
-            m_pPatches[i]->fLifeTime -= a_fElapsedTime;
+            uNumDeferred++;
+            continue;
          }
-      }
 
-#pragma omp section
-      {
-         int i, PatchCount = 0;
-         for (int k = 0; k < j2_; k++)
+         /* a blade is within half the patch and its length of the patch centre, a patch size covers both */
+         Mesh* pColliders[PHYS_MAX_PATCH_COLLIDERS];
+         Mesh** ppColliders = a_pMeshes;
+         UINT uNumColliders = a_uNumMeshes;
+         if (m_pColliderGrid)
          {
-            i = NPatchs2[k];
-            if (m_pPatches[i]->bIsDead)
-               continue;
-
-            //out << "Num=" << i << "\n";
-            float3 sp;
-            float sr = 0.0f;
-            bool collision = (m_pPatches[i]->uMeshIndex != -1 && a_uNumMeshes > 0);
-            if (collision)
-            {
-               XMFLOAT4 sphere = a_pMeshes[m_pPatches[i]->uMeshIndex]->GetPosAndRadius();
-               sr = sphere.w;
-               sp = create(sphere.x, sphere.y, sphere.z, sphere.w);
-            }
-
-            //
-            if (m_pPatches[i]->isVisible)
-               m_pPatches[i]->Patch.UpdatePhysics(viewPos, physLodDst, collision, sp, sr, a_fElapsedTime, grassProps, indexMapData, a_pMeshes, a_uNumMeshes);
-            m_pPatches[i]->isVisible = true;
-
-            m_pPatches[i]->fLifeTime -= a_fElapsedTime;
+            uNumColliders = PatchColliders(pPatch, m_fCellSize, pColliders);
+            ppColliders = pColliders;
          }
+
+         /* the patch makes up the steps it has skipped one fixed step at a time,
+            the render pose blends over all of them from the pose before the first one */
+         UINT uSteps = pPatch->uStepsPending;
+         pPatch->Patch.SavePrevOrientation();
+         for (UINT s = 0; s < uSteps; s++)
+         {
+            pPatch->Patch.UpdatePhysics(viewPos, physLodDst, m_fPhysStep, grassProps, indexMapData, ppColliders, uNumColliders, m_pJobScheduler);
+            uNumCollideTested += pPatch->Patch.CollideTestedCount();
+            uNumCollideCulled += pPatch->Patch.CollideCulledCount();
+         }
+         pPatch->fLastStepDt = uSteps * m_fPhysStep;
+         pPatch->uStepsPending = 0;
+         uNumUpdated++;
+      }
+   };
+
+   if (m_pJobScheduler)
+      m_pJobScheduler->ParallelFor(0, (UINT)m_StepPatches.size(), 1, UpdatePatches);
+   else
+      UpdatePatches(0, (UINT)m_StepPatches.size());
+
+   m_ScheduleStats.uUpdated += uNumUpdated;
+   m_ScheduleStats.uDeferred += uNumDeferred;
+   m_ScheduleStats.uCollideTested += uNumCollideTested;
+   m_ScheduleStats.uCollideCulled += uNumCollideCulled;
+}
+
+void GrassPool::StepPhysics (const float3& viewPos, float physLodDst, Mesh* a_pMeshes[], UINT a_uNumMeshes, const std::vector<GrassPropsUnified>& grassProps, const IndexMapData& indexMapData)
+{
+   StepPatches(viewPos, physLodDst, a_pMeshes, a_uNumMeshes, grassProps, indexMapData, false);
+}
+
+void GrassPool::Update (const float3& viewPos, float physLodDst, float a_fElapsedTime, Mesh* a_pMeshes[], UINT a_uNumMeshes, const std::vector<GrassPropsUnified>& grassProps, const IndexMapData& indexMapData)
+{
+   m_tFrameStart = std::chrono::high_resolution_clock::now();
+   ZeroMemory(&m_ScheduleStats, sizeof(m_ScheduleStats));
+
+   /* fixed step: as many m_fPhysStep steps as fit into the elapsed time, but no more than m_uMaxPhysSubsteps */
+   m_fPhysTime += max(a_fElapsedTime, 0.0f);
+   UINT uNumSteps = UINT(m_fPhysTime / m_fPhysStep);
+   if (uNumSteps > m_uMaxPhysSubsteps)
+   {
+      uNumSteps = m_uMaxPhysSubsteps;
+      m_fPhysTime = uNumSteps * m_fPhysStep;
+   }
+   m_fPhysTime -= uNumSteps * m_fPhysStep;
+
+   for (UINT uStep = 0; uStep < uNumSteps; uStep++)
+      StepPatches(viewPos, physLodDst, a_pMeshes, a_uNumMeshes, grassProps, indexMapData, true);
+   m_ScheduleStats.fPhysMs = FrameMs();
+
+   for (int i = 0; i < m_iPatchCount; i++)
+   {
+      if (!m_Slots.IsAlive(i))
+         continue;
+
+      if (m_pPatches[i]->isVisible)
+      {
+         /* render pose between the last two updates of the patch, which may be several steps apart */
+         float fSinceUpdate = m_pPatches[i]->uStepsPending * m_fPhysStep + m_fPhysTime;
+         float fAlpha = min(fSinceUpdate / max(m_pPatches[i]->fLastStepDt, m_fPhysStep), 1.0f);
+         m_pPatches[i]->Patch.UpdateBuffer(fAlpha);
+         m_ScheduleStats.uPatchesPerTier[m_pPatches[i]->uPhysTier]++;
       }
+      m_pPatches[i]->isVisible = true;
    }
+   m_fPoolTime += a_fElapsedTime;
 
    //out.close();
 /*__asm
@@ -412,9 +710,27 @@ void GrassPool::Update (const float3& viewPos, float physLodDst, float a_fElapse
 PhysPatch::uTickCount = uEnd - uStart;*/
 }
 
+void GrassPool::RenderPhysPatches(ID3DX11EffectPass* a_pPass)
+{
+   /* blade positions are stored relative to the patch origin, so the pass is applied per patch */
+   for (int i = 0; i < m_iPatchCount; i++)
+   {
+      if (m_Slots.IsAlive(i))
+      {
+         XMFLOAT4 vOrigin(m_pPatches[i]->Transform._41, m_pPatches[i]->Transform._42, m_pPatches[i]->Transform._43, 1.0f);
+         m_pPatchOriginEVV->SetFloatVector((float*)&vOrigin);
+         a_pPass->Apply(0, m_pD3DDeviceCtx);
+         m_pPatches[i]->Patch.IASetPhysVertexBuffer0();
+         m_pD3DDeviceCtx->Draw(m_pPatches[i]->Patch.PhysVerticesCount(), 0);
+      }
+   }
+}
+
 void GrassPool::Render(bool a_bShadowPass)
 {
    int i;
+   if (!m_pD3DDevice)
+      return;
    m_pD3DDeviceCtx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
    /* Only physics */
    m_pD3DDeviceCtx->IASetInputLayout(m_pPhysInputLayout);
@@ -424,31 +740,14 @@ void GrassPool::Render(bool a_bShadowPass)
          return;
          //m_pShadowLowGrassPhysPass->Apply(0, m_pD3DDeviceCtx);
       } else {
-         m_pLowGrassPhysPass->Apply(0, m_pD3DDeviceCtx);
-      }
-      for (i = 0; i < m_iPatchCount; i++)
-      {
-         if (!m_pPatches[i]->bIsDead)
-         {
-             m_pPatches[i]->Patch.IASetPhysVertexBuffer0();
-             m_pD3DDeviceCtx->Draw(m_pPatches[i]->Patch.PhysVerticesCount(), 0);
-         }
+         RenderPhysPatches(m_pLowGrassPhysPass);
       }
    }
    
    if (a_bShadowPass) {
-      m_pShadowPassPhys->Apply(0, m_pD3DDeviceCtx);
+      RenderPhysPatches(m_pShadowPassPhys);
    } else {
-      m_pRenderPhysPass->Apply(0, m_pD3DDeviceCtx);
-   }
-
-   for (i = 0; i < m_iPatchCount; i++)
-   {
-      if (!m_pPatches[i]->bIsDead)
-      {
-          m_pPatches[i]->Patch.IASetPhysVertexBuffer0();
-          m_pD3DDeviceCtx->Draw(m_pPatches[i]->Patch.PhysVerticesCount(), 0);
-      }
+      RenderPhysPatches(m_pRenderPhysPass);
    }
    /* Only animations */
 
@@ -464,7 +763,7 @@ void GrassPool::Render(bool a_bShadowPass)
 
       for (i = 0; i < m_iPatchCount; i++)
       {
-         if (!m_pPatches[i]->bIsDead)
+         if (m_Slots.IsAlive(i))
          {
             m_pPatches[i]->Patch.IASetAnimVertexBuffer0();
             m_pD3DDeviceCtx->Draw(m_pPatches[i]->Patch.AnimVerticesCount(), 0);
@@ -480,7 +779,7 @@ void GrassPool::Render(bool a_bShadowPass)
 
    for (i = 0; i < m_iPatchCount; i++)
    {
-      if (!m_pPatches[i]->bIsDead)
+      if (m_Slots.IsAlive(i))
       {
           m_pPatches[i]->Patch.IASetAnimVertexBuffer0();
           m_pD3DDeviceCtx->Draw(m_pPatches[i]->Patch.AnimVerticesCount(), 0);
@@ -3,6 +3,43 @@
 #include "GrassPatch.h"
 #include "PhysPatch.h"
 #include "mesh.h"
+#include "JobScheduler.h"
+#include "TrampleField.h"
+#include "ColliderGrid.h"
+#include "PatchSlots.h"
+
+#include <chrono>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+/* physics update rate tiers, 0 - every step */
+#define PHYS_TIERS 3
+
+/**
+Update rate tier: a patch belongs to the first tier whose camera or collider distance it is within
+*/
+struct PhysTier
+{
+   float fCamDist;        /* in units of the physics lod distance */
+   float fColliderDist;   /* from the collider bounding sphere, in meters */
+   UINT  uPeriod;         /* the patch is stepped once per uPeriod physics steps */
+};
+
+/**
+Physics scheduling counters of the last frame
+*/
+struct PhysScheduleStats
+{
+   UINT  uPatchesPerTier[PHYS_TIERS];  /* alive visible patches per tier */
+   UINT  uUpdated;                     /* patch updates done */
+   UINT  uSkippedByRate;               /* patch updates skipped by the tier period */
+   UINT  uDeferred;                    /* patch updates put off because the budget ran out */
+   UINT  uDroppedSteps;                /* steps a patch missed beyond m_uMaxPhysSubsteps, never made up */
+   float fPhysMs;                      /* time spent in the physics steps */
+   UINT  uCollideTested;               /* awake segments tested against the colliders */
+   UINT  uCollideCulled;               /* awake segments the collision broad phase rejected */
+};
 
 struct GrassPatchExt
 {
@@ -10,13 +47,37 @@ struct GrassPatchExt
 
     PhysPatch      Patch;
     XMFLOAT4X4     Transform;
-    float          fLifeTime;
-    bool           bIsDead;
     UINT           uMeshIndex;
     bool           isVisible;
-    GrassPatchExt *pNext;
-    GrassPatchExt *pPrev;
-    GrassPatchExt ( GrassPatch *a_pPatch );
+    /* slot of the patch in GrassPool::m_Slots */
+    int            iPoolIndex;
+    /* update rate tier, physics steps since the last update and its length */
+    UINT           uPhysTier;
+    UINT           uStepsPending;
+    float          fLastStepDt;
+    float          fCamDist;
+    GrassPatchExt ( GrassPatch *a_pPatch, PhysSlab *a_pSlab );
+};
+
+/**
+Patches added to the pool together, their blade memory is one slab
+*/
+struct PatchChunk
+{
+    PhysSlab *pSlab;
+    int       iFirst;
+    int       iCount;
+};
+
+/**
+Pose of a patch that left the view, kept by the pool until the patch comes back
+*/
+struct DormantPatch
+{
+    UINT64             uKey;
+    float              fLifeTime;
+    UINT               uMeshIndex;
+    std::vector<BYTE>  Data;       /* PhysPatch::SaveDormant */
 };
 
 /* 20.07 
@@ -34,11 +95,29 @@ class GrassPool
 {
 private:    
     /* Patches with transforms and additional info */
-    GrassPatchExt              **m_pPatches;
+    std::vector<GrassPatchExt*>  m_pPatches;
     int                          m_iPatchCount;
-    /* free-space list */       
-    GrassPatchExt               *m_pFirst;
-    GrassPatchExt               *m_pLast;
+    /* growth: the pool grows by m_iChunkSize patches when no patch is free, up to m_iMaxPatchCount */
+    GrassPatch                  *m_pBasePatch;
+    std::vector<PatchChunk>      m_Chunks;
+    int                          m_iChunkSize;
+    int                          m_iMaxPatchCount;
+    /* the last chunk is released after the alive patches fit in the rest for m_fShrinkDelay seconds */
+    float                        m_fShrinkDelay;
+    float                        m_fLastHighTime;
+    /* dormant patches by grid cell, most recently suspended first */
+    std::list<DormantPatch>      m_Dormant;
+    std::unordered_map<UINT64, std::list<DormantPatch>::iterator> m_DormantIndex;
+    size_t                       m_uDormantBytes;
+    size_t                       m_uDormantBudget;
+    std::vector<BYTE>            m_DormantScratch;
+    /* trample of the grass out of the physics range, bends the newly taken patches, may be NULL */
+    const TrampleField          *m_pTrampleField;
+    /* colliders by grid cell, a patch is stepped with the ones around it only, may be NULL */
+    const ColliderGrid          *m_pColliderGrid;
+    /* alive patches, their cell index, free list and lifetime expiry */
+    PatchSlots                   m_Slots;
+    float                        m_fPoolTime;
     /* D3D variables */
     ID3D11InputLayout           *m_pPhysInputLayout;
     ID3D11InputLayout           *m_pAnimInputLayout;
@@ -50,9 +129,48 @@ private:
     ID3DX11EffectPass           *m_pShadowPassAnim;
     ID3DX11EffectPass           *m_pShadowLowGrassAnimPass;
     ID3DX11EffectPass           *m_pShadowLowGrassPhysPass;
+    ID3DX11EffectVectorVariable *m_pPatchOriginEVV;
     ID3D11Device                *m_pD3DDevice;
    ID3D11DeviceContext         *m_pD3DDeviceCtx;
     bool                         m_bUseLowGrass;
+    /* fixed step physics */
+    float                        m_fPhysStep;
+    UINT                         m_uMaxPhysSubsteps;
+    float                        m_fPhysTime;
+    /* physics jobs, NULL - everything on the calling thread */
+    JobScheduler                *m_pJobScheduler;
+    std::vector<GrassPatchExt*>  m_StepPatches;
+    /* update rate tiers and time budget of one frame, 0 - no budget */
+    PhysTier                     m_PhysTiers[PHYS_TIERS];
+    float                        m_fPhysBudgetMs;
+    UINT                         m_uPhysStepIndex;
+    std::chrono::high_resolution_clock::time_point m_tFrameStart;
+    PhysScheduleStats            m_ScheduleStats;
+    /* patch grid cell, the patch size */
+    float                        m_fCellSize;
+
+    /* the state shared by both c-tors, grows the pool by the first chunk */
+    void        Init              ( GrassPatch *a_pBasePatch, int a_iPatchCount );
+    void        RenderPhysPatches ( ID3DX11EffectPass *a_pPass );
+    void        ResetPatchSchedule( GrassPatchExt *a_pPatch );
+    UINT64      CellKey           ( XMVECTOR a_vPatchPos );
+    void        KillPatch         ( GrassPatchExt *a_pPatch );
+    /* a dead patch made alive at a_vPatchPos, the pool grows if there is none */
+    GrassPatchExt* TakeFreePatch  ( XMVECTOR a_vPatchPos );
+    bool        Grow              ( int a_iCount );
+    /* puts back the dormant pose of the patch cell, if there is one */
+    bool        WakeDormant       ( GrassPatchExt *a_pPatch );
+    void        EraseDormant      ( std::list<DormantPatch>::iterator a_It );
+    void        TryShrink         ( void );
+    void        SetLifeTime       ( GrassPatchExt *a_pPatch, float a_fLifeTime );
+    /* debug build: compares the cell index with a scan of the pool */
+    void        ValidateIndex     ( void );
+    void        AssignPhysTier    ( GrassPatchExt *a_pPatch, const float3 &viewPos, float physLodDst, Mesh *a_pMeshes[], UINT a_uNumMeshes );
+    /* colliders of m_pColliderGrid within a_fRange of the patch centre in x and z */
+    UINT        PatchColliders    ( GrassPatchExt *a_pPatch, float a_fRange, Mesh **a_ppOut );
+    float       FrameMs           ( void );
+    /* a_bScheduled - only the patches due in their tier, within the budget */
+    void        StepPatches       ( const float3 &viewPos, float physLodDst, Mesh *a_pMeshes[], UINT a_uNumMeshes, const std::vector<GrassPropsUnified> &grassProps, const IndexMapData &indexMapData, bool a_bScheduled );
 
 public:
     /** 
@@ -60,11 +178,18 @@ public:
      * @param a_pD3DDevice is a direct3d 10 device pointer
      * @param a_pEffect is a direct3d effect pointer
      * @param a_pBasePatch is a grass patch for physics sub-system
-     * @param a_iPatchCount is a number of patches in pool
+     * @param a_iPatchCount is the initial number of patches in pool, the pool grows by chunks of this size
      */
     GrassPool (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx, ID3D11InputLayout* a_pAnimInputLayout,
       ID3DX11Effect* a_pEffect, GrassPatch* a_pBasePatch, int a_iPatchCount, bool a_bUseLowGrass);
 
+    /** 
+     * Pool c-tor without a device, for physics only: the pool steps and indexes patches but does not render
+     * @param a_pBasePatch is a grass patch for physics sub-system, made without a device too
+     * @param a_iPatchCount is the initial number of patches in pool, the pool grows by chunks of this size
+     */
+    GrassPool (GrassPatch* a_pBasePatch, int a_iPatchCount);
+
     /** 
     * Pool d-tor
     * Releases all resources
@@ -72,7 +197,19 @@ public:
     ~GrassPool (void);
 
     /** 
-    * @return the patch count (pool size)
+    * Sets the grid the patch positions are on, patch x and z are a_fOrigin + k * patch size
+    */
+    void        SetPatchGrid  ( float a_fOrigin );
+
+    /** 
+    * Sets how the pool grows and shrinks
+    * @param a_iMaxPatchCount is the pool size TakePatch stops growing at
+    * @param a_fShrinkDelay is the time in seconds the alive patches have to fit without the last chunk before it is released
+    */
+    void        SetPoolLimits ( int a_iMaxPatchCount, float a_fShrinkDelay );
+
+    /** 
+    * @return the patch count (current pool size)
     */
     int         GetPatchCount ( );
 
@@ -113,6 +250,43 @@ public:
     */
     bool        FreePatch     ( int a_iPatchIndex );
 
+    /** 
+    * Frees the patch, keeping its pose until the patch is taken again at the same cell
+    * @param a_iPatchIndex
+    * @return true if patch was found and freed, otherwise false
+    */
+    bool        SuspendPatch  ( int a_iPatchIndex );
+
+    /** 
+    * Takes a patch for a cell with a dormant pose, with the lifetime it had when suspended
+    * @param a_mTransform is the position and orientation matrix
+    * @return true if the cell had a dormant pose and a patch was free for it
+    */
+    bool        RestorePatch  ( XMMATRIX a_mTransform );
+
+    /** 
+    * Sets the memory of the dormant poses, the least recently suspended ones are dropped over it
+    * @param a_uBytes is the budget in bytes, 0 - nothing is kept
+    */
+    void        SetDormantBudget ( size_t a_uBytes );
+
+    /** 
+    * Drops all dormant poses
+    */
+    void        ClearDormant  ( void );
+
+    /** 
+    * Sets the field the patches taken without a dormant pose are bent from
+    * @param a_pField is the field, NULL - patches are taken upright
+    */
+    void        SetTrampleField ( const TrampleField *a_pField );
+
+    /** 
+    * Sets the grid the colliders near a patch are looked up in
+    * @param a_pGrid is the grid, NULL - every patch is tested against all the colliders
+    */
+    void        SetColliderGrid ( const ColliderGrid *a_pGrid );
+
     /** 
     * Taking patch from pool
     * @param a_mTransform is the position and orientation matrix
@@ -145,7 +319,55 @@ public:
    XMVECTOR GetPatchPos   ( int a_iPatchIndex );
 
 
+    /** 
+    * Kills the patches whose lifetime runs out within a_fElapsedTime,
+    * touches only the expiring patches
+    */
     void    ClearDeadPatches( float a_fElapsedTime );
+
+    /** 
+    * Compares the cell index with a linear scan of the pool, and the free list
+    * and the alive count with the dead and alive patches
+    * @return number of disagreements, 0 - the index is consistent
+    */
+    UINT    IndexMismatches ( void );
+
+    /** 
+    * Sets the fixed physics step
+    * @param a_fStep is the step in seconds, clamped to [PHYS_MIN_STEP, PHYS_MAX_STEP]
+    * @param a_uMaxSubsteps is the max number of steps per Update call, the rest of the elapsed time is dropped
+    */
+    void        SetPhysStep   ( float a_fStep, UINT a_uMaxSubsteps );
+
+    /** 
+    * Sets an update rate tier
+    * @param a_uTier is the tier index, 0 is the most frequent one
+    * @param a_Tier is the tier distances and period, the distances of the last tier are ignored
+    */
+    void        SetPhysTier   ( UINT a_uTier, const PhysTier &a_Tier );
+
+    /** 
+    * Sets the time budget of the physics of one frame
+    * @param a_fBudgetMs is the budget in milliseconds, 0 - unlimited.
+    * Patches of tier 0 are always stepped, the rest are deferred in the tier order when the budget is out
+    */
+    void        SetPhysBudget ( float a_fBudgetMs );
+
+    /** 
+    * @return scheduling counters of the last Update call
+    */
+    const PhysScheduleStats& GetScheduleStats ( void );
+
+    /** 
+    * Sets the scheduler, which runs patches and blade chunks as jobs
+    * @param a_pScheduler is the scheduler, NULL to update on the calling thread
+    */
+    void        SetJobScheduler ( JobScheduler *a_pScheduler );
+
+    /** 
+    * Makes one fixed physics step for all alive visible patches, ignoring the tiers and the budget
+    */
+    void        StepPhysics   ( const float3 &viewPos, float physLodDst, Mesh *a_pMeshes[], UINT a_uNumMeshes, const std::vector<GrassPropsUnified> &grassProps, const IndexMapData &indexMapData );
     /** 
     * Update pool function
     * @param a_fElapsedTime is elapsed time (in seconds) since last update call
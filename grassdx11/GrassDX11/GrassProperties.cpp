@@ -1,45 +1,44 @@
 #include "GrassProperties.h"
 #include "PhysMath.h"
-#include "common.h"
 
 #include <fstream>
 
-void ReadToCoord (XMVECTOR& v, DWORD coord, std::ifstream& f)
+void ReadToCoord (XMVECTOR& v, DWORD coord, std::ifstream& f, RandomStream& r)
 {
    float val;
    f >> val;
-   setcoord(v, coord, val * com::frand(0.9, 1.1));
+   setcoord(v, coord, val * r.NextFloat(0.9f, 1.1f));
 }
 
-void GrassProps1::Read (std::ifstream& a_ifIn)
+void GrassProps1::Read (std::ifstream& a_ifIn, RandomStream& a_Random)
 {
-   ReadToCoord(vHardnessSegment, 0, a_ifIn);
-   ReadToCoord(vHardnessSegment, 1, a_ifIn);
-   ReadToCoord(vHardnessSegment, 2, a_ifIn);
-   ReadToCoord(vMassSegment, 0, a_ifIn);
-   ReadToCoord(vMassSegment, 1, a_ifIn);
-   ReadToCoord(vMassSegment, 2, a_ifIn);
-   ReadToCoord(vSizes, 0, a_ifIn);
-   ReadToCoord(vSizes, 1, a_ifIn);
-   ReadToCoord(vColor, 0, a_ifIn);
-   ReadToCoord(vColor, 1, a_ifIn);
-   ReadToCoord(vColor, 2, a_ifIn);
-   ReadToCoord(vColor, 3, a_ifIn);
+   ReadToCoord(vHardnessSegment, 0, a_ifIn, a_Random);
+   ReadToCoord(vHardnessSegment, 1, a_ifIn, a_Random);
+   ReadToCoord(vHardnessSegment, 2, a_ifIn, a_Random);
+   ReadToCoord(vMassSegment, 0, a_ifIn, a_Random);
+   ReadToCoord(vMassSegment, 1, a_ifIn, a_Random);
+   ReadToCoord(vMassSegment, 2, a_ifIn, a_Random);
+   ReadToCoord(vSizes, 0, a_ifIn, a_Random);
+   ReadToCoord(vSizes, 1, a_ifIn, a_Random);
+   ReadToCoord(vColor, 0, a_ifIn, a_Random);
+   ReadToCoord(vColor, 1, a_ifIn, a_Random);
+   ReadToCoord(vColor, 2, a_ifIn, a_Random);
+   ReadToCoord(vColor, 3, a_ifIn, a_Random);
    vColor = create(1.0, 1.0, 1.0, 1.0);
    a_ifIn >> uTexIndex;
 }
 
 
-void GrassProps3::Read (std::ifstream& a_ifIn)
+void GrassProps3::Read (std::ifstream& a_ifIn, RandomStream& a_Random)
 {
-   ReadToCoord(vHardnessSegment, 0, a_ifIn);
-   ReadToCoord(vHardnessSegment, 1, a_ifIn);
-   ReadToCoord(vHardnessSegment, 2, a_ifIn);
-   ReadToCoord(vMassSegment, 0, a_ifIn);
-   ReadToCoord(vMassSegment, 1, a_ifIn);
-   ReadToCoord(vMassSegment, 2, a_ifIn);
-   ReadToCoord(vSizes, 0, a_ifIn);
-   ReadToCoord(vSizes, 1, a_ifIn);
+   ReadToCoord(vHardnessSegment, 0, a_ifIn, a_Random);
+   ReadToCoord(vHardnessSegment, 1, a_ifIn, a_Random);
+   ReadToCoord(vHardnessSegment, 2, a_ifIn, a_Random);
+   ReadToCoord(vMassSegment, 0, a_ifIn, a_Random);
+   ReadToCoord(vMassSegment, 1, a_ifIn, a_Random);
+   ReadToCoord(vMassSegment, 2, a_ifIn, a_Random);
+   ReadToCoord(vSizes, 0, a_ifIn, a_Random);
+   ReadToCoord(vSizes, 1, a_ifIn, a_Random);
    a_ifIn >> uTexIndex;
    a_ifIn >> uTopTexIndex;
 }
\ No newline at end of file
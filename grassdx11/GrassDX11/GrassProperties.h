@@ -3,6 +3,7 @@
 #include <fstream>
 #include "includes.h"
 #include "PhysMath.h"
+#include "PhysRandom.h"
 
 enum GrassPropsType
 {
@@ -11,6 +12,13 @@ enum GrassPropsType
    GRASSPROPSTYPE3,
 };
 
+/* blade segment chain solvers */
+enum BladeIntegrator
+{
+   BLADE_INTEGRATOR_HEUN,           /* explicit, needs small steps for stiff blades */
+   BLADE_INTEGRATOR_SEMI_IMPLICIT,  /* implicit spring, stable at large steps */
+};
+
 /* structures MUST be 16-byte aligned and have all variables aligned by 16 (4xfloat size) */
 __declspec(align(16))
 struct GrassProps1
@@ -22,7 +30,7 @@ struct GrassProps1
    float4 vColor;
    UINT   uTexIndex;
    
-   void Read (std::ifstream& a_ifIn);
+   void Read (std::ifstream& a_ifIn, RandomStream& a_Random);
 
    GrassPropsType GetType (void) { return GRASSPROPSTYPE1; }
 };
@@ -38,7 +46,7 @@ struct GrassProps3
    UINT   uTexIndex;
    UINT   uTopTexIndex;
 
-   void Read (std::ifstream& a_ifIn);
+   void Read (std::ifstream& a_ifIn, RandomStream& a_Random);
 
    GrassPropsType GetType (void) { return GRASSPROPSTYPE3; }
 };
@@ -49,6 +57,8 @@ struct GrassPropsUnified
    float3 vHardnessSegment;
    float3 vMassSegment;
    float2 vSizes;
+   /* cpu only, not a part of GrassProps1/3 */
+   UINT   uIntegrator;
 };
 
 /* class for loading properties */
@@ -66,9 +76,15 @@ public:
       ifStr.open(a_sFileName.c_str());
       ifStr >> m_uNumProps;
       m_pProperties = new TProperties[m_uNumProps];
+
+      /* same spread of the values every run, but not the same one for the sub-types of two files */
+      UINT uFileSeed = 0;
+      for (wchar_t c : a_sFileName)
+         uFileSeed = HashCombine(uFileSeed, (UINT)c);
       for (UINT i = 0; i < m_uNumProps; i++)
       {
-         m_pProperties[i].Read(ifStr);
+         RandomStream random(HashCombine(uFileSeed, i));
+         m_pProperties[i].Read(ifStr, random);
       }
       ifStr.close();
    }
@@ -88,7 +104,10 @@ public:
       if (a_uIndex > m_uNumProps)
          a_uIndex = 0;
       GrassPropsUnified Res;
-      Res = *((GrassPropsUnified*)(&m_pProperties[a_uIndex]));
+      Res.vHardnessSegment = m_pProperties[a_uIndex].vHardnessSegment;
+      Res.vMassSegment = m_pProperties[a_uIndex].vMassSegment;
+      Res.vSizes = m_pProperties[a_uIndex].vSizes;
+      Res.uIntegrator = BLADE_INTEGRATOR_HEUN;
 
       return Res;
    }
@@ -0,0 +1,213 @@
+#include "JobScheduler.h"
+
+/* Scheduler and queue of the current worker thread, NULL for threads outside of any pool */
+static thread_local const JobScheduler* t_pOwner = NULL;
+static thread_local UINT                t_uQueue = 0;
+
+
+JobScheduler::JobScheduler(UINT a_uNumThreads)
+   : m_iQueued(0), m_bStop(false)
+{
+   Start(a_uNumThreads);
+}
+
+
+JobScheduler::~JobScheduler(void)
+{
+   Stop();
+}
+
+
+UINT JobScheduler::ThreadsCount(void) const
+{
+   return (UINT)m_Queues.size();
+}
+
+
+void JobScheduler::SetThreadsCount(UINT a_uNumThreads)
+{
+   Stop();
+   Start(a_uNumThreads);
+}
+
+
+void JobScheduler::Start(UINT a_uNumThreads)
+{
+   if (a_uNumThreads == 0)
+      a_uNumThreads = max(std::thread::hardware_concurrency(), 1u);
+
+   m_bStop = false;
+   m_iQueued = 0;
+   for (UINT i = 0; i < a_uNumThreads; i++)
+      m_Queues.push_back(new WorkerQueue);
+
+   for (UINT i = 1; i < a_uNumThreads; i++)
+      m_Threads.push_back(std::thread(&JobScheduler::WorkerLoop, this, i));
+}
+
+
+void JobScheduler::Stop(void)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_SleepMutex);
+      m_bStop = true;
+   }
+   m_WakeUp.notify_all();
+
+   for (size_t i = 0; i < m_Threads.size(); i++)
+      m_Threads[i].join();
+   m_Threads.clear();
+
+   for (size_t i = 0; i < m_Queues.size(); i++)
+      delete m_Queues[i];
+   m_Queues.clear();
+}
+
+
+void JobScheduler::WorkerLoop(UINT a_uQueue)
+{
+   t_pOwner = this;
+   t_uQueue = a_uQueue;
+
+   Task task;
+   while (!m_bStop)
+   {
+      if (FindTask(task))
+      {
+         Execute(task);
+         continue;
+      }
+
+      std::unique_lock<std::mutex> lock(m_SleepMutex);
+      m_WakeUp.wait(lock, [this] { return m_bStop || m_iQueued > 0; });
+   }
+}
+
+
+UINT JobScheduler::CurrentQueue(void) const
+{
+   return (t_pOwner == this) ? t_uQueue : 0;
+}
+
+
+bool JobScheduler::Pop(UINT a_uQueue, Task& a_Task)
+{
+   WorkerQueue* pQueue = m_Queues[a_uQueue];
+   std::lock_guard<std::mutex> lock(pQueue->mutex);
+   if (pQueue->tasks.empty())
+      return false;
+
+   a_Task = pQueue->tasks.back();
+   pQueue->tasks.pop_back();
+   m_iQueued--;
+   return true;
+}
+
+
+bool JobScheduler::Steal(UINT a_uQueue, Task& a_Task)
+{
+   WorkerQueue* pQueue = m_Queues[a_uQueue];
+   std::unique_lock<std::mutex> lock(pQueue->mutex, std::try_to_lock);
+   if (!lock.owns_lock() || pQueue->tasks.empty())
+      return false;
+
+   a_Task = pQueue->tasks.front();
+   pQueue->tasks.pop_front();
+   m_iQueued--;
+   return true;
+}
+
+
+bool JobScheduler::FindTask(Task& a_Task)
+{
+   UINT uOwn = CurrentQueue();
+   if (Pop(uOwn, a_Task))
+      return true;
+
+   UINT uNumQueues = (UINT)m_Queues.size();
+   for (UINT i = 1; i < uNumQueues; i++)
+   {
+      if (Steal((uOwn + i) % uNumQueues, a_Task))
+         return true;
+   }
+   return false;
+}
+
+
+void JobScheduler::Execute(Task& a_Task)
+{
+   a_Task.job();
+   a_Task.job = NULL;
+   if (--a_Task.pGroup->iPending == 0)
+   {
+      /* the group may be gone once the counter is zero, only the scheduler is touched after it */
+      {
+         std::lock_guard<std::mutex> lock(m_SleepMutex);
+      }
+      m_WakeUp.notify_all();
+   }
+}
+
+
+void JobScheduler::Spawn(JobGroup& a_Group, const Job& a_Job)
+{
+   Task task = { a_Job, &a_Group };
+   a_Group.iPending++;
+
+   WorkerQueue* pQueue = m_Queues[CurrentQueue()];
+   {
+      std::lock_guard<std::mutex> lock(pQueue->mutex);
+      pQueue->tasks.push_back(task);
+      m_iQueued++;
+   }
+
+   if (!m_Threads.empty())
+   {
+      /* taking the lock keeps the wake-up from slipping between a worker's check and its wait */
+      {
+         std::lock_guard<std::mutex> lock(m_SleepMutex);
+      }
+      m_WakeUp.notify_one();
+   }
+}
+
+
+void JobScheduler::Wait(JobGroup& a_Group)
+{
+   Task task;
+   while (a_Group.iPending > 0)
+   {
+      if (FindTask(task))
+      {
+         Execute(task);
+         continue;
+      }
+
+      /* the rest of the group runs on other threads: sleep until it ends or a job is queued to help with */
+      std::unique_lock<std::mutex> lock(m_SleepMutex);
+      m_WakeUp.wait(lock, [this, &a_Group] { return a_Group.iPending == 0 || m_iQueued > 0 || m_bStop; });
+   }
+}
+
+
+void JobScheduler::ParallelFor(UINT a_uBegin, UINT a_uEnd, UINT a_uGrain, const RangeJob& a_Job)
+{
+   if (a_uGrain == 0)
+      a_uGrain = 1;
+
+   /* single range or single thread: nothing to share */
+   if (a_uEnd - a_uBegin <= a_uGrain || m_Threads.empty())
+   {
+      for (UINT uBegin = a_uBegin; uBegin < a_uEnd; uBegin += a_uGrain)
+         a_Job(uBegin, min(uBegin + a_uGrain, a_uEnd));
+      return;
+   }
+
+   JobGroup group;
+   for (UINT uBegin = a_uBegin; uBegin < a_uEnd; uBegin += a_uGrain)
+   {
+      UINT uEnd = min(uBegin + a_uGrain, a_uEnd);
+      Spawn(group, [&a_Job, uBegin, uEnd] { a_Job(uBegin, uEnd); });
+   }
+   Wait(group);
+}
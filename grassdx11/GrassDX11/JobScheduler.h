@@ -0,0 +1,92 @@
+#pragma once
+
+#include "includes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+Counter of unfinished jobs, JobScheduler::Wait returns when it drops to zero
+*/
+struct JobGroup
+{
+   std::atomic<int> iPending;
+
+   JobGroup(void) : iPending(0) {}
+};
+
+/**
+Work-stealing job scheduler.
+Every thread owns a deque: it pushes and pops its own jobs at the back,
+idle threads steal from the front of the others. The thread that waits
+for a group runs jobs too, so jobs may spawn and wait for nested jobs.
+*/
+class JobScheduler
+{
+public:
+   typedef std::function<void(void)>       Job;
+   typedef std::function<void(UINT, UINT)> RangeJob;
+
+   /**
+   param a_uNumThreads threads including the calling one, 0 - one per hardware thread
+   */
+   JobScheduler(UINT a_uNumThreads = 0);
+   ~JobScheduler(void);
+
+   UINT ThreadsCount(void) const;
+
+   /**
+   Restarts the workers, must not be called while jobs are running
+   */
+   void SetThreadsCount(UINT a_uNumThreads);
+
+   void Spawn(JobGroup& a_Group, const Job& a_Job);
+
+   /**
+   Runs queued jobs until all jobs of a_Group are finished, sleeps while there is none to run
+   */
+   void Wait(JobGroup& a_Group);
+
+   /**
+   Calls a_Job for [a_uBegin, a_uEnd) split into ranges of a_uGrain and waits for all of them
+   */
+   void ParallelFor(UINT a_uBegin, UINT a_uEnd, UINT a_uGrain, const RangeJob& a_Job);
+
+private:
+   struct Task
+   {
+      Job       job;
+      JobGroup* pGroup;
+   };
+
+   struct WorkerQueue
+   {
+      std::mutex       mutex;
+      std::deque<Task> tasks;
+   };
+
+   JobScheduler(const JobScheduler&);
+   JobScheduler& operator = (const JobScheduler&);
+
+   void Start      (UINT a_uNumThreads);
+   void Stop       (void);
+   void WorkerLoop (UINT a_uQueue);
+   UINT CurrentQueue(void) const;
+   bool Pop        (UINT a_uQueue, Task& a_Task);
+   bool Steal      (UINT a_uQueue, Task& a_Task);
+   bool FindTask   (Task& a_Task);
+   void Execute    (Task& a_Task);
+
+   /* queue 0 belongs to the threads outside of the pool, 1..N-1 to the workers */
+   std::vector<WorkerQueue*> m_Queues;
+   std::vector<std::thread>  m_Threads;
+   std::mutex                m_SleepMutex;
+   std::condition_variable   m_WakeUp;
+   std::atomic<int>          m_iQueued;
+   std::atomic<bool>         m_bStop;
+};
@@ -41,6 +41,23 @@ void ModelLoader::Draw(ID3D11DeviceContext * devcon, ID3DX11EffectPass * pass, I
 	}
 }
 
+void ModelLoader::GetTriangles(std::vector<XMFLOAT3>& triangles) const
+{
+   triangles.clear();
+   for (size_t i = 0; i < meshes.size(); i++)
+   {
+      const MeshAssimp& mesh = meshes[i];
+      for (size_t j = 0; j + 2 < mesh.indices.size(); j += 3)
+      {
+         for (size_t k = 0; k < 3; k++)
+         {
+            const VERTEX& v = mesh.vertices[mesh.indices[j + k]];
+            triangles.push_back(XMFLOAT3(v.X, v.Y, v.Z));
+         }
+      }
+   }
+}
+
 std::string textype;
 
 MeshAssimp ModelLoader::processMesh(aiMesh * mesh, const aiScene * scene)
@@ -28,6 +28,8 @@ public:
 
 	void  Close(void);
    const std::vector<AABB>& GetBoundBoxes(void) { return boundBoxes; }
+   /* three positions per triangle of all the meshes, model space */
+   void  GetTriangles(std::vector<XMFLOAT3>& triangles) const;
 private:
 	ID3D11Device           *dev;
 	ID3D11DeviceContext    *devcon;
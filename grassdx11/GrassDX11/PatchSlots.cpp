@@ -0,0 +1,219 @@
+#include "PatchSlots.h"
+
+PatchSlots::PatchSlots(void)
+{
+   m_iFirstFree = NO_VALUE;
+   m_iAliveCount = 0;
+   m_fGridOrigin = 0.0f;
+   m_fCellSize = 1.0f;
+}
+
+void PatchSlots::SetGrid(float a_fOrigin, float a_fCellSize)
+{
+   m_fGridOrigin = a_fOrigin;
+   m_fCellSize = a_fCellSize;
+
+   m_CellIndex.clear();
+   for (int i = 0; i < Count(); i++)
+   {
+      if (m_Slots[i].bAlive)
+         m_CellIndex[CellKey(m_Slots[i].fX, m_Slots[i].fZ)] = i;
+   }
+}
+
+UINT64 PatchSlots::CellKey(float a_fX, float a_fZ) const
+{
+   /* patch centres are on the grid nodes, rounding is safe against the drift of the positions */
+   int iX = (int)floorf((a_fX - m_fGridOrigin) / m_fCellSize + 0.5f);
+   int iZ = (int)floorf((a_fZ - m_fGridOrigin) / m_fCellSize + 0.5f);
+   return ((UINT64)(UINT)iX << 32) | (UINT)iZ;
+}
+
+int PatchSlots::Count(void) const
+{
+   return (int)m_Slots.size();
+}
+
+int PatchSlots::AliveCount(void) const
+{
+   return m_iAliveCount;
+}
+
+bool PatchSlots::IsAlive(int a_iSlot) const
+{
+   return m_Slots[a_iSlot].bAlive;
+}
+
+void PatchSlots::Grow(int a_iCount)
+{
+   int iOldCount = Count();
+   Slot slot = { 0.0f, 0.0f, 0.0f, 0.0f, false, false, NO_VALUE };
+   m_Slots.resize(iOldCount + a_iCount, slot);
+   m_CellIndex.reserve(m_Slots.size());
+
+   /* pushed backwards: the lowest index is taken first */
+   for (int i = Count() - 1; i >= iOldCount; i--)
+   {
+      m_Slots[i].iNext = m_iFirstFree;
+      m_iFirstFree = i;
+   }
+}
+
+bool PatchSlots::Shrink(int a_iCount)
+{
+   int i;
+   for (i = a_iCount; i < Count(); i++)
+   {
+      if (m_Slots[i].bAlive)
+         return false;
+   }
+   m_Slots.resize(a_iCount);
+
+   /* dropping the released slots from the free list and the expiry queue */
+   m_iFirstFree = NO_VALUE;
+   for (i = a_iCount - 1; i >= 0; i--)
+   {
+      if (!m_Slots[i].bAlive)
+      {
+         m_Slots[i].iNext = m_iFirstFree;
+         m_iFirstFree = i;
+      }
+   }
+   std::vector<ExpiryEntry> entries;
+   for (; !m_ExpiryQueue.empty(); m_ExpiryQueue.pop())
+   {
+      if (m_ExpiryQueue.top().second < a_iCount)
+         entries.push_back(m_ExpiryQueue.top());
+   }
+   for (size_t e = 0; e < entries.size(); e++)
+      m_ExpiryQueue.push(entries[e]);
+   return true;
+}
+
+int PatchSlots::Find(float a_fX, float a_fZ) const
+{
+   auto it = m_CellIndex.find(CellKey(a_fX, a_fZ));
+   if (it == m_CellIndex.end())
+      return NO_VALUE;
+   return it->second;
+}
+
+int PatchSlots::Take(float a_fX, float a_fZ)
+{
+   if (m_iFirstFree == NO_VALUE)
+      return NO_VALUE;
+
+   int i = m_iFirstFree;
+   Slot& slot = m_Slots[i];
+   m_iFirstFree = slot.iNext;
+   slot.iNext = NO_VALUE;
+   slot.bAlive = true;
+   slot.fX = a_fX;
+   slot.fZ = a_fZ;
+   m_CellIndex[CellKey(a_fX, a_fZ)] = i;
+   m_iAliveCount++;
+   return i;
+}
+
+bool PatchSlots::Kill(int a_iSlot)
+{
+   Slot& slot = m_Slots[a_iSlot];
+   if (!slot.bAlive)
+      return false;
+
+   auto it = m_CellIndex.find(CellKey(slot.fX, slot.fZ));
+   if (it != m_CellIndex.end() && it->second == a_iSlot)
+      m_CellIndex.erase(it);
+
+   slot.bAlive = false;
+   slot.iNext = m_iFirstFree;
+   m_iFirstFree = a_iSlot;
+   m_iAliveCount--;
+   return true;
+}
+
+void PatchSlots::SetExpireTime(int a_iSlot, float a_fTime)
+{
+   Slot& slot = m_Slots[a_iSlot];
+   slot.fExpireTime = a_fTime;
+
+   /* a later expiry reuses the queued entry, it is pushed again when it comes out too early */
+   if (slot.bQueued && slot.fQueuedExpireTime <= slot.fExpireTime)
+      return;
+
+   slot.bQueued = true;
+   slot.fQueuedExpireTime = slot.fExpireTime;
+   m_ExpiryQueue.push(ExpiryEntry(slot.fExpireTime, a_iSlot));
+}
+
+float PatchSlots::ExpireTime(int a_iSlot) const
+{
+   return m_Slots[a_iSlot].fExpireTime;
+}
+
+int PatchSlots::PopExpired(float a_fTime)
+{
+   while (!m_ExpiryQueue.empty() && m_ExpiryQueue.top().first <= a_fTime)
+   {
+      ExpiryEntry entry = m_ExpiryQueue.top();
+      m_ExpiryQueue.pop();
+
+      Slot& slot = m_Slots[entry.second];
+      /* an older entry of a slot, whose lifetime was cut later */
+      if (!slot.bQueued || slot.fQueuedExpireTime != entry.first)
+         continue;
+
+      /* lifetime was extended after the entry was pushed */
+      if (slot.fExpireTime > a_fTime)
+      {
+         slot.fQueuedExpireTime = slot.fExpireTime;
+         m_ExpiryQueue.push(ExpiryEntry(slot.fExpireTime, entry.second));
+         continue;
+      }
+      slot.bQueued = false;
+      return entry.second;
+   }
+   return NO_VALUE;
+}
+
+UINT PatchSlots::Mismatches(void) const
+{
+   UINT uNumMismatches = 0;
+
+   /* every alive slot is found at its cell, two at one cell cannot both be */
+   int iNumAlive = 0;
+   for (int i = 0; i < Count(); i++)
+   {
+      if (!m_Slots[i].bAlive)
+         continue;
+      iNumAlive++;
+      if (Find(m_Slots[i].fX, m_Slots[i].fZ) != i)
+         uNumMismatches++;
+   }
+
+   /* every entry is an alive slot at the cell of the entry */
+   for (auto it = m_CellIndex.begin(); it != m_CellIndex.end(); ++it)
+   {
+      int i = it->second;
+      if (i < 0 || i >= Count() || !m_Slots[i].bAlive || CellKey(m_Slots[i].fX, m_Slots[i].fZ) != it->first)
+         uNumMismatches++;
+   }
+   if (iNumAlive != m_iAliveCount || (size_t)iNumAlive != m_CellIndex.size())
+      uNumMismatches++;
+
+   /* the free list holds every dead slot once, a longer walk is a cycle */
+   int iNumFree = 0;
+   for (int i = m_iFirstFree; i != NO_VALUE && iNumFree <= Count(); iNumFree++)
+   {
+      if (i < 0 || i >= Count() || m_Slots[i].bAlive)
+      {
+         uNumMismatches++;
+         break;
+      }
+      i = m_Slots[i].iNext;
+   }
+   if (iNumFree + iNumAlive != Count())
+      uNumMismatches++;
+
+   return uNumMismatches;
+}
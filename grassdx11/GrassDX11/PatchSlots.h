@@ -0,0 +1,107 @@
+#pragma once
+
+#include "includes.h"
+
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/**
+Bookkeeping of the patch slots of a GrassPool, without the patches themselves:
+which slots are alive and where, the free list of the dead ones, the index of
+the alive ones by patch grid cell and the lifetime expiry queue.
+Slot i is patch i of the pool, the pool keeps the blades and the device buffers.
+*/
+class PatchSlots
+{
+public:
+   PatchSlots(void);
+
+   /**
+   Sets the grid the slot positions are on, x and z are a_fOrigin + k * a_fCellSize, reindexes the alive slots
+   */
+   void   SetGrid     (float a_fOrigin, float a_fCellSize);
+
+   /**
+   return key of the grid cell of (a_fX, a_fZ), positions a little off the nodes round to them
+   */
+   UINT64 CellKey     (float a_fX, float a_fZ) const;
+
+   int    Count       (void) const;
+   int    AliveCount  (void) const;
+   bool   IsAlive     (int a_iSlot) const;
+
+   /**
+   Adds a_iCount dead slots after the last one, the lowest of them is taken first
+   */
+   void   Grow        (int a_iCount);
+
+   /**
+   Drops the slots from a_iCount on
+   return false, with nothing dropped, if one of them is alive
+   */
+   bool   Shrink      (int a_iCount);
+
+   /**
+   return alive slot at the cell of (a_fX, a_fZ), NO_VALUE if there is none
+   */
+   int    Find        (float a_fX, float a_fZ) const;
+
+   /**
+   Pops the most recently freed slot and makes it alive at (a_fX, a_fZ)
+   return the slot, NO_VALUE if all slots are alive
+   */
+   int    Take        (float a_fX, float a_fZ);
+
+   /**
+   Pushes an alive slot to the free list
+   return false if it was dead already
+   */
+   bool   Kill        (int a_iSlot);
+
+   /**
+   Sets the time a slot expires at, a slot has at most one live queue entry
+   */
+   void   SetExpireTime (int a_iSlot, float a_fTime);
+   float  ExpireTime    (int a_iSlot) const;
+
+   /**
+   Pops the next slot whose expire time is a_fTime or earlier, alive or not,
+   the entries of extended lifetimes are queued again at their new time
+   return the slot, NO_VALUE when no more slots expire by a_fTime
+   */
+   int    PopExpired    (float a_fTime);
+
+   /**
+   Compares the cell index with a linear scan of the slots, and the free list
+   and the alive count with the dead and alive slots
+   return number of disagreements, 0 - consistent
+   */
+   UINT   Mismatches    (void) const;
+
+private:
+   struct Slot
+   {
+      float fX;
+      float fZ;
+      float fExpireTime;
+      /* time of the newest m_ExpiryQueue entry of the slot, if it has one */
+      float fQueuedExpireTime;
+      bool  bQueued;
+      bool  bAlive;
+      /* next dead slot in the free list, NO_VALUE ends it */
+      int   iNext;
+   };
+
+   /* lifetime expiry: min-heap of (expire time, slot) */
+   typedef std::pair<float, int> ExpiryEntry;
+
+   std::vector<Slot>               m_Slots;
+   int                             m_iFirstFree;
+   int                             m_iAliveCount;
+   std::unordered_map<UINT64, int> m_CellIndex;
+   std::priority_queue<ExpiryEntry, std::vector<ExpiryEntry>, std::greater<ExpiryEntry> > m_ExpiryQueue;
+   float                           m_fGridOrigin;
+   float                           m_fCellSize;
+};
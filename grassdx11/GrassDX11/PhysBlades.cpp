@@ -0,0 +1,403 @@
+#include "PhysBlades.h"
+
+#include <chrono>
+
+
+BladeStreams::BladeStreams(void)
+{
+   m_pData = NULL;
+   m_uCount = 0;
+   m_uStride = 0;
+   m_bOwned = false;
+}
+
+
+BladeStreams::~BladeStreams(void)
+{
+   Release();
+}
+
+
+void BladeStreams::Release(void)
+{
+   if (m_pData && m_bOwned)
+      _aligned_free(m_pData);
+   m_pData = NULL;
+}
+
+
+size_t BladeStreams::Bytes(UINT a_uNumBlades)
+{
+   return S_COUNT * ((a_uNumBlades + PHYS_LANES - 1) / PHYS_LANES * PHYS_LANES) * sizeof(float);
+}
+
+
+void BladeStreams::Allocate(UINT a_uNumBlades)
+{
+   Release();
+   Init((float*)_aligned_malloc(Bytes(a_uNumBlades), 16), a_uNumBlades);
+   m_bOwned = true;
+}
+
+
+void BladeStreams::Attach(float* a_pData, UINT a_uNumBlades)
+{
+   Release();
+   Init(a_pData, a_uNumBlades);
+   m_bOwned = false;
+}
+
+
+void BladeStreams::Init(float* a_pData, UINT a_uNumBlades)
+{
+   m_uCount = a_uNumBlades;
+   m_uStride = (a_uNumBlades + PHYS_LANES - 1) / PHYS_LANES * PHYS_LANES;
+   m_pData = a_pData;
+   ZeroMemory(m_pData, Bytes(a_uNumBlades));
+
+   /* padding lanes are never simulated, but keep them free of divisions by zero */
+   for (UINT i = 0; i < m_uStride; i++)
+   {
+      Stream(S_HEIGHT)[i] = 1.0f;
+      for (UINT j = 0; j < NUM_SEGMENTS - 1; j++)
+      {
+         Stream(S_MASS + j)[i] = 1.0f;
+         Stream(S_HARDNESS + j)[i] = 1.0f;
+      }
+      Stream(S_FIRST)[i] = (float)NUM_SEGMENTS;
+   }
+}
+
+
+float3 BladeStreams::GetVec(UINT a_uStream, UINT a_uBlade) const
+{
+   return create(Stream(a_uStream)[a_uBlade], Stream(a_uStream + 1)[a_uBlade], Stream(a_uStream + 2)[a_uBlade]);
+}
+
+
+void BladeStreams::SetVec(UINT a_uStream, UINT a_uBlade, const float3& a_vVal)
+{
+   Stream(a_uStream)[a_uBlade] = getx(a_vVal);
+   Stream(a_uStream + 1)[a_uBlade] = gety(a_vVal);
+   Stream(a_uStream + 2)[a_uBlade] = getz(a_vVal);
+}
+
+
+float4 BladeStreams::GetQuat(UINT a_uStream, UINT a_uBlade) const
+{
+   return create(Stream(a_uStream)[a_uBlade], Stream(a_uStream + 1)[a_uBlade], Stream(a_uStream + 2)[a_uBlade], Stream(a_uStream + 3)[a_uBlade]);
+}
+
+
+void BladeStreams::SetQuat(UINT a_uStream, UINT a_uBlade, const float4& a_qVal)
+{
+   SetVec(a_uStream, a_uBlade, a_qVal);
+   Stream(a_uStream + 3)[a_uBlade] = getw(a_qVal);
+}
+
+
+void BladeStreams::Load(UINT a_uBlade, BladeState& a_State) const
+{
+   for (UINT j = 0; j < NUM_SEGMENTS; j++)
+   {
+      a_State.w[j] = GetVec(S_W + 3 * j, a_uBlade);
+      a_State.position[j] = GetVec(S_POSITION + 3 * j, a_uBlade);
+      a_State.R[j] = GetQuat(S_R + 4 * j, a_uBlade);
+      a_State.T[j] = GetQuat(S_T + 4 * j, a_uBlade);
+   }
+}
+
+
+void BladeStreams::Store(UINT a_uBlade, const BladeState& a_State)
+{
+   for (UINT j = 0; j < NUM_SEGMENTS; j++)
+   {
+      SetVec(S_W + 3 * j, a_uBlade, a_State.w[j]);
+      SetVec(S_POSITION + 3 * j, a_uBlade, a_State.position[j]);
+      SetQuat(S_R + 4 * j, a_uBlade, a_State.R[j]);
+      SetQuat(S_T + 4 * j, a_uBlade, a_State.T[j]);
+   }
+}
+
+
+void BladeStreams::CopyBlade(UINT a_uDst, const BladeStreams& a_Src, UINT a_uSrc)
+{
+   for (UINT s = 0; s < S_COUNT; s++)
+      Stream(s)[a_uDst] = a_Src.Stream(s)[a_uSrc];
+}
+
+
+void BladeStreams::SavePrevOrientation(void)
+{
+   memcpy(Stream(S_PREV_T), Stream(S_T), 4 * NUM_SEGMENTS * m_uStride * sizeof(float));
+}
+
+
+/*********************
+Stream lanes
+*********************/
+
+static inline LaneVec3 LoadVec3(const BladeStreams& b, UINT s, UINT i)
+{
+   LaneVec3 r;
+   r.x = LaneLoad(b.Stream(s) + i);
+   r.y = LaneLoad(b.Stream(s + 1) + i);
+   r.z = LaneLoad(b.Stream(s + 2) + i);
+   return r;
+}
+
+
+static inline void StoreVec3(BladeStreams& b, UINT s, UINT i, const LaneVec3& v, FXMVECTOR mask)
+{
+   LaneStore(b.Stream(s) + i, v.x, mask);
+   LaneStore(b.Stream(s + 1) + i, v.y, mask);
+   LaneStore(b.Stream(s + 2) + i, v.z, mask);
+}
+
+
+static inline LaneQuat LoadQuat(const BladeStreams& b, UINT s, UINT i)
+{
+   LaneQuat r;
+   r.x = LaneLoad(b.Stream(s) + i);
+   r.y = LaneLoad(b.Stream(s + 1) + i);
+   r.z = LaneLoad(b.Stream(s + 2) + i);
+   r.w = LaneLoad(b.Stream(s + 3) + i);
+   return r;
+}
+
+
+static inline void StoreQuat(BladeStreams& b, UINT s, UINT i, const LaneQuat& q, FXMVECTOR mask)
+{
+   LaneStore(b.Stream(s) + i, q.x, mask);
+   LaneStore(b.Stream(s + 1) + i, q.y, mask);
+   LaneStore(b.Stream(s + 2) + i, q.z, mask);
+   LaneStore(b.Stream(s + 3) + i, q.w, mask);
+}
+
+
+/* CalcTR with the new angular velocity, positions of the segment end and the velocity for the next segment */
+static void FinishSegmentLanes(BladeStreams& a_Blades, UINT a_uBase, int j, const LaneQuat& T_1, const LaneQuat& R, const LaneVec3& w, FXMVECTOR dt, FXMVECTOR height, FXMVECTOR mask, LaneVec3& a_vZ)
+{
+   LaneVec3 pos_1 = LoadVec3(a_Blades, BladeStreams::S_POSITION + 3 * (j - 1), a_uBase);
+
+   /* RotateSegment: position = pos_1 + T * (0, height, 0), second column of the rotation */
+   LaneQuat Tres, Rres;
+   CalcTRLanes(Tres, Rres, T_1, R, Scale(w, dt));
+   XMVECTOR two = XMVectorReplicate(2.0f);
+   XMVECTOR twoH = XMVectorMultiply(two, height);
+   LaneVec3 pos;
+   pos.x = XMVectorMultiplyAdd(twoH, XMVectorNegativeMultiplySubtract(Tres.z, Tres.w, XMVectorMultiply(Tres.x, Tres.y)), pos_1.x);
+   pos.y = XMVectorAdd(pos_1.y, XMVectorNegativeMultiplySubtract(twoH, XMVectorMultiplyAdd(Tres.z, Tres.z, XMVectorMultiply(Tres.x, Tres.x)), height));
+   pos.z = XMVectorMultiplyAdd(twoH, XMVectorMultiplyAdd(Tres.x, Tres.w, XMVectorMultiply(Tres.y, Tres.z)), pos_1.z);
+
+   LaneVec3 r = VelLanes(Tres, w, XMVectorMultiply(height, XMVectorReplicate(0.5f)));
+   a_vZ.x = XMVectorSelect(a_vZ.x, XMVectorMultiplyAdd(two, r.x, a_vZ.x), mask);
+   a_vZ.y = XMVectorSelect(a_vZ.y, XMVectorMultiplyAdd(two, r.y, a_vZ.y), mask);
+   a_vZ.z = XMVectorSelect(a_vZ.z, XMVectorMultiplyAdd(two, r.z, a_vZ.z), mask);
+
+   StoreVec3(a_Blades, BladeStreams::S_W + 3 * j, a_uBase, w, mask);
+   StoreVec3(a_Blades, BladeStreams::S_POSITION + 3 * j, a_uBase, pos, mask);
+   StoreQuat(a_Blades, BladeStreams::S_R + 4 * j, a_uBase, Rres, mask);
+   StoreQuat(a_Blades, BladeStreams::S_T + 4 * j, a_uBase, Tres, mask);
+}
+
+
+static void HeunStepLanes(BladeStreams& a_Blades, UINT a_uBase, int j, float a_fTime, float a_fDamp, FXMVECTOR a_vMask, LaneVec3& a_vZ)
+{
+   XMVECTOR dt = XMVectorReplicate(a_fTime);
+   XMVECTOR height = LaneLoad(a_Blades.Stream(BladeStreams::S_HEIGHT) + a_uBase);
+   XMVECTOR halfHeight = XMVectorMultiply(height, XMVectorReplicate(0.5f));
+   XMVECTOR mass = LaneLoad(a_Blades.Stream(BladeStreams::S_MASS + j - 1) + a_uBase);
+   XMVECTOR hardness = LaneLoad(a_Blades.Stream(BladeStreams::S_HARDNESS + j - 1) + a_uBase);
+   XMVECTOR oneThirdMMulLSqr = XMVectorMultiply(XMVectorMultiply(XMVectorMultiply(XMVectorReplicate(0.33f), mass), height), height);
+   XMVECTOR invJ = XMVectorDivide(XMVectorReplicate(0.75f), oneThirdMMulLSqr);
+
+   LaneVec3 wind = LoadVec3(a_Blades, BladeStreams::S_WIND, a_uBase);
+   LaneVec3 w = LoadVec3(a_Blades, BladeStreams::S_W + 3 * j, a_uBase);
+   LaneQuat R = LoadQuat(a_Blades, BladeStreams::S_R + 4 * j, a_uBase);
+   LaneQuat T = LoadQuat(a_Blades, BladeStreams::S_T + 4 * j, a_uBase);
+   LaneQuat T_1 = LoadQuat(a_Blades, BladeStreams::S_T + 4 * (j - 1), a_uBase);
+
+   /* predictor */
+   LaneVec3 sum = ForceLanes(wind, a_vZ, VelLanes(T, w, halfHeight), mass);
+   LaneVec3 Dw = DwLanes(T, R, sum, invJ, halfHeight, hardness);
+   LaneVec3 w_ = MulAdd(Dw, dt, w);
+
+   LaneQuat Tres, Rres;
+   CalcTRLanes(Tres, Rres, T_1, R, Scale(w_, dt));
+
+   /* corrector */
+   sum = ForceLanes(wind, a_vZ, VelLanes(Tres, w_, halfHeight), mass);
+   LaneVec3 Dw_ = DwLanes(Tres, Rres, sum, invJ, halfHeight, hardness);
+
+   XMVECTOR halfDt = XMVectorReplicate(0.5f * a_fTime);
+   XMVECTOR damp = XMVectorReplicate(a_fDamp);
+   w.x = XMVectorMultiply(XMVectorMultiplyAdd(halfDt, XMVectorAdd(Dw.x, Dw_.x), w.x), damp);
+   w.y = XMVectorMultiply(XMVectorMultiplyAdd(halfDt, XMVectorAdd(Dw.y, Dw_.y), w.y), damp);
+   w.z = XMVectorMultiply(XMVectorMultiplyAdd(halfDt, XMVectorAdd(Dw.z, Dw_.z), w.z), damp);
+
+   FinishSegmentLanes(a_Blades, a_uBase, j, T_1, R, w, dt, height, a_vMask, a_vZ);
+}
+
+
+/*
+Linearly implicit Euler: gravity and air drag are taken at the start of the step,
+the spring torque -hardness * log(R) at the end of it. With log(R') ~ log(R) + dt * w'
+  J * (w' - w) = dt * (torque - hardness * (log(R) + dt * w'))
+  w' = (w + dt * Dw) / (1 + dt^2 * hardness / J)
+the spring can not gain energy however large dt is.
+*/
+static void SemiImplicitStepLanes(BladeStreams& a_Blades, UINT a_uBase, int j, float a_fTime, float a_fDamp, FXMVECTOR a_vMask, LaneVec3& a_vZ)
+{
+   XMVECTOR dt = XMVectorReplicate(a_fTime);
+   XMVECTOR height = LaneLoad(a_Blades.Stream(BladeStreams::S_HEIGHT) + a_uBase);
+   XMVECTOR halfHeight = XMVectorMultiply(height, XMVectorReplicate(0.5f));
+   XMVECTOR mass = LaneLoad(a_Blades.Stream(BladeStreams::S_MASS + j - 1) + a_uBase);
+   XMVECTOR hardness = LaneLoad(a_Blades.Stream(BladeStreams::S_HARDNESS + j - 1) + a_uBase);
+   XMVECTOR oneThirdMMulLSqr = XMVectorMultiply(XMVectorMultiply(XMVectorMultiply(XMVectorReplicate(0.33f), mass), height), height);
+   XMVECTOR invJ = XMVectorDivide(XMVectorReplicate(0.75f), oneThirdMMulLSqr);
+
+   LaneVec3 wind = LoadVec3(a_Blades, BladeStreams::S_WIND, a_uBase);
+   LaneVec3 w = LoadVec3(a_Blades, BladeStreams::S_W + 3 * j, a_uBase);
+   LaneQuat R = LoadQuat(a_Blades, BladeStreams::S_R + 4 * j, a_uBase);
+   LaneQuat T = LoadQuat(a_Blades, BladeStreams::S_T + 4 * j, a_uBase);
+   LaneQuat T_1 = LoadQuat(a_Blades, BladeStreams::S_T + 4 * (j - 1), a_uBase);
+
+   LaneVec3 sum = ForceLanes(wind, a_vZ, VelLanes(T, w, halfHeight), mass);
+   LaneVec3 Dw = DwLanes(T, R, sum, invJ, halfHeight, hardness);
+
+   XMVECTOR stiff = XMVectorMultiply(XMVectorMultiply(hardness, invJ), XMVectorMultiply(dt, dt));
+   XMVECTOR k = XMVectorDivide(XMVectorReplicate(a_fDamp), XMVectorAdd(XMVectorSplatOne(), stiff));
+   w = Scale(MulAdd(Dw, dt, w), k);
+
+   FinishSegmentLanes(a_Blades, a_uBase, j, T_1, R, w, dt, height, a_vMask, a_vZ);
+}
+
+
+XMVECTOR StepSegmentLanes(BladeStreams& a_Blades, UINT a_uBase, int a_iSegment, float a_fTime, float a_fDamp, LaneVec3& a_vZ)
+{
+   const int j = a_iSegment;
+   XMVECTOR mask = XMVectorLessOrEqual(LaneLoad(a_Blades.Stream(BladeStreams::S_FIRST) + a_uBase), XMVectorReplicate((float)j));
+   if (XMVector4EqualInt(mask, XMVectorFalseInt()))
+      return mask;
+
+   /* blades of different sub-types may share the lanes, each solver writes only its own ones */
+   XMVECTOR implicit = XMVectorEqual(LaneLoad(a_Blades.Stream(BladeStreams::S_SOLVER) + a_uBase), XMVectorReplicate((float)BLADE_INTEGRATOR_SEMI_IMPLICIT));
+   XMVECTOR heunMask = XMVectorAndCInt(mask, implicit);
+   XMVECTOR implicitMask = XMVectorAndInt(mask, implicit);
+
+   if (!XMVector4EqualInt(heunMask, XMVectorFalseInt()))
+      HeunStepLanes(a_Blades, a_uBase, j, a_fTime, a_fDamp, heunMask, a_vZ);
+   if (!XMVector4EqualInt(implicitMask, XMVectorFalseInt()))
+      SemiImplicitStepLanes(a_Blades, a_uBase, j, a_fTime, a_fDamp, implicitMask, a_vZ);
+   return mask;
+}
+
+
+/* kinetic, spring and gravity energy of blade 0, gravity relative to the straight blade */
+static float BladeEnergy(const BladeStreams& a_Blades, const GrassPropsUnified& a_Props)
+{
+   float fHeight = a_Blades.Stream(BladeStreams::S_HEIGHT)[0];
+   float fEnergy = 0.0f;
+   for (int j = 1; j < NUM_SEGMENTS; j++)
+   {
+      float fMass = getcoord(a_Props.vMassSegment, j - 1);
+      float fHardness = getcoord(a_Props.vHardnessSegment, j - 1);
+      float fJ = 0.33f * fMass * fHeight * fHeight / 0.75f;
+      float3 w = a_Blades.GetVec(BladeStreams::S_W + 3 * j, 0);
+      float3 g = QuaternionToRotationVector(a_Blades.GetQuat(BladeStreams::S_R + 4 * j, 0));
+      float fCentreY = 0.5f * (gety(a_Blades.GetVec(BladeStreams::S_POSITION + 3 * (j - 1), 0)) + gety(a_Blades.GetVec(BladeStreams::S_POSITION + 3 * j, 0)));
+
+      fEnergy += 0.5f * fJ * XMVectorGetX(XMVector3LengthSq(w));
+      fEnergy += 0.5f * fHardness * XMVectorGetX(XMVector3LengthSq(g));
+      fEnergy += 9.8f * fMass * (fCentreY - (j - 0.5f) * fHeight);
+   }
+   return fEnergy;
+}
+
+
+static void InitBlade(BladeStreams& a_Blades, const GrassPropsUnified& a_Props, float a_fDeflection)
+{
+   a_Blades.Allocate(1);
+   float fHeight = gety(a_Props.vSizes);
+   a_Blades.Stream(BladeStreams::S_HEIGHT)[0] = fHeight;
+   a_Blades.Stream(BladeStreams::S_FIRST)[0] = 1.0f;
+   a_Blades.Stream(BladeStreams::S_SOLVER)[0] = (float)a_Props.uIntegrator;
+
+   float3 axis = create(0.0f, fHeight, 0.0f);
+   float4 T = create(0.0f, 0.0f, 0.0f, 1.0f);
+   a_Blades.SetQuat(BladeStreams::S_R, 0, T);
+   a_Blades.SetQuat(BladeStreams::S_T, 0, T);
+   for (int j = 1; j < NUM_SEGMENTS; j++)
+   {
+      a_Blades.Stream(BladeStreams::S_MASS + j - 1)[0] = getcoord(a_Props.vMassSegment, j - 1);
+      a_Blades.Stream(BladeStreams::S_HARDNESS + j - 1)[0] = getcoord(a_Props.vHardnessSegment, j - 1);
+
+      float4 R = (j == 1) ? MakeRotationQuaternion(create(a_fDeflection, 0.0f, 0.0f)) : create(0.0f, 0.0f, 0.0f, 1.0f);
+      T = qmul(T, R);
+      a_Blades.SetQuat(BladeStreams::S_R + 4 * j, 0, R);
+      a_Blades.SetQuat(BladeStreams::S_T + 4 * j, 0, T);
+      a_Blades.SetVec(BladeStreams::S_POSITION + 3 * j, 0, a_Blades.GetVec(BladeStreams::S_POSITION + 3 * (j - 1), 0) + qrotate(T, axis));
+   }
+}
+
+
+static void StepBlade(BladeStreams& a_Blades, float a_fTime, float a_fDamp)
+{
+   LaneVec3 vZ;
+   vZ.x = vZ.y = vZ.z = XMVectorZero();
+   for (int j = 1; j < NUM_SEGMENTS; j++)
+      StepSegmentLanes(a_Blades, 0, j, a_fTime, a_fDamp, vZ);
+}
+
+
+BladeRunStats RunBladeToRest(const GrassPropsUnified& a_Props, float a_fTime, UINT a_uNumSteps, float a_fDeflection, float a_fRestVel)
+{
+   BladeRunStats stats;
+   ZeroMemory(&stats, sizeof(stats));
+
+   /* same damping as PhysPatch::UpdatePhysics */
+   float fDamp = powf(0.98f, a_fTime * 0.01f);
+   if (fDamp > 0.9998f) fDamp = 0.9998f;
+
+   BladeStreams blades;
+   InitBlade(blades, a_Props, a_fDeflection);
+   stats.fStartEnergy = BladeEnergy(blades, a_Props);
+   stats.bFinite = true;
+
+   float fEnergy = stats.fStartEnergy;
+   float fScale = max(fabsf(stats.fStartEnergy), 1e-6f);
+   for (UINT uStep = 0; uStep < a_uNumSteps; uStep++)
+   {
+      StepBlade(blades, a_fTime, fDamp);
+
+      float fNewEnergy = BladeEnergy(blades, a_Props);
+      if (!_finite(fNewEnergy))
+      {
+         stats.bFinite = false;
+         break;
+      }
+      stats.fMaxEnergyGain = max(stats.fMaxEnergyGain, (fNewEnergy - fEnergy) / fScale);
+      fEnergy = fNewEnergy;
+
+      /* at rest until the blade moves again, a swing passes zero velocity too */
+      float fMaxVel = 0.0f;
+      for (int j = 1; j < NUM_SEGMENTS; j++)
+         fMaxVel = max(fMaxVel, XMVectorGetX(XMVector3Length(blades.GetVec(BladeStreams::S_W + 3 * j, 0))));
+      if (fMaxVel >= a_fRestVel)
+         stats.uStepsToRest = 0;
+      else if (stats.uStepsToRest == 0)
+         stats.uStepsToRest = uStep + 1;
+   }
+   stats.fEndEnergy = fEnergy;
+
+   /* cost of the step alone, without the energy bookkeeping */
+   InitBlade(blades, a_Props, a_fDeflection);
+   auto tStart = std::chrono::high_resolution_clock::now();
+   for (UINT uStep = 0; uStep < a_uNumSteps; uStep++)
+      StepBlade(blades, a_fTime, fDamp);
+   auto tEnd = std::chrono::high_resolution_clock::now();
+   stats.fNsPerStep = std::chrono::duration<double, std::nano>(tEnd - tStart).count() / max(a_uNumSteps, 1u);
+
+   return stats;
+}
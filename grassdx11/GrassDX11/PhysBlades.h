@@ -0,0 +1,125 @@
+#pragma once
+
+#include "includes.h"
+#include "GrassProperties.h"
+#include "PhysLanes.h"
+
+/**
+Scalar view of one blade's dynamic state.
+Gathered from / scattered back to BladeStreams by the rare per-blade paths
+(broken blades, animation, collision response).
+*/
+struct BladeState
+{
+   float3 w[NUM_SEGMENTS];
+   float4 R[NUM_SEGMENTS];      /* unit quaternion */
+   float4 T[NUM_SEGMENTS];      /* unit quaternion */
+   float3 position[NUM_SEGMENTS];
+};
+
+/**
+Structure-of-arrays storage for the dynamic state of all blades of one patch.
+Every scalar field lives in its own 16-byte aligned stream, padded up to a multiple
+of PHYS_LANES, so PHYS_LANES neighbour blades are loaded with one XMLoadFloat4A.
+Vectors take 3 streams (x, y, z), quaternions take 4 streams (x, y, z, w).
+*/
+class BladeStreams
+{
+public:
+   enum STREAM
+   {
+      /* state */
+      S_W        = 0,                              /* angular velocity, per segment */
+      S_POSITION = S_W + 3 * NUM_SEGMENTS,         /* segment start position, per segment */
+      S_R        = S_POSITION + 3 * NUM_SEGMENTS,  /* rotation relative to the lower segment, per segment */
+      S_T        = S_R + 4 * NUM_SEGMENTS,         /* accumulated rotation, per segment */
+      S_PREV_T   = S_T + 4 * NUM_SEGMENTS,         /* S_T before the last step, for render interpolation */
+      /* integrator inputs, refreshed by PhysPatch::UpdatePhysics every step */
+      S_WIND     = S_PREV_T + 4 * NUM_SEGMENTS,    /* air velocity at the blade root */
+      S_HEIGHT   = S_WIND + 3,                     /* segment height */
+      S_MASS     = S_HEIGHT + 1,                   /* mass of segments 1..NUM_SEGMENTS-1 */
+      S_HARDNESS = S_MASS + NUM_SEGMENTS - 1,      /* hardness of segments 1..NUM_SEGMENTS-1 */
+      S_FIRST    = S_HARDNESS + NUM_SEGMENTS - 1,  /* first simulated segment, NUM_SEGMENTS - not simulated */
+      S_SOLVER   = S_FIRST + 1,                    /* BladeIntegrator of the blade */
+      S_COUNT    = S_SOLVER + 1
+   };
+
+   BladeStreams (void);
+   ~BladeStreams(void);
+
+   /**
+   Allocates zeroed streams for a_uNumBlades blades
+   */
+   void Allocate (UINT a_uNumBlades);
+
+   /**
+   Same as Allocate, but places the streams in a_pData, 16-byte aligned memory
+   of Bytes(a_uNumBlades) owned by the caller
+   */
+   void Attach   (float* a_pData, UINT a_uNumBlades);
+
+   static size_t Bytes (UINT a_uNumBlades);
+
+   UINT Count  (void) const { return m_uCount; }
+   UINT Stride (void) const { return m_uStride; }
+
+   float*       Stream (UINT a_uStream)       { return m_pData + a_uStream * m_uStride; }
+   const float* Stream (UINT a_uStream) const { return m_pData + a_uStream * m_uStride; }
+
+   float3 GetVec  (UINT a_uStream, UINT a_uBlade) const;
+   void   SetVec  (UINT a_uStream, UINT a_uBlade, const float3& a_vVal);
+   float4 GetQuat (UINT a_uStream, UINT a_uBlade) const;
+   void   SetQuat (UINT a_uStream, UINT a_uBlade, const float4& a_qVal);
+
+   void Load      (UINT a_uBlade, BladeState& a_State) const;
+   void Store     (UINT a_uBlade, const BladeState& a_State);
+   void CopyBlade (UINT a_uDst, const BladeStreams& a_Src, UINT a_uSrc);
+
+   /**
+   Copies S_T of all blades to S_PREV_T, called before the steps of a patch update
+   */
+   void SavePrevOrientation (void);
+
+private:
+   BladeStreams (const BladeStreams&);
+   BladeStreams& operator = (const BladeStreams&);
+
+   void Release (void);
+   void Init    (float* a_pData, UINT a_uNumBlades);
+
+   float* m_pData;
+   UINT   m_uCount;
+   UINT   m_uStride;
+   bool   m_bOwned;
+};
+
+/**
+Advances segment a_iSegment of blades [a_uBase, a_uBase + PHYS_LANES) by one step
+of the integrator in S_SOLVER of every blade.
+BLADE_INTEGRATOR_HEUN is the same maths as the scalar GetDw / CalcTR / RotateSegment path in PhysPatch.cpp,
+BLADE_INTEGRATOR_SEMI_IMPLICIT takes the spring torque at the end of the step.
+Orientations are kept as quaternions and never expanded to matrices.
+param a_vZ velocity accumulated by the lower segments, updated for the next segment
+return lane mask of the blades that were advanced
+*/
+XMVECTOR StepSegmentLanes (BladeStreams& a_Blades, UINT a_uBase, int a_iSegment, float a_fTime, float a_fDamp, LaneVec3& a_vZ);
+
+/**
+Single blade run of RunBladeToRest
+*/
+struct BladeRunStats
+{
+   float  fStartEnergy;
+   float  fEndEnergy;
+   float  fMaxEnergyGain;  /* largest energy increase of one step, relative to the start energy */
+   UINT   uStepsToRest;    /* steps until all segments are slower than the rest velocity, 0 - never */
+   double fNsPerStep;
+   bool   bFinite;         /* false if the state blew up to inf / nan */
+};
+
+/**
+Releases one blade, bent by a_fDeflection radians at the root, in still air and steps it
+a_uNumSteps times. Needs no device and no patch, used to compare the integrators.
+param a_Props mass, hardness and height of the segments, a_Props.uIntegrator selects the solver
+*/
+BladeRunStats RunBladeToRest (const GrassPropsUnified& a_Props, float a_fTime, UINT a_uNumSteps, float a_fDeflection, float a_fRestVel);
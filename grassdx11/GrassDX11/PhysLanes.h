@@ -0,0 +1,209 @@
+#pragma once
+
+#include "includes.h"
+#include "PhysMath.h"
+
+/*
+Lane maths shared by the batched solvers: every XMVECTOR holds one scalar of
+PHYS_LANES blades (or wind texels), so PHYS_LANES pendulums advance with the same
+instructions. The functions mirror the scalar ones of PhysMath.h and PhysPatch.cpp.
+*/
+
+/* Number of pendulums advanced together: one XMVECTOR lane per pendulum */
+#define PHYS_LANES 4
+
+/**
+Lane vector: component c of PHYS_LANES lanes
+*/
+struct LaneVec3
+{
+   XMVECTOR x, y, z;
+};
+
+
+/* Quaternion (x, y, z, w) of PHYS_LANES lanes */
+struct LaneQuat
+{
+   XMVECTOR x, y, z, w;
+};
+
+
+inline XMVECTOR LaneLoad(const float* p)
+{
+   return XMLoadFloat4A((const XMFLOAT4A*)p);
+}
+
+
+inline void LaneStore(float* p, FXMVECTOR v, FXMVECTOR mask)
+{
+   XMStoreFloat4A((XMFLOAT4A*)p, XMVectorSelect(LaneLoad(p), v, mask));
+}
+
+
+inline XMVECTOR Dot3(const LaneVec3& a, const LaneVec3& b)
+{
+   return XMVectorMultiplyAdd(a.z, b.z, XMVectorMultiplyAdd(a.y, b.y, XMVectorMultiply(a.x, b.x)));
+}
+
+
+inline LaneVec3 Cross3(const LaneVec3& a, const LaneVec3& b)
+{
+   LaneVec3 r;
+   r.x = XMVectorNegativeMultiplySubtract(a.z, b.y, XMVectorMultiply(a.y, b.z));
+   r.y = XMVectorNegativeMultiplySubtract(a.x, b.z, XMVectorMultiply(a.z, b.x));
+   r.z = XMVectorNegativeMultiplySubtract(a.y, b.x, XMVectorMultiply(a.x, b.y));
+   return r;
+}
+
+
+/* r = a * b (same as qmul) */
+inline LaneQuat MulQuat(const LaneQuat& a, const LaneQuat& b)
+{
+   LaneQuat r;
+   r.x = XMVectorMultiplyAdd(a.w, b.x, XMVectorMultiplyAdd(a.x, b.w, XMVectorNegativeMultiplySubtract(a.z, b.y, XMVectorMultiply(a.y, b.z))));
+   r.y = XMVectorMultiplyAdd(a.w, b.y, XMVectorMultiplyAdd(a.y, b.w, XMVectorNegativeMultiplySubtract(a.x, b.z, XMVectorMultiply(a.z, b.x))));
+   r.z = XMVectorMultiplyAdd(a.w, b.z, XMVectorMultiplyAdd(a.z, b.w, XMVectorNegativeMultiplySubtract(a.y, b.x, XMVectorMultiply(a.x, b.y))));
+   r.w = XMVectorNegativeMultiplySubtract(a.z, b.z, XMVectorNegativeMultiplySubtract(a.y, b.y, XMVectorNegativeMultiplySubtract(a.x, b.x, XMVectorMultiply(a.w, b.w))));
+   return r;
+}
+
+
+inline void NormalizeQuat(LaneQuat& q)
+{
+   XMVECTOR len2 = XMVectorMultiplyAdd(q.w, q.w, XMVectorMultiplyAdd(q.z, q.z, XMVectorMultiplyAdd(q.y, q.y, XMVectorMultiply(q.x, q.x))));
+   XMVECTOR invLen = XMVectorReciprocalSqrt(len2);
+   q.x = XMVectorMultiply(q.x, invLen);
+   q.y = XMVectorMultiply(q.y, invLen);
+   q.z = XMVectorMultiply(q.z, invLen);
+   q.w = XMVectorMultiply(q.w, invLen);
+}
+
+
+/* Rotates v by q, a_fSign = -1 rotates by the conjugate (same as qrotate / qunrotate) */
+inline LaneVec3 RotateLanes(const LaneQuat& q, const LaneVec3& v, float a_fSign)
+{
+   LaneVec3 u;
+   XMVECTOR sign = XMVectorReplicate(a_fSign);
+   u.x = XMVectorMultiply(q.x, sign);
+   u.y = XMVectorMultiply(q.y, sign);
+   u.z = XMVectorMultiply(q.z, sign);
+
+   LaneVec3 t = Cross3(u, v);
+   XMVECTOR two = XMVectorReplicate(2.0f);
+   t.x = XMVectorMultiply(t.x, two);
+   t.y = XMVectorMultiply(t.y, two);
+   t.z = XMVectorMultiply(t.z, two);
+
+   LaneVec3 c = Cross3(u, t);
+   LaneVec3 r;
+   r.x = XMVectorAdd(XMVectorMultiplyAdd(q.w, t.x, v.x), c.x);
+   r.y = XMVectorAdd(XMVectorMultiplyAdd(q.w, t.y, v.y), c.y);
+   r.z = XMVectorAdd(XMVectorMultiplyAdd(q.w, t.z, v.z), c.z);
+   return r;
+}
+
+
+/* Lane version of MakeRotationQuaternion */
+inline LaneQuat RotationQuatLanes(const LaneVec3& axis)
+{
+   XMVECTOR angle = XMVectorSqrt(Dot3(axis, axis));
+   XMVECTOR small = XMVectorLess(angle, XMVectorReplicate((float)EPSILON));
+
+   XMVECTOR fSin, fCos;
+   XMVectorSinCos(&fSin, &fCos, XMVectorMultiply(angle, XMVectorReplicate(0.5f)));
+   XMVECTOR k = XMVectorSelect(XMVectorDivide(fSin, angle), XMVectorZero(), small);
+
+   LaneQuat r;
+   r.x = XMVectorMultiply(axis.x, k);
+   r.y = XMVectorMultiply(axis.y, k);
+   r.z = XMVectorMultiply(axis.z, k);
+   r.w = XMVectorSelect(fCos, XMVectorSplatOne(), small);
+   return r;
+}
+
+
+/* Lane version of QuaternionToRotationVector */
+inline LaneVec3 RotationVectorLanes(const LaneQuat& q)
+{
+   XMVECTOR sign = XMVectorSelect(XMVectorSplatOne(), XMVectorReplicate(-1.0f), XMVectorLess(q.w, XMVectorZero()));
+   LaneVec3 v;
+   v.x = XMVectorMultiply(q.x, sign);
+   v.y = XMVectorMultiply(q.y, sign);
+   v.z = XMVectorMultiply(q.z, sign);
+
+   XMVECTOR fSin = XMVectorSqrt(Dot3(v, v));
+   XMVECTOR small = XMVectorLess(fSin, XMVectorReplicate((float)EPSILON));
+   XMVECTOR thetha = XMVectorMultiply(XMVectorReplicate(2.0f), XMVectorATan2(fSin, XMVectorMultiply(q.w, sign)));
+   XMVECTOR k = XMVectorSelect(XMVectorDivide(thetha, fSin), XMVectorZero(), small);
+
+   v.x = XMVectorMultiply(v.x, k);
+   v.y = XMVectorMultiply(v.y, k);
+   v.z = XMVectorMultiply(v.z, k);
+   return v;
+}
+
+
+/* GetVel: velocity of the segment centre, T rotates cross(w, halfAxis) */
+inline LaneVec3 VelLanes(const LaneQuat& T, const LaneVec3& w, FXMVECTOR halfHeight)
+{
+   LaneVec3 r;
+   r.x = XMVectorNegate(XMVectorMultiply(w.z, halfHeight));
+   r.y = XMVectorZero();
+   r.z = XMVectorMultiply(w.x, halfHeight);
+   return RotateLanes(T, r, 1.0f);
+}
+
+
+/* g * mass + 0.02 * (wind - v) */
+inline LaneVec3 ForceLanes(const LaneVec3& wind, const LaneVec3& vZ, const LaneVec3& r, FXMVECTOR mass)
+{
+   XMVECTOR k = XMVectorReplicate(0.02f);
+   LaneVec3 f;
+   f.x = XMVectorMultiply(k, XMVectorSubtract(wind.x, XMVectorAdd(vZ.x, r.x)));
+   f.y = XMVectorMultiply(k, XMVectorSubtract(wind.y, XMVectorAdd(vZ.y, r.y)));
+   f.z = XMVectorMultiply(k, XMVectorSubtract(wind.z, XMVectorAdd(vZ.z, r.z)));
+   f.y = XMVectorMultiplyAdd(XMVectorReplicate(-9.8f), mass, f.y);
+   return f;
+}
+
+
+/* GetDw: (cross(halfAxis, unrotated sum) - hardness * log(R)) * invJ */
+inline LaneVec3 DwLanes(const LaneQuat& T, const LaneQuat& R, const LaneVec3& sum, FXMVECTOR invJ, FXMVECTOR halfHeight, FXMVECTOR hardness)
+{
+   LaneVec3 localSum = RotateLanes(T, sum, -1.0f);
+   LaneVec3 g = RotationVectorLanes(R);
+   LaneVec3 r;
+   r.x = XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(halfHeight, localSum.z), XMVectorMultiply(hardness, g.x)), invJ);
+   r.y = XMVectorMultiply(XMVectorNegate(XMVectorMultiply(hardness, g.y)), invJ);
+   r.z = XMVectorMultiply(XMVectorSubtract(XMVectorNegate(XMVectorMultiply(halfHeight, localSum.x)), XMVectorMultiply(hardness, g.z)), invJ);
+   return r;
+}
+
+
+/* CalcTR: Rres = R * Rot(psi), Tres = T_1 * Rres */
+inline void CalcTRLanes(LaneQuat& Tres, LaneQuat& Rres, const LaneQuat& T_1, const LaneQuat& R, const LaneVec3& psi)
+{
+   Rres = MulQuat(R, RotationQuatLanes(psi));
+   NormalizeQuat(Rres);
+   Tres = MulQuat(T_1, Rres);
+}
+
+
+inline LaneVec3 Scale(const LaneVec3& v, FXMVECTOR s)
+{
+   LaneVec3 r;
+   r.x = XMVectorMultiply(v.x, s);
+   r.y = XMVectorMultiply(v.y, s);
+   r.z = XMVectorMultiply(v.z, s);
+   return r;
+}
+
+
+inline LaneVec3 MulAdd(const LaneVec3& v, FXMVECTOR s, const LaneVec3& a)
+{
+   LaneVec3 r;
+   r.x = XMVectorMultiplyAdd(v.x, s, a.x);
+   r.y = XMVectorMultiplyAdd(v.y, s, a.y);
+   r.z = XMVectorMultiplyAdd(v.z, s, a.z);
+   return r;
+}
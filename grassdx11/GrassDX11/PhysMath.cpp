@@ -338,4 +338,170 @@ float3x3 MakeIdentityMatrix(void)
    );
 
    return i;
-}
\ No newline at end of file
+}
+
+
+float4 qmul(const float4& a, const float4& b)
+{
+   /* XMQuaternionMultiply(Q1, Q2) returns Q2 * Q1 */
+   return XMQuaternionMultiply(b, a);
+}
+
+
+float4 qconj(const float4& q)
+{
+   return XMQuaternionConjugate(q);
+}
+
+
+float3 qrotate(const float4& q, const float3& v)
+{
+   float3 u = XMVectorSetW(q, 0.0f);
+   float3 t = 2.0f * XMVector3Cross(u, v);
+   return v + XMVectorSplatW(q) * t + XMVector3Cross(u, t);
+}
+
+
+float3 qunrotate(const float4& q, const float3& v)
+{
+   return qrotate(qconj(q), v);
+}
+
+
+float4 MakeRotationQuaternion(const float3& axis)
+{
+   float angle = length(axis);
+   if (angle < EPSILON)
+      return MakeIdentityQuaternion();
+
+   float fSin = sinf(angle * 0.5f) / angle;
+   return XMVectorSetW(axis * fSin, cosf(angle * 0.5f));
+}
+
+
+float3 QuaternionToRotationVector(const float4& q_)
+{
+   /* keep the angle in [0, PI] as MakeRotationVector does */
+   float4 q = (getw(q_) < 0.0f) ? -q_ : q_;
+   float fSin = length(q);
+   if (fSin < EPSILON)
+      return create(0.0f, 0.0f, 0.0f);
+
+   float thetha = 2.0f * atan2f(fSin, getw(q));
+   return XMVectorSetW(q, 0.0f) * (thetha / fSin);
+}
+
+
+float4 MakeIdentityQuaternion(void)
+{
+   return XMQuaternionIdentity();
+}
+
+
+float3x3 QuaternionToMatrix(const float4& q)
+{
+   float x = getx(q), y = gety(q), z = getz(q), w = getw(q);
+
+   return float3x3(
+      create(1 - 2 * (y * y + z * z), 2 * (x * y - z * w), 2 * (x * z + y * w), 0),
+      create(2 * (x * y + z * w), 1 - 2 * (x * x + z * z), 2 * (y * z - x * w), 0),
+      create(2 * (x * z - y * w), 2 * (y * z + x * w), 1 - 2 * (x * x + y * y), 0),
+      create(0, 0, 0, 1)
+   );
+}
+
+
+float4 MatrixToQuaternion(const float3x3& m_)
+{
+   XMFLOAT4X4 m;
+   XMStoreFloat4x4(&m, m_);
+
+   float4 q;
+   float trace = GET_3x3_ELEM(0, 0) + GET_3x3_ELEM(1, 1) + GET_3x3_ELEM(2, 2);
+   if (trace > 0.0f)
+   {
+      float s = 0.5f / sqrtf(trace + 1.0f);
+      q = create((GET_3x3_ELEM(2, 1) - GET_3x3_ELEM(1, 2)) * s,
+         (GET_3x3_ELEM(0, 2) - GET_3x3_ELEM(2, 0)) * s,
+         (GET_3x3_ELEM(1, 0) - GET_3x3_ELEM(0, 1)) * s,
+         0.25f / s);
+   }
+   else if (GET_3x3_ELEM(0, 0) > GET_3x3_ELEM(1, 1) && GET_3x3_ELEM(0, 0) > GET_3x3_ELEM(2, 2))
+   {
+      float s = 2.0f * sqrtf(1.0f + GET_3x3_ELEM(0, 0) - GET_3x3_ELEM(1, 1) - GET_3x3_ELEM(2, 2));
+      q = create(0.25f * s,
+         (GET_3x3_ELEM(0, 1) + GET_3x3_ELEM(1, 0)) / s,
+         (GET_3x3_ELEM(0, 2) + GET_3x3_ELEM(2, 0)) / s,
+         (GET_3x3_ELEM(2, 1) - GET_3x3_ELEM(1, 2)) / s);
+   }
+   else if (GET_3x3_ELEM(1, 1) > GET_3x3_ELEM(2, 2))
+   {
+      float s = 2.0f * sqrtf(1.0f + GET_3x3_ELEM(1, 1) - GET_3x3_ELEM(0, 0) - GET_3x3_ELEM(2, 2));
+      q = create((GET_3x3_ELEM(0, 1) + GET_3x3_ELEM(1, 0)) / s,
+         0.25f * s,
+         (GET_3x3_ELEM(1, 2) + GET_3x3_ELEM(2, 1)) / s,
+         (GET_3x3_ELEM(0, 2) - GET_3x3_ELEM(2, 0)) / s);
+   }
+   else
+   {
+      float s = 2.0f * sqrtf(1.0f + GET_3x3_ELEM(2, 2) - GET_3x3_ELEM(0, 0) - GET_3x3_ELEM(1, 1));
+      q = create((GET_3x3_ELEM(0, 2) + GET_3x3_ELEM(2, 0)) / s,
+         (GET_3x3_ELEM(1, 2) + GET_3x3_ELEM(2, 1)) / s,
+         0.25f * s,
+         (GET_3x3_ELEM(1, 0) - GET_3x3_ELEM(0, 1)) / s);
+   }
+
+   return XMQuaternionNormalize(q);
+}
+
+
+/* 10 bit step of a smallest three component in [-1/sqrt(2), 1/sqrt(2)] */
+#define QUAT_PACK_SCALE 1.41421356f
+
+unsigned int PackQuaternion(const float4& q_)
+{
+   float c[4];
+   XMFLOAT4 q;
+   XMStoreFloat4(&q, XMQuaternionNormalize(q_));
+   c[0] = q.x; c[1] = q.y; c[2] = q.z; c[3] = q.w;
+
+   unsigned int uLargest = 0;
+   for (unsigned int i = 1; i < 4; i++)
+   {
+      if (fabsf(c[i]) > fabsf(c[uLargest]))
+         uLargest = i;
+   }
+
+   /* q and -q are the same rotation: the dropped component is always positive */
+   float fSign = (c[uLargest] < 0.0f) ? -1.0f : 1.0f;
+   unsigned int uPacked = uLargest << 30;
+   unsigned int uShift = 0;
+   for (unsigned int i = 0; i < 4; i++)
+   {
+      if (i == uLargest)
+         continue;
+      float fUnorm = clamp(fSign * c[i] / QUAT_PACK_SCALE + 0.5f, 0.0f, 1.0f);
+      uPacked |= (unsigned int)(fUnorm * 1023.0f + 0.5f) << uShift;
+      uShift += 10;
+   }
+   return uPacked;
+}
+
+
+float4 UnpackQuaternion(unsigned int a_uPacked)
+{
+   float c[4];
+   unsigned int uLargest = a_uPacked >> 30;
+   unsigned int uShift = 0;
+   float fSum = 0.0f;
+   for (unsigned int i = 0; i < 4; i++)
+   {
+      if (i == uLargest)
+         continue;
+      c[i] = (((a_uPacked >> uShift) & 1023) / 1023.0f - 0.5f) * QUAT_PACK_SCALE;
+      fSum += c[i] * c[i];
+      uShift += 10;
+   }
+   c[uLargest] = (fSum < 1.0f) ? sqrtf(1.0f - fSum) : 0.0f;
+   return create(c[0], c[1], c[2], c[3]);
+}
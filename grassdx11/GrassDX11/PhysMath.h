@@ -49,4 +49,22 @@ float3   oneOver   (const float3 &v);
 
 float3x3 MakeRotationMatrix (const float3 &axis);
 float3   MakeRotationVector (const float3x3 &m);
-float3x3 MakeIdentityMatrix (void);
\ No newline at end of file
+float3x3 MakeIdentityMatrix (void);
+
+/* Unit quaternions (x, y, z, w). Composed the same way as the matrices above:
+   qmul(a, b) <=> mul(A, B), QuaternionToMatrix(MakeRotationQuaternion(v)) == MakeRotationMatrix(v) */
+float4   qmul      (const float4 &a, const float4 &b);
+float4   qconj     (const float4 &q);
+float3   qrotate   (const float4 &q, const float3 &v);   /* == XMVector3TransformCoord(v, transpose(Q)) */
+float3   qunrotate (const float4 &q, const float3 &v);   /* == XMVector3TransformCoord(v, Q) */
+
+float4   MakeRotationQuaternion     (const float3 &axis);
+float3   QuaternionToRotationVector (const float4 &q);
+float4   MakeIdentityQuaternion     (void);
+float3x3 QuaternionToMatrix         (const float4 &q);
+float4   MatrixToQuaternion         (const float3x3 &m);
+
+/* Smallest three quaternion in R10G10B10A2 layout: the 3 smaller components in 10 bits each,
+   index of the largest one in the top 2 bits. Round trip error is below 0.005 rad (0.3 deg) */
+unsigned int PackQuaternion   (const float4 &q);
+float4       UnpackQuaternion (unsigned int a_uPacked);
\ No newline at end of file
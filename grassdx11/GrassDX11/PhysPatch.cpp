@@ -1,8 +1,40 @@
 #include "PhysPatch.h"
 #include "GrassManager.h"
+#include "TrampleField.h"
 
+/* 1 - integrate blades one by one with the scalar solver (Phisics), 0 - in lanes with HeunStepLanes */
+#define PHYS_SCALAR_REFERENCE 0
 
-PhysPatch::PhysPatch(GrassPatch* a_pGrassPatch)
+/* Blades per job of UpdatePhysics, a multiple of PHYS_LANES */
+#define PHYS_BLADE_CHUNK 256
+
+/* Blades the air is sampled for at once, small: a job waiting on its patches steals others, nesting these frames */
+#define PHYS_AIR_BATCH 32
+
+static UINT LaneGroupsCount(UINT a_uNumBlades)
+{
+   return (a_uNumBlades + PHYS_LANES - 1) / PHYS_LANES;
+}
+
+static bool BoundsOverlap(const XMFLOAT3& a_vMin, const XMFLOAT3& a_vMax, FXMVECTOR a_vOtherMin, FXMVECTOR a_vOtherMax)
+{
+   return XMVector3LessOrEqual(XMLoadFloat3(&a_vMin), a_vOtherMax) && XMVector3LessOrEqual(a_vOtherMin, XMLoadFloat3(&a_vMax));
+}
+
+static_assert(PHYS_MAX_PATCH_COLLIDERS <= 32, "lane groups keep a bit per collider");
+
+/* Broad phase of the collisions of one physics step */
+struct CollisionCull
+{
+   UINT            uNumColliders;
+   Mesh* const*    ppColliders;  /* colliders the patch reach overlaps */
+   const XMVECTOR* pMin;         /* their bounds */
+   const XMVECTOR* pMax;
+   UINT            uTested;      /* awake segments passed to the narrow phase, per collider */
+   UINT            uCulled;      /* awake segments rejected by the bounds, per collider */
+};
+
+PhysPatch::PhysPatch(GrassPatch* a_pGrassPatch, PhysSlab* a_pSlab)
 {
    m_pBasePatch = a_pGrassPatch;
    m_pD3DDevice = a_pGrassPatch->GetD3DDevicePtr();
@@ -10,15 +42,50 @@ PhysPatch::PhysPatch(GrassPatch* a_pGrassPatch)
    m_dwVertexStride[0] = sizeof(VertexPhysData);
    m_dwVertexStride[1] = sizeof(VertexAnimData);
    m_dwVertexOffset = 0;
+   m_dwNumAwake = m_dwNumSleeping = 0;
+   m_dwNumCollideTested = m_dwNumCollideCulled = 0;
+   m_fTime = 0.0f;
 
    this->numBlades = a_pGrassPatch->VerticesCount();
-   this->bladePhysData = new BladePhysData[numBlades];
+   m_uStaticVersion = 0;
+   m_bSlabMemory = (a_pSlab != NULL);
+   if (m_bSlabMemory)
+   {
+      /* streams first: they are what the solver sweeps */
+      m_Blades.Attach((float*)a_pSlab->Alloc(BladeStreams::Bytes(numBlades)), numBlades);
+      this->bladePhysData = (BladePhysData*)a_pSlab->Alloc(numBlades * sizeof(BladePhysData));
+      m_pStaticData = (BladeStaticData*)a_pSlab->Alloc(numBlades * sizeof(BladeStaticData));
+      m_pLaneBounds = (LaneBounds*)a_pSlab->Alloc(LaneGroupsCount(numBlades) * sizeof(LaneBounds));
+      ZeroMemory(bladePhysData, numBlades * sizeof(BladePhysData));
+      ZeroMemory(m_pStaticData, numBlades * sizeof(BladeStaticData));
+   }
+   else
+   {
+      this->bladePhysData = new BladePhysData[numBlades];
+      m_pStaticData = new BladeStaticData[numBlades];
+      m_pLaneBounds = new LaneBounds[LaneGroupsCount(numBlades)];
+      m_Blades.Allocate(numBlades);
+   }
    GenerateBuffer();
 }
 
 
+size_t PhysPatch::SlabBytes(GrassPatch* a_pGrassPatch)
+{
+   UINT uNumBlades = a_pGrassPatch->VerticesCount();
+   return PhysSlab::RoundUp(BladeStreams::Bytes(uNumBlades)) +
+      PhysSlab::RoundUp(uNumBlades * sizeof(BladePhysData)) +
+      PhysSlab::RoundUp(uNumBlades * sizeof(BladeStaticData)) +
+      PhysSlab::RoundUp(LaneGroupsCount(uNumBlades) * sizeof(LaneBounds));
+}
+
+
 void PhysPatch::GenerateBuffer(void)
 {
+   m_pPhysVertexBuffer = NULL;
+   m_pAnimVertexBuffer = NULL;
+   if (!m_pD3DDevice)
+      return;
    D3D11_BUFFER_DESC bufferDesc =
    {
       numBlades * sizeof(VertexPhysData),
@@ -57,9 +124,38 @@ DWORD PhysPatch::PhysVerticesCount(void)
 }
 
 
+DWORD PhysPatch::AwakeBladesCount(void)
+{
+   return m_dwNumAwake;
+}
+
+
+DWORD PhysPatch::SleepingBladesCount(void)
+{
+   return m_dwNumSleeping;
+}
+
+
+DWORD PhysPatch::CollideTestedCount(void)
+{
+   return m_dwNumCollideTested;
+}
+
+
+DWORD PhysPatch::CollideCulledCount(void)
+{
+   return m_dwNumCollideCulled;
+}
+
+
 PhysPatch::~PhysPatch(void)
 {
-   delete[] bladePhysData;
+   if (!m_bSlabMemory)
+   {
+      delete[] bladePhysData;
+      delete[] m_pStaticData;
+      delete[] m_pLaneBounds;
+   }
    SAFE_RELEASE(m_pAnimVertexBuffer);
    SAFE_RELEASE(m_pPhysVertexBuffer);
 }
@@ -76,26 +172,152 @@ void PhysPatch::Reinit(void)
       bp->startDirection = XMLoadFloat3(&m_pBasePatch->m_pVertices[i].vRotAxe) * 0.01745f;
       bp->startDirectionY = XMLoadFloat3(&m_pBasePatch->m_pVertices[i].vYRotAxe) * 0.01745f;
 
+      float4 T = qmul(MakeRotationQuaternion(bp->startDirectionY), MakeRotationQuaternion(bp->startDirection));
       for (UINT j = 0; j < NUM_SEGMENTS; j++)
       {
-         bp->w[j] = create(0, 0, 0);
-         bp->g[j] = create(0, 0, 0);
-         bp->R[j] = MakeIdentityMatrix();;
-         *(bp->T + j) = XMMatrixMultiply(MakeRotationMatrix(bp->startDirectionY), MakeRotationMatrix(bp->startDirection));
+         m_Blades.SetVec(BladeStreams::S_W + 3 * j, i, create(0, 0, 0));
+         m_Blades.SetQuat(BladeStreams::S_R + 4 * j, i, MakeIdentityQuaternion());
+         m_Blades.SetQuat(BladeStreams::S_T + 4 * j, i, T);
+         m_Blades.SetQuat(BladeStreams::S_PREV_T + 4 * j, i, T);
+      }
+
+      bp->NeedPhysics = 0;
+      bp->brokenFlag = 0;
+      bp->brokenTime = 0.0f;
+      m_Blades.SetVec(BladeStreams::S_POSITION, i, bp->startPosition);
+      bp->grabbedMeshIndex = -1;
+      bp->sleepCounter = 0;
+      bp->vLastTip = bp->startPosition;
+      bp->vSleepAir = create(0, 0, 0);
+   }
+
+   /* new roots: terrain data is cached again by the next UpdatePhysics */
+   m_uStaticVersion = 0;
+}
+
+
+/* dormant state byte: bits 0-1 NeedPhysics, bits 2-7 brokenFlag + 1 */
+#define DORMANT_PHYS_MASK   0x3
+#define DORMANT_BROKEN_SHIFT 2
+#define DORMANT_BROKEN_MAX  62
+
+bool PhysPatch::SaveDormant(std::vector<BYTE>& a_Data) const
+{
+   UINT i, j;
+   UINT uNumDisturbed = 0;
+   a_Data.clear();
+   for (i = 0; i < numBlades; i++)
+   {
+      if (bladePhysData[i].NeedPhysics != 0)
+         uNumDisturbed++;
+   }
+   if (uNumDisturbed == 0)
+      return false;
+
+   a_Data.resize(numBlades + uNumDisturbed * (NUM_SEGMENTS - 1) * sizeof(UINT));
+   BYTE* pState = &a_Data[0];
+   BYTE* pPose = pState + numBlades;
+   for (i = 0; i < numBlades; i++)
+   {
+      const BladePhysData* bp = &bladePhysData[i];
+      int iBroken = min(max(bp->brokenFlag + 1, 0), DORMANT_BROKEN_MAX);
+      pState[i] = (BYTE)((bp->NeedPhysics & DORMANT_PHYS_MASK) | (iBroken << DORMANT_BROKEN_SHIFT));
+      if (bp->NeedPhysics == 0)
+         continue;
+
+      for (j = 1; j < NUM_SEGMENTS; j++)
+      {
+         UINT uPacked = PackQuaternion(m_Blades.GetQuat(BladeStreams::S_T + 4 * j, i));
+         memcpy(pPose, &uPacked, sizeof(UINT));
+         pPose += sizeof(UINT);
+      }
+   }
+   return true;
+}
+
 
+void PhysPatch::LoadDormant(const std::vector<BYTE>& a_Data)
+{
+   if (a_Data.size() < numBlades)
+      return;
+
+   UINT i, j;
+   const BYTE* pState = &a_Data[0];
+   const BYTE* pPose = pState + numBlades;
+   const BYTE* pEnd = pState + a_Data.size();
+   for (i = 0; i < numBlades; i++)
+   {
+      BladePhysData* bp = &bladePhysData[i];
+      bp->NeedPhysics = pState[i] & DORMANT_PHYS_MASK;
+      bp->brokenFlag = (int)(pState[i] >> DORMANT_BROKEN_SHIFT) - 1;
+      if (bp->NeedPhysics == 0)
+         continue;
+      if (pPose + (NUM_SEGMENTS - 1) * sizeof(UINT) > pEnd)
+      {
          bp->NeedPhysics = 0;
          bp->brokenFlag = 0;
-         bp->brokenTime = 0.0f;
+         continue;
       }
 
-      bp->A[0] = bp->T[0];
-      bp->position[0] = bp->startPosition;
-      bp->grabbedMeshIndex = -1;
+      /* relative rotations follow from the accumulated ones, the root keeps the Reinit orientation */
+      float4 T_1 = m_Blades.GetQuat(BladeStreams::S_T, i);
+      for (j = 1; j < NUM_SEGMENTS; j++)
+      {
+         UINT uPacked;
+         memcpy(&uPacked, pPose, sizeof(UINT));
+         pPose += sizeof(UINT);
+
+         float4 T = UnpackQuaternion(uPacked);
+         m_Blades.SetQuat(BladeStreams::S_R + 4 * j, i, XMQuaternionNormalize(qmul(qconj(T_1), T)));
+         m_Blades.SetQuat(BladeStreams::S_T + 4 * j, i, T);
+         m_Blades.SetQuat(BladeStreams::S_PREV_T + 4 * j, i, T);
+         T_1 = T;
+      }
+   }
+}
+
+/* least field amount a blade is bent by, and the amount pressing it down for good */
+#define TRAMPLE_MIN_AMOUNT    0.05f
+#define TRAMPLE_BROKEN_AMOUNT 0.6f
+
+void PhysPatch::ApplyTrample(const TrampleField& a_Field)
+{
+   UINT i, j;
+   float3 vUp = create(0.0f, 1.0f, 0.0f);
+   for (i = 0; i < numBlades; i++)
+   {
+      BladePhysData* bp = &bladePhysData[i];
+      if (bp->NeedPhysics != 0)
+         continue;
+
+      float3 vBend = a_Field.Sample(getx(bp->startPosition), getz(bp->startPosition));
+      float fAmount = XMVectorGetX(XMVector3Length(vBend));
+      if (fAmount < TRAMPLE_MIN_AMOUNT)
+         continue;
+
+      /* the same world rotation per segment as CalcTrample in the shaders */
+      float4 QSeg = MakeRotationQuaternion(XMVector3Cross(vUp, vBend) * trampleAngle);
+      float4 Q = QSeg;
+      float4 T_1 = m_Blades.GetQuat(BladeStreams::S_T, i);
+      for (j = 1; j < NUM_SEGMENTS; j++)
+      {
+         float4 T = XMQuaternionNormalize(qmul(Q, m_Blades.GetQuat(BladeStreams::S_T + 4 * j, i)));
+         m_Blades.SetQuat(BladeStreams::S_R + 4 * j, i, XMQuaternionNormalize(qmul(qconj(T_1), T)));
+         m_Blades.SetQuat(BladeStreams::S_T + 4 * j, i, T);
+         m_Blades.SetQuat(BladeStreams::S_PREV_T + 4 * j, i, T);
+         Q = qmul(Q, QSeg);
+         T_1 = T;
+      }
+      bp->NeedPhysics = 2;
+      if (fAmount > TRAMPLE_BROKEN_AMOUNT)
+         bp->brokenFlag = 2;
    }
 }
 
 void PhysPatch::TransferFromOtherLod(const PhysPatch& a_PhysPatch, bool a_bLod0ToLod1)
 {
+   m_uStaticVersion = 0;
+
    /* just 2 cases: transfer data from lod0 to lod1 and from lod1 to lod0*/
    UINT i, j;
    DWORD dwBladeX;
@@ -120,7 +342,8 @@ void PhysPatch::TransferFromOtherLod(const PhysPatch& a_PhysPatch, bool a_bLod0T
                   dwBladeX = j;
                }
             }
-         bladePhysData[dwStartVertIndex++] = a_PhysPatch.bladePhysData[dwBaseVertIndex + dwBladeZ * 4 + dwBladeX];
+         bladePhysData[dwStartVertIndex] = a_PhysPatch.bladePhysData[dwBaseVertIndex + dwBladeZ * 4 + dwBladeX];
+         m_Blades.CopyBlade(dwStartVertIndex++, a_PhysPatch.m_Blades, dwBaseVertIndex + dwBladeZ * 4 + dwBladeX);
 
          dwBladeZ = 2;
          dwBladeX = 0;
@@ -134,7 +357,8 @@ void PhysPatch::TransferFromOtherLod(const PhysPatch& a_PhysPatch, bool a_bLod0T
                   dwBladeX = j;
                }
             }
-         bladePhysData[dwStartVertIndex++] = a_PhysPatch.bladePhysData[dwBaseVertIndex + dwBladeZ * 4 + dwBladeX];
+         bladePhysData[dwStartVertIndex] = a_PhysPatch.bladePhysData[dwBaseVertIndex + dwBladeZ * 4 + dwBladeX];
+         m_Blades.CopyBlade(dwStartVertIndex++, a_PhysPatch.m_Blades, dwBaseVertIndex + dwBladeZ * 4 + dwBladeX);
 
          dwBladeZ = 0;
          dwBladeX = 2;
@@ -148,7 +372,8 @@ void PhysPatch::TransferFromOtherLod(const PhysPatch& a_PhysPatch, bool a_bLod0T
                   dwBladeX = j;
                }
             }
-         bladePhysData[dwStartVertIndex++] = a_PhysPatch.bladePhysData[dwBaseVertIndex + dwBladeZ * 4 + dwBladeX];
+         bladePhysData[dwStartVertIndex] = a_PhysPatch.bladePhysData[dwBaseVertIndex + dwBladeZ * 4 + dwBladeX];
+         m_Blades.CopyBlade(dwStartVertIndex++, a_PhysPatch.m_Blades, dwBaseVertIndex + dwBladeZ * 4 + dwBladeX);
 
          dwBladeZ = 2;
          dwBladeX = 2;
@@ -162,7 +387,8 @@ void PhysPatch::TransferFromOtherLod(const PhysPatch& a_PhysPatch, bool a_bLod0T
                   dwBladeX = j;
                }
             }
-         bladePhysData[dwStartVertIndex++] = a_PhysPatch.bladePhysData[dwBaseVertIndex + dwBladeZ * 4 + dwBladeX];
+         bladePhysData[dwStartVertIndex] = a_PhysPatch.bladePhysData[dwBaseVertIndex + dwBladeZ * 4 + dwBladeX];
+         m_Blades.CopyBlade(dwStartVertIndex++, a_PhysPatch.m_Blades, dwBaseVertIndex + dwBladeZ * 4 + dwBladeX);
       }
    }
    else
@@ -173,9 +399,11 @@ void PhysPatch::TransferFromOtherLod(const PhysPatch& a_PhysPatch, bool a_bLod0T
          for (i = 0; i < 4; ++i)
          {
             memcpy(bladePhysData + dwStartVertIndex, a_PhysPatch.bladePhysData + dwBaseVertIndex, sizeof(BladePhysData));
+            m_Blades.CopyBlade(dwStartVertIndex, a_PhysPatch.m_Blades, dwBaseVertIndex);
             BladePhysData* bp = &bladePhysData[dwStartVertIndex];
 
-            bp->position[0] = bp->startPosition = PosToWorld(XMLoadFloat3(&m_pBasePatch->m_pVertices[dwBaseVertIndex * 4 + i].vPos));
+            bp->startPosition = PosToWorld(XMLoadFloat3(&m_pBasePatch->m_pVertices[dwBaseVertIndex * 4 + i].vPos));
+            m_Blades.SetVec(BladeStreams::S_POSITION, dwStartVertIndex, bp->startPosition);
             bp->startDirection = XMLoadFloat3(&m_pBasePatch->m_pVertices[dwBaseVertIndex * 4 + i].vRotAxe) * (float)PI / 180.0f;
             bp->startDirectionY = XMLoadFloat3(&m_pBasePatch->m_pVertices[dwBaseVertIndex * 4 + i].vYRotAxe) * (float)PI / 180.0f;
             bp->fTransparency = m_pBasePatch->m_pVertices[dwBaseVertIndex * 4 + i].fTransparency;
@@ -186,8 +414,14 @@ void PhysPatch::TransferFromOtherLod(const PhysPatch& a_PhysPatch, bool a_bLod0T
 }
 
 
+void PhysPatch::SavePrevOrientation(void)
+{
+   m_Blades.SavePrevOrientation();
+}
+
+
 static float maxvphi = 0.0;
-void PhysPatch::UpdateBuffer(void)
+void PhysPatch::UpdateBuffer(float a_fAlpha)
 {
    /* copy data */
    DWORD i, k;
@@ -198,12 +432,16 @@ void PhysPatch::UpdateBuffer(void)
    D3D11_MAPPED_SUBRESOURCE pPhysVertices;
    D3D11_MAPPED_SUBRESOURCE pAnimVertices;
    m_dwVerticesCount[0] = m_dwVerticesCount[1] = 0;
+   if (!m_pPhysVertexBuffer)
+      return;
 
    m_pD3DDeviceCtx->Map(m_pPhysVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &pPhysVertices);
    m_pD3DDeviceCtx->Map(m_pAnimVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &pAnimVertices);
 
    vpd = (VertexPhysData*)pPhysVertices.pData;
    vad = (VertexAnimData*)pAnimVertices.pData;
+   /* must match g_vPhysPatchOrigin set by GrassPool::Render */
+   float3 vOrigin = create(m_pTransform->_41, m_pTransform->_42, m_pTransform->_43);
    for (i = 0; i < numBlades; i++)
    {
       bp = bladePhysData + i;
@@ -212,12 +450,13 @@ void PhysPatch::UpdateBuffer(void)
       {
          for (k = 1; k < NUM_SEGMENTS; k++)
          {
-            XMStoreFloat4x4(&vpd->R[k - 1], bp->T[k]);
+            float4 T = XMQuaternionSlerp(m_Blades.GetQuat(BladeStreams::S_PREV_T + 4 * k, i), m_Blades.GetQuat(BladeStreams::S_T + 4 * k, i), a_fAlpha);
+            vpd->uR[k - 1] = PackQuaternion(T);
          }
 
-         XMStoreFloat3(&vpd->Position, bp->startPosition);
-         vpd->fTransparency = m_pBasePatch->m_pVertices[i].fTransparency;
-         vpd->vColor = m_pBasePatch->m_pVertices[i].vColor;
+         PackedVector::XMStoreHalf4(&vpd->vPosOffset, bp->startPosition - vOrigin);
+         XMFLOAT3& vColor = m_pBasePatch->m_pVertices[i].vColor;
+         PackedVector::XMStoreUByteN4(&vpd->vColor, create(vColor.x, vColor.y, vColor.z, m_pBasePatch->m_pVertices[i].fTransparency));
          m_dwVerticesCount[0]++;
          vpd++;
       }
@@ -267,53 +506,52 @@ float PhysPatch::gravity = 10.0f;
 float PhysPatch::dampfing = 0.98f;
 float PhysPatch::maxAngle = (float)PI / 2.0;
 float PhysPatch::maxBrokenTime = 10.0f;
+float PhysPatch::trampleAngle = 0.5f;
 bool  PhysPatch::transmitSpringMomentDownwards = false;
+float PhysPatch::sleepVelocity = 0.05f;
+float PhysPatch::sleepWakeAir = 0.5f;
+UINT  PhysPatch::uSleepFrames = 30;
+std::atomic<UINT> PhysPatch::uStaticVersion(1);
 float PhysPatch::eTime = 0.0f;
 
 
-void PhysPatch::RotateSegment(PhysPatch::BladePhysData* bp, int j, const float3& psi, const GrassPropsUnified& props) {};
-
-
-void RotateSegment(PhysPatch::BladePhysData* bp, int j, const float3& psi, const GrassPropsUnified& props)
+void RotateSegment(PhysPatch::BladePhysData* bp, BladeState& bs, int j, const float3& psi)
 {
-   bp->R[j] = XMMatrixMultiply(bp->R[j], MakeRotationMatrix(psi));
-   bp->T[j] = XMMatrixMultiply(bp->T[j - 1], bp->R[j]);
+   bs.R[j] = XMQuaternionNormalize(qmul(bs.R[j], MakeRotationQuaternion(psi)));
+   bs.T[j] = qmul(bs.T[j - 1], bs.R[j]);
 
-   float3x3 transposed_t;
-   float3 pos_delta, axis = create(0.0, bp->segmentHeight, 0.0);
-   transposed_t = XMMatrixTranspose(bp->T[j]);
-   pos_delta = XMVector3TransformCoord(axis, transposed_t);
-   bp->position[j] = bp->position[j - 1] + pos_delta;
+   float3 axis = create(0.0, bp->segmentHeight, 0.0);
+   bs.position[j] = bs.position[j - 1] + qrotate(bs.T[j], axis);
 }
 
 
-float3 GetDw(float3x3& T, float3x3& R, float3& fw, float3& sum, float3& w, float invJ, float segmentHeight, float Hardness, int j)
+float3 GetDw(float4& T, float4& R, float3& fw, float3& sum, float3& w, float invJ, float segmentHeight, float Hardness, int j)
 {
    float3 localSum, g, m_f;
    float3 halfAxis = create(0.0f, segmentHeight * 0.5f, 0.0f);
 
-   localSum = XMVector3TransformCoord(sum, T);
+   localSum = qunrotate(T, sum);
    m_f = XMVector3Cross(halfAxis, localSum);
 
-   g = Hardness * MakeRotationVector(R);
+   g = Hardness * QuaternionToRotationVector(R);
    return (m_f - g) * invJ;
 }
 
 
-void CalcTR(float3x3& Tres, float3x3& Rres, float3x3& T, float3x3& T_1, float3x3& R, float3& psi)
+void CalcTR(float4& Tres, float4& Rres, float4& T, float4& T_1, float4& R, float3& psi)
 {
-   Rres = XMMatrixMultiply(R, MakeRotationMatrix(psi));
-   Tres = XMMatrixMultiply(T_1, Rres);
+   Rres = XMQuaternionNormalize(qmul(R, MakeRotationQuaternion(psi)));
+   Tres = qmul(T_1, Rres);
 }
 
 
-void BrokenAnim(float gTime, PhysPatch::BladePhysData* bp, const GrassPropsUnified& props)
+void BrokenAnim(float gTime, PhysPatch::BladePhysData* bp, BladeState& bs, const GrassPropsUnified& props)
 {
    float3 proj, dir, axis;
    float3 vY = create(0.0f, 1.0f, 0.0f);
 
    // Rotate in plane between blade and its projection on the ground
-   dir = bp->position[1] - bp->position[0];
+   dir = bs.position[1] - bs.position[0];
 
    axis = XMVector3Cross(dir, vY);
    axis = XMVector3Normalize(axis);
@@ -322,12 +560,11 @@ void BrokenAnim(float gTime, PhysPatch::BladePhysData* bp, const GrassPropsUnifi
    float phase = gety(bp->startDirectionY);
 
    axis *= sin(20.f * phase + gTime * 0.1f) * 0.005f;
-   float3x3 mR = MakeRotationMatrix(axis);
-   bp->T[1] = XMMatrixMultiply(mR, bp->T[1]);
+   bs.T[1] = qmul(MakeRotationQuaternion(axis), bs.T[1]);
 }
 
 
-void PhysPatch::Broken(float3& vNormal, float3& dir, PhysPatch::BladePhysData* bp, float fDist, const GrassPropsUnified& props)
+void PhysPatch::Broken(float3& vNormal, float3& dir, PhysPatch::BladePhysData* bp, BladeState& bs, float fDist, const GrassPropsUnified& props, RandomStream& a_Random)
 {
    float3 vx, dir1;
    XMMATRIX mRot, mRotX, mRotY, mRotXY, mRotZ;
@@ -335,13 +572,11 @@ void PhysPatch::Broken(float3& vNormal, float3& dir, PhysPatch::BladePhysData* b
 
    float3 cur_pos = create(0.0f, 0.0f, 0.0f);
 
-   int uS = rand() % 2;
+   int uS = a_Random.NextUInt(2);
    if (uS == 0) uS = -1;
    if (bp->brokenFlag == 2) uS = 1;
    if (bp->brokenFlag == 3) uS = -1;
 
-   float3 pos_delta;
-   XMMATRIX transposed_t;
    float2 vTexCoord;
    float3 axis = create(0.0, bp->segmentHeight, 0.0);
 
@@ -350,38 +585,29 @@ void PhysPatch::Broken(float3& vNormal, float3& dir, PhysPatch::BladePhysData* b
       float YRot = 640.f;
       int uR = 320;//uR = 150;
 
-      bp->R[1] = XMMatrixIdentity();
-      bp->T[1] = XMMatrixIdentity();
-
       dir1 = XMVector3Cross(vNormal, dir);
       dir = XMVector3Cross(vNormal, dir1);
       dir = XMVector3Normalize(dir);
 
       float XRot = fDist * 1.2f;
-      bp->T[1] = MakeRotationMatrix(dir * XRot * uS);
-      transposed_t = XMMatrixTranspose(bp->T[0]);
-      bp->R[1] = XMMatrixMultiply(transposed_t, bp->T[1]);
+      bs.T[1] = MakeRotationQuaternion(dir * XRot * uS);
+      bs.R[1] = qmul(qconj(bs.T[0]), bs.T[1]);
 
-      transposed_t = XMMatrixTranspose(bp->T[1]);
-      pos_delta = XMVector3TransformCoord(axis, transposed_t);
-      bp->position[1] = bp->position[0] + pos_delta;
-      bp->w[1] = create(0, 0, 0);
+      bs.position[1] = bs.position[0] + qrotate(bs.T[1], axis);
+      bs.w[1] = create(0, 0, 0);
 
       // Update positions
       for (int j = 2; j < NUM_SEGMENTS; j++)
       {
-         bp->T[j] = XMMatrixMultiply(bp->T[j - 1], bp->R[j]);
-
-         transposed_t = XMMatrixTranspose(bp->T[j]);
-         pos_delta = XMVector3TransformCoord(axis, transposed_t);
-         bp->position[j] = bp->position[j - 1] + pos_delta;
+         bs.T[j] = qmul(bs.T[j - 1], bs.R[j]);
+         bs.position[j] = bs.position[j - 1] + qrotate(bs.T[j], axis);
       }
       return;
    }
 
    for (int j = 1; j < NUM_SEGMENTS; j++)
    {
-      int uR = rand() % 128;//64;
+      int uR = a_Random.NextUInt(128);//64;
       float YRot = 640.f;
       if (bp->brokenFlag > 1) uR = 320;//uR = 150;
       mRotY = XMMatrixRotationY((float)(uS * uR) * (float)M_PI / YRot);
@@ -395,36 +621,31 @@ void PhysPatch::Broken(float3& vNormal, float3& dir, PhysPatch::BladePhysData* b
       if (j > 1)XRot = 0.99f;
       if (bp->brokenFlag > 1) XRot = fDist * a[j - 1];
       mRotX = XMMatrixRotationX(-(float)M_PI * 0.5f * XRot);
-      bp->T[j] = XMMatrixMultiply(mRot, mRotX);
+      bs.T[j] = MatrixToQuaternion(XMMatrixMultiply(mRot, mRotX));
+      bs.position[j] = bs.position[j - 1] + qrotate(bs.T[j], axis);
 
-      transposed_t = XMMatrixTranspose(bp->T[j]);
-      pos_delta = XMVector3TransformCoord(axis, transposed_t);
-      bp->position[j] = bp->position[j - 1] + pos_delta;
-
-      vTexCoord = create(getx(bp->position[j]) / fTerrRadius * 0.5f + 0.5f, getz(bp->position[j]) / fTerrRadius * 0.5f + 0.5f);
+      vTexCoord = create(getx(bs.position[j]) / fTerrRadius * 0.5f + 0.5f, getz(bs.position[j]) / fTerrRadius * 0.5f + 0.5f);
       float height = pHeightData->GetHeight(getx(vTexCoord), gety(vTexCoord)) * fHeightScale;
 
       float angle = 0.0f;
-      if (gety(bp->position[j]) > height + 0.2f)
-         angle = -asinf(clamp((gety(bp->position[j]) - height - 0.2f) / bp->segmentHeight, 0, 1));
-      else if (gety(bp->position[j]) < height)
-         angle = asinf(clamp((height + 0.5f - gety(bp->position[j])) / bp->segmentHeight, 0, 1));
+      if (gety(bs.position[j]) > height + 0.2f)
+         angle = -asinf(clamp((gety(bs.position[j]) - height - 0.2f) / bp->segmentHeight, 0, 1));
+      else if (gety(bs.position[j]) < height)
+         angle = asinf(clamp((height + 0.5f - gety(bs.position[j])) / bp->segmentHeight, 0, 1));
 
       if (angle != 0.0f)
       {
          mRotX = XMMatrixRotationX(angle);
-         bp->T[j] = XMMatrixMultiply(bp->T[j], mRotX);
+         bs.T[j] = qmul(bs.T[j], MatrixToQuaternion(mRotX));
 
          // Update position
-         transposed_t = XMMatrixTranspose(bp->T[j]);
-         pos_delta = XMVector3TransformCoord(axis, transposed_t);
-         bp->position[j] = bp->position[j - 1] + pos_delta;
+         bs.position[j] = bs.position[j - 1] + qrotate(bs.T[j], axis);
       }
    }
 }
 
 
-void PhysPatch::Animatin(PhysPatch::BladePhysData* bp, float2& vTexCoord, Mesh* a_pMeshes[], const GrassPropsUnified& props)
+void PhysPatch::Animatin(PhysPatch::BladePhysData* bp, BladeState& bs, float2& vTexCoord, Mesh* a_pMeshes[], UINT a_uNumMeshes, const GrassPropsUnified& props)
 {
    float3 g = create(0.0f, -9.8f, 0.0f);
    float3 halfAxis = create(0.0f, bp->segmentHeight * 0.5f, 0.0f);
@@ -434,46 +655,43 @@ void PhysPatch::Animatin(PhysPatch::BladePhysData* bp, float2& vTexCoord, Mesh*
    float3 w, w_;
    for (int j = 1; j < NUM_SEGMENTS; j++)
    {
-      bp->w[j] = create(0, 0, 0);
-      bp->T[j] = bp->T[j - 1];
+      bs.w[j] = create(0, 0, 0);
+      bs.T[j] = bs.T[j - 1];
       for (int k = 0; k < 4; k++)
       {
          sum = g * getcoord(props.vMassSegment, j - 1);
-         localSum = XMVector3TransformCoord(sum, bp->T[j]);
+         localSum = qunrotate(bs.T[j], sum);
          float3 G;
          G = XMVector3Cross(halfAxis, localSum);
-         bp->R[j] = MakeRotationMatrix(G / getcoord(props.vHardnessSegment, j - 1));
-         bp->T[j] = XMMatrixMultiply(bp->T[j - 1], bp->R[j]);
+         bs.R[j] = MakeRotationQuaternion(G / getcoord(props.vHardnessSegment, j - 1));
+         bs.T[j] = qmul(bs.T[j - 1], bs.R[j]);
       }
 
       w_ = pWindData->GetWindValueA(vTexCoord, fWindTexTile, 40, j - 1);
          //pAirData->GetAirValue(vTexCoord);//create(0, 0, 0, 0);// pWindData->GetWindValueA(vTexCoord, fWindTexTile, windStrength, j - 1);
       sum = g * getcoord(props.vMassSegment, j - 1);
-      localSum = XMVector3TransformCoord(sum, bp->T[j]);
+      localSum = qunrotate(bs.T[j], sum);
       float3 G;
       G = XMVector3Cross(halfAxis, localSum);
-      w = XMVector3TransformCoord(w_, bp->T[j]);
+      w = qunrotate(bs.T[j], w_);
       G += w;
-      bp->R[j] = MakeRotationMatrix(G / getcoord(props.vHardnessSegment, j - 1));
-      bp->T[j] = XMMatrixMultiply(bp->T[j - 1], bp->R[j]);
+      bs.R[j] = MakeRotationQuaternion(G / getcoord(props.vHardnessSegment, j - 1));
+      bs.T[j] = qmul(bs.T[j - 1], bs.R[j]);
 
-      float3x3 transposed_t;
-      transposed_t = XMMatrixTranspose(bp->T[j]);
-      float3 pos_delta;
-      pos_delta = XMVector3TransformCoord(axis, transposed_t);
-      bp->position[j] = bp->position[j - 1] + pos_delta;
+      bs.position[j] = bs.position[j - 1] + qrotate(bs.T[j], axis);
 
-      if (a_pMeshes[0]->CheckCollision(bp->position[j - 1], bp->position[j], NULL))
+      for (UINT m = 0; m < a_uNumMeshes; m++)
       {
+         if (!a_pMeshes[m]->CheckCollision(bs.position[j - 1], bs.position[j], NULL))
+            continue;
+
          float3 psi;
-         if (a_pMeshes[0]->Collide(&psi, bp->position[j - 1], bp->position[j], bp, j))
+         if (a_pMeshes[m]->Collide(&psi, bs.position[j - 1], bs.position[j], bp, j))
          {
-            psi = XMVector3TransformCoord(psi, bp->T[j]);
-            RotateSegment(bp, j, psi, props);
+            psi = qunrotate(bs.T[j], psi);
+            RotateSegment(bp, bs, j, psi);
             for (int i = j + 1; i < NUM_SEGMENTS; i++)
-               bp->T[i] = XMMatrixMultiply(bp->T[i - 1], bp->R[i]);
-
-            bp->A[j] = bp->T[j];
+               bs.T[i] = qmul(bs.T[i - 1], bs.R[i]);
          }
          bp->NeedPhysics = 2;
          bp->physicTime = 0;
@@ -481,17 +699,15 @@ void PhysPatch::Animatin(PhysPatch::BladePhysData* bp, float2& vTexCoord, Mesh*
    }
 }
 
-static float3 GetVel(float3x3& T, float3& w, float segmentHeight)
+static float3 GetVel(float4& T, float3& w, float segmentHeight)
 {
    float3 halfAxis = create(0.0f, segmentHeight * 0.5f, 0.0f), r;
-   float3x3 transposed_t;
-   transposed_t = XMMatrixTranspose(T);
    r = XMVector3Cross(w, halfAxis);
-   r = XMVector3TransformCoord(r, transposed_t);
+   r = qrotate(T, r);
    return r;
 }
 
-void Phisics(PhysPatch::BladePhysData* bp, float3& w, float dTime, Mesh* a_pMeshes[], const GrassPropsUnified& props)
+void Phisics(PhysPatch::BladePhysData* bp, BladeState& bs, float3& w, float dTime, Mesh* a_pMeshes[], UINT a_uNumMeshes, const GrassPropsUnified& props)
 {
    float3 g = create(0.0f, -9.8f, 0.0f);
    float3 halfAxis = create(0.0f, bp->segmentHeight * 0.5f, 0.0f);
@@ -510,47 +726,66 @@ void Phisics(PhysPatch::BladePhysData* bp, float3& w, float dTime, Mesh* a_pMesh
    {
       float oneThirdMMulLSqr = 0.33f * getcoord(props.vMassSegment, j - 1) * bp->segmentHeight * bp->segmentHeight;
       float invJ = 0.75f * 1.0f / oneThirdMMulLSqr;
-      r = GetVel(bp->T[j], bp->w[j], bp->segmentHeight);
+      r = GetVel(bs.T[j], bs.w[j], bp->segmentHeight);
       v = vZ + r;
       wind = 0.02f * (w - v);
 
       float h = getcoord(props.vHardnessSegment, j - 1);
-      // sum = g * props.vMassSegment[j-1] * bp->T[j][5] + w;
+      // sum = g * props.vMassSegment[j-1] * bs.T[j][5] + w;
       sum = g * getcoord(props.vMassSegment, j - 1) + wind;
 
-      float3 Dw = GetDw(bp->T[j], bp->R[j], bp->w[j], sum, wind, invJ, bp->segmentHeight, h, j);
-      float3 w_ = bp->w[j] + dTime * Dw;
-      psi = dTime * w_;
-
-      float3x3 Tres, Rres;
-      CalcTR(Tres, Rres, bp->T[j], bp->T[j - 1], bp->R[j], psi);
-
-      r = GetVel(Tres, w_, bp->segmentHeight);
-      v = vZ + r;
-      wind = 0.02f * (w - v);
-      //      sum = g * props.vMassSegment[j-1] * Tres[5] + w;
-      sum = g * getcoord(props.vMassSegment, j - 1) + wind;
-      float3 Dw_ = GetDw(Tres, Rres, w_, sum, wind, invJ, bp->segmentHeight, h, j);
-      bp->w[j] += 0.5f * dTime * (Dw + Dw_);
-      bp->w[j] *= d;
-      psi = dTime * bp->w[j];
-      RotateSegment(bp, j, psi, props);
+      float3 Dw = GetDw(bs.T[j], bs.R[j], bs.w[j], sum, wind, invJ, bp->segmentHeight, h, j);
+      if (props.uIntegrator == BLADE_INTEGRATOR_SEMI_IMPLICIT)
+      {
+         /* spring torque at the end of the step, see SemiImplicitStepLanes */
+         bs.w[j] = (bs.w[j] + dTime * Dw) * (d / (1.0f + dTime * dTime * h * invJ));
+      }
+      else
+      {
+         float3 w_ = bs.w[j] + dTime * Dw;
+         psi = dTime * w_;
+
+         float4 Tres, Rres;
+         CalcTR(Tres, Rres, bs.T[j], bs.T[j - 1], bs.R[j], psi);
+
+         r = GetVel(Tres, w_, bp->segmentHeight);
+         v = vZ + r;
+         wind = 0.02f * (w - v);
+         //      sum = g * props.vMassSegment[j-1] * Tres[5] + w;
+         sum = g * getcoord(props.vMassSegment, j - 1) + wind;
+         float3 Dw_ = GetDw(Tres, Rres, w_, sum, wind, invJ, bp->segmentHeight, h, j);
+         bs.w[j] += 0.5f * dTime * (Dw + Dw_);
+         bs.w[j] *= d;
+      }
+      psi = dTime * bs.w[j];
+      RotateSegment(bp, bs, j, psi);
 
-      r = GetVel(bp->T[j], bp->w[j], bp->segmentHeight);
+      r = GetVel(bs.T[j], bs.w[j], bp->segmentHeight);
       vZ = vZ + 2.f * r;
 
-      if (a_pMeshes[0]->Collide(&psi, bp->position[j - 1], bp->position[j], bp, j))
+      /* responses of all the colliders are summed, as Car sums its planes */
+      float3 psiSum = create(0, 0, 0);
+      bool bHit = false;
+      for (UINT m = 0; m < a_uNumMeshes; m++)
       {
-         psi = XMVector3TransformCoord(psi, bp->T[j]);
-         RotateSegment(bp, j, psi, props);
-         bp->w[j] = create(0, 0, 0);
+         if (a_pMeshes[m]->Collide(&psi, bs.position[j - 1], bs.position[j], bp, j))
+         {
+            psiSum += psi;
+            bHit = true;
+         }
+      }
+      if (bHit)
+      {
+         psi = qunrotate(bs.T[j], psiSum);
+         RotateSegment(bp, bs, j, psi);
+         bs.w[j] = create(0, 0, 0);
 
          for (int i = j + 1; i < NUM_SEGMENTS; i++)
          {
-            bp->T[i] = XMMatrixMultiply(bp->T[i - 1], bp->R[i]);
+            bs.T[i] = qmul(bs.T[i - 1], bs.R[i]);
          }
          for (int i = 1; i < NUM_SEGMENTS; i++)
-            bp->w[i] = create(0, 0, 0);
+            bs.w[i] = create(0, 0, 0);
 
       }
    }
@@ -558,121 +793,504 @@ void Phisics(PhysPatch::BladePhysData* bp, float3& w, float dTime, Mesh* a_pMesh
 
 
 
-static float gTime = 0.f;
-void PhysPatch::UpdatePhysics(const float3& viewPos, float physLodDst, bool collision, float3 spherePosition, float sphereRadius, float dTime, const std::vector<GrassPropsUnified>& grassProps, const IndexMapData& indexMapData, Mesh* a_pMeshes[], UINT a_uNumMeshes)
+/* Collision response of segment j to the rotation a_vPsi (world space), same as in Phisics */
+static void CollideSegment(BladeStreams& a_Blades, PhysPatch::BladePhysData* bp, UINT i, int j, const float3& a_vPsi)
 {
-   float3 w = create(0.0f, 0.0f, 0.0f);
-   float a[3] = { (float)M_PI / 2.5f, (float)M_PI / 10.0f, (float)M_PI / 10.0f };
-   float3 g = create(0.0f, -9.8f, 0.0f);
-   float AnimOrPhys = physLodDst;
-   //      TerrainHeightData *pHD = m_pTerrain->HeightDataPtr();
+   BladeState bs;
+   a_Blades.Load(i, bs);
+   float3 psi = qunrotate(bs.T[j], a_vPsi);
+   RotateSegment(bp, bs, j, psi);
+
+   for (int k = j + 1; k < NUM_SEGMENTS; k++)
+   {
+      bs.T[k] = qmul(bs.T[k - 1], bs.R[k]);
+   }
+   for (int k = 1; k < NUM_SEGMENTS; k++)
+      bs.w[k] = create(0, 0, 0);
+   a_Blades.Store(i, bs);
+}
 
-   gTime += dTime;
-   if (dTime >= 0.1f)
-      dTime = 0.1f;
 
-   if (dTime <= 0.001f)
-      dTime = 0.001f;
+/* Phisics for blades [a_uBase, a_uBase + PHYS_LANES): segments go up in lanes, each collider gets the moved segments as one batch.
+   a_uNearMask - bit m is set if the lane group can reach collider m at all, if not its segments are counted as culled */
+static void PhisicsLanes(BladeStreams& a_Blades, PhysPatch::BladePhysData* a_pBlades, UINT a_uBase, float dTime, float d, CollisionCull& a_Cull, UINT a_uNearMask)
+{
+   LaneVec3 vZ;
+   vZ.x = vZ.y = vZ.z = XMVectorZero();
 
-   float3 sum, localSum;
-   float3 psi;
-   float3 vDir = spherePosition - viewPos;
-   vDir = vDir * create(1.0f, 0.0f, 1.0f, 1.0f);
-   AnimOrPhys = XMVectorGetX(XMVector3Length(vDir));
-   vDir = XMVector3Normalize(vDir);
+   for (int j = 1; j < NUM_SEGMENTS; j++)
+   {
+      XMVECTOR mask = StepSegmentLanes(a_Blades, a_uBase, j, dTime, d, vZ);
+      if (a_Cull.uNumColliders == 0 || XMVector4EqualInt(mask, XMVectorZero()))
+         continue;
+
+      XMVECTOR vSegMin[3], vSegMax[3];
+      for (UINT c = 0; c < 3; c++)
+      {
+         XMVECTOR vBeg = XMLoadFloat4A((const XMFLOAT4A*)(a_Blades.Stream(BladeStreams::S_POSITION + 3 * (j - 1) + c) + a_uBase));
+         XMVECTOR vEnd = XMLoadFloat4A((const XMFLOAT4A*)(a_Blades.Stream(BladeStreams::S_POSITION + 3 * j + c) + a_uBase));
+         vSegMin[c] = XMVectorMin(vBeg, vEnd);
+         vSegMax[c] = XMVectorMax(vBeg, vEnd);
+      }
+
+      /* responses of all the colliders are summed, as Car sums its planes, and applied once */
+      XMVECTOR vPsiSum[PHYS_LANES];
+      bool bAnyHit[PHYS_LANES];
+      for (UINT k = 0; k < PHYS_LANES; k++)
+      {
+         vPsiSum[k] = XMVectorZero();
+         bAnyHit[k] = false;
+      }
+
+      for (UINT m = 0; m < a_Cull.uNumColliders; m++)
+      {
+         /* segment bounds of the lanes against the collider bounds */
+         bool bNear = (a_uNearMask & (1u << m)) != 0;
+         XMVECTOR vNear = mask;
+         if (bNear)
+         {
+            for (UINT c = 0; c < 3; c++)
+            {
+               XMVECTOR vColliderMin = XMVectorSplatX(XMVectorRotateLeft(a_Cull.pMin[m], c));
+               XMVECTOR vColliderMax = XMVectorSplatX(XMVectorRotateLeft(a_Cull.pMax[m], c));
+               vNear = XMVectorAndInt(vNear, XMVectorLessOrEqual(vSegMin[c], vColliderMax));
+               vNear = XMVectorAndInt(vNear, XMVectorGreaterOrEqual(vSegMax[c], vColliderMin));
+            }
+         }
+
+         XMVECTOR vBeg[PHYS_LANES], vEnd[PHYS_LANES], vPsi[PHYS_LANES];
+         PhysPatch::BladePhysData* pBlades[PHYS_LANES];
+         UINT uLanes[PHYS_LANES];
+         bool bHit[PHYS_LANES];
+         UINT uCount = 0;
+         for (UINT k = 0; k < PHYS_LANES; k++)
+         {
+            if (!XMVectorGetIntByIndex(mask, k))
+               continue;
+            if (!bNear || !XMVectorGetIntByIndex(vNear, k))
+            {
+               a_Cull.uCulled++;
+               continue;
+            }
+            UINT i = a_uBase + k;
+            vBeg[uCount] = a_Blades.GetVec(BladeStreams::S_POSITION + 3 * (j - 1), i);
+            vEnd[uCount] = a_Blades.GetVec(BladeStreams::S_POSITION + 3 * j, i);
+            pBlades[uCount] = a_pBlades + i;
+            uLanes[uCount] = k;
+            uCount++;
+         }
+         a_Cull.uTested += uCount;
+         if (uCount == 0 || a_Cull.ppColliders[m]->CollideSegments(vPsi, bHit, vBeg, vEnd, uCount, pBlades, j) == 0)
+            continue;
+
+         for (UINT k = 0; k < uCount; k++)
+         {
+            if (!bHit[k])
+               continue;
+            vPsiSum[uLanes[k]] += vPsi[k];
+            bAnyHit[uLanes[k]] = true;
+         }
+      }
+
+      for (UINT k = 0; k < PHYS_LANES; k++)
+      {
+         if (bAnyHit[k])
+            CollideSegment(a_Blades, a_pBlades + a_uBase + k, a_uBase + k, j, vPsiSum[k]);
+      }
+   }
+}
+
+
+BladeSolverDiff PhysPatch::CompareSolvers(const GrassPropsUnified& a_Props, UINT a_uNumBlades, UINT a_uNumSteps, float a_fTime)
+{
+   BladeSolverDiff diff;
+   ZeroMemory(&diff, sizeof(diff));
+   diff.bFinite = true;
+
+   /* same damping as UpdatePhysics */
+   float d = powf(0.98f, a_fTime * 0.01f);
+   if (d > 0.9998f) d = 0.9998f;
+
+   /* blades bent at random in every segment, in random wind, both solvers start from the same streams */
+   BladeStreams scalar, lanes;
+   scalar.Allocate(a_uNumBlades);
+   lanes.Allocate(a_uNumBlades);
+   std::vector<BladePhysData> blades(a_uNumBlades);
+   float fHeight = gety(a_Props.vSizes);
+   for (UINT i = 0; i < a_uNumBlades; i++)
+   {
+      RandomStream random(i);
+      ZeroMemory(&blades[i], sizeof(BladePhysData));
+      blades[i].segmentHeight = fHeight;
+
+      scalar.Stream(BladeStreams::S_HEIGHT)[i] = fHeight;
+      scalar.Stream(BladeStreams::S_FIRST)[i] = 1.0f;
+      scalar.Stream(BladeStreams::S_SOLVER)[i] = (float)a_Props.uIntegrator;
+      scalar.SetVec(BladeStreams::S_WIND, i, create(random.NextFloat(-8.0f, 8.0f), 0.0f, random.NextFloat(-8.0f, 8.0f)));
+
+      float3 axis = create(0.0f, fHeight, 0.0f);
+      float4 T = create(0.0f, 0.0f, 0.0f, 1.0f);
+      scalar.SetQuat(BladeStreams::S_R, i, T);
+      scalar.SetQuat(BladeStreams::S_T, i, T);
+      for (int j = 1; j < NUM_SEGMENTS; j++)
+      {
+         scalar.Stream(BladeStreams::S_MASS + j - 1)[i] = getcoord(a_Props.vMassSegment, j - 1);
+         scalar.Stream(BladeStreams::S_HARDNESS + j - 1)[i] = getcoord(a_Props.vHardnessSegment, j - 1);
+
+         float4 R = MakeRotationQuaternion(create(random.NextFloat(-0.5f, 0.5f), random.NextFloat(-0.5f, 0.5f), random.NextFloat(-0.5f, 0.5f)));
+         T = qmul(T, R);
+         scalar.SetQuat(BladeStreams::S_R + 4 * j, i, R);
+         scalar.SetQuat(BladeStreams::S_T + 4 * j, i, T);
+         scalar.SetVec(BladeStreams::S_W + 3 * j, i, create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f)));
+         scalar.SetVec(BladeStreams::S_POSITION + 3 * j, i, scalar.GetVec(BladeStreams::S_POSITION + 3 * (j - 1), i) + qrotate(T, axis));
+      }
+      lanes.CopyBlade(i, scalar, i);
+   }
 
-   for (DWORD i = 0; i < numBlades; i++)
+   for (UINT uStep = 0; uStep < a_uNumSteps && diff.bFinite; uStep++)
+   {
+      for (UINT i = 0; i < a_uNumBlades; i++)
+      {
+         BladeState bs;
+         scalar.Load(i, bs);
+         float3 w = scalar.GetVec(BladeStreams::S_WIND, i);
+         Phisics(&blades[i], bs, w, a_fTime, NULL, 0, a_Props);
+         scalar.Store(i, bs);
+      }
+      for (UINT i = 0; i < a_uNumBlades; i += PHYS_LANES)
+      {
+         LaneVec3 vZ;
+         vZ.x = vZ.y = vZ.z = XMVectorZero();
+         for (int j = 1; j < NUM_SEGMENTS; j++)
+            StepSegmentLanes(lanes, i, j, a_fTime, d, vZ);
+      }
+
+      for (UINT i = 0; i < a_uNumBlades; i++)
+      {
+         for (int j = 1; j < NUM_SEGMENTS; j++)
+         {
+            float fDot = fabsf(XMVectorGetX(XMVector4Dot(scalar.GetQuat(BladeStreams::S_T + 4 * j, i), lanes.GetQuat(BladeStreams::S_T + 4 * j, i))));
+            float fVel = XMVectorGetX(XMVector3Length(scalar.GetVec(BladeStreams::S_W + 3 * j, i) - lanes.GetVec(BladeStreams::S_W + 3 * j, i)));
+            if (!_finite(fDot) || !_finite(fVel))
+               diff.bFinite = false;
+            diff.fMaxOrientation = max(diff.fMaxOrientation, 2.0f * acosf(min(fDot, 1.0f)));
+            diff.fMaxVelocity = max(diff.fMaxVelocity, fVel);
+         }
+      }
+   }
+   return diff;
+}
+
+
+void PhysPatch::InvalidateStaticData(void)
+{
+   uStaticVersion.fetch_add(1);
+}
+
+
+void PhysPatch::CacheStaticData(UINT a_uBegin, UINT a_uEnd, const std::vector<GrassPropsUnified>& grassProps, const IndexMapData& indexMapData)
+{
+   for (UINT i = a_uBegin; i < a_uEnd; i++)
    {
       BladePhysData* bp = &bladePhysData[i];
-      float3 vDirP = bp->startPosition - viewPos;
+      BladeStaticData& sd = m_pStaticData[i];
 
       //texcoord
       float2 vTexCoord = create(getx(bp->startPosition) / fTerrRadius * 0.5f + 0.5f, getz(bp->startPosition) / fTerrRadius * 0.5f + 0.5f);
+      XMStoreFloat2(&sd.vTexCoord, vTexCoord);
 
       //index map
       UINT uX = UINT(getx(vTexCoord) * (indexMapData.uWidth - 1));
       UINT uY = UINT(gety(vTexCoord) * (indexMapData.uHeight - 1));
-      UCHAR subTypeIndex = 0;
+      sd.uSubType = 0;
       if (indexMapData.pData)
-         subTypeIndex = indexMapData.pData[uX + uY * indexMapData.uWidth];
-      const GrassPropsUnified& props = grassProps[subTypeIndex];
+         sd.uSubType = indexMapData.pData[uX + uY * indexMapData.uWidth];
+      const GrassPropsUnified& props = grassProps[sd.uSubType];
 
       // height map
-      float height = pHeightData->GetHeight(getx(vTexCoord), gety(vTexCoord)) * fHeightScale;
-      sety(bp->startPosition, height);
-      bp->position[0] = bp->startPosition;
+      sd.fHeight = pHeightData->GetHeight(getx(vTexCoord), gety(vTexCoord)) * fHeightScale;
+      sety(bp->startPosition, sd.fHeight);
+      m_Blades.SetVec(BladeStreams::S_POSITION, i, bp->startPosition);
 
-      /*********************
-      Calculations
-      *********************/
-
-      bool near_car = false;
       bp->segmentHeight = gety(props.vSizes);
       bp->segmentWidth = getx(props.vSizes);
+   }
 
-      float r = sphereRadius + 0.12f;
-      float br = sphereRadius + NUM_SEGMENTS * bp->segmentHeight;
+   /* a blade never gets farther from its root than its length, however it is bent */
+   for (UINT i = a_uBegin; i < a_uEnd; i += PHYS_LANES)
+   {
+      XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+      XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+      for (UINT k = i; k < min(i + PHYS_LANES, a_uEnd); k++)
+      {
+         const BladePhysData* bp = &bladePhysData[k];
+         XMVECTOR vReach = XMVectorReplicate(NUM_SEGMENTS * bp->segmentHeight);
+         vMin = XMVectorMin(vMin, bp->startPosition - vReach);
+         vMax = XMVectorMax(vMax, bp->startPosition + vReach);
+      }
+      XMStoreFloat3(&m_pLaneBounds[i / PHYS_LANES].vMin, vMin);
+      XMStoreFloat3(&m_pLaneBounds[i / PHYS_LANES].vMax, vMax);
+   }
+}
 
 
-      if (XMVectorGetX(XMVector3Length(bp->position[0] - spherePosition)) < 0.7f * br)
-         near_car = true;
+void PhysPatch::UpdatePhysics(const float3& viewPos, float physLodDst, float dTime, const std::vector<GrassPropsUnified>& grassProps, const IndexMapData& indexMapData, Mesh* a_pMeshes[], UINT a_uNumMeshes, JobScheduler* a_pScheduler)
+{
+   //      TerrainHeightData *pHD = m_pTerrain->HeightDataPtr();
 
-      if (bp->brokenFlag == -1)
-      {
-         BrokenAnim(gTime, bp, props);
-         bp->NeedPhysics = 1;
+   m_fTime += dTime;
+
+   /* one load per step: a bump during the step refreshes the patch at its next step */
+   UINT uVersion = uStaticVersion.load();
+   bool bRefreshStatic = (m_uStaticVersion != uVersion);
+   m_uStaticVersion = uVersion;
+
+   float* pFirstSegment = m_Blades.Stream(BladeStreams::S_FIRST);
+   std::atomic<UINT> uNumSimulatedTotal(0);
+   std::atomic<UINT> uNumSleepingTotal(0);
+   std::atomic<UINT> uNumTestedTotal(0);
+   std::atomic<UINT> uNumCulledTotal(0);
+
+   /* broad phase: the collider bounds against the reach of the patch, of the lane groups, then of the segments */
+   Mesh*    pColliders[PHYS_MAX_PATCH_COLLIDERS];
+   XMVECTOR vColliderMin[PHYS_MAX_PATCH_COLLIDERS];
+   XMVECTOR vColliderMax[PHYS_MAX_PATCH_COLLIDERS];
+   CollisionCull cull;
+   cull.uNumColliders = 0;
+   cull.ppColliders = pColliders;
+   cull.pMin = vColliderMin;
+   cull.pMax = vColliderMax;
+   cull.uTested = cull.uCulled = 0;
+   for (UINT m = 0; m < a_uNumMeshes && cull.uNumColliders < PHYS_MAX_PATCH_COLLIDERS; m++)
+   {
+      XMVECTOR vMin, vMax;
+      a_pMeshes[m]->GetBounds(vMin, vMax);
+      /* the patch reach is rebuilt below when the static data is */
+      if (!bRefreshStatic && !BoundsOverlap(m_Bounds.vMin, m_Bounds.vMax, vMin, vMax))
          continue;
-      }
-      if (false) /*if (near_car)*/ //crash bellow if true, no time to realize why
+      pColliders[cull.uNumColliders] = a_pMeshes[m];
+      vColliderMin[cull.uNumColliders] = vMin;
+      vColliderMax[cull.uNumColliders] = vMax;
+      cull.uNumColliders++;
+   }
+
+   /* blades [a_uBegin, a_uEnd) are independent of the rest, a_uBegin is a multiple of PHYS_LANES */
+   auto UpdateBlades = [&](UINT a_uBegin, UINT a_uEnd)
+   {
+      BladeState bs;
+      UINT uNumSimulated = 0;
+      UINT uNumSleeping = 0;
+      CollisionCull chunkCull = cull;
+
+      /* air of the next PHYS_AIR_BATCH blades, sampled at once when the first of them needs it */
+      float    fAirX[PHYS_AIR_BATCH];
+      float    fAirY[PHYS_AIR_BATCH];
+      XMVECTOR vAir[PHYS_AIR_BATCH];
+      UINT     uAirBase = a_uBegin;
+      UINT     uAirCount = 0;
+
+      if (bRefreshStatic)
+         CacheStaticData(a_uBegin, a_uEnd, grassProps, indexMapData);
+
+      for (DWORD i = a_uBegin; i < a_uEnd; i++)
       {
-         float3 vNormal = create(0, 0, 0);
-         float3 vDist = create(0, 0, 0); 
-         int OldbrokenFlag = bp->brokenFlag;
+         BladePhysData* bp = &bladePhysData[i];
+         const BladeStaticData& sd = m_pStaticData[i];
+         float2 vTexCoord = XMLoadFloat2(&sd.vTexCoord);
+         const GrassPropsUnified& props = grassProps[sd.uSubType];
+         pFirstSegment[i] = (float)NUM_SEGMENTS;
 
-         bp->brokenFlag = a_pMeshes[0]->IsBottom(bp->position[0], vDist);
+         /*********************
+         Calculations
+         *********************/
 
-         //TODO: getNormal -> XMVECTOR
-         XMFLOAT3 v3 = pHeightData->GetNormal(getx(vTexCoord), gety(vTexCoord));
-         vNormal = XMLoadFloat3(&v3);
-         if (bp->brokenFlag > 0)
+         if (bp->brokenFlag == -1)
          {
-            float3 dir = a_pMeshes[0]->GetMoveDir();
-            Broken(vNormal, dir, bp, getx(vDist), props);
+            m_Blades.Load(i, bs);
+            BrokenAnim(m_fTime, bp, bs, props);
+            m_Blades.Store(i, bs);
             bp->NeedPhysics = 1;
-            if (bp->brokenFlag == 1) bp->brokenFlag = -1;
-            if (bp->brokenFlag > 1)
-               bp->NeedPhysics = 2;
+            continue;
          }
-         else
+         if (false) /*if (near_car)*/ //crash bellow if true, no time to realize why
          {
-            if (OldbrokenFlag > 0)
+            float3 vNormal = create(0, 0, 0);
+            float3 vDist = create(0, 0, 0); 
+            int OldbrokenFlag = bp->brokenFlag;
+
+            m_Blades.Load(i, bs);
+            Mesh* pBottomMesh = NULL;
+            bp->brokenFlag = 0;
+            for (UINT m = 0; m < cull.uNumColliders && pBottomMesh == NULL; m++)
             {
-               if (OldbrokenFlag == 1)
+               bp->brokenFlag = pColliders[m]->IsBottom(bs.position[0], vDist);
+               if (bp->brokenFlag > 0)
+                  pBottomMesh = pColliders[m];
+            }
+
+            //TODO: getNormal -> XMVECTOR
+            XMFLOAT3 v3 = pHeightData->GetNormal(getx(vTexCoord), gety(vTexCoord));
+            vNormal = XMLoadFloat3(&v3);
+            if (bp->brokenFlag > 0)
+            {
+               float3 dir = pBottomMesh->GetMoveDir();
+               RandomStream random(BladeSeed(m_pTransform->_41, m_pTransform->_43, i));
+               Broken(vNormal, dir, bp, bs, getx(vDist), props, random);
+               bp->NeedPhysics = 1;
+               if (bp->brokenFlag == 1) bp->brokenFlag = -1;
+               if (bp->brokenFlag > 1)
+                  bp->NeedPhysics = 2;
+            }
+            else
+            {
+               if (OldbrokenFlag > 0)
                {
-                  bp->brokenFlag = -1;
-                  bp->NeedPhysics = 1;
-                  continue;
+                  if (OldbrokenFlag == 1)
+                  {
+                     bp->brokenFlag = -1;
+                     bp->NeedPhysics = 1;
+                     continue;
+                  }
+                  else
+                  {
+                     bp->NeedPhysics = 2;
+                  }
                }
-               else
+            }
+            {
+               if (bp->brokenFlag == 0 && bp->NeedPhysics != 2)
                {
-                  bp->NeedPhysics = 2;
+                  Animatin(bp, bs, vTexCoord, pColliders, cull.uNumColliders, props);
                }
             }
+            m_Blades.Store(i, bs);
          }
+         if (bp->NeedPhysics == 2)
          {
-            if (bp->brokenFlag == 0 && bp->NeedPhysics != 2)
+            if (i >= uAirBase + uAirCount)
             {
-               Animatin(bp, vTexCoord, a_pMeshes, props);
+               uAirBase = i;
+               uAirCount = min(a_uEnd - i, (UINT)PHYS_AIR_BATCH);
+               for (UINT k = 0; k < uAirCount; k++)
+               {
+                  fAirX[k] = m_pStaticData[uAirBase + k].vTexCoord.x;
+                  fAirY[k] = m_pStaticData[uAirBase + k].vTexCoord.y;
+               }
+               pAirData->GetAirValues(fAirX, fAirY, uAirCount, vAir);
             }
+            float3 w = vAir[i - uAirBase];
+
+            if (bp->sleepCounter >= uSleepFrames)
+            {
+               /* sleeping blade keeps its pose until a collider gets close or the air around it changes */
+               XMVECTOR vReach = XMVectorReplicate(NUM_SEGMENTS * bp->segmentHeight);
+               bool bColliderNear = false;
+               for (UINT m = 0; m < cull.uNumColliders && !bColliderNear; m++)
+                  bColliderNear = XMVector3LessOrEqual(bp->startPosition - vReach, vColliderMax[m]) && XMVector3LessOrEqual(vColliderMin[m], bp->startPosition + vReach);
+               if (!bColliderNear && XMVectorGetX(XMVector3Length(w - bp->vSleepAir)) < sleepWakeAir)
+               {
+                  uNumSleeping++;
+                  continue;
+               }
+               bp->sleepCounter = 0;
+            }
+
+            /* integrator inputs, the step itself is done below for PHYS_LANES blades at once */
+            m_Blades.SetVec(BladeStreams::S_WIND, i, w);
+            m_Blades.Stream(BladeStreams::S_HEIGHT)[i] = bp->segmentHeight;
+            for (int j = 1; j < NUM_SEGMENTS; j++)
+            {
+               m_Blades.Stream(BladeStreams::S_MASS + j - 1)[i] = getcoord(props.vMassSegment, j - 1);
+               m_Blades.Stream(BladeStreams::S_HARDNESS + j - 1)[i] = getcoord(props.vHardnessSegment, j - 1);
+            }
+            m_Blades.Stream(BladeStreams::S_SOLVER)[i] = (float)props.uIntegrator;
+            pFirstSegment[i] = (bp->brokenFlag > 1) ? 2.0f : 1.0f;
+            uNumSimulated++;
+
+#if PHYS_SCALAR_REFERENCE
+            m_Blades.Load(i, bs);
+            Phisics(bp, bs, w, dTime, pColliders, cull.uNumColliders, props);
+            m_Blades.Store(i, bs);
+#endif
          }
-      }
-      if (bp->NeedPhysics == 2)
+      }//for (DWORD i = a_uBegin; i < a_uEnd; i++)
+
+      if (uNumSimulated > 0)
       {
-         float3 w = pAirData->GetAirValue(vTexCoord);
+#if !PHYS_SCALAR_REFERENCE
+         float d = powf(0.98f, dTime * 0.01f);
+         if (d > 0.9998f) d = 0.9998f;
+
+         for (DWORD i = a_uBegin; i < a_uEnd; i += PHYS_LANES)
+         {
+            const LaneBounds& bounds = m_pLaneBounds[i / PHYS_LANES];
+            UINT uNearMask = 0;
+            for (UINT m = 0; m < cull.uNumColliders; m++)
+            {
+               if (BoundsOverlap(bounds.vMin, bounds.vMax, vColliderMin[m], vColliderMax[m]))
+                  uNearMask |= 1u << m;
+            }
+            PhisicsLanes(m_Blades, bladePhysData, i, dTime, d, chunkCull, uNearMask);
+         }
+#endif
+
+         /* sleep test: a blade is at rest when its segments neither spin nor move its tip */
+         for (DWORD i = a_uBegin; i < a_uEnd; i++)
+         {
+            if (pFirstSegment[i] >= NUM_SEGMENTS)
+               continue;
+
+            BladePhysData* bp = &bladePhysData[i];
+            float fMaxVel = 0.0f;
+            for (int j = 1; j < NUM_SEGMENTS; j++)
+            {
+               float fVel = XMVectorGetX(XMVector3Length(m_Blades.GetVec(BladeStreams::S_W + 3 * j, i)));
+               fMaxVel = max(fMaxVel, fVel);
+            }
+
+            float3 vTip = m_Blades.GetVec(BladeStreams::S_POSITION + 3 * (NUM_SEGMENTS - 1), i);
+            float fTipVel = XMVectorGetX(XMVector3Length(vTip - bp->vLastTip)) / (dTime * NUM_SEGMENTS * bp->segmentHeight);
+            bp->vLastTip = vTip;
+
+            if (fMaxVel < sleepVelocity && fTipVel < sleepVelocity)
+               bp->sleepCounter++;
+            else
+               bp->sleepCounter = 0;
 
-         Phisics(bp, w, dTime, a_pMeshes, props);
+            if (bp->sleepCounter >= uSleepFrames)
+            {
+               bp->vSleepAir = m_Blades.GetVec(BladeStreams::S_WIND, i);
+               for (int j = 1; j < NUM_SEGMENTS; j++)
+                  m_Blades.SetVec(BladeStreams::S_W + 3 * j, i, create(0, 0, 0));
+            }
+         }
       }
-   }//for (DWORD i = 0; i < numBlades; i++)
+      uNumSimulatedTotal += uNumSimulated;
+      uNumSleepingTotal += uNumSleeping;
+      uNumTestedTotal += chunkCull.uTested;
+      uNumCulledTotal += chunkCull.uCulled;
+   };
 
-   UpdateBuffer();
+   if (a_pScheduler)
+      a_pScheduler->ParallelFor(0, numBlades, PHYS_BLADE_CHUNK, UpdateBlades);
+   else
+      UpdateBlades(0, numBlades);
+
+   m_dwNumAwake = uNumSimulatedTotal;
+   m_dwNumSleeping = uNumSleepingTotal;
+   m_dwNumCollideTested = uNumTestedTotal;
+   m_dwNumCollideCulled = uNumCulledTotal;
+
+   if (bRefreshStatic)
+   {
+      XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+      XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+      for (UINT g = 0; g < LaneGroupsCount(numBlades); g++)
+      {
+         vMin = XMVectorMin(vMin, XMLoadFloat3(&m_pLaneBounds[g].vMin));
+         vMax = XMVectorMax(vMax, XMLoadFloat3(&m_pLaneBounds[g].vMax));
+      }
+      XMStoreFloat3(&m_Bounds.vMin, vMin);
+      XMStoreFloat3(&m_Bounds.vMax, vMax);
+   }
 }
\ No newline at end of file
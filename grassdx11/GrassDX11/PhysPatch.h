@@ -8,12 +8,38 @@
 #include "GrassProperties.h"
 #include "Terrain.h"
 #include "AirData.h"
+#include "PhysBlades.h"
+#include "JobScheduler.h"
+#include "PhysRandom.h"
+#include "PhysSlab.h"
+
+#include <atomic>
+
+#include <DirectXPackedVector.h>
 
 #include <omp.h>
 
 class Mesh;
+class TrampleField;
 struct IndexMapData;
 
+/**
+Largest difference between the scalar and the lane solver, see PhysPatch::CompareSolvers
+*/
+struct BladeSolverDiff
+{
+   float fMaxOrientation;  /* angle between the segment orientations, radians */
+   float fMaxVelocity;     /* length of the angular velocity difference */
+   bool  bFinite;          /* false if either state blew up to inf / nan */
+};
+
+/* Step range the segment solver stays stable in, seconds; callers split or clamp their steps to it */
+#define PHYS_MIN_STEP 0.001f
+#define PHYS_MAX_STEP 0.1f
+
+/* Colliders one patch is tested against in a physics step, at most 32 (a bit mask of them per lane group) */
+#define PHYS_MAX_PATCH_COLLIDERS 16
+
 /* 20.07
  * New members:
  * float fTransparency - Transparency factor for lods
@@ -31,8 +57,9 @@ public:
    /**
    Simply creates all the arrays of maxBlades size
    param maxBlades maximum blades in patch
+   param a_pSlab arena to carve the blade arrays from, NULL - allocate them separately
    */
-   PhysPatch(GrassPatch* a_pGrassPatch);
+   PhysPatch(GrassPatch* a_pGrassPatch, PhysSlab* a_pSlab = NULL);
 
    /**
    Destroys all the arrays
@@ -41,13 +68,18 @@ public:
 
    /**
    Makes a physics step
-   param sphereRadius sphere collider radius
-   param spherePosition sphere collider position
-   param dTime delta time in SECONDS(!!!)
+   param dTime delta time in SECONDS(!!!), within [PHYS_MIN_STEP, PHYS_MAX_STEP], it is not clamped here
+   param a_pMeshes colliders near the patch, the first PHYS_MAX_PATCH_COLLIDERS of them reaching it are used
+   param a_pScheduler splits the blades into jobs, NULL - update them on the calling thread
    */
-   void UpdatePhysics(const float3& viewPos, float physLodDst, bool collision,
-      float3 spherePosition, float sphereRadius, float dTime, const std::vector<GrassPropsUnified>& grassProps,
-      const IndexMapData& indexMapData, Mesh* a_pMeshes[], UINT a_iNumMeshes);
+   void UpdatePhysics(const float3& viewPos, float physLodDst, float dTime, const std::vector<GrassPropsUnified>& grassProps,
+      const IndexMapData& indexMapData, Mesh* a_pMeshes[], UINT a_iNumMeshes, JobScheduler* a_pScheduler);
+
+   /**
+   Keeps the current pose as the one UpdateBuffer blends from,
+   called once before the UpdatePhysics steps of one patch update
+   */
+   void SavePrevOrientation(void);
 
    void TransferFromOtherLod(const PhysPatch& a_PhysPatch, bool a_bLod0ToLod1);
 
@@ -56,6 +88,26 @@ public:
    */
    void Reinit(void);
 
+   /**
+   Packs the pose of the disturbed blades into a_Data: a state byte per blade
+   and PackQuaternion of the segment orientations of the blades that use physics
+   return false if no blade is disturbed, a_Data is left empty then
+   */
+   bool SaveDormant(std::vector<BYTE>& a_Data) const;
+
+   /**
+   Puts back a pose saved by SaveDormant, called after Reinit with the same transform.
+   Restored blades start at rest, the segment positions follow at the next physics step
+   */
+   void LoadDormant(const std::vector<BYTE>& a_Data);
+
+   /**
+   Bends the blades the way a_Field shows them, called after Reinit for grass
+   trampled while it was out of the physics range. Bent blades go to physics
+   and rise from there, the hardest pressed ones stay down like broken ones
+   */
+   void ApplyTrample(const TrampleField& a_Field);
+
 
    void SetTransform (const XMFLOAT4X4* a_pMtx);
                      
@@ -67,6 +119,43 @@ public:
    DWORD PhysVerticesCount(void);
    DWORD AnimVerticesCount(void);
 
+   /**
+   Uploads blades to the vertex buffers
+   param a_fAlpha position between the previous and the last physics step, [0, 1]
+   */
+   void UpdateBuffer(float a_fAlpha);
+
+   /**
+   Blades integrated / skipped as sleeping by the last UpdatePhysics
+   */
+   DWORD AwakeBladesCount(void);
+   DWORD SleepingBladesCount(void);
+
+   /**
+   Awake segments of the last UpdatePhysics passed to Mesh::CollideSegments /
+   rejected by the patch, lane group or segment bounds before it, once per collider
+   */
+   DWORD CollideTestedCount(void);
+   DWORD CollideCulledCount(void);
+
+   /**
+   Drops the cached terrain data of the blades of all patches.
+   Call when the height map, height scale, index map or sub-types change
+   */
+   static void InvalidateStaticData(void);
+
+   /**
+   Slab bytes taken by the blade arrays of one patch of a_pGrassPatch
+   */
+   static size_t SlabBytes(GrassPatch* a_pGrassPatch);
+
+   /**
+   Steps a_uNumBlades blades, bent at random and in random wind, a_uNumSteps times with the
+   scalar Phisics and in lanes with StepSegmentLanes from the same streams, without colliders.
+   a_Props.uIntegrator selects the solver of both
+   */
+   static BladeSolverDiff CompareSolvers(const GrassPropsUnified& a_Props, UINT a_uNumBlades, UINT a_uNumSteps, float a_fTime);
+
 public:
    /**
    Parameters
@@ -80,7 +169,14 @@ public:
    static float dampfing;
    static float maxAngle;
    static float maxBrokenTime;
+   /* bend of one segment of a fully trampled blade (radians), as g_fTrampleAngle */
+   static float trampleAngle;
    static bool  transmitSpringMomentDownwards;
+   static float sleepVelocity;
+   static float sleepWakeAir;
+   static UINT  uSleepFrames;
+   /* bumped by InvalidateStaticData on the main thread while patch jobs read it */
+   static std::atomic<UINT> uStaticVersion;
    static bool  animation;
    static UINT  uTickCount;
 
@@ -91,7 +187,8 @@ public:
    static const TerrainHeightData* pHeightData;
 
    /**
-   Data, used by physics solver
+   Per-blade bookkeeping, used by physics solver.
+   Segment state (w, R, T, position) lives in BladeStreams
    */
    struct BladePhysData
    {
@@ -108,19 +205,18 @@ public:
       int      NeedPhysics;
       float    brokenTime;
       float    physicTime;
-      float3   g[NUM_SEGMENTS];
-      float3   w[NUM_SEGMENTS];
-      float3x3 R[NUM_SEGMENTS];
-      float3x3 T[NUM_SEGMENTS];
-      float3   position[NUM_SEGMENTS];
-
-      float3x3 A[NUM_SEGMENTS];
       float    lerpCoef;
 
       int type;
 
       int  grabbedMeshIndex;
       bool disableCollision;
+
+      /* Frames the blade has been at rest, asleep after uSleepFrames */
+      UINT   sleepCounter;
+      float3 vLastTip;
+      /* Air velocity when the blade fell asleep */
+      float3 vSleepAir;
    };
 
 private:
@@ -129,26 +225,60 @@ private:
    */
    struct VertexPhysData
    {
-      XMFLOAT4X4 R[NUM_SEGMENTS - 1];
-      XMFLOAT3   Position;
-      float      fTransparency;
-      XMFLOAT3   vColor;
+      PackedVector::XMHALF4   vPosOffset;            /* xyz - blade root relative to the patch origin */
+      UINT                    uR[NUM_SEGMENTS - 1];  /* PackQuaternion of segment orientations */
+      PackedVector::XMUBYTEN4 vColor;                /* rgb - colour, a - transparency */
    };
 
    typedef GrassVertex VertexAnimData;
 
-   void Broken(float3& vNormal, float3& dir, PhysPatch::BladePhysData* bp, float fDist, const GrassPropsUnified& props);
-   void Animatin(PhysPatch::BladePhysData* bp, float2& vTexCoord, Mesh* a_pMeshes[], const GrassPropsUnified& props);
-   void RotateSegment(PhysPatch::BladePhysData* bp, int j, const float3& psi, const GrassPropsUnified& props);
+   /**
+   Per-blade values depending only on the blade root,
+   filled by CacheStaticData when m_uStaticVersion falls behind uStaticVersion
+   */
+   struct BladeStaticData
+   {
+      XMFLOAT2 vTexCoord;
+      float    fHeight;
+      UCHAR    uSubType;
+   };
+
+   /**
+   Box a group of PHYS_LANES blades can reach whatever their pose: roots grown by the blade length
+   */
+   struct LaneBounds
+   {
+      XMFLOAT3 vMin;
+      XMFLOAT3 vMax;
+   };
+
+   void CacheStaticData(UINT a_uBegin, UINT a_uEnd, const std::vector<GrassPropsUnified>& grassProps, const IndexMapData& indexMapData);
+
+   void Broken(float3& vNormal, float3& dir, PhysPatch::BladePhysData* bp, BladeState& bs, float fDist, const GrassPropsUnified& props, RandomStream& a_Random);
+   void Animatin(PhysPatch::BladePhysData* bp, BladeState& bs, float2& vTexCoord, Mesh* a_pMeshes[], UINT a_uNumMeshes, const GrassPropsUnified& props);
 
    DWORD numBlades;
 
    UINT m_dwVertexStride[2];
    UINT m_dwVertexOffset;
    UINT m_dwVerticesCount[2];
+   DWORD m_dwNumAwake;
+   DWORD m_dwNumSleeping;
+   DWORD m_dwNumCollideTested;
+   DWORD m_dwNumCollideCulled;
+   /* simulated time of this patch, drives the broken blades swing */
+   float m_fTime;
 
    GrassPatch* m_pBasePatch;
    PhysPatch::BladePhysData* bladePhysData;
+   BladeStaticData*          m_pStaticData;
+   /* reach of every lane group and of the whole patch, refreshed with the static data */
+   LaneBounds*               m_pLaneBounds;
+   LaneBounds                m_Bounds;
+   /* blade arrays are carved from a PhysSlab and freed with it */
+   bool                      m_bSlabMemory;
+   UINT                      m_uStaticVersion;
+   BladeStreams              m_Blades;
 
    //static Perlin perlin;
    const XMFLOAT4X4  *m_pTransform;
@@ -161,5 +291,4 @@ private:
    ID3D11DeviceContext* m_pD3DDeviceCtx;
 
    void GenerateBuffer(void);
-   void UpdateBuffer(void);
 };
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "includes.h"
+
+/**
+Counter-based random numbers.
+A value depends only on the key and the counter, there is no global state,
+so streams can be used from any thread and give the same sequence every run.
+The mixing function is the PCG output permutation (RXS-M-XS).
+*/
+inline UINT PcgHash (UINT a_uValue)
+{
+   UINT uState = a_uValue * 747796405u + 2891336453u;
+   UINT uWord = ((uState >> ((uState >> 28u) + 4u)) ^ uState) * 277803737u;
+   return (uWord >> 22u) ^ uWord;
+}
+
+
+inline UINT HashCombine (UINT a_uSeed, UINT a_uValue)
+{
+   return PcgHash(a_uSeed ^ (a_uValue + 0x9e3779b9u + (a_uSeed << 6) + (a_uSeed >> 2)));
+}
+
+
+/**
+Seed of a blade: its patch position on the terrain and its index in the patch
+*/
+inline UINT BladeSeed (float a_fPatchX, float a_fPatchZ, UINT a_uBlade)
+{
+   /* millimetres, patch positions coming from the same grid cell give the same seed */
+   UINT uSeed = PcgHash((UINT)(int)floorf(a_fPatchX * 1000.0f + 0.5f));
+   uSeed = HashCombine(uSeed, (UINT)(int)floorf(a_fPatchZ * 1000.0f + 0.5f));
+   return HashCombine(uSeed, a_uBlade);
+}
+
+
+class RandomStream
+{
+public:
+   RandomStream (UINT a_uSeed) : m_uKey(PcgHash(a_uSeed)), m_uCounter(0) {}
+
+   UINT NextUInt (void)
+   {
+      return HashCombine(m_uKey, m_uCounter++);
+   }
+
+   /**
+   return value in [0, a_uRange)
+   */
+   UINT NextUInt (UINT a_uRange)
+   {
+      return NextUInt() % a_uRange;
+   }
+
+   /**
+   return value in [0, 1)
+   */
+   float NextFloat (void)
+   {
+      return (NextUInt() >> 8) * (1.0f / 16777216.0f);
+   }
+
+   float NextFloat (float a_fLeft, float a_fRight)
+   {
+      return (a_fRight - a_fLeft) * NextFloat() + a_fLeft;
+   }
+
+private:
+   UINT m_uKey;
+   UINT m_uCounter;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "includes.h"
+
+/* Alignment of every block carved from a PhysSlab, enough for XMVECTOR and the lane loads */
+#define PHYS_SLAB_ALIGN 16
+
+/**
+One aligned allocation carved into the blade memory of several physics patches.
+Blocks are handed out in order and never freed one by one, the whole slab goes at once.
+*/
+class PhysSlab
+{
+public:
+   /**
+   param a_uBytes size of the arena, a sum of RoundUp of the blocks it will hold
+   */
+   PhysSlab (size_t a_uBytes)
+   {
+      m_uUsed = 0;
+      m_pData = (BYTE*)_aligned_malloc(RoundUp(a_uBytes), PHYS_SLAB_ALIGN);
+      m_uSize = (m_pData != NULL) ? RoundUp(a_uBytes) : 0;
+   }
+
+   ~PhysSlab (void)
+   {
+      _aligned_free(m_pData);
+   }
+
+   /**
+   return next a_uBytes of the arena, NULL when it is full
+   */
+   void* Alloc (size_t a_uBytes)
+   {
+      a_uBytes = RoundUp(a_uBytes);
+      if (m_pData == NULL || m_uUsed + a_uBytes > m_uSize)
+         return NULL;
+
+      void* pBlock = m_pData + m_uUsed;
+      m_uUsed += a_uBytes;
+      return pBlock;
+   }
+
+   /* false if the arena could not be allocated, Alloc returns NULL then */
+   bool   IsValid (void) const { return m_pData != NULL; }
+   size_t Size (void) const { return m_uSize; }
+   size_t Used (void) const { return m_uUsed; }
+
+   static size_t RoundUp (size_t a_uBytes)
+   {
+      return (a_uBytes + PHYS_SLAB_ALIGN - 1) / PHYS_SLAB_ALIGN * PHYS_SLAB_ALIGN;
+   }
+
+private:
+   PhysSlab (const PhysSlab&);
+   PhysSlab& operator = (const PhysSlab&);
+
+   BYTE*  m_pData;
+   size_t m_uSize;
+   size_t m_uUsed;
+};
@@ -0,0 +1,112 @@
+#include "SdfCollider.h"
+
+
+SdfCollider::SdfCollider(const SignedDistanceField* a_pField, float a_fSkin)
+   : m_pField(a_pField)
+   , m_fScale(1.0f)
+   , m_fSkin(a_fSkin)
+   , m_bPlaced(false)
+{
+   XMStoreFloat4x4(&m_mTransform, XMMatrixIdentity());
+   XMStoreFloat4x4(&m_mInvTransform, XMMatrixIdentity());
+   m_vPosAndRadius = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+   m_vPrevPos = XMFLOAT3(0.0f, 0.0f, 0.0f);
+   m_vMoveDir = XMFLOAT3(0.0f, 0.0f, 1.0f);
+}
+
+
+void SdfCollider::SetTransform(XMFLOAT4X4& a_mTransform)
+{
+   m_mTransform = a_mTransform;
+   XMMATRIX mTransform = XMLoadFloat4x4(&a_mTransform);
+   XMStoreFloat4x4(&m_mInvTransform, XMMatrixInverse(NULL, mTransform));
+   m_fScale = XMVectorGetX(XMVector3Length(mTransform.r[0]));
+
+   /* sphere around the field grid */
+   XMFLOAT3 vMin, vMax;
+   m_pField->GetBounds(vMin, vMax);
+   XMVECTOR vCenter = (XMLoadFloat3(&vMin) + XMLoadFloat3(&vMax)) * 0.5f;
+   float fRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&vMax) - vCenter)) * m_fScale;
+   vCenter = XMVector3TransformCoord(vCenter, mTransform);
+
+   XMVECTOR vMove = vCenter - XMLoadFloat3(&m_vPrevPos);
+   if (m_bPlaced && XMVectorGetX(XMVector3LengthSq(vMove)) > 1e-8f)
+      XMStoreFloat3(&m_vMoveDir, XMVector3Normalize(vMove));
+   XMStoreFloat3(&m_vPrevPos, vCenter);
+   XMStoreFloat4(&m_vPosAndRadius, XMVectorSetW(vCenter, fRadius));
+   m_bPlaced = true;
+}
+
+
+XMFLOAT4 SdfCollider::GetPosAndRadius(void)
+{
+   return m_vPosAndRadius;
+}
+
+
+void SdfCollider::GetBounds(XMVECTOR& a_vMin, XMVECTOR& a_vMax)
+{
+   XMFLOAT3 vMin, vMax;
+   m_pField->GetBounds(vMin, vMax);
+   XMMATRIX mTransform = XMLoadFloat4x4(&m_mTransform);
+   a_vMin = XMVectorReplicate(FLT_MAX);
+   a_vMax = XMVectorReplicate(-FLT_MAX);
+   for (int i = 0; i < 8; i++)
+   {
+      XMVECTOR vCorner = XMVectorSet((i & 1) ? vMax.x : vMin.x, (i & 2) ? vMax.y : vMin.y, (i & 4) ? vMax.z : vMin.z, 1.0f);
+      vCorner = XMVector3TransformCoord(vCorner, mTransform);
+      a_vMin = XMVectorMin(a_vMin, vCorner);
+      a_vMax = XMVectorMax(a_vMax, vCorner);
+   }
+}
+
+
+float SdfCollider::Distance(FXMVECTOR a_vPos, XMVECTOR* a_vNormal) const
+{
+   XMVECTOR vLocal = XMVector3TransformCoord(a_vPos, XMLoadFloat4x4(&m_mInvTransform));
+   XMVECTOR vGrad;
+   float fDist = m_pField->Sample(vLocal, &vGrad) * m_fScale;
+   if (a_vNormal)
+   {
+      /* the scale is uniform, the rotation of the gradient is its direction in the world */
+      vGrad = XMVector3TransformNormal(vGrad, XMLoadFloat4x4(&m_mTransform));
+      float fLen = XMVectorGetX(XMVector3Length(vGrad));
+      *a_vNormal = (fLen > 1e-6f) ? vGrad / fLen : XMVectorZero();
+   }
+   return fDist;
+}
+
+
+bool SdfCollider::CheckCollision(XMVECTOR& Beg, XMVECTOR& End, float* Dist)
+{
+   float fDist = Distance(End, NULL);
+   if (Dist != NULL)
+      *Dist = fDist;
+   return fDist < m_fSkin;
+}
+
+
+bool SdfCollider::Collide(XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End,
+   PhysPatch::BladePhysData* a_pBladePhysData, int a_iSegmentIndex)
+{
+   *Ret = XMVectorZero();
+
+   XMVECTOR vNormal;
+   float fDist = Distance(End, &vNormal);
+   if (fDist >= m_fSkin || XMVector3Equal(vNormal, XMVectorZero()))
+      return false;
+
+   XMVECTOR vSeg = End - Beg;
+   float fSegLen2 = XMVectorGetX(XMVector3LengthSq(vSeg));
+   if (fSegLen2 < 1e-8f)
+      return false;
+
+   /* rotation about the segment begin that moves its end by the push, a little further like the planes do */
+   XMVECTOR vPush = vNormal * (m_fSkin - fDist);
+   XMVECTOR vPsi = XMVector3Cross(vSeg, vPush) / fSegLen2;
+   float fAngle = XMVectorGetX(XMVector3Length(vPsi));
+   if (fAngle < 1e-6f)
+      return false;
+   *Ret = vPsi * (min(fAngle * 1.1f, (float)M_PI * 0.5f) / fAngle);
+   return true;
+}
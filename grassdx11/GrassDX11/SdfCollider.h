@@ -0,0 +1,43 @@
+#pragma once
+
+#include "mesh.h"
+#include "SignedDistanceField.h"
+
+/**
+Collider of an arbitrary model by its baked signed distance field.
+A segment is tested by one trilinear sample at its end, so the cost does not
+depend on how many triangles the model has.
+The transform is model to world with a uniform scale, the field is not owned.
+*/
+class SdfCollider : public Mesh
+{
+public:
+   /**
+   param a_pField field in the model space of the transform
+   param a_fSkin segments closer than this to the surface (world units) are pushed out to it
+   */
+   SdfCollider(const SignedDistanceField* a_pField, float a_fSkin);
+
+   virtual void     SetTransform    (XMFLOAT4X4& a_mTransform) override;
+   virtual XMFLOAT4 GetPosAndRadius (void) override;
+   /* world box of the field grid */
+   virtual void     GetBounds       (XMVECTOR& a_vMin, XMVECTOR& a_vMax) override;
+   virtual void     Render          (void) override {}
+
+   virtual bool CheckCollision (XMVECTOR& Beg, XMVECTOR& End, float* Dist) override;
+   virtual bool Collide        (XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End,
+      PhysPatch::BladePhysData* a_pBladePhysData, int a_iSegmentIndex) override;
+
+   /**
+   return world distance from a_vPos to the surface, the band of the field at most
+   param a_vNormal world direction away from the surface, zero away from the surface bricks
+   */
+   float Distance(FXMVECTOR a_vPos, XMVECTOR* a_vNormal) const;
+
+private:
+   const SignedDistanceField* m_pField;
+   XMFLOAT4X4                 m_mInvTransform;
+   float                      m_fScale;
+   float                      m_fSkin;
+   bool                       m_bPlaced;
+};
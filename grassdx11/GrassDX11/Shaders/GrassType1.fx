@@ -238,6 +238,8 @@ GSIn CalcWindAnimation( float3 a_vBladePos, float3 a_vRotAxe, float3 a_vYRotAxe
       G = cross(halfAxis, localSum);
       w = mul(w_, mM_T[j]);
       G += w;
+      /* pressed by a collider, bent by the same angle whatever the hardness */
+      G += mul(CalcTrample(a_vBladePos), mM_T[j]) * vHardnessSeg[j - 1];
       mM_R[j] = MakeRotateMtx(G / vHardnessSeg[j - 1]);
       mM_T[j] = mul(mM_T[j-1], mM_R[j]);
    }
@@ -313,8 +315,9 @@ GSIn AnimVSMain ( InstVSIn Input )
    
 }
 
-GSIn PhysVSMain ( PhysVSIn Input )
+GSIn PhysVSMain ( PackedPhysVSIn PackedInput )
 {
+    PhysVSIn Input = UnpackPhysVSIn(PackedInput);
     //float4 vPos = mul(float4(Input.vPos, 1.0), g_mWorld);
     float4 vPos = float4(Input.vPos, 1.0); //mul(float4(Input.vPos, 1.0), g_mWorld);
     float fY = g_txHeightMap.SampleLevel(g_samLinear, (vPos.xz / g_fTerrRadius) * 0.5 + 0.5, 0).a * g_fHeightScale;    
@@ -334,8 +334,9 @@ GSIn StaticVSMain( StaticVSIn Input )
     return Output;
 }
 
-GSIn PhysVSMain( PhysVSIn Input )
+GSIn PhysVSMain( PackedPhysVSIn PackedInput )
 {
+    PhysVSIn Input = UnpackPhysVSIn(PackedInput);
     float4 vPos = float4(Input.vPos, 1.0); //mul(float4(Input.vPos, 1.0), g_mWorld);
     float fY = g_txHeightMap.SampleLevel(g_samLinear, (vPos.xz / g_fTerrRadius) * 0.5 + 0.5, 0).r * g_fHeightScale;    
     vPos.y = fY;       
@@ -103,5 +103,20 @@ inline float3 CalcWind( float3 a_vPos, int a_iSegmentIndex )
     return g_txAirTex.SampleLevel(g_samLinear, float3(vTexCoord, a_iSegmentIndex), 0).rgb;
 }
 
+/* TrampleField: rg - direction the grass is pressed to, times the amount */
+Texture2D g_txTrampleMap;
+/* bend of one segment of fully pressed grass, radians */
+float g_fTrampleAngle = 0.5;
+/* terrain uv to trample map uv, the map is rounded up to whole tiles */
+float g_fTrampleUVScale = 1.0;
+
+/* world rotation vector, bending a segment the way the grass is pressed */
+inline float3 CalcTrample( float3 a_vPos )
+{
+    float2 vTexCoord = ((a_vPos.xz / g_fTerrRadius) * 0.5 + 0.5 ) * g_fTrampleUVScale;
+    float2 vBend = g_txTrampleMap.SampleLevel(g_samLinear, vTexCoord, 0).rg;
+    return cross(float3(0.0, 1.0, 0.0), float3(vBend.x, 0.0, vBend.y)) * g_fTrampleAngle;
+}
+
 #endif
 
@@ -1,5 +1,6 @@
 
-Texture2DArray g_txWind;
+Texture2DArray g_txWind;      // last wind frame
+Texture2DArray g_txWindPrev;  // the frame before it
 Texture2D      g_txFlow;
 
 Texture2D g_txShadowMap; // Hack
@@ -7,6 +8,7 @@ Texture2D g_txShadowMap; // Hack
 cbuffer cUserControlled
 {
     float g_fWindStrength;
+    float g_fWindBlend;     // weight of g_txWind, the solve clock between the two frames
 };
 
 #include "Samplers.fx"
@@ -45,11 +47,14 @@ MixPSOut PSMix( MixPSIn In ) : SV_Target
 {
     MixPSOut Out;
 
-    float3 vValue1 = g_txWind.SampleLevel(g_samLinear, float3(In.vTexCoordW, 0), 0).rgb;
+    float3 vValue1 = lerp(g_txWindPrev.SampleLevel(g_samLinear, float3(In.vTexCoordW, 0), 0).rgb,
+                          g_txWind.SampleLevel(g_samLinear, float3(In.vTexCoordW, 0), 0).rgb, g_fWindBlend);
     float3 vWind1 = (vValue1) * g_fWindStrength;
-    float3 vValue2 = g_txWind.SampleLevel(g_samLinear, float3(In.vTexCoordW, 1), 0).rgb;
+    float3 vValue2 = lerp(g_txWindPrev.SampleLevel(g_samLinear, float3(In.vTexCoordW, 1), 0).rgb,
+                          g_txWind.SampleLevel(g_samLinear, float3(In.vTexCoordW, 1), 0).rgb, g_fWindBlend);
     float3 vWind2 = (vValue2) * g_fWindStrength;
-    float3 vValue3 = g_txWind.SampleLevel(g_samLinear, float3(In.vTexCoordW, 2), 0).rgb;
+    float3 vValue3 = lerp(g_txWindPrev.SampleLevel(g_samLinear, float3(In.vTexCoordW, 2), 0).rgb,
+                          g_txWind.SampleLevel(g_samLinear, float3(In.vTexCoordW, 2), 0).rgb, g_fWindBlend);
     float3 vWind3 = (vValue3) * g_fWindStrength;
     
     float3 vFlow = g_txFlow.SampleLevel(g_samLinear, float3(In.vTexCoordF, 0), 0).rgb;
@@ -9,12 +9,63 @@ struct InstVSIn
     //uint   uOnEdge				  : uOnEdge;
 };
 
+/* Physics blade as it comes from PhysPatch::VertexPhysData */
+struct PackedPhysVSIn
+{
+    float4 vPosOffset             : POSITION;     /* xyz - offset from g_vPhysPatchOrigin */
+    float4 qR0                    : SEGQUAT0;     /* smallest three quaternions, R10G10B10A2 */
+    float4 qR1                    : SEGQUAT1;
+    float4 qR2                    : SEGQUAT2;
+    float4 vColor                 : BLADECOLOR;   /* rgb - colour, a - transparency */
+};
+
 struct PhysVSIn
 {
-    row_major float4x4 mR0        : R0MTX;
-    row_major float4x4 mR1        : R1MTX;
-    row_major float4x4 mR2        : R2MTX;
-    float3 vPos                   : POSITION;
-    float fTransparency           : TRANSPARENCY;
-    float3 vColor                 : BLADECOLOR;
+    float4x4 mR0;
+    float4x4 mR1;
+    float4x4 mR2;
+    float3 vPos;
+    float fTransparency;
+    float3 vColor;
 };
+
+/* Origin of the patch being drawn, set by GrassPool before each physics draw */
+float3 g_vPhysPatchOrigin;
+
+/* Inverse of PackQuaternion in PhysMath.cpp */
+float4 UnpackQuaternion( float4 vPacked )
+{
+    float3 v = (vPacked.xyz - 0.5) * 1.41421356;
+    float  m = sqrt(saturate(1.0 - dot(v, v)));
+    uint   uLargest = (uint)round(vPacked.w * 3.0);
+
+    if (uLargest == 0)
+        return float4(m, v.x, v.y, v.z);
+    if (uLargest == 1)
+        return float4(v.x, m, v.y, v.z);
+    if (uLargest == 2)
+        return float4(v.x, v.y, m, v.z);
+    return float4(v.x, v.y, v.z, m);
+}
+
+/* Same rows as QuaternionToMatrix in PhysMath.cpp */
+float4x4 QuaternionToMatrix( float4 q )
+{
+    return float4x4(
+        1 - 2 * (q.y * q.y + q.z * q.z), 2 * (q.x * q.y - q.z * q.w), 2 * (q.x * q.z + q.y * q.w), 0,
+        2 * (q.x * q.y + q.z * q.w), 1 - 2 * (q.x * q.x + q.z * q.z), 2 * (q.y * q.z - q.x * q.w), 0,
+        2 * (q.x * q.z - q.y * q.w), 2 * (q.y * q.z + q.x * q.w), 1 - 2 * (q.x * q.x + q.y * q.y), 0,
+        0, 0, 0, 1);
+}
+
+PhysVSIn UnpackPhysVSIn( PackedPhysVSIn Input )
+{
+    PhysVSIn Output;
+    Output.mR0           = QuaternionToMatrix(UnpackQuaternion(Input.qR0));
+    Output.mR1           = QuaternionToMatrix(UnpackQuaternion(Input.qR1));
+    Output.mR2           = QuaternionToMatrix(UnpackQuaternion(Input.qR2));
+    Output.vPos          = g_vPhysPatchOrigin + Input.vPosOffset.xyz;
+    Output.fTransparency = Input.vColor.a;
+    Output.vColor        = Input.vColor.rgb;
+    return Output;
+}
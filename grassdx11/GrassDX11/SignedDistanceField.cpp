@@ -0,0 +1,526 @@
+#include "SignedDistanceField.h"
+
+#include <fstream>
+#include <map>
+#include <tuple>
+
+#define SDF_FILE_MAGIC   0x31464453  /* "SDF1" */
+#define SDF_FILE_VERSION 2
+#define SDF_QUANT        32767.0f
+
+struct SdfFileHeader
+{
+   UINT     uMagic;
+   UINT     uVersion;
+   UINT64   uHash;
+   XMFLOAT3 vOrigin;
+   float    fVoxel;
+   float    fBand;
+   UINT     uBricks[3];
+   UINT     uNumNodeBricks;
+};
+
+
+/* the part of a triangle a closest point lies on, each has its pseudo-normal */
+enum
+{
+   FEATURE_FACE = 0,
+   FEATURE_A,
+   FEATURE_B,
+   FEATURE_C,
+   FEATURE_AB,
+   FEATURE_BC,
+   FEATURE_CA,
+   FEATURE_COUNT
+};
+
+
+/* closest point of triangle abc to p and its FEATURE_, Ericson's Real-Time Collision Detection 5.1.5 */
+static XMVECTOR ClosestPointOnTriangle(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c, UINT* a_pFeature)
+{
+   XMVECTOR ab = b - a, ac = c - a, ap = p - a;
+   float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+   float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+   if (d1 <= 0.0f && d2 <= 0.0f)
+   {
+      *a_pFeature = FEATURE_A;
+      return a;
+   }
+
+   XMVECTOR bp = p - b;
+   float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+   float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+   if (d3 >= 0.0f && d4 <= d3)
+   {
+      *a_pFeature = FEATURE_B;
+      return b;
+   }
+
+   float vc = d1 * d4 - d3 * d2;
+   if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+   {
+      *a_pFeature = FEATURE_AB;
+      return a + ab * (d1 / (d1 - d3));
+   }
+
+   XMVECTOR cp = p - c;
+   float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+   float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+   if (d6 >= 0.0f && d5 <= d6)
+   {
+      *a_pFeature = FEATURE_C;
+      return c;
+   }
+
+   float vb = d5 * d2 - d1 * d6;
+   if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+   {
+      *a_pFeature = FEATURE_CA;
+      return a + ac * (d2 / (d2 - d6));
+   }
+
+   float va = d3 * d6 - d5 * d4;
+   if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+   {
+      *a_pFeature = FEATURE_BC;
+      return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+   }
+
+   *a_pFeature = FEATURE_FACE;
+   float denom = 1.0f / (va + vb + vc);
+   return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+
+static void AddTo(XMFLOAT3& a_vSum, FXMVECTOR a_vAdd)
+{
+   XMStoreFloat3(&a_vSum, XMLoadFloat3(&a_vSum) + a_vAdd);
+}
+
+
+/**
+Angle-weighted pseudo-normals (Baerentzen and Aanaes), FEATURE_COUNT per triangle: the face normal,
+the vertex normals weighted by the corner angles and the edge normals summed over both faces.
+A point is outside if it is in front of the pseudo-normal of the feature nearest to it, which
+holds at the edges and the corners too, where the face normals disagree
+*/
+static void PseudoNormals(const std::vector<XMFLOAT3>& a_Triangles, std::vector<XMFLOAT3>& a_Normals)
+{
+   UINT uNumTris = (UINT)(a_Triangles.size() / 3);
+
+   /* a triangle soup: corners at the same position are one vertex */
+   std::map<std::tuple<float, float, float>, UINT> VertexIds;
+   std::vector<UINT> Corners(uNumTris * 3);
+   for (UINT i = 0; i < uNumTris * 3; i++)
+   {
+      const XMFLOAT3& v = a_Triangles[i];
+      Corners[i] = VertexIds.insert(std::make_pair(std::make_tuple(v.x, v.y, v.z), (UINT)VertexIds.size())).first->second;
+   }
+
+   std::vector<XMFLOAT3> FaceNormals(uNumTris, XMFLOAT3(0.0f, 0.0f, 0.0f));
+   std::vector<XMFLOAT3> VertexNormals(VertexIds.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+   std::map<UINT64, XMFLOAT3> EdgeNormals;
+   for (UINT t = 0; t < uNumTris; t++)
+   {
+      XMVECTOR v[3];
+      for (UINT k = 0; k < 3; k++)
+         v[k] = XMLoadFloat3(&a_Triangles[t * 3 + k]);
+      XMVECTOR vCross = XMVector3Cross(v[1] - v[0], v[2] - v[0]);
+      /* a degenerate triangle is never the only nearest one, it adds nothing */
+      if (XMVectorGetX(XMVector3LengthSq(vCross)) < 1e-20f)
+         continue;
+      XMVECTOR vNormal = XMVector3Normalize(vCross);
+      XMStoreFloat3(&FaceNormals[t], vNormal);
+
+      for (UINT k = 0; k < 3; k++)
+      {
+         UINT uNext = (k + 1) % 3, uPrev = (k + 2) % 3;
+         float fCos = XMVectorGetX(XMVector3Dot(XMVector3Normalize(v[uNext] - v[k]), XMVector3Normalize(v[uPrev] - v[k])));
+         AddTo(VertexNormals[Corners[t * 3 + k]], vNormal * acosf(min(max(fCos, -1.0f), 1.0f)));
+
+         UINT uLo = min(Corners[t * 3 + k], Corners[t * 3 + uNext]);
+         UINT uHi = max(Corners[t * 3 + k], Corners[t * 3 + uNext]);
+         XMFLOAT3& vEdge = EdgeNormals.insert(std::make_pair(((UINT64)uLo << 32) | uHi, XMFLOAT3(0.0f, 0.0f, 0.0f))).first->second;
+         AddTo(vEdge, vNormal);
+      }
+   }
+
+   a_Normals.resize(uNumTris * FEATURE_COUNT);
+   for (UINT t = 0; t < uNumTris; t++)
+   {
+      XMFLOAT3* pNormals = &a_Normals[t * FEATURE_COUNT];
+      const UINT* pCorners = &Corners[t * 3];
+      pNormals[FEATURE_FACE] = FaceNormals[t];
+      for (UINT k = 0; k < 3; k++)
+      {
+         UINT uLo = min(pCorners[k], pCorners[(k + 1) % 3]);
+         UINT uHi = max(pCorners[k], pCorners[(k + 1) % 3]);
+         pNormals[FEATURE_A + k] = VertexNormals[pCorners[k]];
+         /* FEATURE_AB, FEATURE_BC, FEATURE_CA follow the corners */
+         pNormals[FEATURE_AB + k] = EdgeNormals[((UINT64)uLo << 32) | uHi];
+      }
+   }
+}
+
+
+/* rays of the parity vote, near the axes but off them, so a ray from a brick center does not run along an edge of an axis-aligned mesh */
+static const XMFLOAT3 s_vRayDirs[3] =
+{
+   XMFLOAT3(1.0f, 0.0173f, 0.0311f),
+   XMFLOAT3(0.0229f, 1.0f, 0.0137f),
+   XMFLOAT3(0.0191f, 0.0257f, 1.0f)
+};
+
+
+/* the ray from p along a_vDir crosses triangle abc, Moller-Trumbore */
+static bool RayCrossesTriangle(const XMFLOAT3& p, const XMFLOAT3& a_vDir, const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+{
+   XMVECTOR vDir = XMLoadFloat3(&a_vDir);
+   XMVECTOR vA = XMLoadFloat3(&a);
+   XMVECTOR e1 = XMLoadFloat3(&b) - vA;
+   XMVECTOR e2 = XMLoadFloat3(&c) - vA;
+   XMVECTOR h = XMVector3Cross(vDir, e2);
+   float det = XMVectorGetX(XMVector3Dot(e1, h));
+   if (fabsf(det) < 1e-12f)
+      return false;
+
+   float inv = 1.0f / det;
+   XMVECTOR s = XMLoadFloat3(&p) - vA;
+   float u = XMVectorGetX(XMVector3Dot(s, h)) * inv;
+   if (u < 0.0f || u > 1.0f)
+      return false;
+   XMVECTOR q = XMVector3Cross(s, e1);
+   float v = XMVectorGetX(XMVector3Dot(vDir, q)) * inv;
+   if (v < 0.0f || u + v > 1.0f)
+      return false;
+   return XMVectorGetX(XMVector3Dot(e2, q)) * inv > 0.0f;
+}
+
+
+/* inside if most of the three rays cross the surface an odd number of times, holes in the mesh spoil one ray at most */
+static bool IsInside(const XMFLOAT3& p, const std::vector<XMFLOAT3>& a_Triangles)
+{
+   UINT uOdd = 0;
+   for (UINT uRay = 0; uRay < 3; uRay++)
+   {
+      UINT uCrossings = 0;
+      for (size_t t = 0; t + 2 < a_Triangles.size(); t += 3)
+      {
+         if (RayCrossesTriangle(p, s_vRayDirs[uRay], a_Triangles[t], a_Triangles[t + 1], a_Triangles[t + 2]))
+            uCrossings++;
+      }
+      uOdd += uCrossings & 1;
+   }
+   return uOdd >= 2;
+}
+
+
+SignedDistanceField::SignedDistanceField(void)
+   : m_vOrigin(0.0f, 0.0f, 0.0f)
+   , m_fVoxel(1.0f)
+   , m_fBand(0.0f)
+   , m_uHash(0)
+{
+   m_uBricks[0] = m_uBricks[1] = m_uBricks[2] = 0;
+}
+
+
+UINT64 SignedDistanceField::Hash(const std::vector<XMFLOAT3>& a_Triangles, UINT a_uCells, float a_fBandVoxels)
+{
+   /* FNV-1a */
+   UINT64 uHash = 14695981039346656037ull;
+   auto Add = [&uHash](const void* a_pData, size_t a_uBytes)
+   {
+      const BYTE* pBytes = (const BYTE*)a_pData;
+      for (size_t i = 0; i < a_uBytes; i++)
+      {
+         uHash ^= pBytes[i];
+         uHash *= 1099511628211ull;
+      }
+   };
+   UINT uVersion = SDF_FILE_VERSION;
+   Add(&uVersion, sizeof(uVersion));
+   Add(&a_uCells, sizeof(a_uCells));
+   Add(&a_fBandVoxels, sizeof(a_fBandVoxels));
+   if (!a_Triangles.empty())
+      Add(&a_Triangles[0], a_Triangles.size() * sizeof(XMFLOAT3));
+   return uHash;
+}
+
+
+void SignedDistanceField::Bake(const std::vector<XMFLOAT3>& a_Triangles, UINT a_uCells, float a_fBandVoxels)
+{
+   m_uHash = Hash(a_Triangles, a_uCells, a_fBandVoxels);
+   m_BrickIndex.clear();
+   m_Nodes.clear();
+   UINT uNumTris = (UINT)(a_Triangles.size() / 3);
+   if (uNumTris == 0 || a_uCells == 0)
+      return;
+
+   XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+   XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+   for (size_t i = 0; i < uNumTris * 3; i++)
+   {
+      vMin = XMVectorMin(vMin, XMLoadFloat3(&a_Triangles[i]));
+      vMax = XMVectorMax(vMax, XMLoadFloat3(&a_Triangles[i]));
+   }
+   XMFLOAT3 vSize;
+   XMStoreFloat3(&vSize, vMax - vMin);
+   m_fVoxel = max(max(vSize.x, vSize.y), max(vSize.z, 1e-4f)) / a_uCells;
+   m_fBand = max(a_fBandVoxels, 1.0f) * m_fVoxel;
+
+   /* the band is kept around the mesh box, so every surface brick is inside the grid */
+   XMVECTOR vBand = XMVectorReplicate(m_fBand);
+   XMStoreFloat3(&m_vOrigin, vMin - vBand);
+   XMFLOAT3 vGridSize;
+   XMStoreFloat3(&vGridSize, vMax - vMin + 2.0f * vBand);
+   float fGridSize[3] = { vGridSize.x, vGridSize.y, vGridSize.z };
+   for (UINT c = 0; c < 3; c++)
+      m_uBricks[c] = max((UINT)ceilf(fGridSize[c] / (m_fVoxel * SDF_BRICK)), 1u);
+   float fBrickSize = m_fVoxel * SDF_BRICK;
+   UINT uNumBricks = m_uBricks[0] * m_uBricks[1] * m_uBricks[2];
+
+   std::vector<XMFLOAT3> Normals;
+   PseudoNormals(a_Triangles, Normals);
+
+   /* triangles within the band of every brick */
+   std::vector<std::vector<UINT> > BrickTris(uNumBricks);
+   for (UINT t = 0; t < uNumTris; t++)
+   {
+      XMVECTOR a = XMLoadFloat3(&a_Triangles[t * 3]);
+      XMVECTOR b = XMLoadFloat3(&a_Triangles[t * 3 + 1]);
+      XMVECTOR c = XMLoadFloat3(&a_Triangles[t * 3 + 2]);
+
+      XMFLOAT3 vTriMin, vTriMax;
+      XMStoreFloat3(&vTriMin, XMVectorMin(a, XMVectorMin(b, c)) - vBand - XMLoadFloat3(&m_vOrigin));
+      XMStoreFloat3(&vTriMax, XMVectorMax(a, XMVectorMax(b, c)) + vBand - XMLoadFloat3(&m_vOrigin));
+      int iMin[3] = { (int)floorf(vTriMin.x / fBrickSize), (int)floorf(vTriMin.y / fBrickSize), (int)floorf(vTriMin.z / fBrickSize) };
+      int iMax[3] = { (int)floorf(vTriMax.x / fBrickSize), (int)floorf(vTriMax.y / fBrickSize), (int)floorf(vTriMax.z / fBrickSize) };
+      for (UINT k = 0; k < 3; k++)
+      {
+         iMin[k] = max(iMin[k], 0);
+         iMax[k] = min(iMax[k], (int)m_uBricks[k] - 1);
+      }
+      for (int z = iMin[2]; z <= iMax[2]; z++)
+         for (int y = iMin[1]; y <= iMax[1]; y++)
+            for (int x = iMin[0]; x <= iMax[0]; x++)
+               BrickTris[(z * m_uBricks[1] + y) * m_uBricks[0] + x].push_back(t);
+   }
+
+   m_BrickIndex.assign(uNumBricks, BRICK_OUTSIDE);
+   for (UINT bz = 0; bz < m_uBricks[2]; bz++)
+   {
+      for (UINT by = 0; by < m_uBricks[1]; by++)
+      {
+         for (UINT bx = 0; bx < m_uBricks[0]; bx++)
+         {
+            UINT uBrick = (bz * m_uBricks[1] + by) * m_uBricks[0] + bx;
+            XMFLOAT3 vBrickOrigin(m_vOrigin.x + bx * fBrickSize, m_vOrigin.y + by * fBrickSize, m_vOrigin.z + bz * fBrickSize);
+            const std::vector<UINT>& Tris = BrickTris[uBrick];
+            if (Tris.empty())
+            {
+               /* the whole brick is farther than the band from the surface, on one side of it */
+               XMFLOAT3 vCenter(vBrickOrigin.x + fBrickSize * 0.5f, vBrickOrigin.y + fBrickSize * 0.5f, vBrickOrigin.z + fBrickSize * 0.5f);
+               m_BrickIndex[uBrick] = IsInside(vCenter, a_Triangles) ? BRICK_INSIDE : BRICK_OUTSIDE;
+               continue;
+            }
+
+            m_BrickIndex[uBrick] = (int)(m_Nodes.size() / NODES);
+            m_Nodes.resize(m_Nodes.size() + NODES);
+            SHORT* pNodes = &m_Nodes[m_Nodes.size() - NODES];
+            for (UINT z = 0; z <= SDF_BRICK; z++)
+            {
+               for (UINT y = 0; y <= SDF_BRICK; y++)
+               {
+                  for (UINT x = 0; x <= SDF_BRICK; x++)
+                  {
+                     XMVECTOR p = XMVectorSet(vBrickOrigin.x + x * m_fVoxel, vBrickOrigin.y + y * m_fVoxel, vBrickOrigin.z + z * m_fVoxel, 0.0f);
+
+                     /* nearest triangle, the side from the pseudo-normal of its nearest feature */
+                     float fBest = FLT_MAX, fSide = 1.0f;
+                     for (size_t k = 0; k < Tris.size(); k++)
+                     {
+                        UINT t = Tris[k], uFeature;
+                        XMVECTOR vClosest = ClosestPointOnTriangle(p, XMLoadFloat3(&a_Triangles[t * 3]), XMLoadFloat3(&a_Triangles[t * 3 + 1]), XMLoadFloat3(&a_Triangles[t * 3 + 2]), &uFeature);
+                        XMVECTOR vDelta = p - vClosest;
+                        float fDist2 = XMVectorGetX(XMVector3LengthSq(vDelta));
+                        if (fDist2 >= fBest)
+                           continue;
+
+                        fBest = fDist2;
+                        fSide = (XMVectorGetX(XMVector3Dot(vDelta, XMLoadFloat3(&Normals[t * FEATURE_COUNT + uFeature]))) >= 0.0f) ? 1.0f : -1.0f;
+                     }
+
+                     float fDist = min(sqrtf(fBest), m_fBand) * fSide;
+                     pNodes[(z * (SDF_BRICK + 1) + y) * (SDF_BRICK + 1) + x] = (SHORT)floorf(fDist / m_fBand * SDF_QUANT + 0.5f);
+                  }
+               }
+            }
+         }
+      }
+   }
+}
+
+
+bool SignedDistanceField::Save(const std::string& a_sPath) const
+{
+   std::ofstream out(a_sPath.c_str(), std::ios::binary);
+   if (!out)
+      return false;
+
+   SdfFileHeader header;
+   header.uMagic = SDF_FILE_MAGIC;
+   header.uVersion = SDF_FILE_VERSION;
+   header.uHash = m_uHash;
+   header.vOrigin = m_vOrigin;
+   header.fVoxel = m_fVoxel;
+   header.fBand = m_fBand;
+   for (UINT c = 0; c < 3; c++)
+      header.uBricks[c] = m_uBricks[c];
+   header.uNumNodeBricks = (UINT)(m_Nodes.size() / NODES);
+
+   out.write((const char*)&header, sizeof(header));
+   if (!m_BrickIndex.empty())
+      out.write((const char*)&m_BrickIndex[0], m_BrickIndex.size() * sizeof(int));
+   if (!m_Nodes.empty())
+      out.write((const char*)&m_Nodes[0], m_Nodes.size() * sizeof(SHORT));
+   return out.good();
+}
+
+
+bool SignedDistanceField::Load(const std::string& a_sPath, UINT64 a_uHash)
+{
+   std::ifstream in(a_sPath.c_str(), std::ios::binary);
+   if (!in)
+      return false;
+
+   SdfFileHeader header;
+   in.read((char*)&header, sizeof(header));
+   if (!in || header.uMagic != SDF_FILE_MAGIC || header.uVersion != SDF_FILE_VERSION || header.uHash != a_uHash)
+      return false;
+
+   UINT uNumBricks = header.uBricks[0] * header.uBricks[1] * header.uBricks[2];
+   std::vector<int> BrickIndex(uNumBricks);
+   std::vector<SHORT> Nodes((size_t)header.uNumNodeBricks * NODES);
+   if (uNumBricks > 0)
+      in.read((char*)&BrickIndex[0], uNumBricks * sizeof(int));
+   if (!Nodes.empty())
+      in.read((char*)&Nodes[0], Nodes.size() * sizeof(SHORT));
+   if (!in)
+      return false;
+   for (UINT i = 0; i < uNumBricks; i++)
+   {
+      if (BrickIndex[i] >= (int)header.uNumNodeBricks || BrickIndex[i] < BRICK_INSIDE)
+         return false;
+   }
+
+   m_uHash = header.uHash;
+   m_vOrigin = header.vOrigin;
+   m_fVoxel = header.fVoxel;
+   m_fBand = header.fBand;
+   for (UINT c = 0; c < 3; c++)
+      m_uBricks[c] = header.uBricks[c];
+   m_BrickIndex.swap(BrickIndex);
+   m_Nodes.swap(Nodes);
+   return true;
+}
+
+
+bool SignedDistanceField::LoadOrBake(const std::vector<XMFLOAT3>& a_Triangles, UINT a_uCells, float a_fBandVoxels, const std::string& a_sCachePath)
+{
+   if (a_sCachePath.empty())
+   {
+      Bake(a_Triangles, a_uCells, a_fBandVoxels);
+      return false;
+   }
+   if (Load(a_sCachePath, Hash(a_Triangles, a_uCells, a_fBandVoxels)))
+      return true;
+
+   Bake(a_Triangles, a_uCells, a_fBandVoxels);
+   Save(a_sCachePath);
+   return false;
+}
+
+
+std::string SignedDistanceField::CachePath(const std::string& a_sName)
+{
+   char szAppData[MAX_PATH];
+   DWORD uLength = GetEnvironmentVariableA("LOCALAPPDATA", szAppData, MAX_PATH);
+   if (uLength == 0 || uLength >= MAX_PATH)
+      return std::string();
+
+   std::string sDir = std::string(szAppData) + "\\GrassDX11";
+   if (!CreateDirectoryA(sDir.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+      return std::string();
+   return sDir + "\\" + a_sName;
+}
+
+
+float SignedDistanceField::NodeValue(int a_iBrick, UINT a_uX, UINT a_uY, UINT a_uZ) const
+{
+   return m_Nodes[(size_t)a_iBrick * NODES + (a_uZ * (SDF_BRICK + 1) + a_uY) * (SDF_BRICK + 1) + a_uX] * (m_fBand / SDF_QUANT);
+}
+
+
+float SignedDistanceField::Sample(FXMVECTOR a_vPos, XMVECTOR* a_vGrad) const
+{
+   if (a_vGrad)
+      *a_vGrad = XMVectorZero();
+
+   XMFLOAT3 g;
+   XMStoreFloat3(&g, (a_vPos - XMLoadFloat3(&m_vOrigin)) / m_fVoxel);
+   float fCoord[3] = { g.x, g.y, g.z };
+   UINT uCell[3];
+   float fFrac[3];
+   for (UINT c = 0; c < 3; c++)
+   {
+      float fCells = (float)(m_uBricks[c] * SDF_BRICK);
+      if (!(fCoord[c] >= 0.0f && fCoord[c] < fCells))
+         return m_fBand;
+      uCell[c] = min((UINT)fCoord[c], m_uBricks[c] * SDF_BRICK - 1);
+      fFrac[c] = fCoord[c] - uCell[c];
+   }
+
+   int iBrick = m_BrickIndex[((uCell[2] / SDF_BRICK) * m_uBricks[1] + uCell[1] / SDF_BRICK) * m_uBricks[0] + uCell[0] / SDF_BRICK];
+   if (iBrick == BRICK_OUTSIDE)
+      return m_fBand;
+   if (iBrick == BRICK_INSIDE)
+      return -m_fBand;
+
+   UINT x = uCell[0] % SDF_BRICK, y = uCell[1] % SDF_BRICK, z = uCell[2] % SDF_BRICK;
+   float c000 = NodeValue(iBrick, x, y, z),         c100 = NodeValue(iBrick, x + 1, y, z);
+   float c010 = NodeValue(iBrick, x, y + 1, z),     c110 = NodeValue(iBrick, x + 1, y + 1, z);
+   float c001 = NodeValue(iBrick, x, y, z + 1),     c101 = NodeValue(iBrick, x + 1, y, z + 1);
+   float c011 = NodeValue(iBrick, x, y + 1, z + 1), c111 = NodeValue(iBrick, x + 1, y + 1, z + 1);
+   float fx = fFrac[0], fy = fFrac[1], fz = fFrac[2];
+
+   /* along x first, then y, then z */
+   float c00 = c000 + (c100 - c000) * fx, c10 = c010 + (c110 - c010) * fx;
+   float c01 = c001 + (c101 - c001) * fx, c11 = c011 + (c111 - c011) * fx;
+   float c0 = c00 + (c10 - c00) * fy, c1 = c01 + (c11 - c01) * fy;
+
+   if (a_vGrad)
+   {
+      float fGradX = ((c100 - c000) * (1.0f - fy) * (1.0f - fz) + (c110 - c010) * fy * (1.0f - fz) +
+                      (c101 - c001) * (1.0f - fy) * fz + (c111 - c011) * fy * fz) / m_fVoxel;
+      float fGradY = ((c10 - c00) * (1.0f - fz) + (c11 - c01) * fz) / m_fVoxel;
+      float fGradZ = (c1 - c0) / m_fVoxel;
+      *a_vGrad = XMVectorSet(fGradX, fGradY, fGradZ, 0.0f);
+   }
+   return c0 + (c1 - c0) * fz;
+}
+
+
+void SignedDistanceField::GetBounds(XMFLOAT3& a_vMin, XMFLOAT3& a_vMax) const
+{
+   a_vMin = m_vOrigin;
+   a_vMax = XMFLOAT3(m_vOrigin.x + m_uBricks[0] * SDF_BRICK * m_fVoxel,
+                     m_vOrigin.y + m_uBricks[1] * SDF_BRICK * m_fVoxel,
+                     m_vOrigin.z + m_uBricks[2] * SDF_BRICK * m_fVoxel);
+}
+
+
+size_t SignedDistanceField::MemoryBytes(void) const
+{
+   return m_BrickIndex.size() * sizeof(int) + m_Nodes.size() * sizeof(SHORT);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "includes.h"
+
+#include <string>
+#include <vector>
+
+/* voxels per brick side, a brick stores the distances at its (SDF_BRICK + 1)^3 nodes */
+#define SDF_BRICK 8
+
+/**
+Sparse signed distance field of a triangle mesh, in the mesh (model) space.
+The grid is split into bricks; only the bricks near the surface store distances,
+the rest are wholly outside or inside and keep just that. Distances are clamped
+to the band and stored in 16 bits, negative inside the mesh: the side of a node is
+told by the angle-weighted pseudo-normal of its nearest feature, the side of a brick
+without nodes by a parity vote of three rays.
+*/
+class SignedDistanceField
+{
+public:
+   SignedDistanceField(void);
+
+   /**
+   Bakes the field of a triangle list
+   param a_Triangles three positions per triangle, model space
+   param a_uCells voxels along the longest side of the mesh box
+   param a_fBandVoxels distances are exact up to this many voxels from the surface
+   */
+   void Bake(const std::vector<XMFLOAT3>& a_Triangles, UINT a_uCells, float a_fBandVoxels);
+
+   /**
+   Takes the field from a_sCachePath if it was baked from the same triangles and settings,
+   otherwise bakes it and writes it there; an empty path bakes without the cache
+   return true if the field came from the cache
+   */
+   bool LoadOrBake(const std::vector<XMFLOAT3>& a_Triangles, UINT a_uCells, float a_fBandVoxels, const std::string& a_sCachePath);
+
+   bool Save(const std::string& a_sPath) const;
+   bool Load(const std::string& a_sPath, UINT64 a_uHash);
+
+   /**
+   return trilinear distance at a_vPos (model space), the band outside the grid
+   param a_vGrad gradient of the distance, zero away from the surface bricks
+   */
+   float Sample(FXMVECTOR a_vPos, XMVECTOR* a_vGrad) const;
+
+   /**
+   Key of the cache: the triangles and the bake settings
+   */
+   static UINT64 Hash(const std::vector<XMFLOAT3>& a_Triangles, UINT a_uCells, float a_fBandVoxels);
+
+   /**
+   return a_sName in the GrassDX11 folder of %LOCALAPPDATA%, created if missing; empty without the folder
+   */
+   static std::string CachePath(const std::string& a_sName);
+
+   bool   IsEmpty(void) const { return m_BrickIndex.empty(); }
+   float  Band(void) const { return m_fBand; }
+   void   GetBounds(XMFLOAT3& a_vMin, XMFLOAT3& a_vMax) const;
+   size_t MemoryBytes(void) const;
+
+private:
+   /* m_BrickIndex values of the bricks without nodes */
+   enum { BRICK_OUTSIDE = -1, BRICK_INSIDE = -2 };
+
+   static const UINT NODES = (SDF_BRICK + 1) * (SDF_BRICK + 1) * (SDF_BRICK + 1);
+
+   float NodeValue(int a_iBrick, UINT a_uX, UINT a_uY, UINT a_uZ) const;
+
+   XMFLOAT3           m_vOrigin;      /* model space position of node 0 */
+   float              m_fVoxel;       /* voxel side, model units */
+   float              m_fBand;        /* largest stored distance, model units */
+   UINT               m_uBricks[3];   /* bricks along x, y, z */
+   std::vector<int>   m_BrickIndex;   /* brick -> first node / NODES, or BRICK_OUTSIDE, BRICK_INSIDE */
+   std::vector<SHORT> m_Nodes;        /* distance / m_fBand * 32767 */
+   UINT64             m_uHash;
+};
@@ -74,8 +74,10 @@ TexturesMixer::TexturesMixer (ID3D11Device * pD3DDevice, ID3D11DeviceContext * p
    m_pPass = m_pEffect->GetTechniqueByIndex(0)->GetPassByName("MixTexturesPass");
 
    m_pTex1     = m_pEffect->GetVariableByName("g_txWind")->AsShaderResource();
+   m_pTex1Prev = m_pEffect->GetVariableByName("g_txWindPrev")->AsShaderResource();
    m_pTex2     = m_pEffect->GetVariableByName("g_txFlow")->AsShaderResource();
    m_pStrength = m_pEffect->GetVariableByName("g_fWindStrength")->AsScalar();
+   m_pWindBlend = m_pEffect->GetVariableByName("g_fWindBlend")->AsScalar();
 
    m_uVertexStride = sizeof(TexturesMixerVertex);
    m_uVertexOffset = 0;
@@ -140,9 +142,11 @@ void TexturesMixer::SetWindStrength (float strength)
 }
 
 
-void TexturesMixer::MixTextures (ID3D11ShaderResourceView* wind, ID3D11ShaderResourceView* flow)
+void TexturesMixer::MixTextures (ID3D11ShaderResourceView* windPrev, ID3D11ShaderResourceView* wind, float windBlend, ID3D11ShaderResourceView* flow)
 {
    m_pTex1->SetResource(wind);
+   m_pTex1Prev->SetResource(windPrev);
+   m_pWindBlend->SetFloat(windBlend);
    m_pTex2->SetResource(flow);
 
    D3D11_VIEWPORT          m_ViewPort;
@@ -183,6 +187,7 @@ void TexturesMixer::MixTextures (ID3D11ShaderResourceView* wind, ID3D11ShaderRes
    SAFE_RELEASE(m_pOrigRS);
 
    m_pTex1->SetResource(NULL);
+   m_pTex1Prev->SetResource(NULL);
    m_pTex2->SetResource(NULL);
 }
 
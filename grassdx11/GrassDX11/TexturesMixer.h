@@ -13,7 +13,10 @@ public:
    TexturesMixer  (ID3D11Device* pD3DDevice, ID3D11DeviceContext* pD3DDeviceCtx, int txW1, int txH1, int txW2, int txH2);
    ~TexturesMixer (void);
    
-   void MixTextures (ID3D11ShaderResourceView* wind, ID3D11ShaderResourceView* flow);
+   /**
+   Adds the flow to the wind, lerped from windPrev to wind by windBlend
+   */
+   void MixTextures (ID3D11ShaderResourceView* windPrev, ID3D11ShaderResourceView* wind, float windBlend, ID3D11ShaderResourceView* flow);
 
    ID3D11ShaderResourceView* GetShaderResourceView (void);
 
@@ -45,8 +48,10 @@ public:
    ID3DX11EffectPass *m_pPass;
 
    ID3DX11EffectShaderResourceVariable *m_pTex1; // wind
+   ID3DX11EffectShaderResourceVariable *m_pTex1Prev; // wind of the frame before
    ID3DX11EffectShaderResourceVariable *m_pTex2; // flow
    ID3DX11EffectScalarVariable         *m_pStrength;
+   ID3DX11EffectScalarVariable         *m_pWindBlend;
 
    int m_maxW;
    int m_maxH;
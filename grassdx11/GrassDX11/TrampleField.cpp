@@ -0,0 +1,265 @@
+#include "TrampleField.h"
+#include "PhysMath.h"
+
+/* largest texel component, a fully pressed texel */
+#define TRAMPLE_MAX 127.0f
+
+
+TrampleField::TrampleField(ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx, float a_fTerrRadius, float a_fTexelSize)
+   : m_pD3DDevice(a_pD3DDevice)
+   , m_pD3DDeviceCtx(a_pD3DDeviceCtx)
+   , m_pTrampleTex(NULL)
+   , m_pTrampleSRV(NULL)
+   , m_fTerrRadius(a_fTerrRadius)
+   , m_fTexelSize(a_fTexelSize)
+   , m_uNumTiles(0)
+   , m_fRecoveryTime(60.0f)
+   , m_fRecoverAccum(0.0f)
+{
+   m_uTexels = (UINT)ceilf(2.0f * m_fTerrRadius / m_fTexelSize);
+   m_uTiles = (m_uTexels + TRAMPLE_TILE - 1) / TRAMPLE_TILE;
+   m_uTexels = m_uTiles * TRAMPLE_TILE;
+   m_Tiles.assign(m_uTiles * m_uTiles, NULL);
+   /* without a device the field is only sampled by the physics */
+   if (!m_pD3DDevice)
+      return;
+
+   D3D11_TEXTURE2D_DESC TexDesc;
+   ZeroMemory(&TexDesc, sizeof(TexDesc));
+   TexDesc.Width            = m_uTexels;
+   TexDesc.Height           = m_uTexels;
+   TexDesc.MipLevels        = 1;
+   TexDesc.ArraySize        = 1;
+   TexDesc.Format           = DXGI_FORMAT_R8G8_SNORM;
+   TexDesc.SampleDesc.Count = 1;
+   TexDesc.Usage            = D3D11_USAGE_DEFAULT;
+   TexDesc.BindFlags        = D3D11_BIND_SHADER_RESOURCE;
+
+   std::vector<INT8> Zeros(m_uTexels * m_uTexels * 2, 0);
+   D3D11_SUBRESOURCE_DATA InitData;
+   InitData.pSysMem          = &Zeros[0];
+   InitData.SysMemPitch      = m_uTexels * 2;
+   InitData.SysMemSlicePitch = 0;
+   m_pD3DDevice->CreateTexture2D(&TexDesc, &InitData, &m_pTrampleTex);
+
+   D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc;
+   ZeroMemory(&SRVDesc, sizeof(SRVDesc));
+   SRVDesc.Format = TexDesc.Format;
+   SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+   SRVDesc.Texture2D.MostDetailedMip = 0;
+   SRVDesc.Texture2D.MipLevels = 1;
+   m_pD3DDevice->CreateShaderResourceView(m_pTrampleTex, &SRVDesc, &m_pTrampleSRV);
+}
+
+
+TrampleField::~TrampleField(void)
+{
+   for (size_t i = 0; i < m_Tiles.size(); i++)
+      delete m_Tiles[i];
+   SAFE_RELEASE(m_pTrampleSRV);
+   SAFE_RELEASE(m_pTrampleTex);
+}
+
+
+TrampleField::Tile* TrampleField::GetTile(UINT a_uTileX, UINT a_uTileY, bool a_bCreate)
+{
+   Tile*& pTile = m_Tiles[a_uTileY * m_uTiles + a_uTileX];
+   if (pTile == NULL && a_bCreate)
+   {
+      pTile = new Tile;
+      ZeroMemory(pTile->Texels, sizeof(pTile->Texels));
+      pTile->bDirty = false;
+      pTile->bRecovered = false;
+      m_uNumTiles++;
+   }
+   return pTile;
+}
+
+
+void TrampleField::Stamp(const float3& a_vPos, float a_fRadius, const float3& a_vMoveDir)
+{
+   float fPosX = getx(a_vPos);
+   float fPosZ = getz(a_vPos);
+   int iMinX = max((int)floorf((fPosX - a_fRadius + m_fTerrRadius) / m_fTexelSize), 0);
+   int iMinY = max((int)floorf((fPosZ - a_fRadius + m_fTerrRadius) / m_fTexelSize), 0);
+   int iMaxX = min((int)floorf((fPosX + a_fRadius + m_fTerrRadius) / m_fTexelSize), (int)m_uTexels - 1);
+   int iMaxY = min((int)floorf((fPosZ + a_fRadius + m_fTerrRadius) / m_fTexelSize), (int)m_uTexels - 1);
+
+   float fMoveX = getx(a_vMoveDir);
+   float fMoveZ = getz(a_vMoveDir);
+   float fMoveLen = sqrtf(fMoveX * fMoveX + fMoveZ * fMoveZ);
+   if (fMoveLen > 0.0001f)
+   {
+      fMoveX /= fMoveLen;
+      fMoveZ /= fMoveLen;
+   }
+
+   for (int y = iMinY; y <= iMaxY; y++)
+   {
+      for (int x = iMinX; x <= iMaxX; x++)
+      {
+         float fDX = (x + 0.5f) * m_fTexelSize - m_fTerrRadius - fPosX;
+         float fDZ = (y + 0.5f) * m_fTexelSize - m_fTerrRadius - fPosZ;
+         float fDist = sqrtf(fDX * fDX + fDZ * fDZ);
+         if (fDist >= a_fRadius)
+            continue;
+
+         /* pressed along the motion and away from the center, flat in the middle */
+         float fDirX = fMoveX, fDirZ = fMoveZ;
+         if (fDist > 0.0001f)
+         {
+            fDirX += 0.5f * fDX / fDist;
+            fDirZ += 0.5f * fDZ / fDist;
+         }
+         float fDirLen = sqrtf(fDirX * fDirX + fDirZ * fDirZ);
+         if (fDirLen < 0.0001f)
+            continue;
+         float fAmount = min(2.0f * (1.0f - fDist / a_fRadius), 1.0f) * TRAMPLE_MAX;
+
+         Tile* pTile = GetTile(x / TRAMPLE_TILE, y / TRAMPLE_TILE, true);
+         INT8* pTexel = pTile->Texels + ((y % TRAMPLE_TILE) * TRAMPLE_TILE + (x % TRAMPLE_TILE)) * 2;
+         float fOld = sqrtf((float)(pTexel[0] * pTexel[0] + pTexel[1] * pTexel[1]));
+         if (fAmount <= fOld)
+            continue;
+
+         INT8 iX = (INT8)floorf(fDirX / fDirLen * fAmount + 0.5f);
+         INT8 iZ = (INT8)floorf(fDirZ / fDirLen * fAmount + 0.5f);
+         if (iX == pTexel[0] && iZ == pTexel[1])
+            continue;
+         pTexel[0] = iX;
+         pTexel[1] = iZ;
+         pTile->bDirty = true;
+         pTile->bRecovered = false;
+      }
+   }
+}
+
+
+void TrampleField::Update(float a_fElapsedTime)
+{
+   /* whole steps of one texel unit, the rest is carried to the next frame */
+   m_fRecoverAccum += a_fElapsedTime;
+   float fUnitTime = m_fRecoveryTime / TRAMPLE_MAX;
+   float fSteps = floorf(m_fRecoverAccum / fUnitTime);
+   if (fSteps < 1.0f)
+      return;
+   m_fRecoverAccum -= fSteps * fUnitTime;
+
+   for (size_t t = 0; t < m_Tiles.size(); t++)
+   {
+      Tile* pTile = m_Tiles[t];
+      if (pTile == NULL || pTile->bRecovered)
+         continue;
+
+      bool bPressed = false;
+      bool bChanged = false;
+      for (UINT i = 0; i < TRAMPLE_TILE * TRAMPLE_TILE; i++)
+      {
+         INT8* pTexel = pTile->Texels + i * 2;
+         if (pTexel[0] == 0 && pTexel[1] == 0)
+            continue;
+
+         float fOld = sqrtf((float)(pTexel[0] * pTexel[0] + pTexel[1] * pTexel[1]));
+         float fScale = max(fOld - fSteps, 0.0f) / fOld;
+         INT8 iX = (INT8)floorf(pTexel[0] * fScale + 0.5f);
+         INT8 iZ = (INT8)floorf(pTexel[1] * fScale + 0.5f);
+         bChanged |= (iX != pTexel[0] || iZ != pTexel[1]);
+         pTexel[0] = iX;
+         pTexel[1] = iZ;
+         bPressed |= (iX != 0 || iZ != 0);
+      }
+      /* only a tile with a changed texel is uploaded again */
+      pTile->bDirty |= bChanged;
+      pTile->bRecovered = !bPressed;
+   }
+}
+
+
+void TrampleField::Upload(void)
+{
+   for (UINT uTileY = 0; uTileY < m_uTiles; uTileY++)
+   {
+      for (UINT uTileX = 0; uTileX < m_uTiles; uTileX++)
+      {
+         Tile*& pTile = m_Tiles[uTileY * m_uTiles + uTileX];
+         if (pTile == NULL)
+            continue;
+
+         if (pTile->bDirty && m_pTrampleTex)
+         {
+            D3D11_BOX Box;
+            Box.left   = uTileX * TRAMPLE_TILE;
+            Box.right  = Box.left + TRAMPLE_TILE;
+            Box.top    = uTileY * TRAMPLE_TILE;
+            Box.bottom = Box.top + TRAMPLE_TILE;
+            Box.front  = 0;
+            Box.back   = 1;
+            m_pD3DDeviceCtx->UpdateSubresource(m_pTrampleTex, 0, &Box, pTile->Texels, TRAMPLE_TILE * 2, 0);
+         }
+         pTile->bDirty = false;
+
+         if (pTile->bRecovered)
+         {
+            delete pTile;
+            pTile = NULL;
+            m_uNumTiles--;
+         }
+      }
+   }
+}
+
+
+void TrampleField::TexelBend(int a_iX, int a_iY, float& a_fX, float& a_fZ) const
+{
+   a_iX = min(max(a_iX, 0), (int)m_uTexels - 1);
+   a_iY = min(max(a_iY, 0), (int)m_uTexels - 1);
+   const Tile* pTile = m_Tiles[(a_iY / TRAMPLE_TILE) * m_uTiles + a_iX / TRAMPLE_TILE];
+   if (pTile == NULL)
+   {
+      a_fX = a_fZ = 0.0f;
+      return;
+   }
+   const INT8* pTexel = pTile->Texels + ((a_iY % TRAMPLE_TILE) * TRAMPLE_TILE + (a_iX % TRAMPLE_TILE)) * 2;
+   a_fX = pTexel[0] / TRAMPLE_MAX;
+   a_fZ = pTexel[1] / TRAMPLE_MAX;
+}
+
+
+float3 TrampleField::Sample(float a_fX, float a_fZ) const
+{
+   /* bilinear, between the texel centers */
+   float fX = (a_fX + m_fTerrRadius) / m_fTexelSize - 0.5f;
+   float fY = (a_fZ + m_fTerrRadius) / m_fTexelSize - 0.5f;
+   int iX = (int)floorf(fX);
+   int iY = (int)floorf(fY);
+   float fFracX = fX - iX;
+   float fFracY = fY - iY;
+
+   float fLLX, fLLZ, fLRX, fLRZ, fHLX, fHLZ, fHRX, fHRZ;
+   TexelBend(iX, iY, fLLX, fLLZ);
+   TexelBend(iX + 1, iY, fLRX, fLRZ);
+   TexelBend(iX, iY + 1, fHLX, fHLZ);
+   TexelBend(iX + 1, iY + 1, fHRX, fHRZ);
+
+   float fBendX = ((1.0f - fFracX) * fLLX + fFracX * fLRX) * (1.0f - fFracY) + ((1.0f - fFracX) * fHLX + fFracX * fHRX) * fFracY;
+   float fBendZ = ((1.0f - fFracX) * fLLZ + fFracX * fLRZ) * (1.0f - fFracY) + ((1.0f - fFracX) * fHLZ + fFracX * fHRZ) * fFracY;
+   return create(fBendX, 0.0f, fBendZ);
+}
+
+
+void TrampleField::SetRecoveryTime(float a_fSeconds)
+{
+   m_fRecoveryTime = max(a_fSeconds, 0.001f);
+}
+
+
+float TrampleField::UVScale(void) const
+{
+   return 2.0f * m_fTerrRadius / (m_uTexels * m_fTexelSize);
+}
+
+
+size_t TrampleField::MemoryBytes(void) const
+{
+   return m_uNumTiles * sizeof(Tile) + m_Tiles.size() * sizeof(Tile*);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "includes.h"
+
+#include <vector>
+
+/* texels per tile side */
+#define TRAMPLE_TILE 32
+
+/**
+World-space trample and bend field over the whole terrain.
+A texel is the horizontal direction the grass is pressed to, scaled by how hard,
+in two signed bytes. Tiles are allocated when a collider first touches them and
+freed when they have recovered, only tiles changed since the last Upload are sent
+to the texture, which the animated grass samples in terrain uv.
+*/
+class TrampleField
+{
+public:
+   /**
+   param a_fTerrRadius half size of the terrain, the field covers [-a_fTerrRadius, a_fTerrRadius] in x and z
+   param a_fTexelSize texel side in meters
+   */
+   TrampleField(ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx, float a_fTerrRadius, float a_fTexelSize);
+   ~TrampleField(void);
+
+   /**
+   Presses the grass under a collider
+   param a_vPos collider center, only x and z are used
+   param a_fRadius collider radius on the ground
+   param a_vMoveDir collider velocity direction, the grass is pressed along it and away from the center
+   */
+   void Stamp(const float3& a_vPos, float a_fRadius, const float3& a_vMoveDir);
+
+   /**
+   Lets the grass recover, a fully pressed texel is back up after the recovery time
+   */
+   void Update(float a_fElapsedTime);
+
+   /**
+   Copies the dirty tiles to the texture and frees the recovered ones
+   */
+   void Upload(void);
+
+   /**
+   return bend of the grass at x, z: direction times amount in [0, 1], y is 0
+   */
+   float3 Sample(float a_fX, float a_fZ) const;
+
+   void   SetRecoveryTime(float a_fSeconds);
+   size_t MemoryBytes(void) const;
+
+   /**
+   return factor from terrain uv to texture uv, the texture is rounded up to whole tiles
+   */
+   float  UVScale(void) const;
+
+   ID3D11ShaderResourceView* GetSRV(void)
+   {
+      return m_pTrampleSRV;
+   }
+
+private:
+   struct Tile
+   {
+      INT8 Texels[TRAMPLE_TILE * TRAMPLE_TILE * 2];  /* R8G8_SNORM */
+      /* a texel changed since the last Upload */
+      bool bDirty;
+      /* all texels are zero, the tile is freed after its upload */
+      bool bRecovered;
+   };
+
+   TrampleField(const TrampleField&);
+   TrampleField& operator = (const TrampleField&);
+
+   Tile* GetTile(UINT a_uTileX, UINT a_uTileY, bool a_bCreate);
+   void  TexelBend(int a_iX, int a_iY, float& a_fX, float& a_fZ) const;
+
+   ID3D11Device*             m_pD3DDevice;
+   ID3D11DeviceContext*      m_pD3DDeviceCtx;
+   ID3D11Texture2D*          m_pTrampleTex;
+   ID3D11ShaderResourceView* m_pTrampleSRV;
+
+   float m_fTerrRadius;
+   float m_fTexelSize;
+   UINT  m_uTexels;       /* texels per field side */
+   UINT  m_uTiles;        /* tiles per field side */
+   std::vector<Tile*> m_Tiles;
+   UINT  m_uNumTiles;     /* allocated */
+
+   float m_fRecoveryTime;
+   /* time not yet turned into a recovery step */
+   float m_fRecoverAccum;
+};
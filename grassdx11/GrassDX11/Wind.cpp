@@ -1,116 +1,183 @@
 #include "Wind.h"
 #include "PhysMath.h"
+#include "BilinearGrid.h"
 
 #include <DDSTextureLoader.h>
 
-// TODO: move to other place to share (if axes fan need this)
-#define NUM_SEGMENTS 4
-
-#define TEX_W 32
-#define TEX_H 32
-
-static float SegLen = 0.75f;
-static float SegHard[3] = { 0.06f, 0.06f, 0.06f };
-static float SegMass = 0.01f;
 static float ClearColor[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
 
-static float3    fmW[TEX_W * TEX_H][NUM_SEGMENTS - 1];
-static float3    fmA[TEX_W * TEX_H][NUM_SEGMENTS - 1];
-static XMMATRIX  mT[TEX_W * TEX_H][NUM_SEGMENTS - 1];
-static XMMATRIX  mR[TEX_W * TEX_H][NUM_SEGMENTS - 1];
-
-static float fTexOffsets[2] = { 0.0f, 0.0f };
-static float fTexOffsetKoefs[2] = { 0.02f, 0.03f };
-static int   Start = 1;
+static const float fTexOffsetKoefs[2] = { 0.02f, 0.03f };
+static const float TimeCont[4] = { 4.0f, 1.0f, 5.0f, 1.0f };
 
 
 WindData::WindData(void)
 {
-   pData = NULL;
    pWindMapData = NULL;
-
-   for (int i = 0; i < TEX_H; i++)
-      for (int j = 0; j < TEX_W; j++)
-         for (int k = 0; k < NUM_SEGMENTS - 1; k++)
-         {
-            mT[i * TEX_W + j][k] = XMMatrixIdentity();
-            mR[i * TEX_W + j][k] = XMMatrixIdentity();
-         }
+   uMapHeight = uMapWidth = 0;
+   fMapHeight = fMapWidth = 0.0f;
+   uHeight = uWidth = 0;
+   fHeight = fWidth = 0.0f;
+   fWindSpeed = 0.0f;
+   pJobScheduler = NULL;
+   m_uFront = 0;
+   m_fBlend = 1.0f;
+   m_uCopiedFront = 3;
+   m_fSolvePeriod = 0.0f;
+   m_fSolveClock = 0.0f;
+   m_fSolveStep = 0.0f;
+   m_uSolveBegin = m_uSolveEnd = 0;
+   m_bSpectral = false;
+
+   m_fTexOffsets[0] = m_fTexOffsets[1] = 0.0f;
+   m_iGustState = 0;
+   m_fGustTime = 0.0f;
+   m_fGustBound = TimeCont[0];
+   m_fGustFull = m_fGustT = m_fGustT1 = 0.0f;
+   m_fDamp = 1.0f;
+   m_vWaveW = XMFLOAT3(0.0f, 0.0f, 0.0f);
 }
 
 
 WindData::~WindData(void)
 {
-   if (pData)
-      delete[] pData;
    if (pWindMapData)
       delete[] pWindMapData;
 }
 
 
-XMVECTOR WindData::GetValue(const XMVECTOR& a_vTexCoord, const float a_fWindTexTile) const
+void WindData::Resize(UINT a_uWidth, UINT a_uHeight)
 {
-   float fX = (getx(a_vTexCoord) * a_fWindTexTile);
-   float fY = (gety(a_vTexCoord) * a_fWindTexTile);
-   /* bilinear interpolation... */
-   fX = (fX - floorf(fX)) * (float)fWidth - 0.5f;
-   fY = (fY - floorf(fY)) * (float)fWidth - 0.5f;
-   float fFracX = fX - floorf(fX);
-   float fFracY = fY - floorf(fY);
-   UINT uLX = UINT(fX);
-   UINT uHX = uLX + 1;
-   UINT uLY = UINT(fY);
-   UINT uHY = uLY + 1;
-   if (uHX > uWidth - 1)
-      uHX = uWidth - 1;
-   if (uHY > uHeight - 1)
-      uHY = uHeight - 1;
+   uWidth = a_uWidth;
+   uHeight = a_uHeight;
+   fWidth = (float)uWidth;
+   fHeight = (float)uHeight;
+   m_Pendulum.Resize(uWidth, uHeight);
+
+   for (int f = 0; f < 3; f++)
+   {
+      m_Frames[f].vWind.assign(uWidth * uHeight, XMFLOAT3(0.0f, 0.0f, 0.0f));
+      for (int j = 0; j < WIND_SEGMENTS; j++)
+         m_Frames[f].vA[j].assign(uWidth * uHeight, XMFLOAT3(0.0f, 0.0f, 0.0f));
+   }
+   m_Texels.resize(WIND_SEGMENTS * 4 * uWidth * uHeight);
+   m_uCopiedFront = 3;
+
+   /* the solve starts over from the pendulums at rest */
+   m_fBlend = 1.0f;
+   m_fSolveClock = 0.0f;
+   m_uSolveBegin = m_uSolveEnd = 0;
+}
+
 
-   XMFLOAT3 fLL = vWindData[uWidth * uLY + uLX];
-   XMFLOAT3 fHL = vWindData[uWidth * uHY + uLX];
-   XMFLOAT3 fLR = vWindData[uWidth * uLY + uHX];
-   XMFLOAT3 fHR = vWindData[uWidth * uHY + uHX];
+void WindData::SetSolvePeriod(float a_fPeriod)
+{
+   m_fSolvePeriod = max(a_fPeriod, 0.0f);
+   m_fSolveClock = 0.0f;
+}
 
-   XM_TO_V(fLL, v_fLL, 3);
-   XM_TO_V(fHL, v_fHL, 3);
-   XM_TO_V(fLR, v_fLR, 3);
-   XM_TO_V(fHR, v_fHR, 3);
 
-   return ((1.0f - fFracX) * v_fLL + fFracX * v_fLR) * (1.0f - fFracY) +
-      fFracY * ((1.0f - fFracX) * v_fHL + fFracX * v_fHR);
+void WindData::SetSpectrum(const WindSpectrumDesc* a_pDesc)
+{
+   m_bSpectral = (a_pDesc != NULL);
+   if (m_bSpectral)
+      m_Spectrum.Init(*a_pDesc);
+}
+
+
+bool WindData::Advance(float a_fElapsed)
+{
+   if (m_fSolvePeriod <= 0.0f)
+   {
+      m_fSolveStep = min(a_fElapsed, WIND_MAX_STEP);
+      m_uSolveEnd = uHeight;
+      m_fBlend = 1.0f;
+      return true;
+   }
+
+   m_fSolveStep = m_fSolvePeriod;
+   m_fSolveClock += a_fElapsed;
+   if (m_fSolveClock >= m_fSolvePeriod)
+   {
+      /* the back frame is due: its remaining rows now, the periods missed by a long frame are dropped */
+      m_fSolveClock = fmodf(m_fSolveClock, m_fSolvePeriod);
+      m_uSolveEnd = uHeight;
+      m_fBlend = 1.0f;
+      return true;
+   }
+
+   /* the rows are solved in proportion to the period passed */
+   m_fBlend = m_fSolveClock / m_fSolvePeriod;
+   m_uSolveEnd = max(m_uSolveEnd, min((UINT)(m_fBlend * fHeight), uHeight));
+   return false;
+}
+
+
+void WindData::Publish(void)
+{
+   m_uFront.store((m_uFront.load(std::memory_order_relaxed) + 1) % 3, std::memory_order_release);
+   m_uSolveBegin = m_uSolveEnd = 0;
+
+   /* the new frame before the last is what the readers have just seen */
+   if (m_fSolvePeriod > 0.0f)
+      m_fBlend = 0.0f;
+}
+
+
+XMVECTOR WindData::Sample(int a_iGrid, const float a_fWindTexTile, float a_fX, float a_fY) const
+{
+   UINT uLast = m_uFront.load(std::memory_order_acquire);
+   XMVECTOR v = SampleBilinear(m_Frames[uLast].Grid(a_iGrid), uWidth, uHeight, a_fWindTexTile, a_fX, a_fY);
+   if (m_fBlend < 1.0f)
+      v = XMVectorLerp(SampleBilinear(m_Frames[(uLast + 2) % 3].Grid(a_iGrid), uWidth, uHeight, a_fWindTexTile, a_fX, a_fY), v, m_fBlend);
+   return v;
+}
+
+
+void WindData::SampleBatch(int a_iGrid, const float a_fWindTexTile, const float* a_pX, const float* a_pY, UINT a_uCount, XMVECTOR* a_pOut) const
+{
+   UINT uLast = m_uFront.load(std::memory_order_acquire);
+   SampleBilinearBatch(m_Frames[uLast].Grid(a_iGrid), uWidth, uHeight, a_fWindTexTile, a_pX, a_pY, a_uCount, a_pOut);
+   if (m_fBlend >= 1.0f)
+      return;
+
+   const XMFLOAT3* pPrev = m_Frames[(uLast + 2) % 3].Grid(a_iGrid);
+   XMVECTOR vBlend = XMVectorReplicate(m_fBlend);
+   XMVECTOR vPrev[64];
+   for (UINT i = 0; i < a_uCount; i += 64)
+   {
+      UINT uCount = min(a_uCount - i, 64u);
+      SampleBilinearBatch(pPrev, uWidth, uHeight, a_fWindTexTile, a_pX + i, a_pY + i, uCount, vPrev);
+      for (UINT k = 0; k < uCount; k++)
+         a_pOut[i + k] = XMVectorLerpV(vPrev[k], a_pOut[i + k], vBlend);
+   }
+}
+
+
+XMVECTOR WindData::GetValue(const XMVECTOR& a_vTexCoord, const float a_fWindTexTile) const
+{
+   return Sample(-1, a_fWindTexTile, getx(a_vTexCoord), gety(a_vTexCoord));
 }
 
 
 XMVECTOR WindData::GetValueA(const XMVECTOR& a_vTexCoord, const float a_fWindTexTile, int a_iSegmentIndex) const
 {
-   float fX = (getx(a_vTexCoord) * a_fWindTexTile);
-   float fY = (gety(a_vTexCoord) * a_fWindTexTile);
+   return Sample(a_iSegmentIndex, a_fWindTexTile, getx(a_vTexCoord), gety(a_vTexCoord));
+}
 
-   /* bilinear interpolation... */
-   fX = (fX - floorf(fX)) * (float)fWidth - 0.5f;
-   fY = (fY - floorf(fY)) * (float)fWidth - 0.5f;
-   float fFracX = fX - floorf(fX);
-   float fFracY = fY - floorf(fY);
-   UINT uLX = UINT(fX);
-   UINT uHX = uLX + 1;
-   UINT uLY = UINT(fY);
-   UINT uHY = uLY + 1;
-   if (uHX > uWidth - 1)
-      uHX = uWidth - 1;
-   if (uHY > uHeight - 1)
-      uHY = uHeight - 1;
 
-   const XMVECTOR& v_fLL = fmA[uWidth * uLY + uLX][a_iSegmentIndex];
-   const XMVECTOR& v_fHL = fmA[uWidth * uHY + uLX][a_iSegmentIndex];
-   const XMVECTOR& v_fLR = fmA[uWidth * uLY + uHX][a_iSegmentIndex];
-   const XMVECTOR& v_fHR = fmA[uWidth * uHY + uHX][a_iSegmentIndex];
+void WindData::GetValues(const float* a_pX, const float* a_pY, UINT a_uCount, const float a_fWindTexTile, XMVECTOR* a_pOut) const
+{
+   SampleBatch(-1, a_fWindTexTile, a_pX, a_pY, a_uCount, a_pOut);
+}
 
-   return ((1.0f - fFracX) * v_fLL + fFracX * v_fLR) * (1.0f - fFracY) +
-      fFracY * ((1.0f - fFracX) * v_fHL + fFracX * v_fHR);
+
+void WindData::GetValuesA(const float* a_pX, const float* a_pY, UINT a_uCount, const float a_fWindTexTile, int a_iSegmentIndex, XMVECTOR* a_pOut) const
+{
+   SampleBatch(a_iSegmentIndex, a_fWindTexTile, a_pX, a_pY, a_uCount, a_pOut);
 }
 
 
-float WindData::BiLinear(const XMVECTOR& a_vTexCoord)
+float WindData::BiLinear(const XMVECTOR& a_vTexCoord) const
 {
    XMVECTOR vTexCoord = a_vTexCoord;
 
@@ -119,27 +186,27 @@ float WindData::BiLinear(const XMVECTOR& a_vTexCoord)
    if (gety(vTexCoord) < 0.0)
       sety(vTexCoord, gety(vTexCoord) - floorf(gety(vTexCoord)));
 
-   float fX = (getx(vTexCoord) * (fWidth - 1.0f));
-   float fY = (gety(vTexCoord) * (fHeight - 1.0f));
+   float fX = (getx(vTexCoord) * (fMapWidth - 1.0f));
+   float fY = (gety(vTexCoord) * (fMapHeight - 1.0f));
 
    // bilinear interpolation... 
    float fFloorX = floor(fX);
    float fFloorY = floor(fY);
-   UINT uLX = ((UINT)fX) % uWidth;
+   UINT uLX = ((UINT)fX) % uMapWidth;
    UINT uHX = uLX + 1;
-   UINT uLY = ((UINT)fY) % uHeight;
+   UINT uLY = ((UINT)fY) % uMapHeight;
    UINT uHY = uLY + 1;
    float fFracX = fX - fFloorX;
    float fFracY = fY - fFloorY;
-   if (uHX > uWidth - 1)
-      uHX = uWidth - 1;
-   if (uHY > uHeight - 1)
-      uHY = uHeight - 1;
+   if (uHX > uMapWidth - 1)
+      uHX = uMapWidth - 1;
+   if (uHY > uMapHeight - 1)
+      uHY = uMapHeight - 1;
 
-   float fLL = pWindMapData[uWidth * uLY + uLX].w;
-   float fHL = pWindMapData[uWidth * uHY + uLX].w;
-   float fLR = pWindMapData[uWidth * uLY + uHX].w;
-   float fHR = pWindMapData[uWidth * uHY + uHX].w;
+   float fLL = pWindMapData[uMapWidth * uLY + uLX].w;
+   float fHL = pWindMapData[uMapWidth * uHY + uLX].w;
+   float fLR = pWindMapData[uMapWidth * uLY + uHX].w;
+   float fHR = pWindMapData[uMapWidth * uHY + uHX].w;
 
    return ((1.0f - fFracX) * fLL + fFracX * fLR) * (1.0f - fFracY) +
       fFracY * ((1.0f - fFracX) * fHL + fFracX * fHR);
@@ -170,15 +237,17 @@ XMVECTOR WindData::GetWindValueA(const XMVECTOR& a_vTexCoord, const float a_fWin
 void WindData::ConvertFrom(const D3D11_MAPPED_SUBRESOURCE& a_MappedTex, const D3D11_TEXTURE2D_DESC& a_TexDesc)
 {
    float* pTexels = (float*)a_MappedTex.pData;
-   if (pData == NULL)
+   if (pWindMapData == NULL)
    {
-      pData = new XMFLOAT3[a_TexDesc.Height * a_TexDesc.Width];
       pWindMapData = new XMFLOAT4[a_TexDesc.Height * a_TexDesc.Width];
-      uHeight = a_TexDesc.Height;
-      uWidth = a_TexDesc.Width;
-      fHeight = (float)uHeight;
-      fWidth = (float)uWidth;
+      uMapHeight = a_TexDesc.Height;
+      uMapWidth = a_TexDesc.Width;
+      fMapHeight = (float)uMapHeight;
+      fMapWidth = (float)uMapWidth;
    }
+   /* the wind grid matches the map until it is resized */
+   if (uWidth == 0)
+      Resize(uMapWidth, uMapHeight);
 
    for (UINT row = 0; row < a_TexDesc.Height; row++)
    {
@@ -195,61 +264,50 @@ void WindData::ConvertFrom(const D3D11_MAPPED_SUBRESOURCE& a_MappedTex, const D3
 }
 
 
-void WindData::WindCopy(ID3D11Texture2D* a_pDestTex, ID3D11DeviceContext* a_pDeviceCtx)
+bool WindData::StageTexels(void)
 {
-   float row_pitch = 4 * sizeof(float) * TEX_W;
-   static float pTexels[TEX_W * TEX_H * 4];
-   float fMass = 0.23f;
-   float fLseg = 0.6f;
-   float3 fa;
-   D3D11_BOX dest_region;
+   UINT uLast = m_uFront.load(std::memory_order_relaxed);
+   if (uLast == m_uCopiedFront)
+      return false;
+   m_uCopiedFront = uLast;
 
-   dest_region.left = 0;
-   dest_region.right = TEX_W;
-   dest_region.top = 0;
-   dest_region.bottom = TEX_H;
-   dest_region.front = 0;
-   dest_region.back = 1;
-
-   for (int segment = 0; segment < NUM_SEGMENTS - 1; segment++)
+   const Frame& last = m_Frames[uLast];
+   for (int segment = 0; segment < WIND_SEGMENTS; segment++)
    {
-      for (UINT row = 0; row < TEX_H; row++)
-      {
-         UINT rowStart = (UINT)(row * row_pitch / sizeof(float));
+      float* pTexels = &m_Texels[segment * 4 * uWidth * uHeight];
+      for (UINT texel = 0; texel < uWidth * uHeight; texel++)
+         XMStoreFloat4((XMFLOAT4*)&pTexels[texel * 4], XMVectorSetW(XMLoadFloat3(&last.vA[segment][texel]), 1.0f));//RGBA
+   }
+   return true;
+}
 
-         for (UINT col = 0; col < TEX_W; col++)
-         {
-            UINT colStart = col * 4;//RGBA
 
-            float3 vec1 = MakeRotationVector(mR[row * TEX_W + col][segment]);
-            float3 vec2 = MakeRotationVector(mT[row * TEX_W + col][segment]);
-            float3 halfAxis = create(0.0f, SegLen * 0.5f, 0.0f);
+const float* WindData::StagedTexels(int a_iSegment) const
+{
+   return &m_Texels[a_iSegment * 4 * uWidth * uHeight];
+}
 
-            float3 mg = scale(SegMass, create(0, -9.8f, 0));
 
-            if (segment >= 1) {
-               mg = XMVector3TransformCoord(mg, mT[row * TEX_W + col][segment - 1]);
-            }
-            mg = XMVector3Cross(halfAxis, mg);
-            XMVECTOR w = SegHard[segment] * vec1 - mg;
+float WindData::Blend(void) const
+{
+   return m_fBlend;
+}
 
-            if (segment >= 1)
-            {
-               XMMATRIX transposed = XMMatrixTranspose(mT[row * TEX_W + col][segment - 1]);
-               w = XMVector3TransformCoord(w, transposed);
-            }
 
-            pTexels[rowStart + colStart + 0] = XMVectorGetX(w);
-            pTexels[rowStart + colStart + 1] = XMVectorGetY(w);
-            pTexels[rowStart + colStart + 2] = XMVectorGetZ(w);
-            pTexels[rowStart + colStart + 3] = 1.0f;
+void WindData::WindCopy(ID3D11Texture2D* a_pDestTex, ID3D11DeviceContext* a_pDeviceCtx)
+{
+   float row_pitch = 4 * sizeof(float) * uWidth;
+   D3D11_BOX dest_region;
 
-            fmA[row * TEX_W + col][segment] = create(XMVectorGetX(w), XMVectorGetY(w), XMVectorGetZ(w));
-         }
-      }
+   dest_region.left = 0;
+   dest_region.right = uWidth;
+   dest_region.top = 0;
+   dest_region.bottom = uHeight;
+   dest_region.front = 0;
+   dest_region.back = 1;
 
-      a_pDeviceCtx->UpdateSubresource(a_pDestTex, D3D11CalcSubresource(0, segment, 1), &dest_region, (const void*)pTexels, (UINT)row_pitch, 0);
-   }
+   for (int segment = 0; segment < WIND_SEGMENTS; segment++)
+      a_pDeviceCtx->UpdateSubresource(a_pDestTex, D3D11CalcSubresource(0, segment, 1), &dest_region, (const void*)StagedTexels(segment), (UINT)row_pitch, 0);
 }
 
 
@@ -316,208 +374,164 @@ float3 GetWaveW(XMVECTOR vCamDir)
 }
 
 
-static void CalcTR(float3x3& Tres, float3x3& Rres, float3x3& T, float3x3& T_1, float3x3& R, float3& psi)
+void WindData::UpdateWindTex(XMVECTOR a_vCamDir)
 {
-   Rres = XMMatrixMultiply(R, MakeRotationMatrix(psi));
-   Tres = XMMatrixMultiply(T_1, Rres);
-}
-
-
-static XMVECTOR GetDw(XMMATRIX& T, XMMATRIX& R, XMVECTOR& fw, XMVECTOR& sum, XMVECTOR& w, float invJ, float segmentHeight, float Hardness, int j)
-{
-   XMVECTOR localSum, g, m_f;
-   XMVECTOR halfAxis(create(0.0f, segmentHeight * 0.5f, 0.0f));
-
-   localSum = XMVector3TransformCoord(sum, T);
-   m_f = XMVector3Cross(halfAxis, localSum);
-   g = Hardness * MakeRotationVector(R);
+   if (m_uSolveBegin >= m_uSolveEnd)
+      return;
 
-   return (m_f - g) * invJ;
-}
+   /* the frame time or the solve period, whole: the gusts keep pace with the solve clock */
+   float fElapsed = m_fSolveStep;
 
-
-static float3 GetVel(float3x3& T, float3& w, float segmentHeight)
-{
-   float3 halfAxis = create(0.0f, segmentHeight * 0.5f, 0.0f), r;
-   float3x3 transposed_t;
-   transposed_t = XMMatrixTranspose(T);
-   r = XMVector3Cross(w, halfAxis);
-   r = XMVector3TransformCoord(r, transposed_t);
-   return r;
-}
-
-
-static int   State = 0;
-static float maxW = 0.0f;
-static float TimeCont[4] = { 4.0f, 1.0f, 5.0f, 1.0f };
-static float CurTime = 0.f;
-static float Bound = TimeCont[0];
-
-
-void WindData::UpdateWindTex(float a_fElapsed, XMVECTOR a_vCamDir)
-{
-   //    const GrassPropsUnified &props = grassProps[0];
-   if (a_fElapsed >= 0.1f)
-      a_fElapsed = 0.1f;
-
-
-   CurTime += a_fElapsed;
-   if (CurTime > Bound)
+   /* the gusts move once per frame, with its first rows */
+   if (m_uSolveBegin == 0)
    {
-      State++;
-      if (State == 4)
+      m_fGustTime += fElapsed;
+      if (m_fGustTime > m_fGustBound)
       {
-         State = 0;
-         Bound = 0.f;
-         CurTime = 0.f;
+         m_iGustState++;
+         if (m_iGustState == 4)
+         {
+            m_iGustState = 0;
+            m_fGustBound = 0.f;
+            m_fGustTime = 0.f;
+         }
+         m_fGustBound += TimeCont[m_iGustState];
+      }
+      switch (m_iGustState) {
+      case 0: m_fGustFull = 0.1f; break;
+      case 1: m_fGustFull = (m_fGustTime - TimeCont[0]) / TimeCont[1]; break;
+      case 2: m_fGustFull = 1.f; break;
+      case 3: m_fGustFull = 1.f - (m_fGustTime - (TimeCont[0] + TimeCont[1] + TimeCont[2])) / TimeCont[3]; break;
+      default:
+         m_fGustFull = 0.f; break;
       }
-      Bound += TimeCont[State];
-   }
-   float fTFull;
-   switch (State) {
-   case 0: fTFull = 0.1f; break;
-   case 1: fTFull = (CurTime - TimeCont[0]) / TimeCont[1]; break;
-   case 2: fTFull = 1.f; break;
-   case 3: fTFull = 1.f - (CurTime - (TimeCont[0] + TimeCont[1] + TimeCont[2])) / TimeCont[3]; break;
-   default:
-      fTFull = 0.f; break;
-   }
 
+      m_fDamp = powf(0.98f, fElapsed * 0.01f);
+      if (m_fDamp > 0.9998f) m_fDamp = 0.9998f;
 
-   float3 faRes[3];
-   float2 vTexCoord = create(0, 0, 0);
-   XMFLOAT2 vUV;
-   XMFLOAT4 vWind;
-   float2 fPixHeight;
-   float3 fw, fa, fw1, fa1;
-   float d = powf(0.98f, a_fElapsed * 0.01f);
-   if (d > 0.9998f) d = 0.9998f;
-   float fDt = 0.05f;
-   float fMass = 0.245f * 0.8f;//0.23f;
-   float fLseg = 0.75f;//0.6f;
-   float fJ_1 = 0.75f * 1.0f / (0.33f * SegMass * SegLen * SegLen);
-   float4 vRotate45 = create(0.7071f, 0.7071f, -0.7071f, 0.7071f);
-   float4 vRotate315 = create(0.7071f, -0.7071f, 0.7071f, 0.7071f);
+      XMStoreFloat3(&m_vWaveW, GetWaveW(a_vCamDir));
+      for (int i = 0; i < 2; i++)
+      {
+         m_fTexOffsets[i] -= fElapsed * fTexOffsetKoefs[i] * fWindSpeed;
+      }
 
-   float3 vWaveW = GetWaveW(a_vCamDir);
-   for (int i = 0; i < 2; i++)
-   {
-      fTexOffsets[i] -= a_fElapsed * fTexOffsetKoefs[i] * *pWindSpeed;
+      m_fGustT = 0.5f + 0.5f * sinf(4.0f * m_fTexOffsets[0]);
+      m_fGustT1 = 0.5f + 0.5f * sinf(7.5f * m_fTexOffsets[0]);
+
+      /* the spectral gusts drift at the scroll speed of the gradient map */
+      if (m_bSpectral)
+         m_Spectrum.Step(fElapsed, fWindSpeed * fTexOffsetKoefs[0], pJobScheduler);
    }
 
-   float fT = 0.5f + 0.5f * sinf(4.0f * fTexOffsets[0]);
-   float fT1 = 0.5f + 0.5f * sinf(7.5f * fTexOffsets[0]);
-   float height[3];
+   float fTFull = m_fGustFull;
+   float fT = m_fGustT;
+   float fT1 = m_fGustT1;
+   float d = m_fDamp;
+   float3 vWaveW = XMLoadFloat3(&m_vWaveW);
+   float4 vRotate45 = create(0.7071f, 0.7071f, -0.7071f, 0.7071f);
+
+   float* pWindX = m_Pendulum.Stream(WindPendulum::S_WIND);
+   float* pWindZ = m_Pendulum.Stream(WindPendulum::S_WIND + 1);
+   UINT uRowStride = m_Pendulum.RowStride();
+   Frame& back = m_Frames[(m_uFront.load(std::memory_order_relaxed) + 1) % 3];
 
-   for (UINT row = 0; row < uHeight; row++)
+   /* every job samples the wind of its rows and swings their pendulums */
+   auto UpdateRows = [&](UINT a_uBegin, UINT a_uEnd)
    {
-      sety(vTexCoord, float(row) / (fHeight - 1.0f));;
+      float2 vTexCoord = create(0, 0, 0);
+      float2 fPixHeight;
+      float height[3];
 
-      for (UINT col = 0; col < uWidth; col++)
+      for (UINT row = a_uBegin; row < a_uEnd; row++)
       {
-         UINT colStart = col * 4;//RGBA
-         setx(vTexCoord, float(col) / (fWidth - 1.0f));;
-         float2 vUV = create(0, 0);
-
-         height[0] = height[1] = height[2] = 0.0f;
+         sety(vTexCoord, float(row) / (fHeight - 1.0f));;
 
-         if (getx(vWaveW) > 0.001f)
+         for (UINT col = 0; col < uWidth; col++)
          {
-            setx(vUV, getx(vTexCoord));;
-            sety(vUV, gety(vTexCoord));;
-            setx(vUV, getx(vUV) + 1.5f * fTexOffsets[0]);
-            height[0] = BiLinear(vUV);
-         }
-         if (gety(vWaveW) > 0.001)
-         {
-            vUV = 0.7071f * 2.0f * Transform(vTexCoord, vRotate45, fTexOffsets[1]);
-            setx(vUV, getx(vUV) + fTexOffsets[1]);
-            height[1] = BiLinear(vUV);
-         }
-         if (getz(vWaveW) > 0.001f)
-         {
-            setx(vUV, gety(vTexCoord));;
-            sety(vUV, -getx(vTexCoord));;
-            setx(vUV, getx(vUV) + 1.4f * fTexOffsets[0]);
-            height[2] = BiLinear(vUV);
-         }
-
-         fPixHeight = (0.9f * fT + 0.1f) * (create(1.0f, 0.0f) * (1.5f - fT1) * height[0] + create(1.0f, 1.0f) * (0.5f + fT1) * height[1]
-            + create(0.0f, 1.0f) * (1.5f - fT1) * height[2]);
-
-         float fDamp;
-         setx(vUV, getx(vTexCoord));;
-         sety(vUV, gety(vTexCoord));;
-         setx(vUV, getx(vUV) + 1.f * fTexOffsets[0]);
-         fDamp = BiLinear(vUV);
-         fDamp = fDamp * (1.f - fTFull) + fTFull;
-
-         fPixHeight *= 6.f * fDamp;
-         float fPixHmax = 6.f;
-         float fLen = sqrt(getx(fPixHeight) * getx(fPixHeight) + gety(fPixHeight) * gety(fPixHeight) + 0.0001f);
-         if (fLen > fPixHmax) fPixHeight = fPixHmax * fPixHeight / fLen;
-
-         float3 windBase, wind, vZ, v, r;
-         windBase = create(getx(fPixHeight), 0.0f, gety(fPixHeight));
-         vZ = create(0.0f, 0.0f, 0.0f);
-         float3 halfAxis = create(0.0f, SegLen * 0.5f, 0.0f);
-         for (int segment = 0; segment < NUM_SEGMENTS - 1; segment++)
-         {
-            UINT ind = row * uWidth + col;
-            float3 psi;
-            float3 g = create(0.0f, -9.8f, 0.0f);
-
-            r = GetVel(mT[ind][segment], fmW[ind][segment], SegLen);
-            v = vZ + r;
-            wind = 0.02f * (windBase - v);
-            // Calculate physics
-            float h = SegHard[segment];
-            //                float3 sum = g * SegMass * mT[ind][segment][5] + wind;
-            float3 sum = g * SegMass + wind;
-
-            float3 Dw = GetDw(mT[ind][segment], mR[ind][segment], fmW[ind][segment], sum, wind, fJ_1, SegLen, h, segment);
-            float3 w_ = fmW[ind][segment] + a_fElapsed * Dw;
-            psi = a_fElapsed * w_;
-
-            float3x3 Tres, Rres, T_1;
-            if (segment >= 1)
-               T_1 = mT[ind][segment - 1];
+            setx(vTexCoord, float(col) / (fWidth - 1.0f));;
+            if (m_bSpectral)
+            {
+               float fWindX, fWindZ;
+               m_Spectrum.Sample(getx(vTexCoord), gety(vTexCoord), fWindX, fWindZ);
+               fPixHeight = create(fWindX, fWindZ);
+            }
             else
-               T_1 = XMMatrixIdentity();
+            {
+               float2 vUV = create(0, 0);
+
+               height[0] = height[1] = height[2] = 0.0f;
+
+               if (getx(vWaveW) > 0.001f)
+               {
+                  setx(vUV, getx(vTexCoord));;
+                  sety(vUV, gety(vTexCoord));;
+                  setx(vUV, getx(vUV) + 1.5f * m_fTexOffsets[0]);
+                  height[0] = BiLinear(vUV);
+               }
+               if (gety(vWaveW) > 0.001)
+               {
+                  vUV = 0.7071f * 2.0f * Transform(vTexCoord, vRotate45, m_fTexOffsets[1]);
+                  setx(vUV, getx(vUV) + m_fTexOffsets[1]);
+                  height[1] = BiLinear(vUV);
+               }
+               if (getz(vWaveW) > 0.001f)
+               {
+                  setx(vUV, gety(vTexCoord));;
+                  sety(vUV, -getx(vTexCoord));;
+                  setx(vUV, getx(vUV) + 1.4f * m_fTexOffsets[0]);
+                  height[2] = BiLinear(vUV);
+               }
 
-            CalcTR(Tres, Rres, mT[ind][segment], T_1, mR[ind][segment], psi);
+               fPixHeight = (0.9f * fT + 0.1f) * (create(1.0f, 0.0f) * (1.5f - fT1) * height[0] + create(1.0f, 1.0f) * (0.5f + fT1) * height[1]
+                  + create(0.0f, 1.0f) * (1.5f - fT1) * height[2]);
 
-            r = GetVel(Tres, w_, SegLen);
-            v = vZ + r;
-            wind = 0.02f * (windBase - v);
+               float fDamp;
+               setx(vUV, getx(vTexCoord));;
+               sety(vUV, gety(vTexCoord));;
+               setx(vUV, getx(vUV) + 1.f * m_fTexOffsets[0]);
+               fDamp = BiLinear(vUV);
+               fDamp = fDamp * (1.f - fTFull) + fTFull;
 
-            //                sum = g * SegMass * Tres[5] + wind;
-            sum = g * SegMass + wind;
-            float3 Dw_ = GetDw(Tres, Rres, w_, sum, wind, fJ_1, SegLen, h, segment);
-            fmW[ind][segment] += 0.5f * a_fElapsed * (Dw + Dw_);
-            fmW[ind][segment] *= d;
-            psi = a_fElapsed * fmW[ind][segment];
+               fPixHeight *= 6.f * fDamp;
+            }
+            float fPixHmax = 6.f;
+            float fLen = sqrt(getx(fPixHeight) * getx(fPixHeight) + gety(fPixHeight) * gety(fPixHeight) + 0.0001f);
+            if (fLen > fPixHmax) fPixHeight = fPixHmax * fPixHeight / fLen;
 
-            // Rotate segment
-            mR[ind][segment] = XMMatrixMultiply(mR[ind][segment], MakeRotationMatrix(psi));
-            mT[ind][segment] = XMMatrixMultiply(T_1, mR[ind][segment]);
+            /* the pendulums are blown by (x, 0, y) */
+            pWindX[row * uRowStride + col] = getx(fPixHeight);
+            pWindZ[row * uRowStride + col] = gety(fPixHeight);
 
-            r = GetVel(mT[ind][segment], fmW[ind][segment], SegLen);
-            vZ = vZ + 2.f * r;
+            back.vWind[row * uWidth + col].x = getx(fPixHeight);
+            back.vWind[row * uWidth + col].y = 0.0f;
+            back.vWind[row * uWidth + col].z = getz(fPixHeight);
          }
+      }
 
-         vWindData[row * uWidth + col].x = getx(fPixHeight);
-         vWindData[row * uWidth + col].y = 0.0f;
-         vWindData[row * uWidth + col].z = getz(fPixHeight);
+      m_Pendulum.StepRows(a_uBegin, a_uEnd, fElapsed, d);
 
+      for (int j = 0; j < WIND_SEGMENTS; j++)
+      {
+         const float* pAx = m_Pendulum.Stream(WindPendulum::S_A + 3 * j);
+         const float* pAy = m_Pendulum.Stream(WindPendulum::S_A + 3 * j + 1);
+         const float* pAz = m_Pendulum.Stream(WindPendulum::S_A + 3 * j + 2);
+         for (UINT row = a_uBegin; row < a_uEnd; row++)
+            for (UINT col = 0; col < uWidth; col++)
+               back.vA[j][row * uWidth + col] = XMFLOAT3(pAx[row * uRowStride + col], pAy[row * uRowStride + col], pAz[row * uRowStride + col]);
       }
-   }
+   };
 
+   if (pJobScheduler)
+      pJobScheduler->ParallelFor(m_uSolveBegin, m_uSolveEnd, WIND_ROWS_PER_JOB, UpdateRows);
+   else
+      UpdateRows(m_uSolveBegin, m_uSolveEnd);
+   m_uSolveBegin = m_uSolveEnd;
 }
 
 Wind::Wind(ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx)
 {
    m_fTime = 0.0f;
+   m_bPublish = false;
    m_pD3DDevice = a_pD3DDevice;
    m_pD3DDeviceCtx = a_pD3DDeviceCtx;
 
@@ -605,35 +619,17 @@ Wind::Wind(ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx)
    pPixSize->SetFloatVector((float*)& vPixSize);
 
 #pragma region Wind Tex Creation
-   /* And now the same operations for Wind Tex :) */
-   /* Creating Wind Tex texture */
+   /* Creating texture for reading the height map on CPU, the wind texture is created for the grid size */
    ZeroMemory(&m_WindTexStagingDesc, sizeof(m_WindTexStagingDesc));
    m_WindTexStagingDesc.Width = m_uViewPortWidth;
    m_WindTexStagingDesc.Height = m_uViewPortHeight;
    m_WindTexStagingDesc.MipLevels = 1;
-   m_WindTexStagingDesc.ArraySize = NUM_SEGMENTS - 1;
+   m_WindTexStagingDesc.ArraySize = 1;
    m_WindTexStagingDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
    m_WindTexStagingDesc.SampleDesc.Count = 1;
-   m_WindTexStagingDesc.Usage = D3D11_USAGE_DEFAULT;//D3D11_USAGE_DYNAMIC;
-   m_WindTexStagingDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;//D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-   m_pD3DDevice->CreateTexture2D(&m_WindTexStagingDesc, NULL, &m_pWindTex);
-
-   /* Creating Shader Resource View for Wind Tex */
-   D3D11_SHADER_RESOURCE_VIEW_DESC WindTexSRVDesc;
-   ZeroMemory(&WindTexSRVDesc, sizeof(WindTexSRVDesc));
-   WindTexSRVDesc.Format = m_WindTexStagingDesc.Format;
-   WindTexSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
-   WindTexSRVDesc.Texture2DArray.MostDetailedMip = 0;
-   WindTexSRVDesc.Texture2DArray.ArraySize = NUM_SEGMENTS - 1;
-   WindTexSRVDesc.Texture2DArray.FirstArraySlice = 0;
-   WindTexSRVDesc.Texture2DArray.MipLevels = 1;
-   m_pD3DDevice->CreateShaderResourceView(m_pWindTex, &WindTexSRVDesc, &m_pWindTexSRV);
-
-   /* Creating texture for reading on CPU */
    m_WindTexStagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ | D3D11_CPU_ACCESS_WRITE;
    m_WindTexStagingDesc.BindFlags = 0;
    m_WindTexStagingDesc.Usage = D3D11_USAGE_STAGING;
-   m_WindTexStagingDesc.ArraySize = 1;
    m_pD3DDevice->CreateTexture2D(&m_WindTexStagingDesc, 0, &m_pWindTexStaging);
 #pragma endregion
 
@@ -664,14 +660,18 @@ Wind::Wind(ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx)
 
    MakeHeightMap();
 
+   m_pWindTex[0] = m_pWindTex[1] = NULL;
+   m_pWindTexSRV[0] = m_pWindTexSRV[1] = NULL;
+   m_uLastTex = 0;
    UpdateWindData();
-
-   m_WindData.pTime = &m_fTime;
-   m_WindData.pWindSpeed = &m_fWindSpeed;
+   CreateWindTex();
 }
 
 Wind::~Wind()
 {
+   if (m_WindData.pJobScheduler)
+      m_WindData.pJobScheduler->Wait(m_UpdateGroup);
+
    SAFE_RELEASE(m_pInputLayout);
    SAFE_RELEASE(m_pVertexBuffer);
 
@@ -681,10 +681,12 @@ Wind::~Wind()
    SAFE_RELEASE(m_pHeightMapRTV);
    SAFE_RELEASE(m_pHeightMapSRV);
 
-   SAFE_RELEASE(m_pWindTex);
+   SAFE_RELEASE(m_pWindTex[0]);
+   SAFE_RELEASE(m_pWindTex[1]);
    SAFE_RELEASE(m_pWindTexStaging);
 
-   SAFE_RELEASE(m_pWindTexSRV);
+   SAFE_RELEASE(m_pWindTexSRV[0]);
+   SAFE_RELEASE(m_pWindTexSRV[1]);
 
    SAFE_RELEASE(m_pDepthTex);
    SAFE_RELEASE(m_pDSV);
@@ -695,6 +697,26 @@ void Wind::SetWindSpeed(float a_fWindSpeed)
 {
    m_pWindSpeedESV->SetFloat(a_fWindSpeed);
    m_fWindSpeed = a_fWindSpeed;
+   m_WindData.fWindSpeed = a_fWindSpeed;
+}
+
+void Wind::SetJobScheduler(JobScheduler* a_pScheduler)
+{
+   m_WindData.pJobScheduler = a_pScheduler;
+}
+
+void Wind::SetSolveRate(float a_fRate)
+{
+   if (m_WindData.pJobScheduler)
+      m_WindData.pJobScheduler->Wait(m_UpdateGroup);
+   m_WindData.SetSolvePeriod((a_fRate > 0.0f) ? 1.0f / a_fRate : 0.0f);
+}
+
+void Wind::SetSpectrum(const WindSpectrumDesc* a_pDesc)
+{
+   if (m_WindData.pJobScheduler)
+      m_WindData.pJobScheduler->Wait(m_UpdateGroup);
+   m_WindData.SetSpectrum(a_pDesc);
 }
 
 void Wind::SetWindBias(float a_fBias)
@@ -794,17 +816,93 @@ void Wind::MakeWindMap()
    SAFE_RELEASE(pOrigDS);
 }
 
-void Wind::MakeWindTex (float a_fElapsed, XMVECTOR a_vCamDir)
+void Wind::CreateWindTex (void)
 {
-   m_WindData.UpdateWindTex(a_fElapsed, a_vCamDir);
-   m_WindData.WindCopy(m_pWindTex, m_pD3DDeviceCtx);
+   for (int i = 0; i < 2; i++)
+   {
+      SAFE_RELEASE(m_pWindTexSRV[i]);
+      SAFE_RELEASE(m_pWindTex[i]);
+   }
+
+   D3D11_TEXTURE2D_DESC WindTexDesc;
+   ZeroMemory(&WindTexDesc, sizeof(WindTexDesc));
+   WindTexDesc.Width = m_WindData.uWidth;
+   WindTexDesc.Height = m_WindData.uHeight;
+   WindTexDesc.MipLevels = 1;
+   WindTexDesc.ArraySize = WIND_SEGMENTS;
+   WindTexDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+   WindTexDesc.SampleDesc.Count = 1;
+   WindTexDesc.Usage = D3D11_USAGE_DEFAULT;
+   WindTexDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+   /* Creating Shader Resource View for Wind Tex */
+   D3D11_SHADER_RESOURCE_VIEW_DESC WindTexSRVDesc;
+   ZeroMemory(&WindTexSRVDesc, sizeof(WindTexSRVDesc));
+   WindTexSRVDesc.Format = WindTexDesc.Format;
+   WindTexSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+   WindTexSRVDesc.Texture2DArray.MostDetailedMip = 0;
+   WindTexSRVDesc.Texture2DArray.ArraySize = WIND_SEGMENTS;
+   WindTexSRVDesc.Texture2DArray.FirstArraySlice = 0;
+   WindTexSRVDesc.Texture2DArray.MipLevels = 1;
+
+   /* both start at rest, as the frames of the resized WindData */
+   for (int i = 0; i < 2; i++)
+   {
+      m_pD3DDevice->CreateTexture2D(&WindTexDesc, NULL, &m_pWindTex[i]);
+      m_pD3DDevice->CreateShaderResourceView(m_pWindTex[i], &WindTexSRVDesc, &m_pWindTexSRV[i]);
+   }
+   m_uLastTex = 0;
 }
 
-void Wind::Update (float a_fElapsed, XMVECTOR a_vCamDir)
+void Wind::SetResolution (UINT a_uWidth, UINT a_uHeight)
+{
+   if (m_WindData.pJobScheduler)
+      m_WindData.pJobScheduler->Wait(m_UpdateGroup);
+   m_WindData.Resize(a_uWidth, a_uHeight);
+   CreateWindTex();
+}
+
+void Wind::BeginUpdate (float a_fElapsed, XMVECTOR a_vCamDir)
 {
    m_fTime += a_fElapsed;
    m_pTimeESV->SetFloat(m_fTime);
-   MakeWindTex(a_fElapsed, a_vCamDir);
+
+   m_bPublish = m_WindData.Advance(a_fElapsed);
+
+   JobScheduler* pScheduler = m_WindData.pJobScheduler;
+   if (pScheduler == NULL)
+   {
+      m_WindData.UpdateWindTex(a_vCamDir);
+      return;
+   }
+
+   XMFLOAT3 vCamDir;
+   XMStoreFloat3(&vCamDir, a_vCamDir);
+   pScheduler->Spawn(m_UpdateGroup, [this, vCamDir]()
+   {
+      m_WindData.UpdateWindTex(XMLoadFloat3(&vCamDir));
+   });
+}
+
+void Wind::EndUpdate (void)
+{
+   if (m_WindData.pJobScheduler)
+      m_WindData.pJobScheduler->Wait(m_UpdateGroup);
+   if (m_bPublish)
+      m_WindData.Publish();
+
+   /* a new last frame goes to the texture of the frame before the last, the GPU blends the two */
+   if (m_WindData.StageTexels())
+   {
+      m_uLastTex ^= 1;
+      m_WindData.WindCopy(m_pWindTex[m_uLastTex], m_pD3DDeviceCtx);
+   }
+}
+
+void Wind::Update (float a_fElapsed, XMVECTOR a_vCamDir)
+{
+   BeginUpdate(a_fElapsed, a_vCamDir);
+   EndUpdate();
 }
 
 
@@ -856,5 +954,15 @@ void Wind::CreateInputLayout (void)
 
 ID3D11ShaderResourceView* Wind::GetMap (void)
 {
-   return m_pWindTexSRV;
+   return m_pWindTexSRV[m_uLastTex];
+}
+
+ID3D11ShaderResourceView* Wind::GetPrevMap (void)
+{
+   return m_pWindTexSRV[m_uLastTex ^ 1];
+}
+
+float Wind::GetMapBlend (void)
+{
+   return m_WindData.Blend();
 }
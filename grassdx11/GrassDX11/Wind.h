@@ -1,7 +1,15 @@
 #pragma once
 
 #include "includes.h"
+#include "JobScheduler.h"
+#include "WindPendulum.h"
+#include "WindSpectrum.h"
 
+#include <atomic>
+#include <vector>
+
+/* Longest step the pendulums take when a frame is solved every update, a longer frame is cut to it */
+#define WIND_MAX_STEP 0.1f
 
 struct QuadVertex
 {
@@ -9,32 +17,139 @@ struct QuadVertex
    XMFLOAT2 vTexCoord;
 };
 
+/**
+Wind simulation of one wind field: the air velocity on a grid of texels and the
+pendulums it swings. The air comes from the gradient map scrolled by the gusts or
+from a WindSpectrum. The grid resolution is independent of either and may be changed
+with Resize.
+Results are kept in three frames used in turn: UpdateWindTex writes the back frame,
+Publish makes it the last one. The readers (GetValue, GetValueA, the physics and the
+wind textures on the GPU) blend the frame before the last and the last one, so one update may run
+on a worker while they read, without locks. Advance, Publish and Resize must not
+overlap the readers.
+With a solve period the wind is solved at a fixed rate below the frame rate: the rows
+of the next frame are solved a part per update over the period, and the readers blend
+the two last frames by the time passed since the last one was published.
+*/
 struct WindData
 {
-   XMFLOAT3     *pData;              //wind for CPU
-   XMFLOAT3      vWindData[64 * 64]; //wind for CPU
+   struct Frame
+   {
+      std::vector<XMFLOAT3> vWind;              /* air velocity per texel */
+      std::vector<XMFLOAT3> vA[WIND_SEGMENTS];  /* pendulum torque per segment and texel */
+
+      /* vWind for a_iGrid < 0, vA[a_iGrid] otherwise */
+      const XMFLOAT3* Grid (int a_iGrid) const { return (a_iGrid < 0) ? vWind.data() : vA[a_iGrid].data(); }
+   };
+
    XMFLOAT4     *pWindMapData;       //gradient map
-   UINT          uHeight;
+   UINT          uMapHeight;
+   UINT          uMapWidth;
+   float         fMapHeight;
+   float         fMapWidth;
+   UINT          uHeight;            //simulation grid
    UINT          uWidth;
    float         fHeight;
    float         fWidth;
-   float        *pTime;       // pointer to Wind member m_fTime. Unsafe, but fast :)
-   float        *pWindSpeed;  // pointer to Wind member m_fWindSpeed. Unsafe, but fast :)
+   float         fWindSpeed;
+   JobScheduler *pJobScheduler; // rows of the pendulum grid are split into its jobs, NULL - on the calling thread
 
    XMVECTOR   GetValue      (const XMVECTOR& a_vTexCoord, const float a_fWindTexTile) const;
    XMVECTOR   GetValueA     (const XMVECTOR& a_vTexCoord, const float a_fWindTexTile, int a_iSegmentIndex) const;
-   float      BiLinear      (const XMVECTOR& a_vTexCoord);
+   float      BiLinear      (const XMVECTOR& a_vTexCoord) const;
    XMVECTOR   GetWindValue  (const XMVECTOR& a_vTexCoord, const float a_fWindTexTile, const float a_fWindStrength) const;
    XMVECTOR   GetWindValueA (const XMVECTOR& a_vTexCoord, const float a_fWindTexTile, const float a_fWindStrength, int a_iSegmentIndex) const;
 
-   //void          Update        ( );
-   void          UpdateWindTex (float a_fElapsed, XMVECTOR a_vCamDir);
+   /**
+   GetValue / GetValueA of a_uCount texcoords at once
+   param a_pX, a_pY texcoords
+   param a_pOut a_uCount values
+   */
+   void       GetValues     (const float* a_pX, const float* a_pY, UINT a_uCount, const float a_fWindTexTile, XMVECTOR* a_pOut) const;
+   void       GetValuesA    (const float* a_pX, const float* a_pY, UINT a_uCount, const float a_fWindTexTile, int a_iSegmentIndex, XMVECTOR* a_pOut) const;
+
+   /**
+   Takes the air from a spectrum of a_pDesc, from the gradient map if it is NULL
+   */
+   void          SetSpectrum    (const WindSpectrumDesc* a_pDesc);
+   /**
+   Time between two solved frames, 0 - a frame is solved and published every update
+   */
+   void          SetSolvePeriod (float a_fPeriod);
+   /**
+   Advances the solve clock by a frame time, before UpdateWindTex and the readers of the
+   frame. Chooses the rows UpdateWindTex solves and the blend the readers see
+   return true if UpdateWindTex completes the back frame, to be published after it
+   */
+   bool          Advance       (float a_fElapsed);
+   /**
+   Solves the rows of the back frame chosen by Advance
+   */
+   void          UpdateWindTex (XMVECTOR a_vCamDir);
+   /* back frame becomes the last one, the last one the one before */
+   void          Publish       (void);
+
+   /**
+   Sets the grid resolution, the pendulums are put at rest and both frames are cleared
+   */
+   void          Resize        (UINT a_uWidth, UINT a_uHeight);
    void          ConvertFrom   (const D3D11_MAPPED_SUBRESOURCE& a_MappedTex, const D3D11_TEXTURE2D_DESC& a_TexDesc);
 
    WindData  (void);
    ~WindData (void);
 
+   /**
+   Fills the staging texels with the torques of the last frame, once per Publish:
+   WIND_SEGMENTS slices of uWidth * uHeight texels, 16 bytes each
+   return false, with nothing staged, if the last frame was staged already
+   */
+   bool StageTexels (void);
+   /* slice a_iSegment of the staged texels, uWidth * uHeight RGBA floats */
+   const float* StagedTexels (int a_iSegment) const;
+   /* weight of the last frame the readers see, the textures of the two last frames are blended by it on the GPU */
+   float Blend (void) const;
+
+   /**
+   Uploads the staged texels to a texture array of the grid size, after StageTexels
+   */
    void WindCopy(ID3D11Texture2D* a_pDestTex, ID3D11DeviceContext* a_pDeviceCtx);
+
+private:
+   WindData (const WindData&);
+   WindData& operator = (const WindData&);
+
+   /* frame blend of the readers at (a_fX, a_fY), a_iGrid as in Frame::Grid */
+   XMVECTOR Sample      (int a_iGrid, const float a_fWindTexTile, float a_fX, float a_fY) const;
+   void     SampleBatch (int a_iGrid, const float a_fWindTexTile, const float* a_pX, const float* a_pY, UINT a_uCount, XMVECTOR* a_pOut) const;
+
+   WindPendulum      m_Pendulum;
+   WindSpectrum      m_Spectrum;
+   bool              m_bSpectral;
+   Frame             m_Frames[3];
+   std::atomic<UINT> m_uFront;   /* last frame, the one before is (m_uFront + 2) % 3, the back one (m_uFront + 1) % 3 */
+   float             m_fBlend;   /* weight of the last frame the readers see, 1 - the last frame only */
+   std::vector<float> m_Texels;  /* staging of WindCopy, the slices one after another */
+   UINT              m_uCopiedFront;  /* m_uFront of the last StageTexels, 3 - nothing staged */
+
+   /* decimation: time since the last Publish, rows of the back frame solved and to be solved */
+   float m_fSolvePeriod;
+   float m_fSolveClock;
+   float m_fSolveStep;
+   UINT  m_uSolveBegin;
+   UINT  m_uSolveEnd;
+
+   /* gusts: scrolling of the gradient map and the calm / rise / full / fall cycle */
+   float m_fTexOffsets[2];
+   int   m_iGustState;
+   float m_fGustTime;
+   float m_fGustBound;
+
+   /* gust values of the back frame, taken when its first rows are solved */
+   float    m_fGustFull;
+   float    m_fGustT;
+   float    m_fGustT1;
+   float    m_fDamp;
+   XMFLOAT3 m_vWaveW;
 };
 
 class Wind
@@ -58,11 +173,15 @@ private:
    ID3D11ShaderResourceView            *m_pWindMapSRV;
    ID3DX11EffectShaderResourceVariable *m_pWindMapESRV;
 
-   ID3D11Texture2D                    *m_pWindTex;
+   /* the frame before the last and the last one, m_uLastTex is the last */
+   ID3D11Texture2D                    *m_pWindTex[2];
+   ID3D11ShaderResourceView           *m_pWindTexSRV[2];
+   UINT                                m_uLastTex;
    D3D11_TEXTURE2D_DESC                m_WindTexStagingDesc;
    ID3D11Texture2D                    *m_pWindTexStaging;    //special resource to read on GPU
-   ID3D11ShaderResourceView           *m_pWindTexSRV;
    WindData                            m_WindData;
+   JobGroup                            m_UpdateGroup;     //UpdateWindTex running on a worker
+   bool                                m_bPublish;        //UpdateWindTex completes the back frame
 
    ID3D11Texture2D* m_pDepthTex;
    ID3D11DepthStencilView* m_pDSV;
@@ -89,7 +208,7 @@ private:
    void CreateInputLayout  (void);
    void MakeHeightMap      (void);
    void MakeWindMap        (void);
-   void MakeWindTex        (float a_fElapsed, XMVECTOR a_vCamDir);
+   void CreateWindTex      (void);
    void UpdateWindData     (void);
 
 public:
@@ -99,8 +218,36 @@ public:
    void SetWindBias  (float a_fBias);
    void SetWindScale (float a_fScale);
    void SetWindSpeed (float a_fWindSpeed);
+   void SetJobScheduler (JobScheduler* a_pScheduler);
+   /**
+   Wind solves per second, 0 - one every update. Below the frame rate the readers
+   see the wind blended between the two last solved frames
+   */
+   void SetSolveRate    (float a_fRate);
+   /**
+   Spectral wind of a_pDesc instead of the gradient map, NULL - back to the map
+   */
+   void SetSpectrum     (const WindSpectrumDesc* a_pDesc);
    void Update       (float a_fElapsed, XMVECTOR a_vCamDir);
 
+   /**
+   Update split in two: BeginUpdate starts computing the next wind frame on the job
+   scheduler (inline without one), the readers keep seeing the previous frame until
+   EndUpdate waits for it, publishes it and uploads it to the older wind texture
+   */
+   void BeginUpdate  (float a_fElapsed, XMVECTOR a_vCamDir);
+   void EndUpdate    (void);
+
+   /**
+   Wind grid resolution, the gradient map size at start. Restarts the wind at rest
+   */
+   void SetResolution (UINT a_uWidth, UINT a_uHeight);
+
    const WindData* WindDataPtr      (void);
-   ID3D11ShaderResourceView* GetMap (void);
+   /**
+   Wind textures of the last frame and the one before, the shaders lerp them by GetMapBlend
+   */
+   ID3D11ShaderResourceView* GetMap     (void);
+   ID3D11ShaderResourceView* GetPrevMap (void);
+   float                     GetMapBlend(void);
 };
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "WindPendulum.h"
+#include "JobScheduler.h"
+
+
+WindPendulum::WindPendulum(void)
+{
+   m_pData = NULL;
+   m_uWidth = 0;
+   m_uHeight = 0;
+   m_uRowStride = 0;
+   m_uStride = 0;
+}
+
+
+WindPendulum::~WindPendulum(void)
+{
+   Release();
+}
+
+
+void WindPendulum::Release(void)
+{
+   if (m_pData)
+      _aligned_free(m_pData);
+   m_pData = NULL;
+}
+
+
+void WindPendulum::Resize(UINT a_uWidth, UINT a_uHeight)
+{
+   Release();
+   m_uWidth = a_uWidth;
+   m_uHeight = a_uHeight;
+   m_uRowStride = (a_uWidth + PHYS_LANES - 1) / PHYS_LANES * PHYS_LANES;
+   m_uStride = m_uRowStride * a_uHeight;
+
+   size_t uBytes = S_COUNT * m_uStride * sizeof(float);
+   m_pData = (float*)_aligned_malloc(uBytes, 16);
+   ZeroMemory(m_pData, uBytes);
+
+   /* at rest: identity rotations, the padding lanes too */
+   for (int j = 0; j < WIND_SEGMENTS; j++)
+   {
+      float* pRw = Stream(S_R + 4 * j + 3);
+      float* pTw = Stream(S_T + 4 * j + 3);
+      for (UINT i = 0; i < m_uStride; i++)
+         pRw[i] = pTw[i] = 1.0f;
+   }
+}
+
+
+static inline LaneVec3 LoadVec3(const WindPendulum& p, UINT s, UINT i)
+{
+   LaneVec3 r;
+   r.x = LaneLoad(p.Stream(s) + i);
+   r.y = LaneLoad(p.Stream(s + 1) + i);
+   r.z = LaneLoad(p.Stream(s + 2) + i);
+   return r;
+}
+
+
+static inline void StoreVec3(WindPendulum& p, UINT s, UINT i, const LaneVec3& v)
+{
+   XMStoreFloat4A((XMFLOAT4A*)(p.Stream(s) + i), v.x);
+   XMStoreFloat4A((XMFLOAT4A*)(p.Stream(s + 1) + i), v.y);
+   XMStoreFloat4A((XMFLOAT4A*)(p.Stream(s + 2) + i), v.z);
+}
+
+
+static inline LaneQuat LoadQuat(const WindPendulum& p, UINT s, UINT i)
+{
+   LaneQuat r;
+   r.x = LaneLoad(p.Stream(s) + i);
+   r.y = LaneLoad(p.Stream(s + 1) + i);
+   r.z = LaneLoad(p.Stream(s + 2) + i);
+   r.w = LaneLoad(p.Stream(s + 3) + i);
+   return r;
+}
+
+
+static inline void StoreQuat(WindPendulum& p, UINT s, UINT i, const LaneQuat& q)
+{
+   XMStoreFloat4A((XMFLOAT4A*)(p.Stream(s) + i), q.x);
+   XMStoreFloat4A((XMFLOAT4A*)(p.Stream(s + 1) + i), q.y);
+   XMStoreFloat4A((XMFLOAT4A*)(p.Stream(s + 2) + i), q.z);
+   XMStoreFloat4A((XMFLOAT4A*)(p.Stream(s + 3) + i), q.w);
+}
+
+
+void WindPendulum::StepRows(UINT a_uRowBegin, UINT a_uRowEnd, float a_fTime, float a_fDamp)
+{
+   XMVECTOR dt = XMVectorReplicate(a_fTime);
+   XMVECTOR halfDt = XMVectorReplicate(0.5f * a_fTime);
+   XMVECTOR damp = XMVectorReplicate(a_fDamp);
+   XMVECTOR two = XMVectorReplicate(2.0f);
+   XMVECTOR halfHeight = XMVectorReplicate(WIND_SEG_LEN * 0.5f);
+   XMVECTOR mass = XMVectorReplicate(WIND_SEG_MASS);
+   XMVECTOR hardness = XMVectorReplicate(WIND_SEG_HARDNESS);
+   XMVECTOR invJ = XMVectorReplicate(0.75f / (0.33f * WIND_SEG_MASS * WIND_SEG_LEN * WIND_SEG_LEN));
+   XMVECTOR weight = XMVectorReplicate(-9.8f * WIND_SEG_MASS);
+
+   for (UINT uRow = a_uRowBegin; uRow < a_uRowEnd; uRow++)
+   {
+      for (UINT i = uRow * m_uRowStride; i < (uRow + 1) * m_uRowStride; i += PHYS_LANES)
+      {
+         LaneVec3 wind;
+         wind.x = LaneLoad(Stream(S_WIND) + i);
+         wind.y = XMVectorZero();
+         wind.z = LaneLoad(Stream(S_WIND + 1) + i);
+
+         LaneVec3 vZ;
+         vZ.x = vZ.y = vZ.z = XMVectorZero();
+         LaneQuat T_1;
+         T_1.x = T_1.y = T_1.z = XMVectorZero();
+         T_1.w = XMVectorSplatOne();
+
+         for (int j = 0; j < WIND_SEGMENTS; j++)
+         {
+            LaneVec3 w = LoadVec3(*this, S_W + 3 * j, i);
+            LaneQuat R = LoadQuat(*this, S_R + 4 * j, i);
+            LaneQuat T = LoadQuat(*this, S_T + 4 * j, i);
+
+            /* Heun step, the same as HeunStepLanes of the blades */
+            LaneVec3 sum = ForceLanes(wind, vZ, VelLanes(T, w, halfHeight), mass);
+            LaneVec3 Dw = DwLanes(T, R, sum, invJ, halfHeight, hardness);
+            LaneVec3 w_ = MulAdd(Dw, dt, w);
+
+            LaneQuat Tres, Rres;
+            CalcTRLanes(Tres, Rres, T_1, R, Scale(w_, dt));
+
+            sum = ForceLanes(wind, vZ, VelLanes(Tres, w_, halfHeight), mass);
+            LaneVec3 Dw_ = DwLanes(Tres, Rres, sum, invJ, halfHeight, hardness);
+
+            w.x = XMVectorMultiply(XMVectorMultiplyAdd(halfDt, XMVectorAdd(Dw.x, Dw_.x), w.x), damp);
+            w.y = XMVectorMultiply(XMVectorMultiplyAdd(halfDt, XMVectorAdd(Dw.y, Dw_.y), w.y), damp);
+            w.z = XMVectorMultiply(XMVectorMultiplyAdd(halfDt, XMVectorAdd(Dw.z, Dw_.z), w.z), damp);
+            CalcTRLanes(T, R, T_1, R, Scale(w, dt));
+
+            LaneVec3 r = VelLanes(T, w, halfHeight);
+            vZ = MulAdd(r, two, vZ);
+
+            /* A = hardness * log(R) - cross(halfAxis, m * g), both in the frame of the lower segment, then in the world */
+            LaneVec3 mg;
+            mg.x = mg.z = XMVectorZero();
+            mg.y = weight;
+            if (j > 0)
+               mg = RotateLanes(T_1, mg, -1.0f);
+            LaneVec3 g = RotationVectorLanes(R);
+            LaneVec3 A;
+            A.x = XMVectorNegativeMultiplySubtract(halfHeight, mg.z, XMVectorMultiply(hardness, g.x));
+            A.y = XMVectorMultiply(hardness, g.y);
+            A.z = XMVectorMultiplyAdd(halfHeight, mg.x, XMVectorMultiply(hardness, g.z));
+            if (j > 0)
+               A = RotateLanes(T_1, A, 1.0f);
+
+            StoreVec3(*this, S_W + 3 * j, i, w);
+            StoreQuat(*this, S_R + 4 * j, i, R);
+            StoreQuat(*this, S_T + 4 * j, i, T);
+            StoreVec3(*this, S_A + 3 * j, i, A);
+            T_1 = T;
+         }
+      }
+   }
+}
+
+
+void WindPendulum::Step(float a_fTime, float a_fDamp, JobScheduler* a_pScheduler)
+{
+   auto StepJob = [this, a_fTime, a_fDamp](UINT a_uBegin, UINT a_uEnd)
+   {
+      StepRows(a_uBegin, a_uEnd, a_fTime, a_fDamp);
+   };
+
+   if (a_pScheduler)
+      a_pScheduler->ParallelFor(0, m_uHeight, WIND_ROWS_PER_JOB, StepJob);
+   else
+      StepJob(0, m_uHeight);
+}
+
+
+XMVECTOR WindPendulum::GetA(UINT a_uCol, UINT a_uRow, int a_iSegment) const
+{
+   UINT i = a_uRow * m_uRowStride + a_uCol;
+   const float* pA = Stream(S_A + 3 * a_iSegment);
+   return XMVectorSet(pA[i], pA[m_uStride + i], pA[2 * m_uStride + i], 0.0f);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "includes.h"
+#include "PhysLanes.h"
+
+class JobScheduler;
+
+/* Segments of the pendulum above every wind texel */
+#define WIND_SEGMENTS     (NUM_SEGMENTS - 1)
+#define WIND_SEG_LEN      0.75f
+#define WIND_SEG_MASS     0.01f
+#define WIND_SEG_HARDNESS 0.06f
+/* Rows of the grid stepped by one job */
+#define WIND_ROWS_PER_JOB 4
+
+/**
+Three segment pendulums standing on every texel of the wind grid, swung by the wind
+of the texel. Their spring and gravity torque is what the blades feel as the wind
+(the A slices of the wind texture and WindData::GetValueA).
+The state is kept in 16-byte aligned SoA streams, rows padded up to a multiple of
+PHYS_LANES, and is advanced PHYS_LANES texels at a time with the lane maths of the
+blade solver. Rows are independent and are split into jobs.
+*/
+class WindPendulum
+{
+public:
+   enum STREAM
+   {
+      S_W     = 0,                          /* angular velocity, per segment */
+      S_R     = S_W + 3 * WIND_SEGMENTS,    /* rotation relative to the lower segment, per segment */
+      S_T     = S_R + 4 * WIND_SEGMENTS,    /* accumulated rotation, per segment */
+      S_A     = S_T + 4 * WIND_SEGMENTS,    /* spring and gravity torque in the world, per segment */
+      S_WIND  = S_A + 3 * WIND_SEGMENTS,    /* air velocity x, z at the texel, written by the caller */
+      S_COUNT = S_WIND + 2
+   };
+
+   WindPendulum (void);
+   ~WindPendulum(void);
+
+   /**
+   Reallocates the streams and puts all pendulums at rest
+   */
+   void Resize (UINT a_uWidth, UINT a_uHeight);
+
+   UINT Width     (void) const { return m_uWidth; }
+   UINT Height    (void) const { return m_uHeight; }
+   /* texels between the rows, a multiple of PHYS_LANES */
+   UINT RowStride (void) const { return m_uRowStride; }
+
+   float*       Stream (UINT a_uStream)       { return m_pData + a_uStream * m_uStride; }
+   const float* Stream (UINT a_uStream) const { return m_pData + a_uStream * m_uStride; }
+
+   /**
+   Advances rows [a_uRowBegin, a_uRowEnd) by one Heun step and refreshes their S_A
+   param a_fDamp angular velocity factor of the step
+   */
+   void StepRows (UINT a_uRowBegin, UINT a_uRowEnd, float a_fTime, float a_fDamp);
+
+   /**
+   StepRows for all rows, split into jobs of a_pScheduler, inline if it is NULL
+   */
+   void Step     (float a_fTime, float a_fDamp, JobScheduler* a_pScheduler);
+
+   /* S_A of segment a_iSegment at texel (a_uCol, a_uRow) */
+   XMVECTOR GetA (UINT a_uCol, UINT a_uRow, int a_iSegment) const;
+
+private:
+   WindPendulum (const WindPendulum&);
+   WindPendulum& operator = (const WindPendulum&);
+
+   void Release (void);
+
+   float* m_pData;
+   UINT   m_uWidth;
+   UINT   m_uHeight;
+   UINT   m_uRowStride;
+   UINT   m_uStride;
+};
@@ -0,0 +1,247 @@
+#include "WindSpectrum.h"
+#include "JobScheduler.h"
+#include "PhysRandom.h"
+
+
+WindSpectrum::WindSpectrum(void)
+{
+   ZeroMemory(&m_Desc, sizeof(m_Desc));
+   m_uSize = 0;
+   m_uLog = 0;
+   m_bRotors = false;
+   m_fRotorAdvect = 0.0f;
+   m_fClock = 0.0f;
+   m_uSteps = 0;
+   m_bField = false;
+}
+
+
+void WindSpectrum::Init(const WindSpectrumDesc& a_Desc)
+{
+   m_Desc = a_Desc;
+
+   /* the largest power of two not above uSize, 2 at least */
+   m_uLog = 1;
+   while ((2u << m_uLog) <= min(a_Desc.uSize, (UINT)WIND_FFT_MAX_SIZE))
+      m_uLog++;
+   m_uSize = 1u << m_uLog;
+   UINT uModes = m_uSize * m_uSize;
+
+   m_BitReverse.resize(m_uSize);
+   for (UINT i = 0; i < m_uSize; i++)
+   {
+      UINT uReverse = 0;
+      for (UINT b = 0; b < m_uLog; b++)
+         uReverse |= ((i >> b) & 1) << (m_uLog - 1 - b);
+      m_BitReverse[i] = uReverse;
+   }
+   m_Cos.resize(m_uSize / 2);
+   m_Sin.resize(m_uSize / 2);
+   for (UINT k = 0; k < m_uSize / 2; k++)
+   {
+      m_Cos[k] = cosf(XM_2PI * k / m_uSize);
+      m_Sin[k] = sinf(XM_2PI * k / m_uSize);
+   }
+
+   m_ModeRe.resize(uModes);
+   m_ModeIm.resize(uModes);
+   m_Amplitude.resize(uModes);
+   m_Omega.resize(uModes);
+   m_RotorRe.resize(uModes);
+   m_RotorIm.resize(uModes);
+   m_FieldRe.assign(uModes, 0.0f);
+   m_FieldIm.assign(uModes, 0.0f);
+
+   /* spectrum, the mean (k = 0) is fMean */
+   float fTotal = 0.0f;
+   for (UINT row = 0; row < m_uSize; row++)
+      for (UINT col = 0; col < m_uSize; col++)
+      {
+         float fKx = XM_2PI * ((col < m_uSize / 2) ? (float)col : (float)col - m_uSize);
+         float fKz = XM_2PI * ((row < m_uSize / 2) ? (float)row : (float)row - m_uSize);
+         float fKL = sqrtf(fKx * fKx + fKz * fKz) * a_Desc.fLength;
+         float fPower = (row == 0 && col == 0) ? 0.0f : powf(1.0f + fKL * fKL, -4.0f / 3.0f);
+         m_Amplitude[row * m_uSize + col] = fPower;
+         m_Omega[row * m_uSize + col] = a_Desc.fTurnover * powf(fKL, 2.0f / 3.0f);
+         fTotal += fPower;
+      }
+
+   /* the real part of the field gets half the variance of the modes: E|mode|^2 = 2 sigma^2 P / sum P */
+   RandomStream random(a_Desc.uSeed);
+   float fScale = (fTotal > 0.0f) ? 2.0f * a_Desc.fSigma * a_Desc.fSigma / fTotal : 0.0f;
+   for (UINT i = 0; i < uModes; i++)
+   {
+      /* Box-Muller: a complex Gaussian of E|z|^2 = 1 has |z| = sqrt(-ln u) and a uniform phase */
+      float fRadius = sqrtf(-logf(1.0f - random.NextFloat()));
+      float fPhase = random.NextFloat(0.0f, XM_2PI);
+      float fAmplitude = sqrtf(fScale * m_Amplitude[i]) * fRadius;
+      m_ModeRe[i] = fAmplitude * cosf(fPhase);
+      m_ModeIm[i] = fAmplitude * sinf(fPhase);
+      m_Amplitude[i] = fAmplitude;
+      if (random.NextUInt() & 1)
+         m_Omega[i] = -m_Omega[i];
+   }
+
+   m_bRotors = false;
+   m_fClock = 0.0f;
+   m_uSteps = 0;
+   m_bField = false;
+}
+
+
+void WindSpectrum::UpdateRotors(float a_fAdvect)
+{
+   /* f(x - U t): the flow along +x adds -kx U to the turnover rate */
+   for (UINT row = 0; row < m_uSize; row++)
+      for (UINT col = 0; col < m_uSize; col++)
+      {
+         UINT i = row * m_uSize + col;
+         float fKx = XM_2PI * ((col < m_uSize / 2) ? (float)col : (float)col - m_uSize);
+         float fAngle = (m_Omega[i] - fKx * a_fAdvect) * WIND_SPECTRUM_STEP;
+         m_RotorRe[i] = cosf(fAngle);
+         m_RotorIm[i] = sinf(fAngle);
+      }
+   m_bRotors = true;
+   m_fRotorAdvect = a_fAdvect;
+}
+
+
+void WindSpectrum::Transform(float* a_pRe, float* a_pIm) const
+{
+   for (UINT i = 0; i < m_uSize; i++)
+   {
+      UINT j = m_BitReverse[i];
+      if (j > i)
+      {
+         std::swap(a_pRe[i], a_pRe[j]);
+         std::swap(a_pIm[i], a_pIm[j]);
+      }
+   }
+
+   /* butterflies of 2 * uHalf values, their twiddles are every uStride-th one */
+   for (UINT uHalf = 1, uStride = m_uSize / 2; uHalf < m_uSize; uHalf *= 2, uStride /= 2)
+      for (UINT i = 0; i < m_uSize; i += 2 * uHalf)
+         for (UINT k = 0; k < uHalf; k++)
+         {
+            UINT a = i + k;
+            UINT b = a + uHalf;
+            float fCos = m_Cos[k * uStride];
+            float fSin = m_Sin[k * uStride];
+            float fRe = a_pRe[b] * fCos - a_pIm[b] * fSin;
+            float fIm = a_pRe[b] * fSin + a_pIm[b] * fCos;
+            a_pRe[b] = a_pRe[a] - fRe;
+            a_pIm[b] = a_pIm[a] - fIm;
+            a_pRe[a] += fRe;
+            a_pIm[a] += fIm;
+         }
+}
+
+
+void WindSpectrum::Step(float a_fTime, float a_fAdvect, JobScheduler* a_pScheduler)
+{
+   if (!IsValid())
+      return;
+   if (!m_bRotors || a_fAdvect != m_fRotorAdvect)
+      UpdateRotors(a_fAdvect);
+
+   /* the modes turn by whole steps, the field stays as it is until one is due */
+   m_fClock += a_fTime;
+   UINT uTurns = (UINT)(m_fClock / WIND_SPECTRUM_STEP);
+   m_fClock -= uTurns * WIND_SPECTRUM_STEP;
+   if (uTurns == 0 && m_bField)
+      return;
+   m_bField = true;
+
+   /* now and then the modes are put back to their amplitudes */
+   bool bRenormalize = ((m_uSteps >> 10) != ((m_uSteps + uTurns) >> 10));
+   m_uSteps += uTurns;
+
+   auto RowJob = [this, uTurns, bRenormalize](UINT a_uBegin, UINT a_uEnd)
+   {
+      for (UINT row = a_uBegin; row < a_uEnd; row++)
+      {
+         for (UINT i = row * m_uSize; i < (row + 1) * m_uSize; i++)
+         {
+            /* angle addition, one rotor turn per step */
+            float fRe = m_ModeRe[i];
+            float fIm = m_ModeIm[i];
+            for (UINT t = 0; t < uTurns; t++)
+            {
+               float fTurnRe = fRe * m_RotorRe[i] - fIm * m_RotorIm[i];
+               fIm = fRe * m_RotorIm[i] + fIm * m_RotorRe[i];
+               fRe = fTurnRe;
+            }
+            if (bRenormalize)
+            {
+               float fLen = sqrtf(fRe * fRe + fIm * fIm);
+               float fScale = (fLen > 0.0f) ? m_Amplitude[i] / fLen : 0.0f;
+               fRe *= fScale;
+               fIm *= fScale;
+            }
+            m_ModeRe[i] = m_FieldRe[i] = fRe;
+            m_ModeIm[i] = m_FieldIm[i] = fIm;
+         }
+         Transform(&m_FieldRe[row * m_uSize], &m_FieldIm[row * m_uSize]);
+      }
+   };
+
+   auto ColumnJob = [this](UINT a_uBegin, UINT a_uEnd)
+   {
+      float re[WIND_FFT_MAX_SIZE];
+      float im[WIND_FFT_MAX_SIZE];
+      for (UINT col = a_uBegin; col < a_uEnd; col++)
+      {
+         for (UINT row = 0; row < m_uSize; row++)
+         {
+            re[row] = m_FieldRe[row * m_uSize + col];
+            im[row] = m_FieldIm[row * m_uSize + col];
+         }
+         Transform(re, im);
+         for (UINT row = 0; row < m_uSize; row++)
+         {
+            m_FieldRe[row * m_uSize + col] = re[row];
+            m_FieldIm[row * m_uSize + col] = im[row];
+         }
+      }
+   };
+
+   if (a_pScheduler)
+   {
+      a_pScheduler->ParallelFor(0, m_uSize, WIND_FFT_LINES_PER_JOB, RowJob);
+      a_pScheduler->ParallelFor(0, m_uSize, WIND_FFT_LINES_PER_JOB, ColumnJob);
+   }
+   else
+   {
+      RowJob(0, m_uSize);
+      ColumnJob(0, m_uSize);
+   }
+}
+
+
+void WindSpectrum::Sample(float a_fX, float a_fY, float& a_fWindX, float& a_fWindZ) const
+{
+   /* field texel j is at texcoord j / size, the field repeats every tile */
+   float fX = (a_fX - floorf(a_fX)) * m_uSize;
+   float fY = (a_fY - floorf(a_fY)) * m_uSize;
+   float fFloorX = floorf(fX);
+   float fFloorY = floorf(fY);
+   float fFracX = fX - fFloorX;
+   float fFracY = fY - fFloorY;
+   UINT uMask = m_uSize - 1;
+   UINT uLX = (UINT)fFloorX & uMask;
+   UINT uHX = (uLX + 1) & uMask;
+   UINT uLY = (UINT)fFloorY & uMask;
+   UINT uHY = (uLY + 1) & uMask;
+
+   float fWLL = (1.0f - fFracX) * (1.0f - fFracY);
+   float fWLR = fFracX * (1.0f - fFracY);
+   float fWHL = (1.0f - fFracX) * fFracY;
+   float fWHR = fFracX * fFracY;
+   UINT uLL = uLY * m_uSize + uLX;
+   UINT uLR = uLY * m_uSize + uHX;
+   UINT uHL = uHY * m_uSize + uLX;
+   UINT uHR = uHY * m_uSize + uHX;
+
+   a_fWindX = m_Desc.fMean + fWLL * m_FieldRe[uLL] + fWLR * m_FieldRe[uLR] + fWHL * m_FieldRe[uHL] + fWHR * m_FieldRe[uHR];
+   a_fWindZ = fWLL * m_FieldIm[uLL] + fWLR * m_FieldIm[uLR] + fWHL * m_FieldIm[uHL] + fWHR * m_FieldIm[uHR];
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "includes.h"
+
+#include <vector>
+
+class JobScheduler;
+
+/* Rows or columns of the spectrum transformed by one job */
+#define WIND_FFT_LINES_PER_JOB 16
+/* Largest modes per side, a column is transformed in a stack copy of this size */
+#define WIND_FFT_MAX_SIZE 512
+/* Phase step of the modes, seconds: the rotors are the turn of one step */
+#define WIND_SPECTRUM_STEP (1.0f / 60.0f)
+
+/**
+Spectral wind parameters, lengths in wind tiles (texcoord units, the field repeats every tile)
+*/
+struct WindSpectrumDesc
+{
+   UINT  uSize;       /* modes per side, a power of two, WIND_FFT_MAX_SIZE at most */
+   float fLength;     /* von Karman length scale, the size of the largest gusts */
+   float fSigma;      /* standard deviation of either wind component */
+   float fMean;       /* mean wind along +x */
+   float fTurnover;   /* rate the eddies of fLength size change at, 1/s */
+   UINT  uSeed;
+};
+
+/**
+Tileable turbulent wind from a von Karman spectrum: the modes are turned in phase by the
+mean flow and their turnover, an inverse FFT gives the x wind (real) and the z wind (imaginary)
+*/
+class WindSpectrum
+{
+public:
+   WindSpectrum (void);
+
+   /* draws the modes of a_Desc, the field is refreshed by the next Step */
+   void Init    (const WindSpectrumDesc& a_Desc);
+   bool IsValid (void) const { return m_uSize > 0; }
+
+   /**
+   Turns the modes by whole WIND_SPECTRUM_STEP steps and refreshes the field, in jobs of a_pScheduler
+   param a_fAdvect speed of the mean flow, tiles per second
+   */
+   void Step    (float a_fTime, float a_fAdvect, JobScheduler* a_pScheduler);
+
+   /* bilinear wind at texcoord (a_fX, a_fY) */
+   void Sample  (float a_fX, float a_fY, float& a_fWindX, float& a_fWindZ) const;
+
+private:
+   /* inverse FFT of a_uSize values in place */
+   void Transform     (float* a_pRe, float* a_pIm) const;
+   void UpdateRotors  (float a_fAdvect);
+
+   WindSpectrumDesc   m_Desc;
+   UINT               m_uSize;
+   UINT               m_uLog;
+   std::vector<UINT>  m_BitReverse;
+   std::vector<float> m_Cos;        /* twiddles e^(2 pi i k / size), k < size / 2 */
+   std::vector<float> m_Sin;
+
+   /* per mode, row-major, the row is the z wavenumber */
+   std::vector<float> m_ModeRe;
+   std::vector<float> m_ModeIm;
+   std::vector<float> m_Amplitude;  /* |mode| as drawn, renormalizes the rotated modes */
+   std::vector<float> m_Omega;      /* turnover rate, signed */
+   std::vector<float> m_RotorRe;    /* e^(i w WIND_SPECTRUM_STEP) of the flow m_fRotorAdvect */
+   std::vector<float> m_RotorIm;
+   bool               m_bRotors;
+   float              m_fRotorAdvect;
+   float              m_fClock;     /* time not yet turned by a whole step */
+   UINT               m_uSteps;
+   bool               m_bField;     /* the field shows the modes */
+
+   /* the field, x wind in m_FieldRe, z wind in m_FieldIm */
+   std::vector<float> m_FieldRe;
+   std::vector<float> m_FieldIm;
+};
@@ -44,15 +44,6 @@ inline float mod(float a, float b)
 }
 
 
-inline float frand(float Min, float Max, float prec = 0.001f)
-{
-   if (Min > Max)
-      return 0.0f;
-   if (Min == Max)
-      return Min;
-   return Min + prec * (float)(rand() % long((Max - Min) / prec) + 1);
-}
-
 template <typename Real>
 void clamp(Real* value, const Real min, const Real max)
 {
@@ -46,29 +46,6 @@ inline bool XMVector3Alike (XMVECTOR a_vVec1, XMVECTOR a_vVec2)
 }
 
 
-inline float fRand (float a_fLeft, float a_fRight)
-{
-   if (a_fRight < a_fLeft)
-      return 0.0f;
-   /* Random value in (0, 1) */
-   float fRandom = (rand() % g_iInvPrecision) * g_fPrecision;
-
-   return (a_fRight - a_fLeft) * fRandom + a_fLeft;
-}
-
-
-inline float fRand (float a_fMax)
-{
-   return fRand(0.0f, a_fMax);
-}
-
-
-inline float SignedfRand (float a_fMax)
-{
-   return fRand (-a_fMax, a_fMax);
-}
-
-
 inline HRESULT D3DXLoadTextureArray (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx, std::vector< std::wstring > a_sTexNames,
    ID3D11Texture2D** a_ppTex2D, ID3D11ShaderResourceView** a_ppSRV)
 {
@@ -168,6 +168,7 @@ void InitApp()
    g_HUD.AddButton(IDC_TOGGLE_RENDERING_DBG_WIN, L"Toggle rendering-dbg win (F6)", 25, iY += iYo, 125, 22, VK_F6);
    g_HUD.AddButton(IDC_TOGGLE_DBG_WIN_SLICE, L"Toggle dbg win slice (F7)", 25, iY += iYo, 125, 22, VK_F7);
    g_HUD.AddButton(IDC_FIX_CAMERA, L"Fix cam (F8)", 25, iY += iYo, 125, 22, VK_F8);
+   g_HUD.AddButton(IDC_TOGGLE_SPECTRAL_WIND, L"Toggle spectral wind (F9)", 25, iY += iYo, 125, 22, VK_F9);
 
    
    swprintf_s(sStr, MAX_PATH, L"Diffuse: (%.2f,%.2f,%.2f)", g_vTerrRGB.x, g_vTerrRGB.y, g_vTerrRGB.z);
@@ -223,8 +224,16 @@ void RenderText()
    WCHAR lookAtStr[100];
    swprintf(lookAtStr, sizeof(lookAtStr), L"Look to: X = %f, Y = %f, Z = % f", lookAt.x - eye.x, lookAt.y - eye.y, lookAt.z - eye.z);
 
+   PhysScheduleStats physStats;
+   g_pGrassField->GetPhysScheduleStats(physStats);
+   WCHAR physStr[200];
+   swprintf(physStr, sizeof(physStr) / sizeof(WCHAR), L"Physics: %.2f ms, tiers %u/%u/%u, updated %u, skipped %u, deferred %u, dropped %u, collide %u, culled %u",
+      physStats.fPhysMs, physStats.uPatchesPerTier[0], physStats.uPatchesPerTier[1], physStats.uPatchesPerTier[2],
+      physStats.uUpdated, physStats.uSkippedByRate, physStats.uDeferred, physStats.uDroppedSteps, physStats.uCollideTested, physStats.uCollideCulled);
+
    g_pTxtHelper->DrawTextLine(eyeStr);
    g_pTxtHelper->DrawTextLine(lookAtStr);
+   g_pTxtHelper->DrawTextLine(physStr);
 
    g_pTxtHelper->End();
 }
@@ -375,6 +384,10 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
    
    g_GrassInitState.InitState[0].uNumCollidedPatchesPerMesh = 10;
    g_GrassInitState.InitState[0].uMaxColliders = MAX_NUM_MESHES;
+   g_GrassInitState.InitState[0].fPhysStep = 1.0f / 60.0f;
+   g_GrassInitState.InitState[0].uMaxPhysSubsteps = 4;
+   g_GrassInitState.InitState[0].fPhysBudgetMs = 2.0f;
+   g_GrassInitState.InitState[0].uDormantBudgetKB = 1024;
    
    g_GrassInitState.InitState[1] = g_GrassInitState.InitState[0];
    g_GrassInitState.InitState[2] = g_GrassInitState.InitState[0];
@@ -414,6 +427,14 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
    g_GrassInitState.sNoiseMapPath = L"resources/Noise.dds";
    g_GrassInitState.sGrassOnTerrainTexturePath = L"resources/g.dds";
    g_GrassInitState.fHeightScale = g_fHeightScale;
+   g_GrassInitState.fWindSolveRate = 0.0f;
+   /* 128^2 modes over a wind tile, the largest gusts a quarter of it */
+   g_GrassInitState.SpectralWind.uSize = 128;
+   g_GrassInitState.SpectralWind.fLength = 0.25f;
+   g_GrassInitState.SpectralWind.fSigma = 1.5f;
+   g_GrassInitState.SpectralWind.fMean = 2.5f;
+   g_GrassInitState.SpectralWind.fTurnover = 0.4f;
+   g_GrassInitState.SpectralWind.uSeed = 1;
    g_GrassInitState.fTerrRadius = 400.0f;
    g_pGrassField = new GrassFieldManager(g_GrassInitState);
    g_pTerrTile = g_pGrassField->SceneEffect()->GetVariableByName("g_fTerrTile")->AsScalar();
@@ -1119,6 +1140,10 @@ void CALLBACK OnGUIEvent( UINT nEvent, int nControlID, CDXUTControl* pControl, v
          g_dbgWin->ToggleSlice();
          break;
       
+      case IDC_TOGGLE_SPECTRAL_WIND:
+         g_pGrassField->ToggleSpectralWind();
+         break;
+      
       //case IDC_FIX_CAMERA:
       //   g_RotCamController.isFixed = !g_RotCamController.isFixed;
       //   if (g_RotCamController.isFixed) {
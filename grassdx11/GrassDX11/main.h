@@ -181,6 +181,7 @@ enum IDC_HUD
    IDC_TOGGLE_RENDERING_GRASS,
    IDC_TOGGLE_RENDERING_DBG_WIN,
    IDC_TOGGLE_DBG_WIN_SLICE,
+   IDC_TOGGLE_SPECTRAL_WIND,
    
    IDC_CAMERA_TYPE,
 
@@ -171,6 +171,30 @@ XMVECTOR Mesh::GetMoveDir (void)
    return XMLoadFloat3(&m_vMoveDir);
 }
 
+void Mesh::GetBounds (XMVECTOR& a_vMin, XMVECTOR& a_vMax)
+{
+   XMFLOAT4 vPosAndRadius = GetPosAndRadius();
+   XMVECTOR vPos = XMLoadFloat4(&vPosAndRadius);
+   XMVECTOR vRadius = XMVectorReplicate(vPosAndRadius.w);
+   a_vMin = vPos - vRadius;
+   a_vMax = vPos + vRadius;
+   if (m_pContacts != NULL && m_pContacts->Count() > 0)
+   {
+      XMVECTOR vMin, vMax;
+      m_pContacts->GetBounds(vMin, vMax);
+      a_vMin = XMVectorMin(a_vMin, vMin);
+      a_vMax = XMVectorMax(a_vMax, vMax);
+   }
+}
+
+bool Mesh::Collide(XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End,
+   PhysPatch::BladePhysData *a_pBladePhysData, int a_iSegmentIndex)
+{
+   if (m_pContacts == NULL)
+      return false;
+   return m_pContacts->Collide(Ret, Beg, End);
+}
+
 XMFLOAT4X4 Mesh::GetMatr (void)
 {
    return m_mMatr;
@@ -199,6 +223,28 @@ void Mesh::Render()
    m_pD3DDeviceCtx->DrawIndexed(m_uIndexCount, 0, 0);
 }
 
+UINT Mesh::CollideSegments(XMVECTOR* a_pRet, bool* a_pHit, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount,
+   PhysPatch::BladePhysData** a_ppBladePhysData, int a_iSegmentIndex)
+{
+   return CollideSegmentsScalar(a_pRet, a_pHit, a_pBeg, a_pEnd, a_uCount, a_ppBladePhysData, a_iSegmentIndex);
+}
+
+UINT Mesh::CollideSegmentsScalar(XMVECTOR* a_pRet, bool* a_pHit, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount,
+   PhysPatch::BladePhysData** a_ppBladePhysData, int a_iSegmentIndex)
+{
+   UINT uNumHits = 0;
+   for (UINT i = 0; i < a_uCount; i++)
+   {
+      XMVECTOR vBeg = a_pBeg[i], vEnd = a_pEnd[i];
+      a_pHit[i] = Collide(&a_pRet[i], vBeg, vEnd, a_ppBladePhysData[i], a_iSegmentIndex);
+      if (a_pHit[i])
+         uNumHits++;
+      else
+         a_pRet[i] = XMVectorZero();
+   }
+   return uNumHits;
+}
+
 void Mesh::SetTransform(XMFLOAT4X4& a_mTransform)
 {
    m_mTransform = a_mTransform;
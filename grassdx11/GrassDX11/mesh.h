@@ -2,6 +2,7 @@
 
 #include "includes.h"
 #include "PhysPatch.h"
+#include "ContactPrimitives.h"
 
 struct MeshVertex
 {   
@@ -40,6 +41,9 @@ protected:
 
    float                                m_Angle;
 
+   /* wheels or feet moving with the mesh, not owned */
+   ContactPrimitives                   *m_pContacts     = NULL;
+
    void CreateVertexBuffer();
    void CreateInputLayout();
 public:
@@ -55,15 +59,41 @@ public:
    virtual void        SetInvTransform (XMFLOAT4X4& a_mInvTransform);
    virtual XMFLOAT4    GetPosAndRadius (void);
    virtual XMVECTOR    GetMoveDir      (void);
+   /* world-space box around the colliding part of the mesh, the box of the bounding sphere and the contacts here */
+   virtual void        GetBounds       (XMVECTOR& a_vMin, XMVECTOR& a_vMax);
    virtual XMFLOAT4X4  GetMatr         (void);
    virtual void        Render          (void);
 
+   /**
+   Attaches capsules and cylinders, Collide and GetBounds of the meshes that
+   do not override them go through the contacts, placed by the mesh owner
+   */
+   void                AttachContacts  (ContactPrimitives* a_pContacts) { m_pContacts = a_pContacts; }
+   ContactPrimitives*  GetContacts     (void) { return m_pContacts; }
+
 
    virtual bool CheckCollision (XMVECTOR &Beg, XMVECTOR &End, float* Dist) { return false; }
 
    virtual bool Collide(XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End,
-      PhysPatch::BladePhysData *a_pBladePhysData, int a_iSegmentIndex) 
-   { return false; }
+      PhysPatch::BladePhysData *a_pBladePhysData, int a_iSegmentIndex);
+
+   /**
+   Collide for a_uCount segments at once. This one calls Collide per segment
+   and is the reference for the meshes that override it
+   param a_pRet rotation vectors (world space) of the colliding segments, zero for the others
+   param a_pHit true for the colliding segments
+   param a_ppBladePhysData blade of every segment
+   param a_iSegmentIndex index of the segments in their blades
+   return number of colliding segments
+   */
+   virtual UINT CollideSegments(XMVECTOR* a_pRet, bool* a_pHit, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount,
+      PhysPatch::BladePhysData **a_ppBladePhysData, int a_iSegmentIndex);
+
+   /**
+   Scalar reference of CollideSegments, whatever the mesh overrides
+   */
+   UINT CollideSegmentsScalar(XMVECTOR* a_pRet, bool* a_pHit, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount,
+      PhysPatch::BladePhysData **a_ppBladePhysData, int a_iSegmentIndex);
 
    virtual float GetDist      (XMVECTOR& Pnt, bool* IsUnderWheel) { return 0; }
    virtual void  RotateToEdge (XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End) {}
@@ -20,11 +20,14 @@ Plane::Plane (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx,
    m_fWheelBeg = a_fWheelBeg;
    m_fWheelEnd = a_fWheelEnd;
 
-   // Render if we need 
-   ID3DX11EffectTechnique* pTechnique = a_pEffect->GetTechniqueByIndex(0);
-   m_pPass = pTechnique->GetPassByName("RenderMeshPassDbg");
+   // Render if we need, without an effect the plane only collides
+   if (a_pEffect != NULL)
+   {
+      ID3DX11EffectTechnique* pTechnique = a_pEffect->GetTechniqueByIndex(0);
+      m_pPass = pTechnique->GetPassByName("RenderMeshPassDbg");
 
-   m_pTransformEMV = a_pEffect->GetVariableByName("g_mWorld")->AsMatrix();
+      m_pTransformEMV = a_pEffect->GetVariableByName("g_mWorld")->AsMatrix();
+   }
   // m_pTextureESRV = a_pEffect->GetVariableByName("g_txMeshDiffuse")->AsShaderResource();
   // CreateDDSTextureFromFile(m_pD3DDevice, L"resources/stone.dds", nullptr, &m_pTextureSRV);
    
@@ -37,8 +40,11 @@ Plane::Plane (ID3D11Device* a_pD3DDevice, ID3D11DeviceContext* a_pD3DDeviceCtx,
    XMMATRIX newTransform = XMMatrixTranslation(a_vPosAndRadius.x, a_vPosAndRadius.y, a_vPosAndRadius.z);
    XMStoreFloat4x4(&m_mTransform, newTransform);
 
-   CreateVertexBuffer();
-   CreateInputLayout();
+   if (m_pD3DDevice != NULL && m_pPass != NULL)
+   {
+      CreateVertexBuffer();
+      CreateInputLayout();
+   }
 
    XMStoreFloat4x4(&m_mTranslation, XMMatrixIdentity());
    XMStoreFloat4x4(&m_mRotation,    XMMatrixIdentity());
@@ -199,6 +205,20 @@ void Plane::SetInvTransform (XMFLOAT4X4& a_mInvTransform)
    XMStoreFloat4x4(&m_mTransform, tr);
 }
 
+void Plane::GetBounds (XMVECTOR& a_vMin, XMVECTOR& a_vMax)
+{
+   XM_TO_M(m_mTransform, tr);
+   a_vMin = XMVectorReplicate(FLT_MAX);
+   a_vMax = XMVectorReplicate(-FLT_MAX);
+   for (int i = 0; i < 4; i++)
+   {
+      XMVECTOR vCorner = create((i & 1) ? m_fWidth : -m_fWidth, (i & 2) ? m_fHeight : -m_fHeight, 0.0f);
+      vCorner = XMVector3TransformCoord(vCorner, tr);
+      a_vMin = XMVectorMin(a_vMin, vCorner);
+      a_vMax = XMVectorMax(a_vMax, vCorner);
+   }
+}
+
 bool Plane::CheckCollision(XMVECTOR& Beg, XMVECTOR& End, float* Dist)
 {
    XMVECTOR loc_beg, loc_end;
@@ -241,6 +261,158 @@ bool Plane::CheckCollision(XMVECTOR& Beg, XMVECTOR& End, float* Dist)
 }
 
 
+/* a_vIn * a_m for PHYS_LANES points at once, the matrix is affine */
+static void TransformLanes(LaneVec3& a_vOut, const LaneVec3& a_vIn, const XMFLOAT4X4& a_m, bool a_bPoint)
+{
+   a_vOut.x = XMVectorMultiply(a_vIn.x, XMVectorReplicate(a_m._11));
+   a_vOut.y = XMVectorMultiply(a_vIn.x, XMVectorReplicate(a_m._12));
+   a_vOut.z = XMVectorMultiply(a_vIn.x, XMVectorReplicate(a_m._13));
+   a_vOut.x = XMVectorMultiplyAdd(a_vIn.y, XMVectorReplicate(a_m._21), a_vOut.x);
+   a_vOut.y = XMVectorMultiplyAdd(a_vIn.y, XMVectorReplicate(a_m._22), a_vOut.y);
+   a_vOut.z = XMVectorMultiplyAdd(a_vIn.y, XMVectorReplicate(a_m._23), a_vOut.z);
+   a_vOut.x = XMVectorMultiplyAdd(a_vIn.z, XMVectorReplicate(a_m._31), a_vOut.x);
+   a_vOut.y = XMVectorMultiplyAdd(a_vIn.z, XMVectorReplicate(a_m._32), a_vOut.y);
+   a_vOut.z = XMVectorMultiplyAdd(a_vIn.z, XMVectorReplicate(a_m._33), a_vOut.z);
+   if (a_bPoint)
+   {
+      a_vOut.x = XMVectorAdd(a_vOut.x, XMVectorReplicate(a_m._41));
+      a_vOut.y = XMVectorAdd(a_vOut.y, XMVectorReplicate(a_m._42));
+      a_vOut.z = XMVectorAdd(a_vOut.z, XMVectorReplicate(a_m._43));
+   }
+}
+
+/* 1 / length, 0 for zero vectors as in XMVector3Normalize */
+static XMVECTOR InvLengthLanes(XMVECTOR a_vX, XMVECTOR a_vY, XMVECTOR a_vZ)
+{
+   XMVECTOR vLenSq = XMVectorMultiplyAdd(a_vX, a_vX, XMVectorMultiplyAdd(a_vY, a_vY, XMVectorMultiply(a_vZ, a_vZ)));
+   XMVECTOR vInv = XMVectorDivide(XMVectorReplicate(1.0f), XMVectorSqrt(vLenSq));
+   return XMVectorSelect(vInv, XMVectorZero(), XMVectorEqual(vLenSq, XMVectorZero()));
+}
+
+static_assert(PHYS_LANES == 4, "Plane::CollideLanes transposes the lanes as a 4x4 matrix");
+
+bool Plane::Collide (XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End,
+   PhysPatch::BladePhysData* a_pBladePhysData, int a_iSegmentIndex)
+{
+   return Collide(Ret, Beg, End, a_pBladePhysData);
+}
+
+
+UINT Plane::CollideSegments (XMVECTOR* a_pRet, bool* a_pHit, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount,
+   PhysPatch::BladePhysData** a_ppBladePhysData, int a_iSegmentIndex)
+{
+   UINT uNumHits = 0;
+   for (UINT uBase = 0; uBase < a_uCount; uBase += PHYS_LANES)
+   {
+      UINT uLanes = min(a_uCount - uBase, (UINT)PHYS_LANES);
+      UINT uMask = CollideLanes(a_pRet + uBase, a_pBeg + uBase, a_pEnd + uBase, uLanes);
+      for (UINT i = 0; i < uLanes; i++)
+      {
+         a_pHit[uBase + i] = (uMask & (1 << i)) != 0;
+         if (a_pHit[uBase + i])
+            uNumHits++;
+      }
+   }
+   return uNumHits;
+}
+
+
+UINT Plane::CollideLanes(XMVECTOR* a_pRet, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount) const
+{
+   UINT k;
+   XMVECTOR vBeg[PHYS_LANES], vEnd[PHYS_LANES];
+   for (k = 0; k < PHYS_LANES; k++)
+   {
+      /* missing lanes repeat the first segment and are masked out at the end */
+      vBeg[k] = a_pBeg[(k < a_uCount) ? k : 0];
+      vEnd[k] = a_pEnd[(k < a_uCount) ? k : 0];
+   }
+
+   /* AoS -> SoA */
+   XMMATRIX mBeg = XMMatrixTranspose(XMMATRIX(vBeg[0], vBeg[1], vBeg[2], vBeg[3]));
+   XMMATRIX mEnd = XMMatrixTranspose(XMMATRIX(vEnd[0], vEnd[1], vEnd[2], vEnd[3]));
+   LaneVec3 vWorldBeg = { mBeg.r[0], mBeg.r[1], mBeg.r[2] };
+   LaneVec3 vWorldEnd = { mEnd.r[0], mEnd.r[1], mEnd.r[2] };
+
+   // In model coordinate system
+   LaneVec3 vLocBeg, vLocEnd;
+   TransformLanes(vLocBeg, vWorldBeg, m_mInvTransform, true);
+   TransformLanes(vLocEnd, vWorldEnd, m_mInvTransform, true);
+
+   // Count plane interval intersection
+   XMVECTOR vZero = XMVectorZero();
+   XMVECTOR vOne = XMVectorReplicate(1.0f);
+   XMVECTOR vDirX = XMVectorSubtract(vLocEnd.x, vLocBeg.x);
+   XMVECTOR vDirY = XMVectorSubtract(vLocEnd.y, vLocBeg.y);
+   XMVECTOR vDirZ = XMVectorSubtract(vLocEnd.z, vLocBeg.z);
+   XMVECTOR vT = XMVectorDivide(XMVectorNegate(vLocBeg.z), vDirZ);
+   XMVECTOR vX = XMVectorMultiplyAdd(vT, vDirX, vLocBeg.x);
+   XMVECTOR vY = XMVectorMultiplyAdd(vT, vDirY, vLocBeg.y);
+
+   XMVECTOR vHit = XMVectorLess(XMVectorMultiply(vLocBeg.z, vLocEnd.z), vZero);
+   vHit = XMVectorAndInt(vHit, XMVectorGreaterOrEqual(vT, vZero));
+   vHit = XMVectorAndInt(vHit, XMVectorLessOrEqual(vT, vOne));
+   vHit = XMVectorAndInt(vHit, XMVectorLessOrEqual(XMVectorAbs(vX), XMVectorReplicate(m_fWidth)));
+   vHit = XMVectorAndInt(vHit, XMVectorLessOrEqual(XMVectorAbs(vY), XMVectorReplicate(m_fHeight)));
+
+   UINT uMask = 0;
+   for (k = 0; k < a_uCount; k++)
+      if (XMVectorGetIntByIndex(vHit, k))
+         uMask |= 1 << k;
+   if (uMask == 0)
+   {
+      for (k = 0; k < a_uCount; k++)
+         a_pRet[k] = vZero;
+      return 0;
+   }
+
+   // Count rotation angle
+   XMVECTOR vAX = XMVectorSubtract(vLocBeg.x, vX);
+   XMVECTOR vAY = XMVectorSubtract(vLocBeg.y, vY);
+   XMVECTOR vA = XMVectorSqrt(XMVectorMultiplyAdd(vAX, vAX, XMVectorMultiplyAdd(vAY, vAY, XMVectorMultiply(vLocBeg.z, vLocBeg.z))));
+   XMVECTOR vInvB = InvLengthLanes(vDirX, vDirY, vDirZ);
+   XMVECTOR vInvProj = InvLengthLanes(vDirX, vDirY, vZero);
+
+   LaneVec3 vDir = { XMVectorMultiply(vDirX, vInvB), XMVectorMultiply(vDirY, vInvB), XMVectorMultiply(vDirZ, vInvB) };
+   LaneVec3 vProj = { XMVectorMultiply(vDirX, vInvProj), XMVectorMultiply(vDirY, vInvProj), vZero };
+
+   XMVECTOR vAngle = XMVectorMultiplyAdd(vProj.x, vDir.x, XMVectorMultiply(vProj.y, vDir.y));
+   vAngle = XMVectorClamp(vAngle, XMVectorNegate(vOne), vOne);
+   XMVECTOR vPi = XMVectorReplicate((float)M_PI);
+   XMVECTOR vAlpha = XMVectorSubtract(vPi, XMVectorACos(vAngle));
+   XMVECTOR vBeta = XMVectorMultiply(XMVectorMultiply(vA, XMVectorSin(vAlpha)), vInvB);
+   vBeta = XMVectorSqrt(XMVectorNegativeMultiplySubtract(vBeta, vBeta, vOne));
+   vBeta = XMVectorACos(XMVectorClamp(vBeta, XMVectorNegate(vOne), vOne));
+   XMVECTOR vGamma = XMVectorSubtract(XMVectorSubtract(vPi, vBeta), vAlpha);
+
+   // Count rotation axis: cross(dir, proj), proj.z is 0
+   LaneVec3 vPsi;
+   vPsi.x = XMVectorNegate(XMVectorMultiply(vDir.z, vProj.y));
+   vPsi.y = XMVectorMultiply(vDir.z, vProj.x);
+   vPsi.z = XMVectorSubtract(XMVectorMultiply(vDir.x, vProj.y), XMVectorMultiply(vDir.y, vProj.x));
+   XMVECTOR vInvPsi = InvLengthLanes(vPsi.x, vPsi.y, vPsi.z);
+   vPsi.x = XMVectorMultiply(vPsi.x, vInvPsi);
+   vPsi.y = XMVectorMultiply(vPsi.y, vInvPsi);
+   vPsi.z = XMVectorMultiply(vPsi.z, vInvPsi);
+
+   /* to world space, a direction */
+   LaneVec3 vRet;
+   TransformLanes(vRet, vPsi, m_mTransform, false);
+   XMVECTOR vScale = XMVectorMultiply(InvLengthLanes(vRet.x, vRet.y, vRet.z), XMVectorMultiply(vGamma, XMVectorReplicate(1.1f)));
+
+   /* SoA -> AoS, lanes that miss may hold nan and are zeroed */
+   XMMATRIX mRet = XMMatrixTranspose(XMMATRIX(
+      XMVectorSelect(vZero, XMVectorMultiply(vRet.x, vScale), vHit),
+      XMVectorSelect(vZero, XMVectorMultiply(vRet.y, vScale), vHit),
+      XMVectorSelect(vZero, XMVectorMultiply(vRet.z, vScale), vHit),
+      vZero));
+   for (k = 0; k < a_uCount; k++)
+      a_pRet[k] = mRet.r[k];
+
+   return uMask;
+}
+
+
 bool Plane::Collide (XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End,
    PhysPatch::BladePhysData* a_pBladePhysData)
 {
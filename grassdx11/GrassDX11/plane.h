@@ -21,9 +21,23 @@ public:
 
    virtual void     SetTransform    (XMFLOAT4X4& a_mTransform) override;
    virtual void     SetInvTransform (XMFLOAT4X4& a_mInvTransform) override;
+   /* box of the four corners of the rectangle */
+   virtual void     GetBounds       (XMVECTOR& a_vMin, XMVECTOR& a_vMax) override;
 
    virtual bool  CheckCollision (XMVECTOR& Beg, XMVECTOR& End, float* Dist);
    virtual bool  Collide        (XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End, PhysPatch::BladePhysData* a_pBladePhysData);
+   /* the plane as a Mesh collider: Collide above, CollideSegments by CollideLanes */
+   virtual bool  Collide        (XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End,
+      PhysPatch::BladePhysData* a_pBladePhysData, int a_iSegmentIndex) override;
+   virtual UINT  CollideSegments(XMVECTOR* a_pRet, bool* a_pHit, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount,
+      PhysPatch::BladePhysData** a_ppBladePhysData, int a_iSegmentIndex) override;
+   /**
+   Collide for up to PHYS_LANES segments at once, one segment per SIMD lane
+   param a_pRet rotation vectors of the colliding segments, zero for the others
+   param a_uCount number of segments, at most PHYS_LANES
+   return bit k set if segment k collides
+   */
+   UINT          CollideLanes   (XMVECTOR* a_pRet, const XMVECTOR* a_pBeg, const XMVECTOR* a_pEnd, UINT a_uCount) const;
    virtual float GetDist        (XMVECTOR& Pnt, bool* IsUnderWheel);
    virtual void  RotateToEdge   (XMVECTOR* Ret, XMVECTOR& Beg, XMVECTOR& End);
 
@@ -0,0 +1,71 @@
+#include "GrassTests.h"
+#include "plane.h"
+#include "PhysRandom.h"
+
+#include <vector>
+
+#define COLLISION_TEST_SEGMENTS 100000
+/* largest difference of the lane and the scalar rotation vectors, the lanes take the DirectXMath acos and sin estimates */
+#define COLLISION_MAX_ERROR     1e-4f
+
+static_assert(sizeof(bool) == sizeof(UINT8), "the hit flags are bytes");
+
+/**
+Mesh::CollideSegments of a mesh against Mesh::CollideSegmentsScalar, on random
+blade-sized segments around its bounding sphere. The hits must agree exactly
+*/
+static void CheckSegments (Mesh& a_Mesh, UINT a_uSeed)
+{
+   std::vector<XMVECTOR> vBeg(COLLISION_TEST_SEGMENTS), vEnd(COLLISION_TEST_SEGMENTS);
+   std::vector<XMVECTOR> vScalar(COLLISION_TEST_SEGMENTS), vBatched(COLLISION_TEST_SEGMENTS);
+   std::vector<UINT8> ScalarHit(COLLISION_TEST_SEGMENTS), BatchedHit(COLLISION_TEST_SEGMENTS);
+   std::vector<PhysPatch::BladePhysData*> pBlades(COLLISION_TEST_SEGMENTS, NULL);
+
+   XMFLOAT4 vPosAndRadius = a_Mesh.GetPosAndRadius();
+   float3 vCenter = XMLoadFloat4(&vPosAndRadius);
+   float fR = vPosAndRadius.w * 1.2f;
+   RandomStream random(a_uSeed);
+   for (UINT i = 0; i < COLLISION_TEST_SEGMENTS; i++)
+   {
+      vBeg[i] = vCenter + create(random.NextFloat(-fR, fR), random.NextFloat(-fR, fR), random.NextFloat(-fR, fR));
+      float3 vDir = normalize(create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f)));
+      vEnd[i] = vBeg[i] + vDir * random.NextFloat(0.1f, 0.5f);
+   }
+
+   /* std::vector<bool> is packed, the flags are bytes handed out as bool */
+   UINT uScalarHits = a_Mesh.CollideSegmentsScalar(vScalar.data(), (bool*)ScalarHit.data(), vBeg.data(), vEnd.data(),
+      COLLISION_TEST_SEGMENTS, pBlades.data(), 1);
+   UINT uBatchedHits = a_Mesh.CollideSegments(vBatched.data(), (bool*)BatchedHit.data(), vBeg.data(), vEnd.data(),
+      COLLISION_TEST_SEGMENTS, pBlades.data(), 1);
+
+   UINT uMismatches = 0;
+   float fMaxDiff = 0.0f;
+   for (UINT i = 0; i < COLLISION_TEST_SEGMENTS; i++)
+   {
+      if (ScalarHit[i] != BatchedHit[i])
+         uMismatches++;
+      else if (ScalarHit[i])
+         fMaxDiff = max(fMaxDiff, length(vScalar[i] - vBatched[i]));
+   }
+   printf("   %u segments, %u hits: %u mismatches, max difference %g\n", COLLISION_TEST_SEGMENTS, uScalarHits, uMismatches, fMaxDiff);
+   CHECK(uScalarHits > 0);
+   CHECK(uScalarHits == uBatchedHits);
+   CHECK(uMismatches == 0);
+   CHECK_BELOW(fMaxDiff, COLLISION_MAX_ERROR);
+}
+
+/* headless planes of the car sizes, turned and moved off the origin */
+GRASS_TEST(PlaneSegmentsMatchScalar)
+{
+   const float fYaws[] = { 0.0f, 0.7f, 2.3f };
+   for (UINT k = 0; k < ARRAYSIZE(fYaws); k++)
+   {
+      XMFLOAT4 vPosAndRadius(3.0f * k, 0.5f, -2.0f * k, 0.0f);
+      Plane plane(NULL, NULL, NULL, vPosAndRadius, 2.0f, 1.0f, INVALID_DIST, INVALID_DIST);
+      XMFLOAT4X4 mTransform;
+      XMStoreFloat4x4(&mTransform, XMMatrixRotationRollPitchYaw(0.1f * k, fYaws[k], 0.0f) *
+         XMMatrixTranslation(vPosAndRadius.x, vPosAndRadius.y, vPosAndRadius.z));
+      plane.SetTransform(mTransform);
+      CheckSegments(plane, k + 1);
+   }
+}
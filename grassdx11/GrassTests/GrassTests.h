@@ -0,0 +1,43 @@
+#pragma once
+
+#include "includes.h"
+
+#include <cstdio>
+
+/**
+Headless checks of the GrassDX11 code, no window and no device.
+A test is a function registered with GRASS_TEST, the runner calls all of them
+(or the ones whose name contains the first argument) and exits with 1 if any check failed.
+Data files are read relative to the GrassDX11 directory, the post-build step runs there
+*/
+typedef void (*TestFunc)(void);
+
+struct TestCase
+{
+   const char *sName;
+   TestFunc    pFunc;
+   TestCase   *pNext;
+
+   TestCase (const char* a_sName, TestFunc a_pFunc);
+};
+
+/**
+Records a check, prints it with a_sFile and a_iLine if it failed
+return a_bPassed
+*/
+bool ReportCheck (bool a_bPassed, const char* a_sExpr, const char* a_sFile, int a_iLine);
+
+#define GRASS_TEST(name) \
+static void name (void); \
+static TestCase s_##name##Case(#name, name); \
+static void name (void)
+
+#define CHECK(expr) ReportCheck((expr) ? true : false, #expr, __FILE__, __LINE__)
+
+/* a_fValue below a_fLimit, both printed when it is not */
+#define CHECK_BELOW(value, limit) \
+do { \
+   float fCheckValue = (float)(value), fCheckLimit = (float)(limit); \
+   if (!ReportCheck(fCheckValue < fCheckLimit, #value " < " #limit, __FILE__, __LINE__)) \
+      printf("      %g >= %g\n", fCheckValue, fCheckLimit); \
+} while (0)
@@ -0,0 +1,264 @@
+#include "GrassTests.h"
+#include "PatchSlots.h"
+#include "PhysRandom.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+What PatchSlots should do, by brute force: a linear scan for the cell lookups,
+a stack of the dead slots for the free list and a pending flag for the expiry queue
+*/
+struct SlotModel
+{
+   struct Slot
+   {
+      bool  bAlive;
+      bool  bPending;
+      float fX;
+      float fZ;
+      float fExpireTime;
+   };
+
+   std::vector<Slot> Slots;
+   std::vector<int>  Free;   /* the back is taken next */
+
+   static int Cell(float a_fPos)
+   {
+      return (int)floorf(a_fPos + 0.5f);
+   }
+
+   int Find(float a_fX, float a_fZ) const
+   {
+      for (size_t i = 0; i < Slots.size(); i++)
+      {
+         if (Slots[i].bAlive && Cell(Slots[i].fX) == Cell(a_fX) && Cell(Slots[i].fZ) == Cell(a_fZ))
+            return (int)i;
+      }
+      return NO_VALUE;
+   }
+
+   void Grow(int a_iCount)
+   {
+      int iOldCount = (int)Slots.size();
+      Slot slot = { false, false, 0.0f, 0.0f, 0.0f };
+      Slots.resize(iOldCount + a_iCount, slot);
+      for (int i = (int)Slots.size() - 1; i >= iOldCount; i--)
+         Free.push_back(i);
+   }
+
+   bool Shrink(int a_iCount)
+   {
+      for (size_t i = a_iCount; i < Slots.size(); i++)
+      {
+         if (Slots[i].bAlive)
+            return false;
+      }
+      Slots.resize(a_iCount);
+      Free.clear();
+      for (int i = a_iCount - 1; i >= 0; i--)
+      {
+         if (!Slots[i].bAlive)
+            Free.push_back(i);
+      }
+      return true;
+   }
+
+   int Take(float a_fX, float a_fZ)
+   {
+      if (Free.empty())
+         return NO_VALUE;
+      int i = Free.back();
+      Free.pop_back();
+      Slots[i].bAlive = true;
+      Slots[i].fX = a_fX;
+      Slots[i].fZ = a_fZ;
+      return i;
+   }
+
+   bool Kill(int a_iSlot)
+   {
+      if (!Slots[a_iSlot].bAlive)
+         return false;
+      Slots[a_iSlot].bAlive = false;
+      Free.push_back(a_iSlot);
+      return true;
+   }
+
+   void SetExpireTime(int a_iSlot, float a_fTime)
+   {
+      Slots[a_iSlot].fExpireTime = a_fTime;
+      Slots[a_iSlot].bPending = true;
+   }
+
+   /* slots PopExpired returns, in slot order */
+   void PopExpired(float a_fTime, std::vector<int>& a_Out)
+   {
+      for (size_t i = 0; i < Slots.size(); i++)
+      {
+         if (Slots[i].bPending && Slots[i].fExpireTime <= a_fTime)
+         {
+            Slots[i].bPending = false;
+            a_Out.push_back((int)i);
+         }
+      }
+   }
+};
+
+/**
+Random takes, kills, lifetimes, expiries, shrinks and lookups as GrassPool makes them,
+on slots growing by a_iChunk up to 8 chunks, compared with SlotModel after every call
+*/
+static void RunSlotScript(int a_iChunk, UINT a_uNumOps)
+{
+   PatchSlots slots;
+   SlotModel model;
+   slots.SetGrid(0.0f, 1.0f);
+   slots.Grow(a_iChunk);
+   model.Grow(a_iChunk);
+
+   /* twice as many cells as slots, so takes fail on full slots too; positions a little off the grid nodes */
+   int iMaxCount = 8 * a_iChunk;
+   UINT uSide = (UINT)ceilf(sqrtf(2.0f * iMaxCount));
+   RandomStream random(a_iChunk);
+   float fTime = 0.0f;
+   /* lifetimes long enough for the slots to grow by several chunks */
+   float fMaxLifeTime = 0.5f * a_iChunk + 1.0f;
+   UINT uDrainPeriod = 64 * a_iChunk;
+
+   UINT uNumMismatches = 0, uNumModelMisses = 0, uNumExpired = 0, uNumShrinks = 0;
+   std::vector<int> expired, modelExpired;
+   for (UINT uOp = 0; uOp < a_uNumOps; uOp++)
+   {
+      UINT uCell = random.NextUInt(uSide * uSide);
+      float fX = (uCell % uSide) + random.NextFloat(-0.01f, 0.01f);
+      float fZ = (uCell / uSide) + random.NextFloat(-0.01f, 0.01f);
+      int iSlot = (int)random.NextUInt((UINT)slots.Count());
+
+      /* now and then all lifetimes expire, so whole chunks empty and are released */
+      bool bDrain = (uOp % uDrainPeriod == uDrainPeriod - 1);
+      UINT uCall = bDrain ? 3 : random.NextUInt(7);
+      switch (uCall)
+      {
+      case 0:
+      case 6:
+      {
+         /* taken for a cell without a patch, the slots grow by a chunk when none is free */
+         if (slots.Find(fX, fZ) != NO_VALUE)
+            break;
+         int iTaken = slots.Take(fX, fZ);
+         if (iTaken == NO_VALUE && slots.Count() < iMaxCount)
+         {
+            slots.Grow(a_iChunk);
+            iTaken = slots.Take(fX, fZ);
+            model.Grow(a_iChunk);
+         }
+         if (iTaken != model.Take(fX, fZ))
+            uNumModelMisses++;
+         if (iTaken != NO_VALUE)
+         {
+            slots.SetExpireTime(iTaken, fTime + random.NextFloat(0.0f, fMaxLifeTime));
+            model.SetExpireTime(iTaken, slots.ExpireTime(iTaken));
+         }
+         break;
+      }
+      case 1:
+         if (slots.Kill(iSlot) != model.Kill(iSlot))
+            uNumModelMisses++;
+         break;
+      case 2:
+      {
+         /* lifetime cut or extended, the queue entry is reused or pushed again */
+         if (!slots.IsAlive(iSlot))
+            break;
+         float fExpire = fTime + random.NextFloat(0.0f, fMaxLifeTime);
+         slots.SetExpireTime(iSlot, fExpire);
+         model.SetExpireTime(iSlot, fExpire);
+         break;
+      }
+      case 3:
+      {
+         /* expiry kills the alive slots, as GrassPool::ClearDeadPatches does */
+         fTime += bDrain ? fMaxLifeTime : random.NextFloat(0.0f, 0.3f);
+         expired.clear();
+         modelExpired.clear();
+         for (int i = slots.PopExpired(fTime); i != NO_VALUE; i = slots.PopExpired(fTime))
+         {
+            expired.push_back(i);
+            slots.Kill(i);
+         }
+         /* killed in the order they were popped, which sets the order of the free list */
+         model.PopExpired(fTime, modelExpired);
+         for (size_t e = 0; e < expired.size(); e++)
+            model.Kill(expired[e]);
+         std::sort(expired.begin(), expired.end());
+         if (expired != modelExpired)
+            uNumModelMisses++;
+         uNumExpired += (UINT)expired.size();
+         break;
+      }
+      case 4:
+      {
+         /* the last chunk is released once it is empty */
+         if (slots.Count() <= a_iChunk)
+            break;
+         bool bShrunk = slots.Shrink(slots.Count() - a_iChunk);
+         if (bShrunk != model.Shrink((int)model.Slots.size() - a_iChunk))
+            uNumModelMisses++;
+         uNumShrinks += bShrunk ? 1 : 0;
+         break;
+      }
+      default:
+         if (slots.Find(fX, fZ) != model.Find(fX, fZ))
+            uNumModelMisses++;
+         break;
+      }
+
+      uNumMismatches += slots.Mismatches();
+      if (slots.Count() != (int)model.Slots.size() || slots.AliveCount() != (int)(model.Slots.size() - model.Free.size()))
+         uNumModelMisses++;
+   }
+
+   printf("   chunk %d, %u operations: %u expired, %u shrinks, %u mismatches, %u model misses\n",
+      a_iChunk, a_uNumOps, uNumExpired, uNumShrinks, uNumMismatches, uNumModelMisses);
+   CHECK(uNumMismatches == 0);
+   CHECK(uNumModelMisses == 0);
+   CHECK(uNumExpired > 0 && uNumShrinks > 0);
+}
+
+GRASS_TEST(PatchSlotsMatchModel)
+{
+   RunSlotScript(1, 20000);
+   RunSlotScript(16, 20000);
+   RunSlotScript(64, 20000);
+}
+
+GRASS_TEST(PatchSlotsReuseFreedSlot)
+{
+   PatchSlots slots;
+   slots.SetGrid(-0.5f, 2.0f);
+   slots.Grow(4);
+
+   /* the lowest slot first, a freed slot before the never used ones */
+   CHECK(slots.Take(0.0f, 0.0f) == 0);
+   CHECK(slots.Take(2.0f, 0.0f) == 1);
+   CHECK(slots.Kill(0));
+   CHECK(!slots.Kill(0));
+   CHECK(slots.Take(4.0f, 0.0f) == 0);
+   CHECK(slots.Find(4.01f, -0.02f) == 0);
+   CHECK(slots.Find(0.0f, 0.0f) == NO_VALUE);
+
+   /* a new grid origin reindexes the alive slots */
+   slots.SetGrid(0.5f, 2.0f);
+   CHECK(slots.Find(4.0f, 0.0f) == 0);
+   CHECK(slots.Find(2.0f, 0.0f) == 1);
+   CHECK(slots.Mismatches() == 0);
+
+   /* slots past an alive one are not released */
+   CHECK(!slots.Shrink(1));
+   CHECK(slots.Kill(1));
+   CHECK(slots.Shrink(1));
+   CHECK(slots.Count() == 1 && slots.AliveCount() == 1);
+   CHECK(slots.Take(6.0f, 0.0f) == NO_VALUE);
+   CHECK(slots.Mismatches() == 0);
+}
@@ -0,0 +1,122 @@
+#include "GrassTests.h"
+#include "PhysMath.h"
+#include "PhysRandom.h"
+
+#include <vector>
+
+/* largest rotation error of a quaternion packed into R10G10B10A2 and unpacked */
+#define QUAT_PACK_MAX_ERROR 0.005f
+
+/* UnpackQuaternion of VSIn.fx after the R10G10B10A2_UNORM fetch of the vertex */
+static float4 UnpackQuaternionVSIn(UINT a_uPacked)
+{
+   float3 v = create((float)(a_uPacked & 1023), (float)((a_uPacked >> 10) & 1023), (float)((a_uPacked >> 20) & 1023)) / 1023.0f;
+   float fW = (float)(a_uPacked >> 30) / 3.0f;
+   v = (v - create(0.5f, 0.5f, 0.5f)) * 1.41421356f;
+   float m = sqrtf(clamp(1.0f - XMVectorGetX(XMVector3Dot(v, v)), 0.0f, 1.0f));
+   UINT uLargest = (UINT)(fW * 3.0f + 0.5f);
+
+   if (uLargest == 0)
+      return create(m, getx(v), gety(v), getz(v));
+   if (uLargest == 1)
+      return create(getx(v), m, gety(v), getz(v));
+   if (uLargest == 2)
+      return create(getx(v), gety(v), m, getz(v));
+   return create(getx(v), gety(v), getz(v), m);
+}
+
+/* angle of the rotation between a and b, either may be off the unit length */
+static float QuaternionAngle(const float4& a, const float4& b)
+{
+   XMFLOAT4 qa, qb;
+   XMStoreFloat4(&qa, a);
+   XMStoreFloat4(&qb, b);
+   double fDot = (double)qa.x * qb.x + (double)qa.y * qb.y + (double)qa.z * qb.z + (double)qa.w * qb.w;
+   double fLen = sqrt(((double)qa.x * qa.x + (double)qa.y * qa.y + (double)qa.z * qa.z + (double)qa.w * qa.w) *
+      ((double)qb.x * qb.x + (double)qb.y * qb.y + (double)qb.z * qb.z + (double)qb.w * qb.w));
+   if (fLen <= 0.0)
+      return (float)M_PI;
+   return (float)(2.0 * acos(min(fabs(fDot) / fLen, 1.0)));
+}
+
+/* a component at or near +-1 in every place, ties of the largest two, four and
+   of the smallest three at their range bound */
+static void EdgeQuaternions(std::vector<float4>& a_Cases)
+{
+   const float fNear[] = { 1.0f, 0.99999f, 0.999f, 0.99f };
+   for (UINT i = 0; i < 4; i++)
+   {
+      for (UINT n = 0; n < sizeof(fNear) / sizeof(fNear[0]); n++)
+      {
+         float c[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+         float fRest = sqrtf(max(1.0f - fNear[n] * fNear[n], 0.0f) / 3.0f);
+         for (UINT k = 0; k < 4; k++)
+            c[k] = (k == i) ? fNear[n] : fRest * ((k & 1) ? -1.0f : 1.0f);
+         a_Cases.push_back(create(c[0], c[1], c[2], c[3]));
+         a_Cases.push_back(-create(c[0], c[1], c[2], c[3]));
+      }
+      for (UINT j = 0; j < 4; j++)
+      {
+         if (j == i)
+            continue;
+         float c[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+         c[i] = 0.70710678f;
+         c[j] = -0.70710678f;
+         a_Cases.push_back(create(c[0], c[1], c[2], c[3]));
+      }
+   }
+   for (UINT uSigns = 0; uSigns < 16; uSigns++)
+   {
+      float c[4];
+      for (UINT k = 0; k < 4; k++)
+         c[k] = (uSigns & (1 << k)) ? -0.5f : 0.5f;
+      a_Cases.push_back(create(c[0], c[1], c[2], c[3]));
+   }
+}
+
+/* uniform orientations, rejection sampled in the unit 4-ball */
+static void RandomQuaternions(std::vector<float4>& a_Cases, UINT a_uCount)
+{
+   RandomStream random(a_uCount);
+   while (a_Cases.size() < a_uCount)
+   {
+      float4 q = create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f));
+      float fLen2 = XMVectorGetX(XMVector4LengthSq(q));
+      if (fLen2 > 1e-4f && fLen2 <= 1.0f)
+         a_Cases.push_back(q / sqrtf(fLen2));
+   }
+}
+
+/* packs a_Cases, unpacks them on the CPU and as VSIn.fx does, checks the error bound and that every largest index is used */
+static void CheckPacking(const std::vector<float4>& a_Cases)
+{
+   UINT uLargest[4] = { 0, 0, 0, 0 };
+   float fMaxError = 0.0f;
+   float fMaxShaderError = 0.0f;
+   for (size_t i = 0; i < a_Cases.size(); i++)
+   {
+      UINT uPacked = PackQuaternion(a_Cases[i]);
+      uLargest[uPacked >> 30]++;
+      fMaxError = max(fMaxError, QuaternionAngle(a_Cases[i], UnpackQuaternion(uPacked)));
+      fMaxShaderError = max(fMaxShaderError, QuaternionAngle(a_Cases[i], UnpackQuaternionVSIn(uPacked)));
+   }
+   printf("   %u quaternions: max error %g rad, shader %g rad, largest index %u/%u/%u/%u\n", (UINT)a_Cases.size(),
+      fMaxError, fMaxShaderError, uLargest[0], uLargest[1], uLargest[2], uLargest[3]);
+   CHECK_BELOW(fMaxError, QUAT_PACK_MAX_ERROR);
+   CHECK_BELOW(fMaxShaderError, QUAT_PACK_MAX_ERROR);
+   CHECK(uLargest[0] > 0 && uLargest[1] > 0 && uLargest[2] > 0 && uLargest[3] > 0);
+}
+
+GRASS_TEST(QuaternionPackingEdgeCases)
+{
+   std::vector<float4> cases;
+   EdgeQuaternions(cases);
+   CheckPacking(cases);
+}
+
+GRASS_TEST(QuaternionPackingRandom)
+{
+   std::vector<float4> cases;
+   RandomQuaternions(cases, 100000);
+   CheckPacking(cases);
+}
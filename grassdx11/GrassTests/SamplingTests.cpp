@@ -0,0 +1,142 @@
+#include "GrassTests.h"
+#include "AirData.h"
+#include "BilinearGrid.h"
+#include "PhysRandom.h"
+
+#include <vector>
+
+/* largest difference of the batched and the scalar samples of grid values up to 5 */
+#define SAMPLE_BATCH_MAX_ERROR 5e-5f
+
+/* a grid of random vectors, odd sizes so no lane lines up with a row */
+static std::vector<XMFLOAT3> RandomGrid (UINT a_uWidth, UINT a_uHeight)
+{
+   RandomStream random(a_uWidth * 1000 + a_uHeight);
+   std::vector<XMFLOAT3> grid(a_uWidth * a_uHeight);
+   for (size_t i = 0; i < grid.size(); i++)
+      grid[i] = XMFLOAT3(random.NextFloat(-5.0f, 5.0f), random.NextFloat(-5.0f, 5.0f), random.NextFloat(-5.0f, 5.0f));
+   return grid;
+}
+
+/* random texcoords over several tiles, the negative ones too, then the texel centres and the tile edges */
+static void SampleTexCoords (UINT a_uWidth, UINT a_uHeight, float a_fTile, std::vector<float>& a_X, std::vector<float>& a_Y)
+{
+   RandomStream random(a_uWidth + a_uHeight);
+   for (UINT i = 0; i < 4000; i++)
+   {
+      a_X.push_back(random.NextFloat(-2.0f, 2.0f));
+      a_Y.push_back(random.NextFloat(-2.0f, 2.0f));
+   }
+   const float fEdges[] = { 0.0f, 1.0f, -1.0f, 1.0f - 1e-6f, -1e-6f, 0.5f };
+   for (float fEdgeX : fEdges)
+   {
+      for (float fEdgeY : fEdges)
+      {
+         a_X.push_back(fEdgeX / a_fTile);
+         a_Y.push_back(fEdgeY / a_fTile);
+      }
+   }
+   for (UINT i = 0; i < a_uWidth; i++)
+   {
+      a_X.push_back((i + 0.5f) / a_uWidth / a_fTile);
+      a_Y.push_back((i % a_uHeight + 0.5f) / a_uHeight / a_fTile);
+   }
+   /* a count that leaves a partial group of lanes */
+   if (a_X.size() % PHYS_LANES == 0)
+   {
+      a_X.push_back(0.25f);
+      a_Y.push_back(0.75f);
+   }
+}
+
+static float MaxComponentDiff (XMVECTOR a_vA, XMVECTOR a_vB)
+{
+   XMVECTOR vDiff = XMVectorAbs(XMVectorSubtract(a_vA, a_vB));
+   return max(getx(vDiff), max(gety(vDiff), getz(vDiff)));
+}
+
+/* SampleBilinearBatch against SampleBilinear, from an unaligned start of the texcoords too */
+static void CheckBatch (UINT a_uWidth, UINT a_uHeight, float a_fTile)
+{
+   std::vector<XMFLOAT3> grid = RandomGrid(a_uWidth, a_uHeight);
+   std::vector<float> vX, vY;
+   SampleTexCoords(a_uWidth, a_uHeight, a_fTile, vX, vY);
+
+   float fMaxDiff = 0.0f;
+   for (UINT uStart = 0; uStart < 2; uStart++)
+   {
+      UINT uCount = (UINT)vX.size() - uStart;
+      std::vector<XMVECTOR> vBatch(uCount);
+      SampleBilinearBatch(grid.data(), a_uWidth, a_uHeight, a_fTile, vX.data() + uStart, vY.data() + uStart, uCount, vBatch.data());
+      for (UINT i = 0; i < uCount; i++)
+      {
+         XMVECTOR vScalar = SampleBilinear(grid.data(), a_uWidth, a_uHeight, a_fTile, vX[uStart + i], vY[uStart + i]);
+         fMaxDiff = max(fMaxDiff, MaxComponentDiff(vScalar, vBatch[i]));
+      }
+   }
+   printf("   %ux%u grid, tile %g, %u samples: max difference %g\n", a_uWidth, a_uHeight, a_fTile, (UINT)vX.size(), fMaxDiff);
+   CHECK_BELOW(fMaxDiff, SAMPLE_BATCH_MAX_ERROR);
+}
+
+GRASS_TEST(SampleBatchMatchesScalar)
+{
+   CheckBatch(37, 23, 1.0f);
+   CheckBatch(128, 128, 3.7f);
+   CheckBatch(1, 5, 2.0f);
+}
+
+/* the air of the physics: AirData::GetAirValues against GetAirValue on a headless AirData */
+GRASS_TEST(AirBatchMatchesScalar)
+{
+   AirData air(NULL, NULL);
+   std::vector<XMFLOAT3> grid = RandomGrid(512, 512);
+   memcpy(air.data, grid.data(), grid.size() * sizeof(XMFLOAT3));
+
+   std::vector<float> vX, vY;
+   SampleTexCoords(512, 512, 1.0f, vX, vY);
+   std::vector<XMVECTOR> vBatch(vX.size());
+   air.GetAirValues(vX.data(), vY.data(), (UINT)vX.size(), vBatch.data());
+
+   float fMaxDiff = 0.0f;
+   for (size_t i = 0; i < vX.size(); i++)
+      fMaxDiff = max(fMaxDiff, MaxComponentDiff(air.GetAirValue(XMVectorSet(vX[i], vY[i], 0.0f, 0.0f)), vBatch[i]));
+   printf("   %u samples: max difference %g\n", (UINT)vX.size(), fMaxDiff);
+   CHECK_BELOW(fMaxDiff, SAMPLE_BATCH_MAX_ERROR);
+}
+
+/* SampleBilinear against the original sampler: the same values past the first texel centre, texel 0 before it */
+GRASS_TEST(SampleMatchesReference)
+{
+   const UINT uWidth = 37, uHeight = 23;
+   const float fTile = 1.0f;
+   std::vector<XMFLOAT3> grid = RandomGrid(uWidth, uHeight);
+   std::vector<float> vX, vY;
+   SampleTexCoords(uWidth, uHeight, fTile, vX, vY);
+
+   float fMaxDiff = 0.0f;
+   UINT uNumCompared = 0, uNumEdge = 0, uNumEdgeClamped = 0;
+   for (size_t i = 0; i < vX.size(); i++)
+   {
+      float fX = vX[i] * fTile, fY = vY[i] * fTile;
+      fX = (fX - floorf(fX)) * uWidth - 0.5f;
+      fY = (fY - floorf(fY)) * uHeight - 0.5f;
+      XMVECTOR vSample = SampleBilinear(grid.data(), uWidth, uHeight, fTile, vX[i], vY[i]);
+      if (fX >= 0.0f && fY >= 0.0f)
+      {
+         fMaxDiff = max(fMaxDiff, MaxComponentDiff(vSample, SampleBilinearReference(grid.data(), uWidth, uHeight, fTile, vX[i], vY[i])));
+         uNumCompared++;
+      }
+      else if (fX < 0.0f && fY < 0.0f)
+      {
+         /* below both first centres the sample is the corner texel */
+         uNumEdge++;
+         if (MaxComponentDiff(vSample, XMLoadFloat3(&grid[0])) < 1e-6f)
+            uNumEdgeClamped++;
+      }
+   }
+   printf("   %u samples past the first centres: max difference %g, %u of %u corner samples clamped\n",
+      uNumCompared, fMaxDiff, uNumEdgeClamped, uNumEdge);
+   CHECK(uNumCompared > 0 && uNumEdge > 0);
+   CHECK_BELOW(fMaxDiff, 1e-6f);
+   CHECK(uNumEdgeClamped == uNumEdge);
+}
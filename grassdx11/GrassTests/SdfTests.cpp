@@ -0,0 +1,81 @@
+#include "GrassTests.h"
+#include "SignedDistanceField.h"
+
+#include <vector>
+
+/* box of half size 1 at the origin, 16 voxels along it, nodes land on its faces */
+#define SDF_TEST_CELLS 16
+#define SDF_TEST_BAND  3.0f
+
+/* a triangle soup of the box, two triangles per face, wound outwards */
+static std::vector<XMFLOAT3> BoxTriangles (void)
+{
+   std::vector<XMFLOAT3> Triangles;
+   for (UINT uAxis = 0; uAxis < 3; uAxis++)
+   {
+      UINT uU = (uAxis + 1) % 3, uV = (uAxis + 2) % 3;
+      for (float fSide = -1.0f; fSide <= 1.0f; fSide += 2.0f)
+      {
+         float fCorners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+         /* u x v is the axis, the corners go backwards on the negative side */
+         UINT uOrder[6] = { 0, 1, 2, 0, 2, 3 };
+         for (UINT i = 0; i < 6; i++)
+         {
+            UINT uCorner = (fSide > 0.0f) ? uOrder[i] : uOrder[5 - i];
+            float fPos[3];
+            fPos[uAxis] = fSide;
+            fPos[uU] = fCorners[uCorner][0];
+            fPos[uV] = fCorners[uCorner][1];
+            Triangles.push_back(XMFLOAT3(fPos[0], fPos[1], fPos[2]));
+         }
+      }
+   }
+   return Triangles;
+}
+
+/* exact signed distance of the box */
+static float BoxDistance (float a_fX, float a_fY, float a_fZ)
+{
+   float fQ[3] = { fabsf(a_fX) - 1.0f, fabsf(a_fY) - 1.0f, fabsf(a_fZ) - 1.0f };
+   float fOut = 0.0f;
+   for (UINT c = 0; c < 3; c++)
+      fOut += max(fQ[c], 0.0f) * max(fQ[c], 0.0f);
+   return sqrtf(fOut) + min(max(fQ[0], max(fQ[1], fQ[2])), 0.0f);
+}
+
+/* every node of the field against the exact distance: the side at the faces, the edges and the corners, where the face normals disagree */
+GRASS_TEST(SdfMatchesBox)
+{
+   SignedDistanceField field;
+   field.Bake(BoxTriangles(), SDF_TEST_CELLS, SDF_TEST_BAND);
+   CHECK(!field.IsEmpty());
+
+   XMFLOAT3 vMin, vMax;
+   field.GetBounds(vMin, vMax);
+   float fVoxel = 2.0f / SDF_TEST_CELLS;
+   float fBand = field.Band();
+   UINT uNodes[3] = { (UINT)((vMax.x - vMin.x) / fVoxel + 0.5f), (UINT)((vMax.y - vMin.y) / fVoxel + 0.5f), (UINT)((vMax.z - vMin.z) / fVoxel + 0.5f) };
+
+   float fMaxDiff = 0.0f;
+   UINT uNumNodes = 0, uWrongSide = 0;
+   for (UINT z = 0; z < uNodes[2]; z++)
+   {
+      for (UINT y = 0; y < uNodes[1]; y++)
+      {
+         for (UINT x = 0; x < uNodes[0]; x++)
+         {
+            float fX = vMin.x + x * fVoxel, fY = vMin.y + y * fVoxel, fZ = vMin.z + z * fVoxel;
+            float fExact = BoxDistance(fX, fY, fZ);
+            float fSample = field.Sample(XMVectorSet(fX, fY, fZ, 0.0f), NULL);
+            uNumNodes++;
+            /* the surface nodes may take either sign */
+            if (fabsf(fExact) > 1e-3f && (fExact > 0.0f) != (fSample > 0.0f))
+               uWrongSide++;
+            fMaxDiff = max(fMaxDiff, fabsf(fSample - min(max(fExact, -fBand), fBand)));
+         }
+      }
+   }
+   printf("   %u nodes: %u on the wrong side, max difference %g\n", uNumNodes, uWrongSide, fMaxDiff);
+   CHECK(uWrongSide == 0);
+   CHECK_BELOW(fMaxDiff, 1e-3f);
+}
@@ -0,0 +1,98 @@
+#include "GrassTests.h"
+#include "PhysPatch.h"
+
+/* sub-type with the largest total hardness, the one the explicit solver has the hardest time with */
+template <typename TProperties>
+static GrassPropsUnified StiffestSubType(TProperties& a_SubTypes)
+{
+   GrassPropsUnified props = a_SubTypes.GetProperty(0);
+   for (UINT i = 1; i < a_SubTypes.GetDataNum(); i++)
+   {
+      GrassPropsUnified cur = a_SubTypes.GetProperty(i);
+      if (XMVectorGetX(XMVector3Dot(cur.vHardnessSegment, create(1, 1, 1))) > XMVectorGetX(XMVector3Dot(props.vHardnessSegment, create(1, 1, 1))))
+         props = cur;
+   }
+   return props;
+}
+
+/* stiffest sub-types of the two physics grass types, as main.cpp loads them */
+static void LoadPhysSubTypes(GrassPropsUnified a_Props[2])
+{
+   GrassPropertiesT1 t1(L"config/T1SubTypes.cfg");
+   GrassPropertiesT3 t3(L"config/T3SubTypes.cfg");
+   a_Props[0] = StiffestSubType(t1);
+   a_Props[1] = StiffestSubType(t3);
+}
+
+/* largest scalar / lane difference of CompareSolvers after 2 s of 60 Hz steps */
+#define SOLVER_MAX_ORIENTATION 0.01f
+#define SOLVER_MAX_VELOCITY    0.05f
+
+GRASS_TEST(LanesMatchScalarSolver)
+{
+   GrassPropsUnified props[2];
+   LoadPhysSubTypes(props);
+   CHECK(gety(props[0].vSizes) > 0.0f && gety(props[1].vSizes) > 0.0f);
+
+   for (UINT t = 0; t < 2; t++)
+   {
+      for (UINT k = BLADE_INTEGRATOR_HEUN; k <= BLADE_INTEGRATOR_SEMI_IMPLICIT; k++)
+      {
+         props[t].uIntegrator = k;
+         BladeSolverDiff diff = PhysPatch::CompareSolvers(props[t], 256, 120, 1.0f / 60.0f);
+         printf("   type %u, integrator %u: orientation %g rad, velocity %g\n", (t == 0) ? 1 : 3, k, diff.fMaxOrientation, diff.fMaxVelocity);
+         CHECK(diff.bFinite);
+         CHECK_BELOW(diff.fMaxOrientation, SOLVER_MAX_ORIENTATION);
+         CHECK_BELOW(diff.fMaxVelocity, SOLVER_MAX_VELOCITY);
+      }
+   }
+}
+
+GRASS_TEST(IntegratorsStayFinite)
+{
+   GrassPropsUnified props[2];
+   LoadPhysSubTypes(props);
+
+   /* a blade bent by 0.6 rad and released, 2000 steps at the game step with either solver */
+   for (UINT t = 0; t < 2; t++)
+   {
+      for (UINT k = BLADE_INTEGRATOR_HEUN; k <= BLADE_INTEGRATOR_SEMI_IMPLICIT; k++)
+      {
+         props[t].uIntegrator = k;
+         BladeRunStats stats = RunBladeToRest(props[t], 1.0f / 60.0f, 2000, 0.6f, PhysPatch::sleepVelocity);
+         printf("   type %u, integrator %u: energy %g -> %g, at rest after %u steps, %.1f ns/step\n", (t == 0) ? 1 : 3, k,
+            stats.fStartEnergy, stats.fEndEnergy, stats.uStepsToRest, stats.fNsPerStep);
+         CHECK(stats.bFinite);
+      }
+   }
+}
+
+/* energy of a released blade relative to the start energy: net gain over the run and the largest gain of one step */
+#define SOLVER_MAX_DRIFT     0.01f
+#define SOLVER_MAX_STEP_GAIN 0.02f
+
+static void CheckEnergyDrift(GrassPropsUnified& a_Props, UINT a_uType, BladeIntegrator a_Integrator, float a_fTime)
+{
+   a_Props.uIntegrator = a_Integrator;
+   BladeRunStats stats = RunBladeToRest(a_Props, a_fTime, 2000, 0.6f, PhysPatch::sleepVelocity);
+   float fDrift = (stats.fEndEnergy - stats.fStartEnergy) / max(fabsf(stats.fStartEnergy), 1e-6f);
+   printf("   type %u, integrator %u, %.0f Hz: drift %g, max step gain %g\n", a_uType, (UINT)a_Integrator, 1.0f / a_fTime, fDrift, stats.fMaxEnergyGain);
+   CHECK(stats.bFinite);
+   CHECK_BELOW(fDrift, SOLVER_MAX_DRIFT);
+   CHECK_BELOW(stats.fMaxEnergyGain, SOLVER_MAX_STEP_GAIN);
+}
+
+GRASS_TEST(IntegratorsDoNotGainEnergy)
+{
+   GrassPropsUnified props[2];
+   LoadPhysSubTypes(props);
+
+   /* both solvers at the game step, the semi-implicit one at twice the step too */
+   for (UINT t = 0; t < 2; t++)
+   {
+      UINT uType = (t == 0) ? 1 : 3;
+      CheckEnergyDrift(props[t], uType, BLADE_INTEGRATOR_HEUN, 1.0f / 60.0f);
+      CheckEnergyDrift(props[t], uType, BLADE_INTEGRATOR_SEMI_IMPLICIT, 1.0f / 60.0f);
+      CheckEnergyDrift(props[t], uType, BLADE_INTEGRATOR_SEMI_IMPLICIT, 1.0f / 30.0f);
+   }
+}
@@ -0,0 +1,49 @@
+#include "GrassTests.h"
+
+#include <cstring>
+
+static TestCase* s_pFirstCase = NULL;
+static UINT      s_uNumChecks = 0;
+static UINT      s_uNumFailed = 0;
+
+TestCase::TestCase (const char* a_sName, TestFunc a_pFunc)
+{
+   sName = a_sName;
+   pFunc = a_pFunc;
+   pNext = s_pFirstCase;
+   s_pFirstCase = this;
+}
+
+bool ReportCheck (bool a_bPassed, const char* a_sExpr, const char* a_sFile, int a_iLine)
+{
+   s_uNumChecks++;
+   if (!a_bPassed)
+   {
+      s_uNumFailed++;
+      printf("   %s(%d): failed: %s\n", a_sFile, a_iLine, a_sExpr);
+   }
+   return a_bPassed;
+}
+
+int main (int argc, char* argv[])
+{
+   const char* sFilter = (argc > 1) ? argv[1] : NULL;
+   UINT uNumTests = 0;
+   UINT uNumFailedTests = 0;
+
+   for (TestCase* pCase = s_pFirstCase; pCase; pCase = pCase->pNext)
+   {
+      if (sFilter && !strstr(pCase->sName, sFilter))
+         continue;
+
+      UINT uFailedBefore = s_uNumFailed;
+      printf("%s\n", pCase->sName);
+      pCase->pFunc();
+      uNumTests++;
+      if (s_uNumFailed != uFailedBefore)
+         uNumFailedTests++;
+   }
+
+   printf("%u tests, %u checks, %u failed checks in %u tests\n", uNumTests, s_uNumChecks, s_uNumFailed, uNumFailedTests);
+   return (s_uNumFailed == 0) ? 0 : 1;
+}